@@ -9,7 +9,7 @@
 
 enum class eBTErrorCategory
 {
-	UNINITIALISED = eErrorCategory::MAX,
+	UNINITIALISED = static_cast<int>(eErrorCategory::MAX),
 
 	ExpressionType,
 
@@ -18,7 +18,7 @@ enum class eBTErrorCategory
 
 enum class eBTErrorCode
 {
-	UNINITIALISED = eErrorCode::MAX,
+	UNINITIALISED = static_cast<int>(eErrorCode::MAX),
 
 	ConditionTypeNotBool,
 
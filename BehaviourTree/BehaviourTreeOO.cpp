@@ -118,9 +118,19 @@ namespace BehaviourTreeOO
 	 * BTConditionNode
 	 */
 
-	BTConditionNode::BTConditionNode(const char* nodeName, const char* _conditionText)
+	BTConditionNode::BTConditionNode(const char* nodeName, const char* _conditionText, eDispatchMode _dispatchMode)
 		: BTLeafNode(nodeName)
 		, conditionText(_conditionText)
+		, precompiled(nullptr)
+		, dispatchMode(_dispatchMode)
+		, expData(nullptr)
+	{}
+
+	BTConditionNode::BTConditionNode(const char* nodeName, const ExpressionPrecompiled& _precompiled, eDispatchMode _dispatchMode)
+		: BTLeafNode(nodeName)
+		, conditionText(_precompiled.text)
+		, precompiled(&_precompiled)
+		, dispatchMode(_dispatchMode)
 		, expData(nullptr)
 	{}
 
@@ -134,22 +144,37 @@ namespace BehaviourTreeOO
 
 	void BTConditionNode::compileExpressions(BTEvalContext& context)
 	{
-		ExpressionCompiler comp(context.vars->getLayout());
-		expData = comp.compile(conditionText);
+		// a table that doesn't fit the layout is compiled from its text instead
+		if (precompiled)
+		{
+			expData = loadPrecompiledExpression(*precompiled, *context.vars->getLayout());
+		}
 
-		if (comp.errors().errorCount() > 0)
+		if (!expData)
 		{
-			context.errorReporter->combine(comp.errors());
+			ExpressionCompiler comp(context.vars->getLayout());
+			expData = comp.compile(conditionText);
+
+			if (comp.errors().errorCount() > 0)
+			{
+				context.errorReporter->combine(comp.errors());
+				return;
+			}
 		}
-		else if (expData->resultType != eExpType::BOOL)
+
+		if (expData->resultType != eExpType::BOOL)
 		{
 			context.errorReporter->addError(eBTErrorCategory::ExpressionType, eBTErrorCode::ConditionTypeNotBool, "Condition node expressions must be a boolean type");
 		}
+		else
+		{
+			expData->dispatchMode = dispatchMode;
+		}
 	}
 
 	void BTConditionNode::evaluate(BTEvalContext& context) const
 	{
-		ExpressionEvaluator eval(context.vars);
+		ExpressionEvaluator eval(context.vars, eDispatchMode::PerExpression);
 		eval.evaluate(expData);
 
 		if (eval.errors().errorCount() > 0)
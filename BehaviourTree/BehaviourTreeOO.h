@@ -8,6 +8,7 @@
 #include <memory>
 
 #include "Expression.h"
+#include "ExpressionPrecompiled.h"
 #include "BTErrorReporter.h"
 
 
@@ -90,10 +91,15 @@ namespace BehaviourTreeOO
 	class BTConditionNode : public BTLeafNode
 	{
 		const char* conditionText;
+		const ExpressionPrecompiled* precompiled;	// nullptr for a condition compiled from its text
+		eDispatchMode dispatchMode;
 		ExpressionData *expData;
 
 	public:
-		BTConditionNode(const char* nodeName, const char *conditionText);
+		// dispatchMode picks the expression backend used to evaluate this condition
+		BTConditionNode(const char* nodeName, const char *conditionText, eDispatchMode dispatchMode = eDispatchMode::Switch);
+		// a condition built into the program, loaded from its table rather than compiled - see ExpressionPrecompiled.h
+		BTConditionNode(const char* nodeName, const ExpressionPrecompiled& precompiled, eDispatchMode dispatchMode = eDispatchMode::Switch);
 		virtual ~BTConditionNode();
 
 		virtual void compileExpressions(BTEvalContext& context) override;
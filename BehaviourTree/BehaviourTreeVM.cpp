@@ -343,27 +343,47 @@ namespace BehaviourTreeVM
 	 * BTConditionNode
 	 */
 
-	BTConditionNode::BTConditionNode(const char* nodeName, const char *_conditionText)
+	BTConditionNode::BTConditionNode(const char* nodeName, const char *_conditionText, eDispatchMode _dispatchMode)
 		: BTLeafNode(nodeName)
 		, conditionText(_conditionText)
+		, precompiled(nullptr)
+		, dispatchMode(_dispatchMode)
+	{}
+
+	BTConditionNode::BTConditionNode(const char* nodeName, const ExpressionPrecompiled& _precompiled, eDispatchMode _dispatchMode)
+		: BTLeafNode(nodeName)
+		, conditionText(_precompiled.text)
+		, precompiled(&_precompiled)
+		, dispatchMode(_dispatchMode)
 	{}
 
 	void BTConditionNode::compile(BTCompilerContext& context) const
 	{
-		ExpressionCompiler comp(context.getBehaviourContext()->vars->getLayout());
-		ExpressionData *exprData = comp.compile(conditionText);
+		const VariableLayout* layout = context.getBehaviourContext()->vars->getLayout();
 
-		if (comp.errors().errorCount() > 0)
+		// a table that doesn't fit the layout is compiled from its text instead
+		ExpressionData *exprData = precompiled ? loadPrecompiledExpression(*precompiled, *layout) : nullptr;
+
+		if (!exprData)
 		{
-			context.errors().combine(comp.errors());
+			ExpressionCompiler comp(layout);
+			exprData = comp.compile(conditionText);
+
+			if (comp.errors().errorCount() > 0)
+			{
+				context.errors().combine(comp.errors());
+				return;
+			}
 		}
-		else if (exprData->resultType != eExpType::BOOL)
+
+		if (exprData->resultType != eExpType::BOOL)
 		{
 			context.errors().addError(eBTErrorCategory::ExpressionType, eBTErrorCode::ConditionTypeNotBool, "Condition node expressions must be a boolean type");
 		}
 		else
 		{
 			assert(exprData);
+			exprData->dispatchMode = dispatchMode;
 
 			NodeIdx_t exprIdx = context.storeExpressionData(exprData);
 			context.emitOpcode(eBTOpcode::EVAL_EXPR, exprIdx);
@@ -504,6 +524,15 @@ namespace BehaviourTreeVM
 		, currBehaviourExec(nullptr)
 	{
 		seqCounters.resize(rtData->seqNodeCount, 0);
+
+		// one set of register banks big enough for every condition, so ticking never allocates for expressions
+		ExpressionSlotIndex maxRegCount(1);
+		for (const auto& exprData : rtData->expData)
+		{
+			maxRegCount = exprData->regCount > maxRegCount ? exprData->regCount : maxRegCount;
+		}
+		expressionRegisters.resize(maxRegCount, 0.f);
+		expressionBoolRegisters.resize(maxRegCount, 0);
 	}
 
 	void BTEvalEngine::evaluate()
@@ -511,7 +540,6 @@ namespace BehaviourTreeVM
 		errorReporter.reset();
 		
 		eBTResult result = eBTResult::Undefined;
-		ExpressionEvaluator expEval(context.vars);
 
 		const size_t codeLen(rtData->byteCode.size());
 			
@@ -551,17 +579,21 @@ namespace BehaviourTreeVM
 
 			case eBTOpcode::EVAL_EXPR:
 				{
-					expEval.reset();
-					expEval.evaluate(rtData->expData[operand].get());
+					const ExpressionResult exprResult = evaluateExpression(*rtData->expData[operand], *context.vars,
+						expressionRegisters.data(), expressionBoolRegisters.data(), expressionRegisters.size());
 
-					if (expEval.errors().errorCount() > 0)
+					if (exprResult.failed())
 					{
 						result = eBTResult::Failure;
-						errorReporter.combine(expEval.errors());
+						const bool divideByZero = exprResult.error == eErrorCode::DivideByZero;
+						errorReporter.addError(
+							static_cast<eBTErrorCategory>(divideByZero ? eErrorCategory::Math : eErrorCategory::Internal),
+							static_cast<eBTErrorCode>(exprResult.error),
+							divideByZero ? "Divide by zero error" : "Expression register file too small");
 					}
 					else
 					{
-						result = expEval.getBoolResult() ? eBTResult::Success : eBTResult::Failure;
+						result = exprResult.getBoolResult() ? eBTResult::Success : eBTResult::Failure;
 					}
 				}
 				break;
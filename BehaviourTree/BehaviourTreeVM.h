@@ -8,6 +8,7 @@
 #include <memory>
 
 #include "Expression.h"
+#include "ExpressionPrecompiled.h"
 #include "BTErrorReporter.h"
 
 
@@ -89,9 +90,14 @@ namespace BehaviourTreeVM
 	class BTConditionNode : public BTLeafNode
 	{
 		const char* conditionText;
+		const ExpressionPrecompiled* precompiled;	// nullptr for a condition compiled from its text
+		eDispatchMode dispatchMode;
 
 	public:
-		BTConditionNode(const char* nodeName, const char *conditionText);
+		// dispatchMode picks the expression backend used to evaluate this condition
+		BTConditionNode(const char* nodeName, const char *conditionText, eDispatchMode dispatchMode = eDispatchMode::Switch);
+		// a condition built into the program, loaded from its table rather than compiled - see ExpressionPrecompiled.h
+		BTConditionNode(const char* nodeName, const ExpressionPrecompiled& precompiled, eDispatchMode dispatchMode = eDispatchMode::Switch);
 
 		virtual void compile(BTCompilerContext& context) const override;
 	};
@@ -210,6 +216,8 @@ namespace BehaviourTreeVM
 		NodeIdx_t currBehaviourIdx;
 		BTBehaviourExec* currBehaviourExec;
 		std::vector<NodeIdx_t> seqCounters;
+		std::vector<float> expressionRegisters;
+		std::vector<uint8_t> expressionBoolRegisters;
 
 		static const NodeIdx_t invalidBehaviourIdx = UINT16_MAX;
 
@@ -11,6 +11,7 @@
 #include "TestRunner.h"
 
 #include "BehaviourTreeVM.h"
+#include "GeneratedFiles/BehaviourTreeConditions.inl"
 
 
 namespace BehaviourTreeVM
@@ -188,15 +189,15 @@ namespace BehaviourTreeVM
 			new BTSelectorNode("root-sel",
 				{
 					new BTSequenceNode("seq1", {
-						new BTConditionNode("cond1", "branch == 1"),
+						new BTConditionNode("cond1", conditionBranch1),
 						new BTBehaviourNode("count1", new BTBehaviourTestSpec(1)),
 					}),
 					new BTSequenceNode("seq2", {
-						new BTConditionNode("cond2", "branch == 2"),
+						new BTConditionNode("cond2", conditionBranch2, eDispatchMode::Closure),
 						new BTBehaviourNode("count2", new BTBehaviourTestSpec(2)),
 					}),
 					new BTSequenceNode("seq3", {
-						new BTConditionNode("cond3", "branch == 3"),
+						new BTConditionNode("cond3", conditionBranch3, eDispatchMode::Threaded),
 						new BTBehaviourNode("count3", new BTBehaviourTestSpec(3)),
 					}),
 				}
@@ -1,7 +0,0 @@
-/*
- * Unit tests for the Expresion system
- */
-
-#pragma once
-
-int runExpressionTests();
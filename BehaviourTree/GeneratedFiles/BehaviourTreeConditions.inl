@@ -0,0 +1,85 @@
+/*
+ * Precompiled expressions, see ExpressionPrecompiled.h. Generated by the precompiler from its spec
+ * at build time - edit the spec rather than this.
+ */
+
+// branch == 1
+static const uint32_t conditionBranch1_byteCode[] =
+{
+	0x01190000u, 0x00000000u,
+};
+static const uint32_t conditionBranch1_constFloats[] =
+{
+	0x3f800000u,
+};
+static const ExpressionPrecompiledVariable conditionBranch1_inputs[] =
+{
+	{ "branch", eExpType::NUMBER, 0, 0xff800000u, 0x7f800000u, false },
+};
+static const ExpressionPrecompiled conditionBranch1 =
+{
+	"branch == 1",
+	545, eExpType::BOOL, 1, false,
+	conditionBranch1_byteCode, 2,
+	conditionBranch1_constFloats, 1,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	conditionBranch1_inputs, 1,
+};
+
+// branch == 2
+static const uint32_t conditionBranch2_byteCode[] =
+{
+	0x01190000u, 0x00000000u,
+};
+static const uint32_t conditionBranch2_constFloats[] =
+{
+	0x40000000u,
+};
+static const ExpressionPrecompiledVariable conditionBranch2_inputs[] =
+{
+	{ "branch", eExpType::NUMBER, 0, 0xff800000u, 0x7f800000u, false },
+};
+static const ExpressionPrecompiled conditionBranch2 =
+{
+	"branch == 2",
+	545, eExpType::BOOL, 1, false,
+	conditionBranch2_byteCode, 2,
+	conditionBranch2_constFloats, 1,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	conditionBranch2_inputs, 1,
+};
+
+// branch == 3
+static const uint32_t conditionBranch3_byteCode[] =
+{
+	0x01190000u, 0x00000000u,
+};
+static const uint32_t conditionBranch3_constFloats[] =
+{
+	0x40400000u,
+};
+static const ExpressionPrecompiledVariable conditionBranch3_inputs[] =
+{
+	{ "branch", eExpType::NUMBER, 0, 0xff800000u, 0x7f800000u, false },
+};
+static const ExpressionPrecompiled conditionBranch3 =
+{
+	"branch == 3",
+	545, eExpType::BOOL, 1, false,
+	conditionBranch3_byteCode, 2,
+	conditionBranch3_constFloats, 1,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	conditionBranch3_inputs, 1,
+};
@@ -7,6 +7,7 @@
 #include <string.h>
 
 #include "ExpressionTests.h"
+#include "ExpressionBenchmarks.h"
 #include "BehaviourTreeTests.h"
 
  
@@ -26,5 +27,10 @@ int main(int argc, char* argv[])
 		return 0;
 	}
 
+	if (argc >= 2 && _stricmp(argv[1], "bench") == 0)
+	{
+		return runExpressionBenchmarks();
+	}
+
     return 10;
 }
\ No newline at end of file
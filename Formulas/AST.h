@@ -34,7 +34,12 @@ enum class eASTNodeType
 	ARITH_DIV,
 	ARITH_MOD,
 
+	SELECT,
+	IN_SET,
+	IN_RANGE,		// made by the interval fusion pass, never by the parser
+
 	IDENT,
+	SHARED_VALUE,
 
 	NODE_TYPE_MAX
 };
@@ -50,6 +55,12 @@ ASTNode *createConstNode(float _value);
 ASTNode *createConstNode(bool _value);
 ASTNode *createConstNode(const char *_value);
 ASTNode *createIDNode(const char *_id);
+ASTNode *createSelectNode(ASTNode* _condition, ASTNode* _ifTrue, ASTNode* _ifFalse);
+
+// value in (member, ...) - the parser builds the member list first and then attaches the value to it
+ASTNode *createSetNode(ASTNode* _firstMember);
+ASTNode *addSetMember(ASTNode* _set, ASTNode* _member);
+ASTNode *createInNode(ASTNode* _value, ASTNode* _set);
 
 void freeNode(ASTNode *node);
 
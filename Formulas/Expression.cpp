@@ -8,11 +8,22 @@
 
 #include "stdafx.h"
 
+#include <algorithm>
+#include <cmath>
 #include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include "Expression.h"
+#include "ExpressionBytecode.h"
+#include "ExpressionClosure.h"
+#include "ExpressionJIT.h"
+#include "ExpressionNetwork.h"
+#include "ExpressionProfile.h"
 #include "Name.h"
 
 
@@ -66,153 +77,9 @@ const char *getTypeAsString(eExpType type)
 
 
 /* 
- * Bytecode values
+ * Bytecode encoding - see ExpressionBytecode.h for the opcode values
  */
 
-#define LEFT_REG_BITS    0x00
-#define LEFT_CONST_BITS  0x04 // 0b00000100
-#define LEFT_VAR_BITS    0x08 // 0b00001000
-#define RIGHT_REG_BITS   0x00
-#define RIGHT_CONST_BITS 0x01 // 0b00000001
-#define RIGHT_VAR_BITS   0x02 // 0b00000010
-
-#define OP_FLAG_BITS 4
-#define OPCODE(OP,LEFT,RIGHT) ((((uint8_t)OP)<<(OP_FLAG_BITS))|(LEFT)|(RIGHT))
-
-
-enum class eSimpleOp : uint8_t
-{
-	UNINITIALISED,
-
-	ADD,
-	SUB,
-	MUL,
-	DIV,
-	MOD,
-
-	AND,
-	OR,
-	XOR,
-	NOT,
-
-	NAME_EQ,
-	NAME_NEQ,
-	BOOL_EQ,
-	NUM_EQ,
-	NUM_NEQ,
-	NUM_LT,
-	NUM_GT,
-	NUM_LTEQ,
-	NUM_GTEQ,
-
-	NUM_VAL,
-	BOOL_VAL
-};
-
-
-enum class eEncOpcode : uint16_t
-{
-	UNINITIALISED = eSimpleOp::UNINITIALISED,
-
-	// Arithmetic (Numeric)
-	ADD			= OPCODE(eSimpleOp::ADD,LEFT_REG_BITS,  RIGHT_REG_BITS),
-	ADD_LC		= OPCODE(eSimpleOp::ADD,LEFT_CONST_BITS,RIGHT_REG_BITS),
-	ADD_LV		= OPCODE(eSimpleOp::ADD,LEFT_VAR_BITS,  RIGHT_REG_BITS),
-	ADD_LV_RV	= OPCODE(eSimpleOp::ADD,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
-	ADD_LC_RV   = OPCODE(eSimpleOp::ADD,LEFT_CONST_BITS,RIGHT_VAR_BITS),
-
-	SUB			= OPCODE(eSimpleOp::SUB,LEFT_REG_BITS,  RIGHT_REG_BITS),
-	SUB_LC		= OPCODE(eSimpleOp::SUB,LEFT_CONST_BITS,RIGHT_REG_BITS),
-	SUB_LV		= OPCODE(eSimpleOp::SUB,LEFT_VAR_BITS,  RIGHT_REG_BITS),
-	SUB_RC		= OPCODE(eSimpleOp::SUB,LEFT_REG_BITS,  RIGHT_CONST_BITS),
-	SUB_RV		= OPCODE(eSimpleOp::SUB,LEFT_REG_BITS,  RIGHT_VAR_BITS),
-	SUB_LC_RV	= OPCODE(eSimpleOp::SUB,LEFT_CONST_BITS,RIGHT_VAR_BITS),
-	SUB_LV_RC	= OPCODE(eSimpleOp::SUB,LEFT_VAR_BITS,  RIGHT_CONST_BITS),
-	SUB_LV_RV	= OPCODE(eSimpleOp::SUB,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
-	
-	MUL			= OPCODE(eSimpleOp::MUL,LEFT_REG_BITS,  RIGHT_REG_BITS),
-	MUL_LC		= OPCODE(eSimpleOp::MUL,LEFT_CONST_BITS,RIGHT_REG_BITS),
-	MUL_LV		= OPCODE(eSimpleOp::MUL,LEFT_VAR_BITS,  RIGHT_REG_BITS),
-	MUL_LV_RV	= OPCODE(eSimpleOp::MUL,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
-	MUL_LC_RV	= OPCODE(eSimpleOp::MUL,LEFT_CONST_BITS,RIGHT_VAR_BITS),
-
-	DIV			= OPCODE(eSimpleOp::DIV,LEFT_REG_BITS,  RIGHT_REG_BITS),
-	DIV_LC		= OPCODE(eSimpleOp::DIV,LEFT_CONST_BITS,RIGHT_REG_BITS),
-	DIV_LV		= OPCODE(eSimpleOp::DIV,LEFT_VAR_BITS,  RIGHT_REG_BITS),
-	DIV_RC		= OPCODE(eSimpleOp::DIV,LEFT_REG_BITS,  RIGHT_CONST_BITS),
-	DIV_RV		= OPCODE(eSimpleOp::DIV,LEFT_REG_BITS,  RIGHT_VAR_BITS),
-	DIV_LC_RV	= OPCODE(eSimpleOp::DIV,LEFT_CONST_BITS,RIGHT_VAR_BITS),
-	DIV_LV_RC	= OPCODE(eSimpleOp::DIV,LEFT_VAR_BITS,  RIGHT_CONST_BITS),
-	DIV_LV_RV	= OPCODE(eSimpleOp::DIV,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
-
-	MOD			= OPCODE(eSimpleOp::MOD,LEFT_REG_BITS,  RIGHT_REG_BITS),
-	MOD_LC		= OPCODE(eSimpleOp::MOD,LEFT_CONST_BITS,RIGHT_REG_BITS),
-	MOD_LV		= OPCODE(eSimpleOp::MOD,LEFT_VAR_BITS,  RIGHT_REG_BITS),
-	MOD_RC		= OPCODE(eSimpleOp::MOD,LEFT_REG_BITS,  RIGHT_CONST_BITS),
-	MOD_RV		= OPCODE(eSimpleOp::MOD,LEFT_REG_BITS,  RIGHT_VAR_BITS),
-	MOD_LC_RV	= OPCODE(eSimpleOp::MOD,LEFT_CONST_BITS,RIGHT_VAR_BITS),
-	MOD_LV_RC	= OPCODE(eSimpleOp::MOD,LEFT_VAR_BITS,  RIGHT_CONST_BITS),
-	MOD_LV_RV	= OPCODE(eSimpleOp::MOD,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
-
-	// Logic (Boolean)
-	AND			= OPCODE(eSimpleOp::AND,LEFT_REG_BITS,  RIGHT_REG_BITS),
-	OR			= OPCODE(eSimpleOp::OR,LEFT_REG_BITS,  RIGHT_REG_BITS),
-	XOR			= OPCODE(eSimpleOp::XOR,LEFT_REG_BITS, RIGHT_REG_BITS),
-	NOT			= OPCODE(eSimpleOp::NOT,LEFT_REG_BITS, RIGHT_REG_BITS), // right not used
-
-	// Comparison (Names)
-	NAME_EQ_LC_RV  = OPCODE(eSimpleOp::NAME_EQ ,LEFT_CONST_BITS,RIGHT_VAR_BITS),
-	NAME_EQ_LV_RV  = OPCODE(eSimpleOp::NAME_EQ ,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
-	NAME_NEQ_LC_RV = OPCODE(eSimpleOp::NAME_NEQ,LEFT_CONST_BITS,RIGHT_VAR_BITS),
-	NAME_NEQ_LV_RV = OPCODE(eSimpleOp::NAME_NEQ,LEFT_VAR_BITS  ,RIGHT_VAR_BITS),
-
-	// Comparison (Boolean)	[NEQ is handled by XOR]
-	BOOL_EQ		  = OPCODE(eSimpleOp::BOOL_EQ ,LEFT_REG_BITS,RIGHT_REG_BITS),
-
-	// Comparison (Numeric)
-	NUM_EQ			= OPCODE(eSimpleOp::NUM_EQ,  LEFT_REG_BITS,  RIGHT_REG_BITS),
-	NUM_EQ_LC		= OPCODE(eSimpleOp::NUM_EQ,  LEFT_CONST_BITS,RIGHT_REG_BITS),
-	NUM_EQ_LV		= OPCODE(eSimpleOp::NUM_EQ,  LEFT_VAR_BITS,  RIGHT_REG_BITS),
-	NUM_EQ_LV_RV	= OPCODE(eSimpleOp::NUM_EQ,  LEFT_VAR_BITS,  RIGHT_VAR_BITS),
-	NUM_EQ_LV_RC	= OPCODE(eSimpleOp::NUM_EQ,  LEFT_VAR_BITS,  RIGHT_CONST_BITS),
-
-	NUM_NEQ			= OPCODE(eSimpleOp::NUM_NEQ,  LEFT_REG_BITS,  RIGHT_REG_BITS),
-	NUM_NEQ_LC		= OPCODE(eSimpleOp::NUM_NEQ,  LEFT_CONST_BITS,RIGHT_REG_BITS),
-	NUM_NEQ_LV		= OPCODE(eSimpleOp::NUM_NEQ,  LEFT_VAR_BITS,  RIGHT_REG_BITS),
-	NUM_NEQ_LV_RV	= OPCODE(eSimpleOp::NUM_NEQ,  LEFT_VAR_BITS,  RIGHT_VAR_BITS),
-	NUM_NEQ_LV_RC	= OPCODE(eSimpleOp::NUM_NEQ,  LEFT_VAR_BITS,  RIGHT_CONST_BITS),
-
-	NUM_LT			= OPCODE(eSimpleOp::NUM_LT,  LEFT_REG_BITS,  RIGHT_REG_BITS),
-	NUM_LT_LC		= OPCODE(eSimpleOp::NUM_LT,  LEFT_CONST_BITS,RIGHT_REG_BITS),
-	NUM_LT_LV		= OPCODE(eSimpleOp::NUM_LT,  LEFT_VAR_BITS,  RIGHT_REG_BITS),
-	NUM_LT_LV_RV	= OPCODE(eSimpleOp::NUM_LT,  LEFT_VAR_BITS,  RIGHT_VAR_BITS),
-	NUM_LT_LV_RC	= OPCODE(eSimpleOp::NUM_LT,  LEFT_VAR_BITS,  RIGHT_CONST_BITS),
-
-	NUM_GT			= OPCODE(eSimpleOp::NUM_GT,  LEFT_REG_BITS,  RIGHT_REG_BITS),
-	NUM_GT_LC		= OPCODE(eSimpleOp::NUM_GT,  LEFT_CONST_BITS,RIGHT_REG_BITS),
-	NUM_GT_LV		= OPCODE(eSimpleOp::NUM_GT,  LEFT_VAR_BITS,  RIGHT_REG_BITS),
-	NUM_GT_LV_RV	= OPCODE(eSimpleOp::NUM_GT,  LEFT_VAR_BITS,  RIGHT_VAR_BITS),
-	NUM_GT_LV_RC	= OPCODE(eSimpleOp::NUM_GT,  LEFT_VAR_BITS,  RIGHT_CONST_BITS),
-
-	NUM_LTEQ		= OPCODE(eSimpleOp::NUM_LTEQ,LEFT_REG_BITS,  RIGHT_REG_BITS),
-	NUM_LTEQ_LC		= OPCODE(eSimpleOp::NUM_LTEQ,LEFT_CONST_BITS,RIGHT_REG_BITS),
-	NUM_LTEQ_LV		= OPCODE(eSimpleOp::NUM_LTEQ,LEFT_VAR_BITS,  RIGHT_REG_BITS),
-	NUM_LTEQ_LV_RV	= OPCODE(eSimpleOp::NUM_LTEQ,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
-	NUM_LTEQ_LV_RC	= OPCODE(eSimpleOp::NUM_LTEQ,LEFT_VAR_BITS,  RIGHT_CONST_BITS),
-
-	NUM_GTEQ		= OPCODE(eSimpleOp::NUM_GTEQ,LEFT_REG_BITS,  RIGHT_REG_BITS),
-	NUM_GTEQ_LC		= OPCODE(eSimpleOp::NUM_GTEQ,LEFT_CONST_BITS,RIGHT_REG_BITS),
-	NUM_GTEQ_LV		= OPCODE(eSimpleOp::NUM_GTEQ,LEFT_VAR_BITS,  RIGHT_REG_BITS),
-	NUM_GTEQ_LV_RV	= OPCODE(eSimpleOp::NUM_GTEQ,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
-	NUM_GTEQ_LV_RC	= OPCODE(eSimpleOp::NUM_GTEQ,LEFT_VAR_BITS,  RIGHT_CONST_BITS),
-
-	// Value operations (for const expressions)
-	NUM_VAL_LC		= OPCODE(eSimpleOp::NUM_VAL, LEFT_CONST_BITS,RIGHT_CONST_BITS),
-	BOOL_VAL_LC     = OPCODE(eSimpleOp::BOOL_VAL,LEFT_CONST_BITS,RIGHT_CONST_BITS),
-
-	OPCODE_MAX
-};
-
 inline eEncOpcode encodeOp(eSimpleOp simpleOp, eResultSource leftSource, eResultSource rightSource)
 {
 	uint8_t left, right;
@@ -254,12 +121,105 @@ public:
 	ExpressionSlotIndex addNumericConst(float value);
 	ExpressionSlotIndex addNameConst(Name value);
 
+	// adds the members of an in test, already sorted, and returns the set's index
+	ExpressionSlotIndex addNumberSet(const std::vector<float>& members);
+	ExpressionSlotIndex addNameSet(const std::vector<Name>& members);
+
+	// adds the bounds of a range test, each a constant or a variable, and returns the range's index
+	ExpressionSlotIndex addRange(const ResultInfo& low, const ResultInfo& high);
+
+	// records a variable the expression reads, see ExpressionData::numberInputs
+	void addInput(eExpType type, ExpressionSlotIndex slotIndex);
+
+	// whether / and % that can divide by zero are emitted as the non-trapping IEEE opcodes
+	void setIeeeDivide(bool ieeeDivide) { data->ieeeDivide = ieeeDivide; }
+	bool isIeeeDivide() const { return data->ieeeDivide; }
+
 	void emitInstr(eEncOpcode opcode, ExpressionSlotIndex resultReg, ExpressionSlotIndex leftOperand, ExpressionSlotIndex rightOperand);
 
+	// emits a forward jump and returns its instruction index, patchJump() then points it at the next instruction emitted
+	uint32_t emitJump(eEncOpcode opcode, ExpressionSlotIndex conditionReg);
+	void patchJump(uint32_t jumpIndex);
+
 	ExpressionData *getData();
 };
 
 
+/*
+ * SubexpressionSharing
+ *
+ * State for common subexpression elimination. Structurally equal subtrees are given the same value
+ * number, and a subtree whose value has already been computed by the time it runs is replaced with
+ * a read of the register holding it. Each shared value gets a register above the working registers,
+ * held from the instruction computing it to the last one reading it.
+ */
+
+class ASTNodeNonLeaf;
+
+class SubexpressionSharing
+{
+	struct Definition
+	{
+		ASTNodeNonLeaf *node;
+		std::vector<const ASTNode*> guards;
+	};
+
+	std::unordered_map<std::string, uint32_t> valueNumbers;
+	std::unordered_multimap<uint32_t, Definition> definitions;
+	std::vector<bool> registerInUse;
+
+public:
+	// the && and || nodes whose right side is being walked, and the ?: sides - code inside them may be
+	// jumped over
+	std::vector<const ASTNode*> guards;
+
+	uint32_t firstRegister;
+	uint32_t maxRegister;
+
+	SubexpressionSharing()
+		: firstRegister(0)
+		, maxRegister(0)
+	{}
+
+	uint32_t getValueNumber(const std::string& key);
+
+	void addDefinition(ASTNodeNonLeaf *node, uint32_t valueNumber);
+	ASTNodeNonLeaf* findDefinition(uint32_t valueNumber) const;
+
+	uint32_t acquireRegister();
+	void releaseRegister(uint32_t reg);
+};
+
+
+/*
+ * RangeAnalysis
+ *
+ * State for the value range pass. The right side of a && only runs once the left has come out true,
+ * and of a || once it has come out false, so while it is walked any comparison of a number variable
+ * with a constant on the left narrows that variable's range. A range covers every value a subtree can
+ * have except NaN - NaN is never zero and stays NaN through the arithmetic, so it can't make a divisor
+ * the analysis has cleared fail.
+ */
+
+class RangeAnalysis
+{
+	struct Fact
+	{
+		ExpressionSlotIndex slotIndex;
+		ValueRange range;
+	};
+
+	std::vector<Fact> facts;
+
+public:
+	uint32_t getFactCount() const { return static_cast<uint32_t>(facts.size()); }
+	void addFact(ExpressionSlotIndex slotIndex, const ValueRange& range);
+	void removeFacts(uint32_t factCount);	// back to what was known when getFactCount() returned factCount
+
+	ValueRange getVariableRange(ExpressionSlotIndex slotIndex, const ValueRange& declaredRange) const;
+};
+
+
 /*
  * Node classes
  *
@@ -283,12 +243,26 @@ public:
 	virtual ~ASTNode() {};
 
 	virtual bool typeCheck(const VariableLayout& varLayout, ExpressionErrorReporter& reporter) = 0;
+	virtual void bindConstants(ASTNode **parentPointerToThis, const ExpressionBindings& bindings) {}	// after typeCheck, before constFold
 	virtual bool constFold(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter);
+	virtual bool simplify(ASTNode **parentPointerToThis, const ExpressionCompileOptions& options, ExpressionErrorReporter& reporter) { return true; }
+	virtual void fuseIntervals(ASTNode **parentPointerToThis) {}
+	virtual uint32_t numberValues(SubexpressionSharing& sharing) = 0;
+	virtual void shareSubexpressions(ASTNode **parentPointerToThis, SubexpressionSharing& sharing) {}
+	virtual bool containsSharedDefinition() const { return false; }
 	virtual void gatherConsts(ExpressionDataWriter& writer) {};
+	virtual uint32_t labelRegisterNeed() { return 0; }
 	virtual void allocateRegisters(uint32_t useRegister, uint32_t& maxRegister) {};
+	virtual void allocateSharedRegisters(SubexpressionSharing& sharing) {}
+	virtual void releaseSharedRegister(SubexpressionSharing& sharing) {}
+	virtual void holdSharedResult() {}	// keeps the result in its shared register to the end of the program
+	virtual ValueRange analyseRanges(RangeAnalysis& analysis) { return ValueRange(); }	// range of a number subtree
+	virtual void addFacts(bool outcome, RangeAnalysis& analysis) const {}	// what this condition coming out as outcome says about variables
 	virtual void generateCode(ExpressionDataWriter& writer) = 0;
+	virtual ExpressionClosureBuilder::Value lowerToClosure(ExpressionClosureBuilder& builder) const = 0;
 
 	virtual bool isConstant() const = 0;
+	virtual bool canFail() const { return false; }	// true if evaluating this subtree can divide by zero
 	virtual ResultInfo getResultInfo() const = 0;
 	eASTNodeType nodeType() const { return NodeType; }
 	eExpType exprType() const { return ExprType; }
@@ -299,9 +273,23 @@ public:
 
 class ASTNodeNonLeaf : public ASTNode
 {
+	friend class ASTNodeInSet;		// takes the variable out of the == tests it merges
+	friend class ASTNodeInRange;	// and the variable and bounds out of the comparisons it fuses
+
 protected:
 	ASTNode *leftChild, *rightChild;
 	uint32_t resultRegister;
+	uint32_t registerNeed;		// registers needed to evaluate this subtree (Sethi-Ullman number)
+	bool rightFirst;			// evaluate the right child first because it needs more registers
+	uint32_t valueNumber;		// equal for structurally equal subtrees
+	uint32_t sharedUses;		// later copies of this subtree that read its result instead
+	uint32_t sharedUsesLeft;	// uses not yet reached while allocating shared registers
+
+	virtual bool mayEvaluateRightFirst() const { return true; }
+	virtual void simplifyThisNode(ASTNode **parentPointerToThis, const ExpressionCompileOptions& options) {}
+	virtual void fuseIntervalsThisNode(ASTNode **parentPointerToThis) {}
+	void replaceWithChild(ASTNode **parentPointerToThis, ASTNode *&child);
+	void generateChildCode(ExpressionDataWriter& writer);
 
 public:
 	ASTNodeNonLeaf(eASTNodeType _nodeType, ASTNode *_leftChild, ASTNode *_rightChild)
@@ -309,16 +297,37 @@ public:
 		, leftChild(_leftChild)
 		, rightChild(_rightChild)
 		, resultRegister(UINT32_MAX)
+		, registerNeed(0)
+		, rightFirst(false)
+		, valueNumber(0)
+		, sharedUses(0)
+		, sharedUsesLeft(0)
 	{}
 	virtual ~ASTNodeNonLeaf();
 
 	virtual bool isConstant() const override { return false; }
+	virtual bool canFail() const override;
+	virtual void bindConstants(ASTNode **parentPointerToThis, const ExpressionBindings& bindings) override;
 	virtual bool constFold(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter) override;
+	virtual bool simplify(ASTNode **parentPointerToThis, const ExpressionCompileOptions& options, ExpressionErrorReporter& reporter) override;
+	virtual void fuseIntervals(ASTNode **parentPointerToThis) override;
+	virtual uint32_t numberValues(SubexpressionSharing& sharing) override;
+	virtual void shareSubexpressions(ASTNode **parentPointerToThis, SubexpressionSharing& sharing) override;
+	virtual bool containsSharedDefinition() const override;
 	virtual void gatherConsts(ExpressionDataWriter& writer) override;
+	virtual uint32_t labelRegisterNeed() override;
 	virtual void allocateRegisters(uint32_t useRegister, uint32_t& maxRegister) override;
+	virtual void allocateSharedRegisters(SubexpressionSharing& sharing) override;
+	virtual ValueRange analyseRanges(RangeAnalysis& analysis) override;
+	virtual ExpressionClosureBuilder::Value lowerToClosure(ExpressionClosureBuilder& builder) const override;
 
 	virtual ResultInfo getResultInfo() const override;
 
+	virtual void holdSharedResult() override { addSharedUse(); }
+
+	void addSharedUse() { ++sharedUses; }
+	void releaseSharedUse(SubexpressionSharing& sharing);
+
 	//ASTNode *leftChild() const { return leftChild; }
 	//ASTNode *rightChild() const { return rightChild; }
 };
@@ -351,8 +360,11 @@ public:
 		ExprType = eExpType::NUMBER;
 	}
 
+	virtual uint32_t numberValues(SubexpressionSharing& sharing) override;
 	virtual void gatherConsts(ExpressionDataWriter& writer) override;
+	virtual ValueRange analyseRanges(RangeAnalysis& analysis) override { return value != value ? ValueRange() : ValueRange(value, value); }
 	virtual ResultInfo getResultInfo() const override;
+	virtual ExpressionClosureBuilder::Value lowerToClosure(ExpressionClosureBuilder& builder) const override;
 
 	float getValue() const { return value; }
 };
@@ -372,8 +384,10 @@ public:
 		ExprType = eExpType::NAME;
 	}
 
+	virtual uint32_t numberValues(SubexpressionSharing& sharing) override;
 	virtual void gatherConsts(ExpressionDataWriter& writer) override;
 	virtual ResultInfo getResultInfo() const override;
+	virtual ExpressionClosureBuilder::Value lowerToClosure(ExpressionClosureBuilder& builder) const override;
 
 	Name getValue() const { return value; }
 };
@@ -391,7 +405,9 @@ public:
 		ExprType = eExpType::BOOL;
 	}
 
+	virtual uint32_t numberValues(SubexpressionSharing& sharing) override;
 	virtual ResultInfo getResultInfo() const override;
+	virtual ExpressionClosureBuilder::Value lowerToClosure(ExpressionClosureBuilder& builder) const override;
 
 	bool getValue() const { return value; }
 };
@@ -400,14 +416,30 @@ public:
 
 class ASTNodeLogic : public ASTNodeNonLeaf
 {
+	// Replaces the last two tests of a chain of this node's operation with merged. A chain leans left, so
+	// they are the right child and either the left child or, if that is the same operation, its right child.
+	void replaceLastTests(ASTNode **parentPointerToThis, ASTNode *&leftTest, ASTNode *merged);
+	ASTNode*& getTestBeforeRight();
+
 public:
 	ASTNodeLogic(eASTNodeType _nodeType, ASTNode *_leftChild, ASTNode *_rightChild)
 		: ASTNodeNonLeaf(_nodeType, _leftChild, _rightChild)
 	{}
 
+	// for nodes made by the const folder after type checking has run
+	static ASTNodeLogic* createTyped(eASTNodeType _nodeType, ASTNode *_leftChild, ASTNode *_rightChild);
+
 	virtual bool typeCheck(const VariableLayout& varLayout, ExpressionErrorReporter& reporter) override;
 	virtual bool constFoldThisNode(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter);
+	virtual ValueRange analyseRanges(RangeAnalysis& analysis) override;
+	virtual void addFacts(bool outcome, RangeAnalysis& analysis) const override;
 	virtual void generateCode(ExpressionDataWriter& writer) override;
+
+protected:
+	// the left side of && and || has to run first so that it can skip the right side
+	virtual bool mayEvaluateRightFirst() const override { return false; }
+	virtual void simplifyThisNode(ASTNode **parentPointerToThis, const ExpressionCompileOptions& options) override;
+	virtual void fuseIntervalsThisNode(ASTNode **parentPointerToThis) override;
 };
 
 
@@ -418,22 +450,179 @@ public:
 		: ASTNodeNonLeaf(_nodeType, _leftChild, _rightChild)
 	{}
 
+	// for nodes made by the const folder after type checking has run
+	static ASTNodeComp* createTyped(eASTNodeType _nodeType, ASTNode *_leftChild, ASTNode *_rightChild);
+
 	virtual bool typeCheck(const VariableLayout& varLayout, ExpressionErrorReporter& reporter) override;
 	virtual bool constFoldThisNode(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter);
+	virtual void addFacts(bool outcome, RangeAnalysis& analysis) const override;
 	virtual void generateCode(ExpressionDataWriter& writer) override;
 };
 
 
 class ASTNodeArith : public ASTNodeNonLeaf
 {
+	// An ADD, SUB or MUL with exactly one constant side, seen as sign * term + constant (or term * constant)
+	struct ConstantChain
+	{
+		ASTNode **term;
+		float sign;
+		float constant;
+	};
+
+	bool getConstantChain(ConstantChain& chain);
+	void foldConstantChain(ASTNode **parentPointerToThis);
+
+	bool divisorNonZero;	// set by the range analysis for a / or % that doesn't need its divide by zero check
+	bool keepProducts;		// part of a / or % that mustn't be simplified into dividing by a constant 0
+
+	void markKeepProducts(ASTNode *node) const;
+
 public:
 	ASTNodeArith(eASTNodeType _nodeType, ASTNode *_leftChild, ASTNode *_rightChild)
 		: ASTNodeNonLeaf(_nodeType, _leftChild, _rightChild)
+		, divisorNonZero(false)
+		, keepProducts(false)
+	{}
+
+	// for nodes made by the simplifier after type checking has run
+	static ASTNodeArith* createTyped(eASTNodeType _nodeType, ASTNode *_leftChild, ASTNode *_rightChild);
+
+	virtual bool typeCheck(const VariableLayout& varLayout, ExpressionErrorReporter& reporter) override;
+	virtual bool constFoldThisNode(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter);
+	virtual bool simplify(ASTNode **parentPointerToThis, const ExpressionCompileOptions& options, ExpressionErrorReporter& reporter) override;
+	virtual bool canFail() const override;
+	virtual ValueRange analyseRanges(RangeAnalysis& analysis) override;
+	virtual void generateCode(ExpressionDataWriter& writer) override;
+
+protected:
+	virtual void simplifyThisNode(ASTNode **parentPointerToThis, const ExpressionCompileOptions& options) override;
+};
+
+
+// cond ? ifTrue : ifFalse. Both sides are normally computed and the SELECT instruction picks one, so
+// the left child is the value if the condition is true and the right child the value if it's false.
+class ASTNodeSelect : public ASTNodeNonLeaf
+{
+	ASTNode *condition;
+	bool ifTrueNeedsRegister;	// the false side then starts one register further up
+
+public:
+	ASTNodeSelect(ASTNode *_condition, ASTNode *_ifTrue, ASTNode *_ifFalse)
+		: ASTNodeNonLeaf(eASTNodeType::SELECT, _ifTrue, _ifFalse)
+		, condition(_condition)
+		, ifTrueNeedsRegister(false)
+	{}
+	virtual ~ASTNodeSelect();
+
+	virtual bool typeCheck(const VariableLayout& varLayout, ExpressionErrorReporter& reporter) override;
+	virtual void bindConstants(ASTNode **parentPointerToThis, const ExpressionBindings& bindings) override;
+	virtual bool constFold(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter) override;
+	virtual bool constFoldThisNode(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter);
+	virtual bool simplify(ASTNode **parentPointerToThis, const ExpressionCompileOptions& options, ExpressionErrorReporter& reporter) override;
+	virtual void fuseIntervals(ASTNode **parentPointerToThis) override;
+	virtual bool canFail() const override;
+	virtual uint32_t numberValues(SubexpressionSharing& sharing) override;
+	virtual void shareSubexpressions(ASTNode **parentPointerToThis, SubexpressionSharing& sharing) override;
+	virtual bool containsSharedDefinition() const override;
+	virtual void gatherConsts(ExpressionDataWriter& writer) override;
+	virtual uint32_t labelRegisterNeed() override;
+	virtual void allocateRegisters(uint32_t useRegister, uint32_t& maxRegister) override;
+	virtual void allocateSharedRegisters(SubexpressionSharing& sharing) override;
+	virtual ValueRange analyseRanges(RangeAnalysis& analysis) override;
+	virtual void generateCode(ExpressionDataWriter& writer) override;
+	virtual ExpressionClosureBuilder::Value lowerToClosure(ExpressionClosureBuilder& builder) const override;
+};
+
+
+// value in (member, ...). The members must fold to constants of the value's type, and are kept sorted
+// without repeats so that the whole test is one NUM_IN_SET or NAME_IN_SET instruction searching them.
+// The left child is the value, there is no right child.
+class ASTNodeInSet : public ASTNodeNonLeaf
+{
+	std::vector<ASTNode*> memberNodes;	// as parsed, until constFold turns them into numbers or names
+	std::vector<float> numbers;
+	std::vector<Name> names;
+	ExpressionSlotIndex setIndex;
+
+	// the slot holding the variable of x == constant, constant == x or x in (...), otherwise nullptr
+	static ASTNode** getTestedVariable(ASTNode *test);
+
+	void addNumber(float number);
+	void addName(Name name);
+	void addMembersOf(const ASTNode *test);
+	uint32_t getMemberCount() const { return static_cast<uint32_t>(leftChild->exprType() == eExpType::NAME ? names.size() : numbers.size()); }
+
+public:
+	ASTNodeInSet()
+		: ASTNodeNonLeaf(eASTNodeType::IN_SET, nullptr, nullptr)
+		, setIndex(EXP_SLOT_INDEX_MAX)
 	{}
+	virtual ~ASTNodeInSet();
+
+	void addMemberNode(ASTNode *member) { memberNodes.push_back(member); }
+	void setValue(ASTNode *value) { leftChild = value; }
+
+	// Merges two type checked tests of the same variable, each an == with a constant or an in test, into
+	// one set - x == a || x in (b, c) -> x in (a, b, c). The variable is taken from left. Returns nullptr,
+	// leaving both alone, if they don't test the same variable.
+	static ASTNodeInSet* mergeTests(ASTNode *left, ASTNode *right);
 
 	virtual bool typeCheck(const VariableLayout& varLayout, ExpressionErrorReporter& reporter) override;
+	virtual void bindConstants(ASTNode **parentPointerToThis, const ExpressionBindings& bindings) override;
+	virtual bool constFold(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter) override;
 	virtual bool constFoldThisNode(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter);
+	virtual uint32_t numberValues(SubexpressionSharing& sharing) override;
+	virtual void gatherConsts(ExpressionDataWriter& writer) override;
+	virtual void addFacts(bool outcome, RangeAnalysis& analysis) const override;
+	virtual void generateCode(ExpressionDataWriter& writer) override;
+	virtual ExpressionClosureBuilder::Value lowerToClosure(ExpressionClosureBuilder& builder) const override;
+};
+
+
+// lo <= x < hi and the like, fused from a && of a lower and an upper bound comparison on the same
+// variable. The left child is the variable, there is no right child, and each bound is a constant or a
+// variable - the whole test is one NUM_IN_RANGE instruction.
+class ASTNodeInRange : public ASTNodeNonLeaf
+{
+	ASTNode *low, *high;
+	bool lowClosed, highClosed;
+	ExpressionSlotIndex rangeIndex;
+
+	// one comparison read as a bound on a variable, turned round to put the variable on the left
+	struct Bound
+	{
+		ASTNode **variable;
+		ASTNode **bound;
+		bool isLow;
+		bool closed;
+	};
+
+	static bool readBound(ASTNode *test, Name variableName, Bound& bound);
+
+public:
+	ASTNodeInRange(ASTNode *_value, ASTNode *_low, bool _lowClosed, ASTNode *_high, bool _highClosed)
+		: ASTNodeNonLeaf(eASTNodeType::IN_RANGE, _value, nullptr)
+		, low(_low)
+		, high(_high)
+		, lowClosed(_lowClosed)
+		, highClosed(_highClosed)
+		, rangeIndex(EXP_SLOT_INDEX_MAX)
+	{
+		ExprType = eExpType::BOOL;
+	}
+	virtual ~ASTNodeInRange();
+
+	// Fuses two type checked comparisons of the same variable, one with a lower and one with an upper
+	// bound, into a range test. Returns nullptr, leaving both alone, if they aren't that.
+	static ASTNodeInRange* fuseTests(ASTNode *left, ASTNode *right);
+
+	virtual bool typeCheck(const VariableLayout& varLayout, ExpressionErrorReporter& reporter) override { return true; }
+	virtual uint32_t numberValues(SubexpressionSharing& sharing) override;
+	virtual void gatherConsts(ExpressionDataWriter& writer) override;
+	virtual void addFacts(bool outcome, RangeAnalysis& analysis) const override;
 	virtual void generateCode(ExpressionDataWriter& writer) override;
+	virtual ExpressionClosureBuilder::Value lowerToClosure(ExpressionClosureBuilder& builder) const override;
 };
 
 
@@ -441,6 +630,7 @@ class ASTNodeID : public ASTNode
 {
 	const Name name;
 	ExpressionSlotIndex slotIndex;
+	ValueRange declaredRange;
 
 public:
 	ASTNodeID(const char *_name)
@@ -449,14 +639,45 @@ public:
 	{}
 
 	virtual bool typeCheck(const VariableLayout& varLayout, ExpressionErrorReporter& reporter) override;
+	virtual void bindConstants(ASTNode **parentPointerToThis, const ExpressionBindings& bindings) override;
+	virtual uint32_t numberValues(SubexpressionSharing& sharing) override;
+	virtual ValueRange analyseRanges(RangeAnalysis& analysis) override;
 	virtual bool isConstant() const override { return false; }
+	virtual void gatherConsts(ExpressionDataWriter& writer) override { writer.addInput(ExprType, slotIndex); }
 	virtual void generateCode(ExpressionDataWriter& writer) override {}
 	virtual ResultInfo getResultInfo() const override;
+	virtual ExpressionClosureBuilder::Value lowerToClosure(ExpressionClosureBuilder& builder) const override;
 
 	Name getName() const { return name; }
 };
 
 
+// A repeated subexpression, read from the register its first copy left the result in
+class ASTNodeSharedValue : public ASTNode
+{
+	ASTNodeNonLeaf *definition;
+
+public:
+	ASTNodeSharedValue(ASTNodeNonLeaf *_definition)
+		: ASTNode(eASTNodeType::SHARED_VALUE)
+		, definition(_definition)
+	{
+		ExprType = _definition->exprType();
+	}
+
+	virtual bool typeCheck(const VariableLayout& varLayout, ExpressionErrorReporter& reporter) override { return true; }
+	virtual uint32_t numberValues(SubexpressionSharing& sharing) override { assert(false); return 0; }
+	virtual bool isConstant() const override { return false; }
+	virtual void releaseSharedRegister(SubexpressionSharing& sharing) override { definition->releaseSharedUse(sharing); }
+	virtual void holdSharedResult() override { definition->addSharedUse(); }
+	virtual void generateCode(ExpressionDataWriter& writer) override {}
+	virtual ResultInfo getResultInfo() const override { return definition->getResultInfo(); }
+
+	// the closure backend has no registers, so it computes the value again
+	virtual ExpressionClosureBuilder::Value lowerToClosure(ExpressionClosureBuilder& builder) const override { return definition->lowerToClosure(builder); }
+};
+
+
 /*
  * ASTNode
  *
@@ -485,6 +706,9 @@ const char* ASTNode::getOperatorAsString() const
 	case eASTNodeType::ARITH_MUL:		return "*";
 	case eASTNodeType::ARITH_DIV:		return "/";
 	case eASTNodeType::ARITH_MOD:		return "%";
+	case eASTNodeType::SELECT:			return "?:";
+	case eASTNodeType::IN_SET:			return "in";
+	case eASTNodeType::IN_RANGE:		return "in range";
 
 	default:
 		assert(false);
@@ -512,6 +736,26 @@ ASTNodeNonLeaf::~ASTNodeNonLeaf()
 	}
 }
 
+void ASTNodeNonLeaf::bindConstants(ASTNode **parentPointerToThis, const ExpressionBindings& bindings)
+{
+	ASTNode *tempLeftChild(leftChild);
+	leftChild->bindConstants(&leftChild, bindings);
+	if (tempLeftChild != leftChild)
+	{
+		freeNode(tempLeftChild);
+	}
+
+	if (rightChild)
+	{
+		ASTNode *tempRightChild(rightChild);
+		rightChild->bindConstants(&rightChild, bindings);
+		if (tempRightChild != rightChild)
+		{
+			freeNode(tempRightChild);
+		}
+	}
+}
+
 bool ASTNodeNonLeaf::constFold(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter)
 {
 	ASTNode *tempLeftChild(leftChild);
@@ -536,104 +780,350 @@ bool ASTNodeNonLeaf::constFold(ASTNode **parentPointerToThis, ExpressionErrorRep
 	return constFoldThisNode(parentPointerToThis, reporter);
 }
 
-void ASTNodeNonLeaf::gatherConsts(ExpressionDataWriter& writer)
+bool ASTNodeNonLeaf::simplify(ASTNode **parentPointerToThis, const ExpressionCompileOptions& options, ExpressionErrorReporter& reporter)
 {
-	leftChild->gatherConsts(writer);
+	ASTNode *tempLeftChild(leftChild);
+	bool leftChildResult = leftChild->simplify(&leftChild, options, reporter);
+	if (tempLeftChild != leftChild)
+	{
+		freeNode(tempLeftChild);
+	}
+	if (!leftChildResult) return false;
+
 	if (rightChild)
 	{
-		rightChild->gatherConsts(writer);
+		ASTNode *tempRightChild(rightChild);
+		bool rightChildResult = rightChild->simplify(&rightChild, options, reporter);
+		if (tempRightChild != rightChild)
+		{
+			freeNode(tempRightChild);
+		}
+		if (!rightChildResult) return false;
+	}
+
+	// simplifying the children can leave them all constant
+	if (!constFoldThisNode(parentPointerToThis, reporter)) return false;
+
+	if (*parentPointerToThis == this)
+	{
+		simplifyThisNode(parentPointerToThis, options);
 	}
+
+	return true;
 }
 
-void ASTNodeNonLeaf::allocateRegisters(uint32_t useRegister, uint32_t& maxRegister)
+void ASTNodeNonLeaf::fuseIntervals(ASTNode **parentPointerToThis)
 {
-	resultRegister = useRegister;
-	if (useRegister > maxRegister)
+	ASTNode *tempLeftChild(leftChild);
+	leftChild->fuseIntervals(&leftChild);
+	if (tempLeftChild != leftChild)
 	{
-		maxRegister = useRegister;
+		freeNode(tempLeftChild);
 	}
 
-	leftChild->allocateRegisters(useRegister, maxRegister);
 	if (rightChild)
 	{
-		rightChild->allocateRegisters(useRegister + 1, maxRegister);
+		ASTNode *tempRightChild(rightChild);
+		rightChild->fuseIntervals(&rightChild);
+		if (tempRightChild != rightChild)
+		{
+			freeNode(tempRightChild);
+		}
 	}
-}
 
-ResultInfo ASTNodeNonLeaf::getResultInfo() const
-{
-	return ResultInfo(eResultSource::Register, resultRegister);
+	fuseIntervalsThisNode(parentPointerToThis);
 }
 
+bool ASTNodeNonLeaf::canFail() const
+{
+	if (nodeType() == eASTNodeType::ARITH_DIV || nodeType() == eASTNodeType::ARITH_MOD)
+	{
+		return true;
+	}
 
+	return leftChild->canFail() || (rightChild && rightChild->canFail());
+}
 
-/*
- * ASTNodeLogic
- *
- */
+void ASTNodeNonLeaf::replaceWithChild(ASTNode **parentPointerToThis, ASTNode *&child)
+{
+	// the caller frees this node, so the child is detached from whichever node held it
+	*parentPointerToThis = child;
+	child = nullptr;
+}
 
-bool ASTNodeLogic::typeCheck(const VariableLayout& varLayout, ExpressionErrorReporter& reporter)
+uint32_t ASTNodeNonLeaf::numberValues(SubexpressionSharing& sharing)
 {
-	if (!leftChild->typeCheck(varLayout, reporter)) return false;
-	if (rightChild && !rightChild->typeCheck(varLayout, reporter)) return false;
+	uint32_t leftNumber = leftChild->numberValues(sharing);
+	uint32_t rightNumber = rightChild ? rightChild->numberValues(sharing) : 0;
 
-	if (leftChild->exprType() != eExpType::BOOL ||
-		(rightChild && rightChild->exprType() != eExpType::BOOL))
+	// operand order doesn't matter to these, so a + b and b + a are the same value
+	switch (nodeType())
 	{
-		std::ostringstream msg;
-		if (nodeType() == eASTNodeType::LOGICAL_NOT)
-		{
-			msg << "Right side of " << getOperatorAsString() << " must be boolean";
-		}
-		else
+	case eASTNodeType::ARITH_ADD:
+	case eASTNodeType::ARITH_MUL:
+	case eASTNodeType::COMP_EQ:
+	case eASTNodeType::COMP_NEQ:
+		if (leftNumber > rightNumber)
 		{
-			msg << "Both sides of " << getOperatorAsString() << " must be boolean";	
+			std::swap(leftNumber, rightNumber);
 		}
-		reporter.addError(eErrorCategory::TypeCheck, eErrorCode::LogicTypeError, msg.str());
+		break;
 
-		return false;
+	default:
+		break;
 	}
 
-	ExprType = eExpType::BOOL;
-	
-	return true;
+	std::ostringstream key;
+	key << static_cast<int>(nodeType()) << '(' << leftNumber << ',' << rightNumber << ')';
+
+	valueNumber = sharing.getValueNumber(key.str());
+	return valueNumber;
 }
 
-bool ASTNodeLogic::constFoldThisNode(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter)
+void ASTNodeNonLeaf::shareSubexpressions(ASTNode **parentPointerToThis, SubexpressionSharing& sharing)
 {
-	if (nodeType() == eASTNodeType::LOGICAL_NOT)
+	ASTNodeNonLeaf *definition = sharing.findDefinition(valueNumber);
+	if (definition)
 	{
-		if (leftChild->isConstant())
-		{
-			assert(leftChild->exprType() == eExpType::BOOL);
-			const bool leftVal = static_cast<ASTNodeConstBool*>(leftChild)->getValue();
+		definition->addSharedUse();
+		*parentPointerToThis = new ASTNodeSharedValue(definition);
+		return;
+	}
 
-			*parentPointerToThis = createConstNode(!leftVal);
-		}
+	ASTNode *tempLeftChild(leftChild);
+	leftChild->shareSubexpressions(&leftChild, sharing);
+	if (tempLeftChild != leftChild)
+	{
+		freeNode(tempLeftChild);
 	}
-	else if (nodeType() == eASTNodeType::LOGICAL_AND)
+
+	if (rightChild)
 	{
-		if (leftChild->isConstant() || rightChild->isConstant())
+		// the right side of && and || only runs some of the time, so values computed there can only be
+		// shared with code that is skipped along with them
+		const bool guarded = nodeType() == eASTNodeType::LOGICAL_AND || nodeType() == eASTNodeType::LOGICAL_OR;
+		if (guarded)
 		{
-			assert(leftChild->exprType() == eExpType::BOOL);
-			assert(rightChild && rightChild->exprType() == eExpType::BOOL);
+			sharing.guards.push_back(this);
+		}
 
-			const bool leftVal = leftChild->isConstant() ? static_cast<ASTNodeConstBool*>(leftChild)->getValue() : true;
-			const bool rightVal = rightChild->isConstant() ? static_cast<ASTNodeConstBool*>(rightChild)->getValue() : true;
+		ASTNode *tempRightChild(rightChild);
+		rightChild->shareSubexpressions(&rightChild, sharing);
+		if (tempRightChild != rightChild)
+		{
+			freeNode(tempRightChild);
+		}
 
-			if (!(leftVal && rightVal))
-			{
-				*parentPointerToThis = createConstNode(false);
-			}
-			else if (leftChild->isConstant())
-			{
-				*parentPointerToThis = rightChild;
-				rightChild = nullptr;
-			}
-			else
-			{
-				*parentPointerToThis = leftChild;
-				leftChild = nullptr;
+		if (guarded)
+		{
+			sharing.guards.pop_back();
+		}
+	}
+
+	sharing.addDefinition(this, valueNumber);
+}
+
+bool ASTNodeNonLeaf::containsSharedDefinition() const
+{
+	return sharedUses > 0 || leftChild->containsSharedDefinition() || (rightChild && rightChild->containsSharedDefinition());
+}
+
+void ASTNodeNonLeaf::gatherConsts(ExpressionDataWriter& writer)
+{
+	leftChild->gatherConsts(writer);
+	if (rightChild)
+	{
+		rightChild->gatherConsts(writer);
+	}
+}
+
+uint32_t ASTNodeNonLeaf::labelRegisterNeed()
+{
+	const uint32_t leftNeed = leftChild->labelRegisterNeed();
+	const uint32_t rightNeed = rightChild ? rightChild->labelRegisterNeed() : 0;
+
+	// a shared value has to be computed before the copies reading it, and those always come later in
+	// left to right order
+	rightFirst = rightNeed > leftNeed && mayEvaluateRightFirst() && !leftChild->containsSharedDefinition();
+
+	// The child evaluated first works in this node's register and leaves its result there, the second
+	// starts at the next register up. Leaves are read in place and need no register at all.
+	const uint32_t firstNeed = rightFirst ? rightNeed : leftNeed;
+	const uint32_t secondNeed = rightFirst ? leftNeed : rightNeed;
+
+	registerNeed = std::max<uint32_t>(1, std::max(firstNeed, secondNeed > 0 ? secondNeed + 1 : 0));
+	return registerNeed;
+}
+
+void ASTNodeNonLeaf::allocateRegisters(uint32_t useRegister, uint32_t& maxRegister)
+{
+	resultRegister = useRegister;
+	if (useRegister > maxRegister)
+	{
+		maxRegister = useRegister;
+	}
+
+	ASTNode* firstChild = rightFirst ? rightChild : leftChild;
+	ASTNode* secondChild = rightFirst ? leftChild : rightChild;
+
+	firstChild->allocateRegisters(useRegister, maxRegister);
+	if (secondChild)
+	{
+		secondChild->allocateRegisters(useRegister + 1, maxRegister);
+	}
+}
+
+void ASTNodeNonLeaf::allocateSharedRegisters(SubexpressionSharing& sharing)
+{
+	ASTNode* firstChild = rightFirst ? rightChild : leftChild;
+	ASTNode* secondChild = rightFirst ? leftChild : rightChild;
+
+	// Operands are normally read before the result is written, so a register freed here can take the
+	// result. && and || copy their left side into the result before the right side runs though, so their
+	// result is taken first - otherwise a shared value whose last use is inside the right side could hand
+	// its register over while it still has to be read.
+	const bool resultWrittenEarly = nodeType() == eASTNodeType::LOGICAL_AND || nodeType() == eASTNodeType::LOGICAL_OR;
+
+	firstChild->allocateSharedRegisters(sharing);
+
+	if (sharedUses > 0 && resultWrittenEarly)
+	{
+		resultRegister = sharing.acquireRegister();
+		sharedUsesLeft = sharedUses;
+	}
+
+	if (secondChild)
+	{
+		secondChild->allocateSharedRegisters(sharing);
+	}
+
+	leftChild->releaseSharedRegister(sharing);
+	if (rightChild)
+	{
+		rightChild->releaseSharedRegister(sharing);
+	}
+
+	if (sharedUses > 0 && !resultWrittenEarly)
+	{
+		resultRegister = sharing.acquireRegister();
+		sharedUsesLeft = sharedUses;
+	}
+}
+
+void ASTNodeNonLeaf::releaseSharedUse(SubexpressionSharing& sharing)
+{
+	assert(sharedUsesLeft > 0);
+	if (--sharedUsesLeft == 0)
+	{
+		sharing.releaseRegister(resultRegister);
+	}
+}
+
+void ASTNodeNonLeaf::generateChildCode(ExpressionDataWriter& writer)
+{
+	ASTNode* firstChild = rightFirst ? rightChild : leftChild;
+	ASTNode* secondChild = rightFirst ? leftChild : rightChild;
+
+	firstChild->generateCode(writer);
+	if (secondChild)
+	{
+		secondChild->generateCode(writer);
+	}
+}
+
+ResultInfo ASTNodeNonLeaf::getResultInfo() const
+{
+	return ResultInfo(eResultSource::Register, resultRegister);
+}
+
+ValueRange ASTNodeNonLeaf::analyseRanges(RangeAnalysis& analysis)
+{
+	leftChild->analyseRanges(analysis);
+	if (rightChild)
+	{
+		rightChild->analyseRanges(analysis);
+	}
+
+	return ValueRange();
+}
+
+ExpressionClosureBuilder::Value ASTNodeNonLeaf::lowerToClosure(ExpressionClosureBuilder& builder) const
+{
+	const ExpressionClosureBuilder::Value leftValue = leftChild->lowerToClosure(builder);
+	const ExpressionClosureBuilder::Value rightValue = rightChild ? rightChild->lowerToClosure(builder) : leftValue;
+
+	return builder.addOperation(nodeType(), leftValue, rightValue);
+}
+
+
+
+/*
+ * ASTNodeLogic
+ *
+ */
+
+bool ASTNodeLogic::typeCheck(const VariableLayout& varLayout, ExpressionErrorReporter& reporter)
+{
+	if (!leftChild->typeCheck(varLayout, reporter)) return false;
+	if (rightChild && !rightChild->typeCheck(varLayout, reporter)) return false;
+
+	if (leftChild->exprType() != eExpType::BOOL ||
+		(rightChild && rightChild->exprType() != eExpType::BOOL))
+	{
+		std::ostringstream msg;
+		if (nodeType() == eASTNodeType::LOGICAL_NOT)
+		{
+			msg << "Right side of " << getOperatorAsString() << " must be boolean";
+		}
+		else
+		{
+			msg << "Both sides of " << getOperatorAsString() << " must be boolean";	
+		}
+		reporter.addError(eErrorCategory::TypeCheck, eErrorCode::LogicTypeError, msg.str());
+
+		return false;
+	}
+
+	ExprType = eExpType::BOOL;
+	
+	return true;
+}
+
+bool ASTNodeLogic::constFoldThisNode(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter)
+{
+	if (nodeType() == eASTNodeType::LOGICAL_NOT)
+	{
+		if (leftChild->isConstant())
+		{
+			assert(leftChild->exprType() == eExpType::BOOL);
+			const bool leftVal = static_cast<ASTNodeConstBool*>(leftChild)->getValue();
+
+			*parentPointerToThis = createConstNode(!leftVal);
+		}
+	}
+	else if (nodeType() == eASTNodeType::LOGICAL_AND)
+	{
+		if (leftChild->isConstant() || rightChild->isConstant())
+		{
+			assert(leftChild->exprType() == eExpType::BOOL);
+			assert(rightChild && rightChild->exprType() == eExpType::BOOL);
+
+			const bool leftVal = leftChild->isConstant() ? static_cast<ASTNodeConstBool*>(leftChild)->getValue() : true;
+			const bool rightVal = rightChild->isConstant() ? static_cast<ASTNodeConstBool*>(rightChild)->getValue() : true;
+
+			if (!(leftVal && rightVal))
+			{
+				*parentPointerToThis = createConstNode(false);
+			}
+			else if (leftChild->isConstant())
+			{
+				*parentPointerToThis = rightChild;
+				rightChild = nullptr;
+			}
+			else
+			{
+				*parentPointerToThis = leftChild;
+				leftChild = nullptr;
 			}
 		}
 	}
@@ -672,9 +1162,124 @@ bool ASTNodeLogic::constFoldThisNode(ASTNode **parentPointerToThis, ExpressionEr
 	return true;
 }
 
+ASTNodeLogic* ASTNodeLogic::createTyped(eASTNodeType _nodeType, ASTNode *_leftChild, ASTNode *_rightChild)
+{
+	ASTNodeLogic* node = new ASTNodeLogic(_nodeType, _leftChild, _rightChild);
+	node->ExprType = eExpType::BOOL;
+	return node;
+}
+
+void ASTNodeLogic::simplifyThisNode(ASTNode **parentPointerToThis, const ExpressionCompileOptions& options)
+{
+	// !!x -> x
+	if (nodeType() == eASTNodeType::LOGICAL_NOT && leftChild->nodeType() == eASTNodeType::LOGICAL_NOT)
+	{
+		replaceWithChild(parentPointerToThis, static_cast<ASTNodeLogic*>(leftChild)->leftChild);
+	}
+
+	// x == a || x == b -> x in (a, b). A longer chain has already had its left end merged into a set.
+	if (nodeType() == eASTNodeType::LOGICAL_OR)
+	{
+		ASTNode *&test = getTestBeforeRight();
+
+		ASTNodeInSet *merged = ASTNodeInSet::mergeTests(test, rightChild);
+		if (merged)
+		{
+			replaceLastTests(parentPointerToThis, test, merged);
+		}
+	}
+}
+
+void ASTNodeLogic::fuseIntervalsThisNode(ASTNode **parentPointerToThis)
+{
+	// x >= lo && x < hi -> lo <= x < hi
+	if (nodeType() == eASTNodeType::LOGICAL_AND)
+	{
+		ASTNode *&test = getTestBeforeRight();
+
+		ASTNodeInRange *fused = ASTNodeInRange::fuseTests(test, rightChild);
+		if (fused)
+		{
+			replaceLastTests(parentPointerToThis, test, fused);
+		}
+	}
+}
+
+ASTNode*& ASTNodeLogic::getTestBeforeRight()
+{
+	return leftChild->nodeType() == nodeType() ? static_cast<ASTNodeLogic*>(leftChild)->rightChild : leftChild;
+}
+
+void ASTNodeLogic::replaceLastTests(ASTNode **parentPointerToThis, ASTNode *&leftTest, ASTNode *merged)
+{
+	if (&leftTest == &leftChild)
+	{
+		// both tests go when the caller frees this node
+		*parentPointerToThis = merged;
+	}
+	else
+	{
+		// the rest of the chain takes this node's place, with merged in place of its last test
+		freeNode(leftTest);
+		leftTest = merged;
+		replaceWithChild(parentPointerToThis, leftChild);
+	}
+}
+
+ValueRange ASTNodeLogic::analyseRanges(RangeAnalysis& analysis)
+{
+	leftChild->analyseRanges(analysis);
+
+	if (rightChild)
+	{
+		// the right side only runs if the left came out true for && or false for ||
+		const uint32_t factCount = analysis.getFactCount();
+		leftChild->addFacts(nodeType() == eASTNodeType::LOGICAL_AND, analysis);
+		rightChild->analyseRanges(analysis);
+		analysis.removeFacts(factCount);
+	}
+
+	return ValueRange();
+}
+
+void ASTNodeLogic::addFacts(bool outcome, RangeAnalysis& analysis) const
+{
+	if (nodeType() == eASTNodeType::LOGICAL_NOT)
+	{
+		leftChild->addFacts(!outcome, analysis);
+	}
+	else if (outcome == (nodeType() == eASTNodeType::LOGICAL_AND))
+	{
+		// a true && or a false || means both sides came out the same way
+		leftChild->addFacts(outcome, analysis);
+		rightChild->addFacts(outcome, analysis);
+	}
+}
+
 void ASTNodeLogic::generateCode(ExpressionDataWriter& writer)
 {
 	leftChild->generateCode(writer);
+
+	// && and || jump over the right side when the left side already decides the result. The left side
+	// is in this node's register, which then already holds the answer. The combining instruction is
+	// still emitted after the right side, so running every instruction in order gives the same result
+	// (which is what the lane-parallel evaluators do when their lanes disagree).
+	uint32_t jumpIndex(UINT32_MAX);
+	if (nodeType() != eASTNodeType::LOGICAL_NOT)
+	{
+		const ResultInfo conditionRI = leftChild->getResultInfo();
+		assert(conditionRI.source == eResultSource::Register);
+
+		// a shared left side lives in its own register, so copy it into this one before jumping
+		if (conditionRI.index != resultRegister)
+		{
+			writer.emitInstr(encodeOp(eSimpleOp::AND, eResultSource::Register, eResultSource::Register), resultRegister, conditionRI.index, conditionRI.index);
+		}
+
+		const eSimpleOp jumpOp = nodeType() == eASTNodeType::LOGICAL_AND ? eSimpleOp::JUMP_IF_FALSE : eSimpleOp::JUMP_IF_TRUE;
+		jumpIndex = writer.emitJump(encodeOp(jumpOp, eResultSource::Register, eResultSource::Register), conditionRI.index);
+	}
+
 	if (rightChild)
 	{
 		rightChild->generateCode(writer);
@@ -697,6 +1302,11 @@ void ASTNodeLogic::generateCode(ExpressionDataWriter& writer)
 	eEncOpcode encOp = encodeOp(simpleOp, leftRI.source, rightRI.source);
 
 	writer.emitInstr(encOp, resultRegister, leftRI.index, rightRI.index);
+
+	if (jumpIndex != UINT32_MAX)
+	{
+		writer.patchJump(jumpIndex);
+	}
 }
 
 
@@ -821,17 +1431,110 @@ bool ASTNodeComp::constFoldThisNode(ASTNode **parentPointerToThis, ExpressionErr
 			return false;
 		}
 	}
+	else if (leftChild->exprType() == eExpType::BOOL && (leftChild->isConstant() || rightChild->isConstant()))
+	{
+		// The boolean comparisons have no constant operands to read, so one constant side turns the
+		// comparison into the other side or its negation: x == true -> x, x == false -> !x, and the
+		// other way round for !=
+		const bool leftConst = leftChild->isConstant();
+		const bool constVal = static_cast<ASTNodeConstBool*>(leftConst ? leftChild : rightChild)->getValue();
+		ASTNode *&other = leftConst ? rightChild : leftChild;
+
+		if (constVal == (nodeType() == eASTNodeType::COMP_EQ))
+		{
+			*parentPointerToThis = other;
+		}
+		else
+		{
+			*parentPointerToThis = ASTNodeLogic::createTyped(eASTNodeType::LOGICAL_NOT, other, nullptr);
+		}
+		other = nullptr;
+	}
 
 	return true;
 }
 
-void ASTNodeComp::generateCode(ExpressionDataWriter& writer)
+ASTNodeComp* ASTNodeComp::createTyped(eASTNodeType _nodeType, ASTNode *_leftChild, ASTNode *_rightChild)
 {
-	leftChild->generateCode(writer);
-	if (rightChild)
+	ASTNodeComp* node = new ASTNodeComp(_nodeType, _leftChild, _rightChild);
+	node->ExprType = eExpType::BOOL;
+	return node;
+}
+
+void ASTNodeComp::addFacts(bool outcome, RangeAnalysis& analysis) const
+{
+	if (leftChild->exprType() != eExpType::NUMBER)
 	{
-		rightChild->generateCode(writer);
+		return;
+	}
+
+	// only a variable compared with a constant says anything, turned round to put the variable on the left
+	const ASTNode *variable(leftChild), *constant(rightChild);
+	eASTNodeType comparison(nodeType());
+
+	if (variable->nodeType() != eASTNodeType::IDENT)
+	{
+		std::swap(variable, constant);
+
+		switch (comparison)
+		{
+		case eASTNodeType::COMP_LT:		comparison = eASTNodeType::COMP_GT;   break;
+		case eASTNodeType::COMP_LTEQ:	comparison = eASTNodeType::COMP_GTEQ; break;
+		case eASTNodeType::COMP_GT:		comparison = eASTNodeType::COMP_LT;   break;
+		case eASTNodeType::COMP_GTEQ:	comparison = eASTNodeType::COMP_LTEQ; break;
+		default: break;
+		}
+	}
+
+	if (variable->nodeType() != eASTNodeType::IDENT || constant->nodeType() != eASTNodeType::VALUE_FLOAT)
+	{
+		return;
+	}
+
+	// a comparison that came out false holds the other way round (or the variable is NaN, see RangeAnalysis)
+	if (!outcome)
+	{
+		switch (comparison)
+		{
+		case eASTNodeType::COMP_EQ:		comparison = eASTNodeType::COMP_NEQ;  break;
+		case eASTNodeType::COMP_NEQ:	comparison = eASTNodeType::COMP_EQ;   break;
+		case eASTNodeType::COMP_LT:		comparison = eASTNodeType::COMP_GTEQ; break;
+		case eASTNodeType::COMP_LTEQ:	comparison = eASTNodeType::COMP_GT;   break;
+		case eASTNodeType::COMP_GT:		comparison = eASTNodeType::COMP_LTEQ; break;
+		case eASTNodeType::COMP_GTEQ:	comparison = eASTNodeType::COMP_LT;   break;
+		default:
+			assert(false);
+		}
+	}
+
+	// a comparison with NaN says nothing about the variable
+	const float value = static_cast<const ASTNodeConstNumber*>(constant)->getValue();
+	if (value != value) return;
+
+	const float infinity = std::numeric_limits<float>::infinity();
+	ValueRange range;
+
+	switch (comparison)
+	{
+	case eASTNodeType::COMP_EQ:		range = ValueRange(value, value); break;
+	case eASTNodeType::COMP_NEQ:	range.nonZero = value == 0.f; break;
+	case eASTNodeType::COMP_LT:		range = ValueRange(-infinity, value); range.nonZero = value <= 0.f; break;
+	case eASTNodeType::COMP_LTEQ:	range = ValueRange(-infinity, value); break;
+	case eASTNodeType::COMP_GT:		range = ValueRange(value, infinity); range.nonZero = value >= 0.f; break;
+	case eASTNodeType::COMP_GTEQ:	range = ValueRange(value, infinity); break;
+	default:
+		assert(false);
+	}
+
+	if (!range.isUnbounded())
+	{
+		analysis.addFact(variable->getResultInfo().index, range);
 	}
+}
+
+void ASTNodeComp::generateCode(ExpressionDataWriter& writer)
+{
+	generateChildCode(writer);
 
 	ResultInfo leftRI = leftChild->getResultInfo();
 	ResultInfo rightRI = rightChild ? rightChild->getResultInfo() : leftRI;
@@ -959,7 +1662,7 @@ bool ASTNodeArith::constFoldThisNode(ASTNode **parentPointerToThis, ExpressionEr
 			result = leftValue / rightValue; 
 			break;
 
-		case eASTNodeType::ARITH_MOD: result = remainderf(leftValue, rightValue); break;
+		case eASTNodeType::ARITH_MOD: result = fmodf(leftValue, rightValue); break;
 
 		default:
 			assert(false);
@@ -971,13 +1674,285 @@ bool ASTNodeArith::constFoldThisNode(ASTNode **parentPointerToThis, ExpressionEr
 	return true;
 }
 
-void ASTNodeArith::generateCode(ExpressionDataWriter& writer)
+ASTNodeArith* ASTNodeArith::createTyped(eASTNodeType _nodeType, ASTNode *_leftChild, ASTNode *_rightChild)
 {
-	leftChild->generateCode(writer);
-	if (rightChild)
+	ASTNodeArith* node = new ASTNodeArith(_nodeType, _leftChild, _rightChild);
+	node->ExprType = eExpType::NUMBER;
+	return node;
+}
+
+bool ASTNodeArith::canFail() const
+{
+	// a divide the range analysis has cleared can't fail, though its operands still might
+	if (divisorNonZero)
 	{
-		rightChild->generateCode(writer);
+		return leftChild->canFail() || rightChild->canFail();
+	}
+
+	return ASTNodeNonLeaf::canFail();
+}
+
+static bool isConstNumber(const ASTNode* node)
+{
+	return node->nodeType() == eASTNodeType::VALUE_FLOAT;
+}
+
+static bool isConstNumber(const ASTNode* node, float value)
+{
+	return isConstNumber(node) && static_cast<const ASTNodeConstNumber*>(node)->getValue() == value;
+}
+
+// x / c and x * (1 / c) only give the same answer for every x when c is a power of two whose
+// reciprocal is still a normal float
+static bool hasExactReciprocal(float value)
+{
+	int exponent(0);
+	const float mantissa = frexpf(value, &exponent);
+	return (mantissa == 0.5f || mantissa == -0.5f) && std::isnormal(1.f / value);
+}
+
+// A term that can't fail has no divide in it, so it can only be inf or NaN if a variable in it can be or
+// the arithmetic overflows - and either way its range then has an infinite bound
+static bool isFiniteTerm(ASTNode *term)
+{
+	if (term->canFail())
+	{
+		return false;
+	}
+
+	RangeAnalysis analysis;
+	const ValueRange range = term->analyseRanges(analysis);
+	return std::isfinite(range.minValue) && std::isfinite(range.maxValue);
+}
+
+void ASTNodeArith::markKeepProducts(ASTNode *node) const
+{
+	if (node->nodeType() == eASTNodeType::ARITH_ADD || node->nodeType() == eASTNodeType::ARITH_SUB || node->nodeType() == eASTNodeType::ARITH_MUL)
+	{
+		static_cast<ASTNodeArith*>(node)->keepProducts = true;
+	}
+}
+
+bool ASTNodeArith::simplify(ASTNode **parentPointerToThis, const ExpressionCompileOptions& options, ExpressionErrorReporter& reporter)
+{
+	// A divisor like NumB * 0 divides by zero at run time. Folded to a constant 0 it would fail to compile
+	// instead, or give NaN for %, so a divisor and the sums and products it's made of keep their x * 0.
+	// So does a dividend over a constant 0, which would otherwise fold into a constant divided by 0.
+	if (nodeType() == eASTNodeType::ARITH_DIV || nodeType() == eASTNodeType::ARITH_MOD)
+	{
+		markKeepProducts(rightChild);
+		if (isConstNumber(rightChild, 0.f))
+		{
+			markKeepProducts(leftChild);
+		}
+	}
+	else if (keepProducts)
+	{
+		markKeepProducts(leftChild);
+		markKeepProducts(rightChild);
+	}
+
+	return ASTNodeNonLeaf::simplify(parentPointerToThis, options, reporter);
+}
+
+void ASTNodeArith::simplifyThisNode(ASTNode **parentPointerToThis, const ExpressionCompileOptions& options)
+{
+	switch (nodeType())
+	{
+	case eASTNodeType::ARITH_ADD:
+		if (isConstNumber(rightChild, 0.f)) { replaceWithChild(parentPointerToThis, leftChild); return; }
+		if (isConstNumber(leftChild, 0.f)) { replaceWithChild(parentPointerToThis, rightChild); return; }
+		break;
+
+	case eASTNodeType::ARITH_SUB:
+		if (isConstNumber(rightChild, 0.f)) { replaceWithChild(parentPointerToThis, leftChild); return; }
+		break;
+
+	case eASTNodeType::ARITH_MUL:
+		if (isConstNumber(rightChild, 1.f)) { replaceWithChild(parentPointerToThis, leftChild); return; }
+		if (isConstNumber(leftChild, 1.f)) { replaceWithChild(parentPointerToThis, rightChild); return; }
+
+		// the other side is dropped, so it mustn't be able to report an error, and it has to be finite
+		// as inf or NaN times 0 is NaN
+		if (!keepProducts && ((isConstNumber(leftChild, 0.f) && isFiniteTerm(rightChild)) ||
+			(isConstNumber(rightChild, 0.f) && isFiniteTerm(leftChild))))
+		{
+			*parentPointerToThis = createConstNode(0.f);
+			return;
+		}
+		break;
+
+	case eASTNodeType::ARITH_DIV:
+		if (isConstNumber(rightChild, 1.f)) { replaceWithChild(parentPointerToThis, leftChild); return; }
+
+		if (isConstNumber(rightChild) && !isConstNumber(rightChild, 0.f))
+		{
+			const float divisor = static_cast<ASTNodeConstNumber*>(rightChild)->getValue();
+
+			if (options.inexactReciprocals || hasExactReciprocal(divisor))
+			{
+				ASTNodeArith* product = createTyped(eASTNodeType::ARITH_MUL, leftChild, createConstNode(1.f / divisor));
+				leftChild = nullptr;
+
+				// the product may fold further into a constant chain
+				ASTNode* replacement(product);
+				product->simplifyThisNode(&replacement, options);
+				if (replacement != product)
+				{
+					freeNode(product);
+				}
+
+				*parentPointerToThis = replacement;
+				return;
+			}
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	foldConstantChain(parentPointerToThis);
+}
+
+bool ASTNodeArith::getConstantChain(ConstantChain& chain)
+{
+	const bool leftConst = isConstNumber(leftChild);
+	if (leftConst == isConstNumber(rightChild))
+	{
+		return false;
+	}
+
+	const float value = static_cast<ASTNodeConstNumber*>(leftConst ? leftChild : rightChild)->getValue();
+	chain.term = leftConst ? &rightChild : &leftChild;
+
+	switch (nodeType())
+	{
+	case eASTNodeType::ARITH_ADD:	chain.sign = 1.f; chain.constant = value; return true;
+	case eASTNodeType::ARITH_SUB:	chain.sign = leftConst ? -1.f : 1.f; chain.constant = leftConst ? value : -value; return true;
+	case eASTNodeType::ARITH_MUL:	chain.sign = 1.f; chain.constant = value; return true;
+
+	default:
+		return false;
+	}
+}
+
+// Folds this node's constant into a child chain of the same kind: (1 + x) + 2 -> x + 3,
+// 5 - (x - 1) -> 6 - x, 0 - (0 - x) -> x, (x * 2) * 3 -> x * 6
+void ASTNodeArith::foldConstantChain(ASTNode **parentPointerToThis)
+{
+	ConstantChain outer;
+	if (!getConstantChain(outer))
+	{
+		return;
+	}
+
+	const bool multiply = nodeType() == eASTNodeType::ARITH_MUL;
+	const eASTNodeType innerType = (*outer.term)->nodeType();
+
+	if (multiply ? innerType != eASTNodeType::ARITH_MUL : (innerType != eASTNodeType::ARITH_ADD && innerType != eASTNodeType::ARITH_SUB))
+	{
+		return;
+	}
+
+	ConstantChain inner;
+	if (!static_cast<ASTNodeArith*>(*outer.term)->getConstantChain(inner))
+	{
+		return;
+	}
+
+	ASTNode* term = *inner.term;
+	*inner.term = nullptr;
+
+	if (multiply)
+	{
+		const float constant = inner.constant * outer.constant;
+		*parentPointerToThis = constant == 1.f ? term : createTyped(eASTNodeType::ARITH_MUL, term, createConstNode(constant));
+	}
+	else
+	{
+		const float sign = outer.sign * inner.sign;
+		const float constant = outer.sign * inner.constant + outer.constant;
+
+		if (sign < 0.f)
+		{
+			*parentPointerToThis = createTyped(eASTNodeType::ARITH_SUB, createConstNode(constant), term);
+		}
+		else
+		{
+			*parentPointerToThis = constant == 0.f ? term : createTyped(eASTNodeType::ARITH_ADD, term, createConstNode(constant));
+		}
+	}
+}
+
+// the smallest range holding all of the values, which may include NaN from inf - inf or 0 * inf
+static ValueRange getRangeOf(float a, float b, float c, float d)
+{
+	if (std::isnan(a) || std::isnan(b) || std::isnan(c) || std::isnan(d))
+	{
+		return ValueRange();
+	}
+
+	return ValueRange(std::min(std::min(a, b), std::min(c, d)), std::max(std::max(a, b), std::max(c, d)));
+}
+
+static ValueRange getRangeOf(float a, float b)
+{
+	return getRangeOf(a, b, a, b);
+}
+
+ValueRange ASTNodeArith::analyseRanges(RangeAnalysis& analysis)
+{
+	const ValueRange left = leftChild->analyseRanges(analysis);
+	const ValueRange right = rightChild->analyseRanges(analysis);
+
+	// Rounding to nearest never reverses the order of two results, so bounds computed in float are
+	// still bounds on what the float operations give. A bound that comes out NaN loses the range.
+	switch (nodeType())
+	{
+	case eASTNodeType::ARITH_ADD:
+		return getRangeOf(left.minValue + right.minValue, left.maxValue + right.maxValue);
+
+	case eASTNodeType::ARITH_SUB:
+		{
+			ValueRange range = getRangeOf(left.minValue - right.maxValue, left.maxValue - right.minValue);
+			range.nonZero = left.minValue == 0.f && left.maxValue == 0.f && right.nonZero;	// negation
+			return range;
+		}
+
+	case eASTNodeType::ARITH_MUL:
+		return getRangeOf(left.minValue * right.minValue, left.minValue * right.maxValue,
+			left.maxValue * right.minValue, left.maxValue * right.maxValue);
+
+	case eASTNodeType::ARITH_DIV:
+		divisorNonZero = right.excludesZero();
+
+		// a divisor only known to be non-zero can still be tiny, so the quotient is unbounded
+		if (right.minValue > 0.f || right.maxValue < 0.f)
+		{
+			return getRangeOf(left.minValue / right.minValue, left.minValue / right.maxValue,
+				left.maxValue / right.minValue, left.maxValue / right.maxValue);
+		}
+		return ValueRange();
+
+	case eASTNodeType::ARITH_MOD:
+		{
+			divisorNonZero = right.excludesZero();
+
+			// the remainder is smaller than the divisor and no bigger than the dividend, with the dividend's sign
+			const float divisorLimit = std::max(fabsf(right.minValue), fabsf(right.maxValue));
+			return getRangeOf(std::max(-divisorLimit, std::min(left.minValue, 0.f)), std::min(divisorLimit, std::max(left.maxValue, 0.f)));
+		}
+
+	default:
+		assert(false);
+		return ValueRange();
 	}
+}
+
+void ASTNodeArith::generateCode(ExpressionDataWriter& writer)
+{
+	generateChildCode(writer);
 
 	ResultInfo leftRI = leftChild->getResultInfo();
 	ResultInfo rightRI = rightChild ? rightChild->getResultInfo() : leftRI;
@@ -998,237 +1973,2044 @@ void ASTNodeArith::generateCode(ExpressionDataWriter& writer)
 	case eASTNodeType::ARITH_ADD:	simpleOp = eSimpleOp::ADD; break;
 	case eASTNodeType::ARITH_SUB:	simpleOp = eSimpleOp::SUB; break;
 	case eASTNodeType::ARITH_MUL:	simpleOp = eSimpleOp::MUL; break;
-	case eASTNodeType::ARITH_DIV:	simpleOp = eSimpleOp::DIV; break;
-	case eASTNodeType::ARITH_MOD:	simpleOp = eSimpleOp::MOD; break;
+	case eASTNodeType::ARITH_DIV:	simpleOp = divisorNonZero ? eSimpleOp::DIV_NZ : (writer.isIeeeDivide() ? eSimpleOp::DIV_IEEE : eSimpleOp::DIV); break;
+	case eASTNodeType::ARITH_MOD:	simpleOp = divisorNonZero ? eSimpleOp::MOD_NZ : (writer.isIeeeDivide() ? eSimpleOp::MOD_IEEE : eSimpleOp::MOD); break;
 
 	default:
 		assert(false);
 	}
 
-	eEncOpcode encOp = encodeOp(simpleOp, leftRI.source, rightRI.source);
+	eEncOpcode encOp = encodeOp(simpleOp, leftRI.source, rightRI.source);
+
+	writer.emitInstr(encOp, resultRegister, leftRI.index, rightRI.index);
+}
+
+
+/*
+ * ASTNodeSelect
+ *
+ */
+
+ASTNodeSelect::~ASTNodeSelect()
+{
+	if (condition)
+	{
+		delete condition;
+	}
+}
+
+bool ASTNodeSelect::typeCheck(const VariableLayout& varLayout, ExpressionErrorReporter& reporter)
+{
+	if (!condition->typeCheck(varLayout, reporter)) return false;
+	if (!leftChild->typeCheck(varLayout, reporter)) return false;
+	if (!rightChild->typeCheck(varLayout, reporter)) return false;
+
+	if (condition->exprType() != eExpType::BOOL)
+	{
+		std::ostringstream msg;
+		msg << "Condition of " << getOperatorAsString() << " must be boolean";
+		reporter.addError(eErrorCategory::TypeCheck, eErrorCode::LogicTypeError, msg.str());
+
+		return false;
+	}
+
+	if (leftChild->exprType() != rightChild->exprType())
+	{
+		std::ostringstream msg;
+		msg << "Both results of " << getOperatorAsString() << " must be the same type";
+		reporter.addError(eErrorCategory::TypeCheck, eErrorCode::SelectTypeError, msg.str());
+
+		return false;
+	}
+
+	// there are no name registers to select between
+	if (leftChild->exprType() == eExpType::NAME)
+	{
+		std::ostringstream msg;
+		msg << "Operator " << getOperatorAsString() << " is invalid with " << getTypeAsString(eExpType::NAME) << " results";
+		reporter.addError(eErrorCategory::TypeCheck, eErrorCode::SelectTypeError, msg.str());
+
+		return false;
+	}
+
+	ExprType = leftChild->exprType();
+
+	return true;
+}
+
+void ASTNodeSelect::bindConstants(ASTNode **parentPointerToThis, const ExpressionBindings& bindings)
+{
+	ASTNode *tempCondition(condition);
+	condition->bindConstants(&condition, bindings);
+	if (tempCondition != condition)
+	{
+		freeNode(tempCondition);
+	}
+
+	ASTNodeNonLeaf::bindConstants(parentPointerToThis, bindings);
+}
+
+bool ASTNodeSelect::constFold(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter)
+{
+	ASTNode *tempCondition(condition);
+	bool conditionResult = condition->constFold(&condition, reporter);
+	if (tempCondition != condition)
+	{
+		freeNode(tempCondition);
+	}
+	if (!conditionResult) return false;
+
+	return ASTNodeNonLeaf::constFold(parentPointerToThis, reporter);
+}
+
+bool ASTNodeSelect::constFoldThisNode(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter)
+{
+	if (condition->isConstant())
+	{
+		assert(condition->exprType() == eExpType::BOOL);
+		const bool conditionVal = static_cast<ASTNodeConstBool*>(condition)->getValue();
+
+		replaceWithChild(parentPointerToThis, conditionVal ? leftChild : rightChild);
+		return true;
+	}
+
+	if (ExprType != eExpType::BOOL || !(leftChild->isConstant() || rightChild->isConstant()))
+	{
+		return true;
+	}
+
+	// A constant boolean side turns the select into logic, which has no constant operands for
+	// BOOL_SELECT to read: c ? true : x -> c || x, c ? false : x -> !c && x, c ? x : true -> !c || x
+	// and c ? x : false -> c && x. Both sides constant leaves c, !c or the constant itself.
+	const bool leftConst = leftChild->isConstant();
+	const bool constVal = static_cast<ASTNodeConstBool*>(leftConst ? leftChild : rightChild)->getValue();
+	ASTNode *replacement(nullptr);
+
+	if (leftConst && rightChild->isConstant() && constVal == static_cast<ASTNodeConstBool*>(rightChild)->getValue())
+	{
+		replacement = createConstNode(constVal);
+	}
+	else
+	{
+		ASTNode *test = leftConst == constVal ? condition : ASTNodeLogic::createTyped(eASTNodeType::LOGICAL_NOT, condition, nullptr);
+		condition = nullptr;
+
+		if (leftConst && rightChild->isConstant())
+		{
+			replacement = test;
+		}
+		else
+		{
+			ASTNode *&other = leftConst ? rightChild : leftChild;
+			replacement = ASTNodeLogic::createTyped(constVal ? eASTNodeType::LOGICAL_OR : eASTNodeType::LOGICAL_AND, test, other);
+			other = nullptr;
+		}
+	}
+
+	*parentPointerToThis = replacement;
+	return true;
+}
+
+bool ASTNodeSelect::simplify(ASTNode **parentPointerToThis, const ExpressionCompileOptions& options, ExpressionErrorReporter& reporter)
+{
+	ASTNode *tempCondition(condition);
+	bool conditionResult = condition->simplify(&condition, options, reporter);
+	if (tempCondition != condition)
+	{
+		freeNode(tempCondition);
+	}
+	if (!conditionResult) return false;
+
+	return ASTNodeNonLeaf::simplify(parentPointerToThis, options, reporter);
+}
+
+void ASTNodeSelect::fuseIntervals(ASTNode **parentPointerToThis)
+{
+	ASTNode *tempCondition(condition);
+	condition->fuseIntervals(&condition);
+	if (tempCondition != condition)
+	{
+		freeNode(tempCondition);
+	}
+
+	ASTNodeNonLeaf::fuseIntervals(parentPointerToThis);
+}
+
+bool ASTNodeSelect::canFail() const
+{
+	return condition->canFail() || leftChild->canFail() || rightChild->canFail();
+}
+
+uint32_t ASTNodeSelect::numberValues(SubexpressionSharing& sharing)
+{
+	const uint32_t conditionNumber = condition->numberValues(sharing);
+	const uint32_t leftNumber = leftChild->numberValues(sharing);
+	const uint32_t rightNumber = rightChild->numberValues(sharing);
+
+	std::ostringstream key;
+	key << static_cast<int>(nodeType()) << '(' << conditionNumber << ',' << leftNumber << ',' << rightNumber << ')';
+
+	valueNumber = sharing.getValueNumber(key.str());
+	return valueNumber;
+}
+
+void ASTNodeSelect::shareSubexpressions(ASTNode **parentPointerToThis, SubexpressionSharing& sharing)
+{
+	ASTNodeNonLeaf *definition = sharing.findDefinition(valueNumber);
+	if (definition)
+	{
+		definition->addSharedUse();
+		*parentPointerToThis = new ASTNodeSharedValue(definition);
+		return;
+	}
+
+	ASTNode *tempCondition(condition);
+	condition->shareSubexpressions(&condition, sharing);
+	if (tempCondition != condition)
+	{
+		freeNode(tempCondition);
+	}
+
+	// either side may be jumped over, so each is guarded on its own and neither can share values
+	// computed in the other
+	ASTNode** sides[] = { &leftChild, &rightChild };
+	for (ASTNode** side : sides)
+	{
+		ASTNode *tempSide(*side);
+		sharing.guards.push_back(tempSide);
+		(*side)->shareSubexpressions(side, sharing);
+		sharing.guards.pop_back();
+
+		if (tempSide != *side)
+		{
+			freeNode(tempSide);
+		}
+	}
+
+	sharing.addDefinition(this, valueNumber);
+}
+
+bool ASTNodeSelect::containsSharedDefinition() const
+{
+	return condition->containsSharedDefinition() || ASTNodeNonLeaf::containsSharedDefinition();
+}
+
+void ASTNodeSelect::gatherConsts(ExpressionDataWriter& writer)
+{
+	condition->gatherConsts(writer);
+	ASTNodeNonLeaf::gatherConsts(writer);
+}
+
+uint32_t ASTNodeSelect::labelRegisterNeed()
+{
+	const uint32_t conditionNeed = condition->labelRegisterNeed();
+	const uint32_t ifTrueNeed = leftChild->labelRegisterNeed();
+	const uint32_t ifFalseNeed = rightChild->labelRegisterNeed();
+
+	// The condition is worked out in this node's register and stays there for SELECT to read, so the
+	// true side starts one register up and the false side above whatever the true side's result holds.
+	ifTrueNeedsRegister = ifTrueNeed > 0;
+	const uint32_t ifFalseStart = ifTrueNeedsRegister ? 2 : 1;
+
+	rightFirst = false;
+	registerNeed = std::max(std::max<uint32_t>(1, conditionNeed),
+		std::max(ifTrueNeed > 0 ? ifTrueNeed + 1 : 0, ifFalseNeed > 0 ? ifFalseNeed + ifFalseStart : 0));
+	return registerNeed;
+}
+
+void ASTNodeSelect::allocateRegisters(uint32_t useRegister, uint32_t& maxRegister)
+{
+	resultRegister = useRegister;
+	if (useRegister > maxRegister)
+	{
+		maxRegister = useRegister;
+	}
+
+	condition->allocateRegisters(useRegister, maxRegister);
+	leftChild->allocateRegisters(useRegister + 1, maxRegister);
+	rightChild->allocateRegisters(useRegister + (ifTrueNeedsRegister ? 2 : 1), maxRegister);
+}
+
+void ASTNodeSelect::allocateSharedRegisters(SubexpressionSharing& sharing)
+{
+	// The condition is copied into the result register before either side runs, so a shared result
+	// register is taken before the sides can be given it for values of their own
+	condition->allocateSharedRegisters(sharing);
+
+	if (sharedUses > 0)
+	{
+		resultRegister = sharing.acquireRegister();
+		sharedUsesLeft = sharedUses;
+	}
+
+	condition->releaseSharedRegister(sharing);
+
+	leftChild->allocateSharedRegisters(sharing);
+	rightChild->allocateSharedRegisters(sharing);
+	leftChild->releaseSharedRegister(sharing);
+	rightChild->releaseSharedRegister(sharing);
+}
+
+ValueRange ASTNodeSelect::analyseRanges(RangeAnalysis& analysis)
+{
+	condition->analyseRanges(analysis);
+
+	// each side is only chosen when the condition came out its way
+	const uint32_t factCount = analysis.getFactCount();
+	condition->addFacts(true, analysis);
+	const ValueRange ifTrue = leftChild->analyseRanges(analysis);
+	analysis.removeFacts(factCount);
+
+	condition->addFacts(false, analysis);
+	const ValueRange ifFalse = rightChild->analyseRanges(analysis);
+	analysis.removeFacts(factCount);
+
+	return ifTrue.unite(ifFalse);
+}
+
+void ASTNodeSelect::generateCode(ExpressionDataWriter& writer)
+{
+	condition->generateCode(writer);
+
+	const ResultInfo conditionRI = condition->getResultInfo();
+	assert(conditionRI.source == eResultSource::Register);
+
+	// a shared condition lives in its own register, so copy it into this one for SELECT to read
+	if (conditionRI.index != resultRegister)
+	{
+		writer.emitInstr(encodeOp(eSimpleOp::AND, eResultSource::Register, eResultSource::Register), resultRegister, conditionRI.index, conditionRI.index);
+	}
+
+	// Both sides run and SELECT keeps one, so there is nothing for the branch predictor to get wrong.
+	// A side that can still divide by zero is jumped over when it isn't chosen though, so that it can't
+	// fail (or set the ieeeDivide status) on a value the expression never uses.
+	ASTNode* sides[] = { leftChild, rightChild };
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		uint32_t jumpIndex(UINT32_MAX);
+		if (sides[i]->canFail())
+		{
+			jumpIndex = writer.emitJump(encodeOp(i == 0 ? eSimpleOp::JUMP_IF_FALSE : eSimpleOp::JUMP_IF_TRUE, eResultSource::Register, eResultSource::Register), resultRegister);
+		}
+
+		sides[i]->generateCode(writer);
+
+		if (jumpIndex != UINT32_MAX)
+		{
+			writer.patchJump(jumpIndex);
+		}
+	}
+
+	const ResultInfo leftRI = leftChild->getResultInfo();
+	const ResultInfo rightRI = rightChild->getResultInfo();
+
+	const eSimpleOp simpleOp = ExprType == eExpType::BOOL ? eSimpleOp::BOOL_SELECT : eSimpleOp::SELECT;
+	assert(simpleOp == eSimpleOp::SELECT || (leftRI.source == eResultSource::Register && rightRI.source == eResultSource::Register));
+
+	writer.emitInstr(encodeOp(simpleOp, leftRI.source, rightRI.source), resultRegister, leftRI.index, rightRI.index);
+}
+
+ExpressionClosureBuilder::Value ASTNodeSelect::lowerToClosure(ExpressionClosureBuilder& builder) const
+{
+	const ExpressionClosureBuilder::Value conditionValue = condition->lowerToClosure(builder);
+	const ExpressionClosureBuilder::Value ifTrueValue = leftChild->lowerToClosure(builder);
+	const ExpressionClosureBuilder::Value ifFalseValue = rightChild->lowerToClosure(builder);
+
+	return builder.addSelect(conditionValue, ifTrueValue, ifFalseValue);
+}
+
+
+/*
+ * ASTNodeInSet
+ *
+ */
+
+ASTNodeInSet::~ASTNodeInSet()
+{
+	for (ASTNode *member : memberNodes)
+	{
+		delete member;
+	}
+}
+
+void ASTNodeInSet::addNumber(float number)
+{
+	// NaN is never equal to the value, so it is left out rather than breaking the sort order
+	if (number != number) return;
+
+	std::vector<float>::iterator it = std::lower_bound(numbers.begin(), numbers.end(), number);
+	if (it == numbers.end() || *it != number)
+	{
+		numbers.insert(it, number);
+	}
+}
+
+void ASTNodeInSet::addName(Name name)
+{
+	std::vector<Name>::iterator it = std::lower_bound(names.begin(), names.end(), name, setNameLess);
+	if (it == names.end() || *it != name)
+	{
+		names.insert(it, name);
+	}
+}
+
+void ASTNodeInSet::addMembersOf(const ASTNode *test)
+{
+	if (test->nodeType() == eASTNodeType::IN_SET)
+	{
+		const ASTNodeInSet *set = static_cast<const ASTNodeInSet*>(test);
+		for (float number : set->numbers) addNumber(number);
+		for (Name name : set->names) addName(name);
+		return;
+	}
+
+	const ASTNodeNonLeaf *comp = static_cast<const ASTNodeNonLeaf*>(test);
+	const ASTNode *constant = comp->leftChild->isConstant() ? comp->leftChild : comp->rightChild;
+
+	if (constant->exprType() == eExpType::NAME)
+	{
+		addName(static_cast<const ASTNodeConstName*>(constant)->getValue());
+	}
+	else
+	{
+		addNumber(static_cast<const ASTNodeConstNumber*>(constant)->getValue());
+	}
+}
+
+ASTNode** ASTNodeInSet::getTestedVariable(ASTNode *test)
+{
+	if (test->exprType() != eExpType::BOOL) return nullptr;
+
+	if (test->nodeType() == eASTNodeType::IN_SET)
+	{
+		ASTNodeInSet *set = static_cast<ASTNodeInSet*>(test);
+		return set->leftChild->nodeType() == eASTNodeType::IDENT ? &set->leftChild : nullptr;
+	}
+
+	if (test->nodeType() == eASTNodeType::COMP_EQ)
+	{
+		ASTNodeNonLeaf *comp = static_cast<ASTNodeNonLeaf*>(test);
+		if (comp->leftChild->exprType() == eExpType::BOOL) return nullptr;
+
+		if (comp->leftChild->nodeType() == eASTNodeType::IDENT && comp->rightChild->isConstant()) return &comp->leftChild;
+		if (comp->rightChild->nodeType() == eASTNodeType::IDENT && comp->leftChild->isConstant()) return &comp->rightChild;
+	}
+
+	return nullptr;
+}
+
+ASTNodeInSet* ASTNodeInSet::mergeTests(ASTNode *left, ASTNode *right)
+{
+	ASTNode **leftVariable = getTestedVariable(left);
+	ASTNode **rightVariable = getTestedVariable(right);
+
+	if (!leftVariable || !rightVariable ||
+		static_cast<const ASTNodeID*>(*leftVariable)->getName() != static_cast<const ASTNodeID*>(*rightVariable)->getName())
+	{
+		return nullptr;
+	}
+
+	ASTNodeInSet *merged = new ASTNodeInSet();
+	merged->ExprType = eExpType::BOOL;
+	merged->addMembersOf(left);
+	merged->addMembersOf(right);
+
+	// the caller frees both tests, so the variable is detached from the left one
+	merged->leftChild = *leftVariable;
+	*leftVariable = nullptr;
+
+	return merged;
+}
+
+bool ASTNodeInSet::typeCheck(const VariableLayout& varLayout, ExpressionErrorReporter& reporter)
+{
+	if (!leftChild->typeCheck(varLayout, reporter)) return false;
+	for (ASTNode *member : memberNodes)
+	{
+		if (!member->typeCheck(varLayout, reporter)) return false;
+	}
+
+	ExprType = eExpType::BOOL;
+
+	if (leftChild->exprType() == eExpType::BOOL)
+	{
+		std::ostringstream msg;
+		msg << "Operator " << getOperatorAsString() << " is invalid with " << getTypeAsString(eExpType::BOOL) << " operands";
+		reporter.addError(eErrorCategory::TypeCheck, eErrorCode::ComparisonTypeError, msg.str());
+
+		return false;
+	}
+
+	for (ASTNode *member : memberNodes)
+	{
+		if (member->exprType() != leftChild->exprType())
+		{
+			std::ostringstream msg;
+			msg << "Members of " << getOperatorAsString() << " must be the same type as the value tested";
+			reporter.addError(eErrorCategory::TypeCheck, eErrorCode::ComparisonTypeError, msg.str());
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// a bound variable is as good as a constant member, so "x in (a, maxRange)" folds with maxRange bound
+void ASTNodeInSet::bindConstants(ASTNode **parentPointerToThis, const ExpressionBindings& bindings)
+{
+	for (ASTNode *&member : memberNodes)
+	{
+		ASTNode *tempMember(member);
+		member->bindConstants(&member, bindings);
+		if (tempMember != member)
+		{
+			freeNode(tempMember);
+		}
+	}
+
+	ASTNodeNonLeaf::bindConstants(parentPointerToThis, bindings);
+}
+
+bool ASTNodeInSet::constFold(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter)
+{
+	for (ASTNode *&member : memberNodes)
+	{
+		ASTNode *tempMember(member);
+		bool memberResult = member->constFold(&member, reporter);
+		if (tempMember != member)
+		{
+			freeNode(tempMember);
+		}
+		if (!memberResult) return false;
+
+		if (!member->isConstant())
+		{
+			std::ostringstream msg;
+			msg << "Members of " << getOperatorAsString() << " must be constant";
+			reporter.addError(eErrorCategory::Const, eErrorCode::SetMemberNotConstant, msg.str());
+
+			return false;
+		}
+
+		if (member->exprType() == eExpType::NAME)
+		{
+			addName(static_cast<ASTNodeConstName*>(member)->getValue());
+		}
+		else
+		{
+			addNumber(static_cast<ASTNodeConstNumber*>(member)->getValue());
+		}
+	}
+
+	for (ASTNode *member : memberNodes)
+	{
+		freeNode(member);
+	}
+	memberNodes.clear();
+
+	return ASTNodeNonLeaf::constFold(parentPointerToThis, reporter);
+}
+
+bool ASTNodeInSet::constFoldThisNode(ASTNode **parentPointerToThis, ExpressionErrorReporter& reporter)
+{
+	const bool isName = leftChild->exprType() == eExpType::NAME;
+
+	if (leftChild->isConstant())
+	{
+		const bool newVal = isName ?
+			isSetMember(names.data(), getMemberCount(), static_cast<ASTNodeConstName*>(leftChild)->getValue()) :
+			isSetMember(numbers.data(), getMemberCount(), static_cast<ASTNodeConstNumber*>(leftChild)->getValue());
+
+		*parentPointerToThis = createConstNode(newVal);
+	}
+	else if (getMemberCount() == 0)
+	{
+		*parentPointerToThis = createConstNode(false);
+	}
+	else if (getMemberCount() == 1)
+	{
+		// x in (a) -> x == a
+		ASTNode *member = isName ? static_cast<ASTNode*>(new ASTNodeConstName(names.front())) : new ASTNodeConstNumber(numbers.front());
+		*parentPointerToThis = ASTNodeComp::createTyped(eASTNodeType::COMP_EQ, leftChild, member);
+		leftChild = nullptr;
+	}
+
+	return true;
+}
+
+uint32_t ASTNodeInSet::numberValues(SubexpressionSharing& sharing)
+{
+	const uint32_t leftNumber = leftChild->numberValues(sharing);
+
+	std::ostringstream key;
+	key << static_cast<int>(nodeType()) << '(' << leftNumber;
+
+	// the members by bit pattern or string pointer, as for constants
+	for (float number : numbers)
+	{
+		uint32_t bits(0);
+		memcpy(&bits, &number, sizeof(bits));
+		key << ",f" << bits;
+	}
+	for (Name name : names)
+	{
+		key << ",n" << static_cast<const void*>(name.c_str());
+	}
+	key << ')';
+
+	valueNumber = sharing.getValueNumber(key.str());
+	return valueNumber;
+}
+
+void ASTNodeInSet::gatherConsts(ExpressionDataWriter& writer)
+{
+	leftChild->gatherConsts(writer);
+	setIndex = leftChild->exprType() == eExpType::NAME ? writer.addNameSet(names) : writer.addNumberSet(numbers);
+}
+
+void ASTNodeInSet::addFacts(bool outcome, RangeAnalysis& analysis) const
+{
+	if (leftChild->exprType() != eExpType::NUMBER || leftChild->nodeType() != eASTNodeType::IDENT || numbers.empty())
+	{
+		return;
+	}
+
+	// a variable in the set lies between its smallest and largest members, one that isn't can't be any of them
+	const bool zeroMember = isSetMember(numbers.data(), getMemberCount(), 0.f);
+	ValueRange range;
+
+	if (outcome)
+	{
+		range = ValueRange(numbers.front(), numbers.back());
+		range.nonZero = !zeroMember;
+	}
+	else
+	{
+		range.nonZero = zeroMember;
+	}
+
+	if (!range.isUnbounded())
+	{
+		analysis.addFact(leftChild->getResultInfo().index, range);
+	}
+}
+
+void ASTNodeInSet::generateCode(ExpressionDataWriter& writer)
+{
+	generateChildCode(writer);
+
+	const ResultInfo valueRI = leftChild->getResultInfo();
+	const eSimpleOp simpleOp = leftChild->exprType() == eExpType::NAME ? eSimpleOp::NAME_IN_SET : eSimpleOp::NUM_IN_SET;
+
+	writer.emitInstr(encodeOp(simpleOp, valueRI.source, eResultSource::Constant), resultRegister, valueRI.index, setIndex);
+}
+
+ExpressionClosureBuilder::Value ASTNodeInSet::lowerToClosure(ExpressionClosureBuilder& builder) const
+{
+	const ExpressionClosureBuilder::Value value = leftChild->lowerToClosure(builder);
+
+	if (leftChild->exprType() == eExpType::NAME)
+	{
+		return builder.addSetTest(value, names);
+	}
+
+	return builder.addSetTest(value, numbers);
+}
+
+
+/*
+ * ASTNodeInRange
+ *
+ */
+
+ASTNodeInRange::~ASTNodeInRange()
+{
+	if (low)
+	{
+		delete low;
+	}
+
+	if (high)
+	{
+		delete high;
+	}
+}
+
+static bool isVariableNamed(const ASTNode* node, Name name)
+{
+	return node->nodeType() == eASTNodeType::IDENT && static_cast<const ASTNodeID*>(node)->getName() == name;
+}
+
+static bool isOrderComparison(eASTNodeType nodeType)
+{
+	return nodeType == eASTNodeType::COMP_LT || nodeType == eASTNodeType::COMP_LTEQ ||
+		nodeType == eASTNodeType::COMP_GT || nodeType == eASTNodeType::COMP_GTEQ;
+}
+
+bool ASTNodeInRange::readBound(ASTNode *test, Name variableName, Bound& bound)
+{
+	eASTNodeType comparison(test->nodeType());
+	if (!isOrderComparison(comparison))
+	{
+		return false;
+	}
+
+	ASTNodeNonLeaf *comp = static_cast<ASTNodeNonLeaf*>(test);
+	bound.variable = &comp->leftChild;
+	bound.bound = &comp->rightChild;
+
+	if (!isVariableNamed(*bound.variable, variableName))
+	{
+		std::swap(bound.variable, bound.bound);
+
+		switch (comparison)
+		{
+		case eASTNodeType::COMP_LT:		comparison = eASTNodeType::COMP_GT;   break;
+		case eASTNodeType::COMP_LTEQ:	comparison = eASTNodeType::COMP_GTEQ; break;
+		case eASTNodeType::COMP_GT:		comparison = eASTNodeType::COMP_LT;   break;
+		case eASTNodeType::COMP_GTEQ:	comparison = eASTNodeType::COMP_LTEQ; break;
+		default: break;
+		}
+	}
+
+	// the bounds are read straight from the constants or variables by the instruction
+	const eASTNodeType boundType = (*bound.bound)->nodeType();
+	if (!isVariableNamed(*bound.variable, variableName) || (boundType != eASTNodeType::VALUE_FLOAT && boundType != eASTNodeType::IDENT))
+	{
+		return false;
+	}
+
+	bound.isLow = comparison == eASTNodeType::COMP_GT || comparison == eASTNodeType::COMP_GTEQ;
+	bound.closed = comparison == eASTNodeType::COMP_GTEQ || comparison == eASTNodeType::COMP_LTEQ;
+	return true;
+}
+
+ASTNodeInRange* ASTNodeInRange::fuseTests(ASTNode *left, ASTNode *right)
+{
+	if (!isOrderComparison(left->nodeType()))
+	{
+		return nullptr;
+	}
+
+	// either side of the left comparison could be the variable the right one also tests
+	const ASTNodeNonLeaf *leftComp = static_cast<const ASTNodeNonLeaf*>(left);
+	const ASTNode* const candidates[] = { leftComp->leftChild, leftComp->rightChild };
+
+	for (const ASTNode *candidate : candidates)
+	{
+		if (candidate->nodeType() != eASTNodeType::IDENT)
+		{
+			continue;
+		}
+
+		const Name name = static_cast<const ASTNodeID*>(candidate)->getName();
+		Bound leftBound, rightBound;
+
+		if (readBound(left, name, leftBound) && readBound(right, name, rightBound) && leftBound.isLow != rightBound.isLow)
+		{
+			const Bound& lowBound = leftBound.isLow ? leftBound : rightBound;
+			const Bound& highBound = leftBound.isLow ? rightBound : leftBound;
+
+			ASTNodeInRange *fused = new ASTNodeInRange(*leftBound.variable, *lowBound.bound, lowBound.closed, *highBound.bound, highBound.closed);
+
+			// the caller frees both comparisons, so what the range test keeps is detached from them
+			*leftBound.variable = nullptr;
+			*lowBound.bound = nullptr;
+			*highBound.bound = nullptr;
+
+			return fused;
+		}
+	}
+
+	return nullptr;
+}
+
+uint32_t ASTNodeInRange::numberValues(SubexpressionSharing& sharing)
+{
+	const uint32_t valueNumber = leftChild->numberValues(sharing);
+	const uint32_t lowNumber = low->numberValues(sharing);
+	const uint32_t highNumber = high->numberValues(sharing);
+
+	std::ostringstream key;
+	key << static_cast<int>(nodeType()) << '(' << valueNumber << ',' << (lowClosed ? '[' : '(') << lowNumber << ',' << highNumber << (highClosed ? ']' : ')') << ')';
+
+	this->valueNumber = sharing.getValueNumber(key.str());
+	return this->valueNumber;
+}
+
+void ASTNodeInRange::gatherConsts(ExpressionDataWriter& writer)
+{
+	leftChild->gatherConsts(writer);
+	low->gatherConsts(writer);
+	high->gatherConsts(writer);
+
+	rangeIndex = writer.addRange(low->getResultInfo(), high->getResultInfo());
+}
+
+void ASTNodeInRange::addFacts(bool outcome, RangeAnalysis& analysis) const
+{
+	// a failed test doesn't say which bound the variable is outside of
+	if (!outcome)
+	{
+		return;
+	}
+
+	const float infinity = std::numeric_limits<float>::infinity();
+	ValueRange range(-infinity, infinity);
+
+	if (isConstNumber(low))
+	{
+		range.minValue = static_cast<const ASTNodeConstNumber*>(low)->getValue();
+		range.nonZero = range.nonZero || (!lowClosed && range.minValue >= 0.f);
+	}
+
+	if (isConstNumber(high))
+	{
+		range.maxValue = static_cast<const ASTNodeConstNumber*>(high)->getValue();
+		range.nonZero = range.nonZero || (!highClosed && range.maxValue <= 0.f);
+	}
+
+	if (!range.isUnbounded())
+	{
+		analysis.addFact(leftChild->getResultInfo().index, range);
+	}
+}
+
+void ASTNodeInRange::generateCode(ExpressionDataWriter& writer)
+{
+	eSimpleOp simpleOp;
+	if (lowClosed)
+	{
+		simpleOp = highClosed ? eSimpleOp::NUM_IN_RANGE_CC : eSimpleOp::NUM_IN_RANGE_CO;
+	}
+	else
+	{
+		simpleOp = highClosed ? eSimpleOp::NUM_IN_RANGE_OC : eSimpleOp::NUM_IN_RANGE_OO;
+	}
+
+	const ResultInfo valueRI = leftChild->getResultInfo();
+	assert(valueRI.source == eResultSource::Variable);
+
+	writer.emitInstr(encodeOp(simpleOp, eResultSource::Variable, eResultSource::Constant), resultRegister, valueRI.index, rangeIndex);
+}
+
+ExpressionClosureBuilder::Value ASTNodeInRange::lowerToClosure(ExpressionClosureBuilder& builder) const
+{
+	return builder.addRangeTest(leftChild->lowerToClosure(builder), low->lowerToClosure(builder), lowClosed, high->lowerToClosure(builder), highClosed);
+}
+
+
+/*
+ * ASTNodeConst
+ *
+ */
+
+uint32_t ASTNodeConstNumber::numberValues(SubexpressionSharing& sharing)
+{
+	// by bit pattern, so 0 and -0 stay apart
+	uint32_t bits(0);
+	memcpy(&bits, &value, sizeof(bits));
+
+	std::ostringstream key;
+	key << 'f' << bits;
+	return sharing.getValueNumber(key.str());
+}
+
+void ASTNodeConstNumber::gatherConsts(ExpressionDataWriter& writer)
+{
+	constSlotIndex = writer.addNumericConst(getValue());
+}
+
+ResultInfo ASTNodeConstNumber::getResultInfo() const
+{
+	return ResultInfo(eResultSource::Constant, constSlotIndex);
+}
+
+ExpressionClosureBuilder::Value ASTNodeConstNumber::lowerToClosure(ExpressionClosureBuilder& builder) const
+{
+	return ExpressionClosureBuilder::Value::makeConst(value);
+}
+
+uint32_t ASTNodeConstName::numberValues(SubexpressionSharing& sharing)
+{
+	// names are interned, so equal names share a string pointer
+	std::ostringstream key;
+	key << 'n' << static_cast<const void*>(value.c_str());
+	return sharing.getValueNumber(key.str());
+}
+
+void ASTNodeConstName::gatherConsts(ExpressionDataWriter& writer)
+{
+	constSlotIndex = writer.addNameConst(getValue());
+}
+
+ResultInfo ASTNodeConstName::getResultInfo() const
+{
+	return ResultInfo(eResultSource::Constant, constSlotIndex);
+}
+
+ExpressionClosureBuilder::Value ASTNodeConstName::lowerToClosure(ExpressionClosureBuilder& builder) const
+{
+	return ExpressionClosureBuilder::Value::makeConst(value);
+}
+
+uint32_t ASTNodeConstBool::numberValues(SubexpressionSharing& sharing)
+{
+	return sharing.getValueNumber(value ? "b1" : "b0");
+}
+
+ResultInfo ASTNodeConstBool::getResultInfo() const
+{
+	return ResultInfo(eResultSource::Constant, 0);
+}
+
+ExpressionClosureBuilder::Value ASTNodeConstBool::lowerToClosure(ExpressionClosureBuilder& builder) const
+{
+	return ExpressionClosureBuilder::Value::makeConst(value);
+}
+
+
+/*
+ * ASTNodeID
+ *
+ */
+
+bool ASTNodeID::typeCheck(const VariableLayout& varLayout, ExpressionErrorReporter& reporter)
+{
+	if (!varLayout.variableExists(name))
+	{
+		std::ostringstream msg;
+		msg << "Variable '" << name.c_str() << "' does not exist";
+		reporter.addError(eErrorCategory::Identifier, eErrorCode::IdentifierNotFound, msg.str());
+	
+		return false;
+	}
+
+	slotIndex = varLayout.getIndex(name);
+	ExprType = varLayout.getType(name);
+
+	if (ExprType == eExpType::NUMBER)
+	{
+		declaredRange = varLayout.getRange(name);
+	}
+
+	return true;
+}
+
+void ASTNodeID::bindConstants(ASTNode **parentPointerToThis, const ExpressionBindings& bindings)
+{
+	if (ExprType == eExpType::NUMBER)
+	{
+		const float* value = bindings.findNumber(slotIndex);
+		if (value)
+		{
+			*parentPointerToThis = createConstNode(*value);
+		}
+	}
+	else
+	{
+		const Name* value = bindings.findName(slotIndex);
+		if (value)
+		{
+			*parentPointerToThis = new ASTNodeConstName(*value);
+		}
+	}
+}
+
+uint32_t ASTNodeID::numberValues(SubexpressionSharing& sharing)
+{
+	std::ostringstream key;
+	key << 'v' << static_cast<int>(ExprType) << ':' << slotIndex;
+	return sharing.getValueNumber(key.str());
+}
+
+ValueRange ASTNodeID::analyseRanges(RangeAnalysis& analysis)
+{
+	if (ExprType != eExpType::NUMBER)
+	{
+		return ValueRange();
+	}
+
+	return analysis.getVariableRange(slotIndex, declaredRange);
+}
+
+ResultInfo ASTNodeID::getResultInfo() const
+{
+	return ResultInfo(eResultSource::Variable, slotIndex);
+}
+
+ExpressionClosureBuilder::Value ASTNodeID::lowerToClosure(ExpressionClosureBuilder& builder) const
+{
+	return ExpressionClosureBuilder::Value::makeVariable(ExprType, slotIndex);
+}
+
+
+/*
+ * SubexpressionSharing
+ *
+ */
+
+uint32_t SubexpressionSharing::getValueNumber(const std::string& key)
+{
+	auto it = valueNumbers.find(key);
+	if (it != valueNumbers.end())
+	{
+		return it->second;
+	}
+
+	const uint32_t valueNumber = valueNumbers.size() + 1;
+	valueNumbers[key] = valueNumber;
+	return valueNumber;
+}
+
+void SubexpressionSharing::addDefinition(ASTNodeNonLeaf *node, uint32_t valueNumber)
+{
+	Definition definition;
+	definition.node = node;
+	definition.guards = guards;
+	definitions.insert(std::make_pair(valueNumber, definition));
+}
+
+ASTNodeNonLeaf* SubexpressionSharing::findDefinition(uint32_t valueNumber) const
+{
+	// a definition can be used if it's always run before this point - when every && or || guarding
+	// it also guards the current node
+	auto range = definitions.equal_range(valueNumber);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		const std::vector<const ASTNode*>& definitionGuards = it->second.guards;
+		if (definitionGuards.size() <= guards.size() && std::equal(definitionGuards.begin(), definitionGuards.end(), guards.begin()))
+		{
+			return it->second.node;
+		}
+	}
+
+	return nullptr;
+}
+
+uint32_t SubexpressionSharing::acquireRegister()
+{
+	uint32_t index(0);
+	while (index < registerInUse.size() && registerInUse[index])
+	{
+		++index;
+	}
+
+	if (index == registerInUse.size())
+	{
+		registerInUse.push_back(false);
+	}
+
+	registerInUse[index] = true;
+
+	const uint32_t reg = firstRegister + index;
+	maxRegister = std::max(maxRegister, reg);
+	return reg;
+}
+
+void SubexpressionSharing::releaseRegister(uint32_t reg)
+{
+	assert(reg >= firstRegister && registerInUse[reg - firstRegister]);
+	registerInUse[reg - firstRegister] = false;
+}
+
+
+/*
+ * RangeAnalysis
+ *
+ */
+
+void RangeAnalysis::addFact(ExpressionSlotIndex slotIndex, const ValueRange& range)
+{
+	Fact fact = { slotIndex, range };
+	facts.push_back(fact);
+}
+
+void RangeAnalysis::removeFacts(uint32_t factCount)
+{
+	assert(factCount <= facts.size());
+	facts.erase(facts.begin() + factCount, facts.end());
+}
+
+ValueRange RangeAnalysis::getVariableRange(ExpressionSlotIndex slotIndex, const ValueRange& declaredRange) const
+{
+	ValueRange range(declaredRange);
+	for (const Fact& fact : facts)
+	{
+		if (fact.slotIndex == slotIndex)
+		{
+			range = range.intersect(fact.range);
+		}
+	}
+
+	return range;
+}
+
+
+/*
+ * Node creation functions
+ */
+
+ASTNode* createNode(eASTNodeType _nodeType, ASTNode* _leftChild, ASTNode* _rightChild)
+{
+	ASTNode* retval(nullptr);
+
+	switch (_nodeType)
+	{
+	case eASTNodeType::LOGICAL_OR:	retval = new ASTNodeLogic(_nodeType, _leftChild, _rightChild); break;
+	case eASTNodeType::LOGICAL_AND:	retval = new ASTNodeLogic(_nodeType, _leftChild, _rightChild); break;
+	case eASTNodeType::LOGICAL_NOT:	retval = new ASTNodeLogic(_nodeType, _leftChild, _rightChild); break;
+
+	case eASTNodeType::COMP_EQ:		retval = new ASTNodeComp(_nodeType, _leftChild, _rightChild); break;
+	case eASTNodeType::COMP_NEQ:	retval = new ASTNodeComp(_nodeType, _leftChild, _rightChild); break;
+	case eASTNodeType::COMP_LT:		retval = new ASTNodeComp(_nodeType, _leftChild, _rightChild); break;
+	case eASTNodeType::COMP_LTEQ:	retval = new ASTNodeComp(_nodeType, _leftChild, _rightChild); break;
+	case eASTNodeType::COMP_GT:		retval = new ASTNodeComp(_nodeType, _leftChild, _rightChild); break;
+	case eASTNodeType::COMP_GTEQ:	retval = new ASTNodeComp(_nodeType, _leftChild, _rightChild); break;
+
+	case eASTNodeType::ARITH_ADD:	retval = new ASTNodeArith(_nodeType, _leftChild, _rightChild); break;
+	case eASTNodeType::ARITH_SUB:	retval = new ASTNodeArith(_nodeType, _leftChild, _rightChild); break;
+	case eASTNodeType::ARITH_MUL:	retval = new ASTNodeArith(_nodeType, _leftChild, _rightChild); break;
+	case eASTNodeType::ARITH_DIV:	retval = new ASTNodeArith(_nodeType, _leftChild, _rightChild); break;
+	case eASTNodeType::ARITH_MOD:	retval = new ASTNodeArith(_nodeType, _leftChild, _rightChild); break;
+
+	default:
+		assert(0);
+	}
+
+	return retval;
+}
+
+ASTNode *createConstNode(float _value)
+{
+	return new ASTNodeConstNumber(_value);
+}
+
+ASTNode *createConstNode(bool _value)
+{
+	return new ASTNodeConstBool(_value);
+}
+
+ASTNode *createConstNode(const char *_value)
+{
+	Name nameValue(_value);
+	return new ASTNodeConstName(nameValue);
+}
+
+ASTNode *createIDNode(const char *_id)
+{
+	return new ASTNodeID(_id);
+}
+
+ASTNode *createSelectNode(ASTNode* _condition, ASTNode* _ifTrue, ASTNode* _ifFalse)
+{
+	return new ASTNodeSelect(_condition, _ifTrue, _ifFalse);
+}
+
+ASTNode *createSetNode(ASTNode* _firstMember)
+{
+	ASTNodeInSet *set = new ASTNodeInSet();
+	set->addMemberNode(_firstMember);
+	return set;
+}
+
+ASTNode *addSetMember(ASTNode* _set, ASTNode* _member)
+{
+	static_cast<ASTNodeInSet*>(_set)->addMemberNode(_member);
+	return _set;
+}
+
+ASTNode *createInNode(ASTNode* _value, ASTNode* _set)
+{
+	static_cast<ASTNodeInSet*>(_set)->setValue(_value);
+	return _set;
+}
+
+void freeNode(ASTNode *node)
+{
+	assert(node);
+	delete node;
+}
+
+
+/*
+ * VariableLayout
+ *
+ */
+
+ExpressionSlotIndex VariableLayout::addVariable(Name name, eExpType type)
+{
+	if (variableExists(name))
+	{
+		assert(getType(name) == type);
+		return getIndex(name);
+	}
+
+	ExpressionSlotIndex slotIndex(0);
+
+	if (type == eExpType::NUMBER)
+	{
+		slotIndex = numberCount;
+		numberCount += 1;
+		numberRanges.push_back(ValueRange());
+	}
+	else if (type == eExpType::NAME)
+	{
+		slotIndex = nameCount;
+		nameCount += 1;
+	}
+	else
+	{
+		// bool variables not allowed
+		assert(false);
+		return 0;
+	}
+
+	layout.emplace(name, Info(type, slotIndex, ValueRange()));
+	return slotIndex;
+}
+
+ExpressionSlotIndex VariableLayout::addVariable(Name name, const ValueRange& range)
+{
+	const ExpressionSlotIndex slotIndex = addVariable(name, eExpType::NUMBER);
+	layout.find(name)->second.range = range;
+	numberRanges[slotIndex] = range;
+	return slotIndex;
+}
+
+ExpressionSlotIndex VariableLayout::addDerivedVariable(Name name, const char* formula, ExpressionErrorReporter* errors)
+{
+	assert(!variableExists(name));
+
+	// compiled against the layout as it is, so the formula can't read this variable or any added after it
+	ExpressionCompileOptions options;
+	options.ieeeDivide = true;
+	ExpressionCompiler compiler(this, options);
+	std::shared_ptr<const ExpressionData> expression(compiler.compile(formula));
+
+	if (!expression || expression->resultType != eExpType::NUMBER)
+	{
+		if (errors && expression)
+		{
+			errors->addError(eErrorCategory::TypeCheck, eErrorCode::DerivedVariableType, "Derived variables must be numbers");
+		}
+		else if (errors)
+		{
+			for (uint32_t i = 0; i < compiler.errors().errorCount(); ++i)
+			{
+				const ExpressionErrorReporter::Info& error = compiler.errors().error(i);
+				errors->addError(error.category, error.code, error.message);
+			}
+		}
+		return EXP_SLOT_INDEX_MAX;
+	}
+
+	const ExpressionSlotIndex slotIndex = addVariable(name, eExpType::NUMBER);
+	const uint32_t derivedIndex = static_cast<uint32_t>(derivedVariables.size());
+
+	DerivedVariable derived = { slotIndex, expression };
+	derivedVariables.push_back(derived);
+
+	derivedSlots.resize(numberCount, false);
+	derivedSlots[slotIndex] = true;
+	numberDependents.resize(numberCount);
+	nameDependents.resize(nameCount);
+
+	// the derived variables this one reads
+	std::vector<uint32_t> derivedInputs;
+	for (uint32_t i = 0; i < derivedIndex; ++i)
+	{
+		if (std::binary_search(expression->numberInputs.begin(), expression->numberInputs.end(), derivedVariables[i].slotIndex))
+		{
+			derivedInputs.push_back(i);
+		}
+	}
+
+	// A slot changes this variable if the formula reads it, or it changes one of the derived variables
+	// the formula reads. Added last, this variable is computed after all of those.
+	auto addDependent = [&](std::vector<uint32_t>& dependents, bool isInput)
+	{
+		bool affects = isInput;
+		for (uint32_t i = 0; !affects && i < derivedInputs.size(); ++i)
+		{
+			affects = std::find(dependents.begin(), dependents.end(), derivedInputs[i]) != dependents.end();
+		}
+
+		if (affects)
+		{
+			dependents.push_back(derivedIndex);
+		}
+	};
+
+	for (ExpressionSlotIndex i = 0; i < numberCount; ++i)
+	{
+		addDependent(numberDependents[i], std::binary_search(expression->numberInputs.begin(), expression->numberInputs.end(), i));
+	}
+
+	for (ExpressionSlotIndex i = 0; i < nameCount; ++i)
+	{
+		addDependent(nameDependents[i], std::binary_search(expression->nameInputs.begin(), expression->nameInputs.end(), i));
+	}
+
+	return slotIndex;
+}
+
+Name VariableLayout::getVariableAt(eExpType type, ExpressionSlotIndex slotIndex) const
+{
+	for (const auto& variable : layout)
+	{
+		if (variable.second.type == type && variable.second.index == slotIndex)
+		{
+			return variable.first;
+		}
+	}
+
+	return Name();
+}
+
+
+/*
+ * VariablePack
+ */
+
+void VariablePack::computeDerived(const std::vector<uint32_t>& derivedIndices, bool stamp)
+{
+	for (uint32_t derivedIndex : derivedIndices)
+	{
+		const VariableLayout::DerivedVariable& derived = layout->getDerived(derivedIndex);
+
+		// compiled with ieeeDivide, so a zero divisor still gives a value
+		bool divideByZero(false);
+		const float value = derived.expression->closureCode->run(this, divideByZero);
+
+		if (stamp)
+		{
+			storeNumber(derived.slotIndex, value);
+		}
+		else
+		{
+			floatVars[derived.slotIndex] = value;
+		}
+	}
+}
+
+
+/*
+ * ExpressionBindings
+ */
+
+void ExpressionBindings::bindNumber(ExpressionSlotIndex slotIndex, float value)
+{
+	auto it = std::lower_bound(numbers.begin(), numbers.end(), slotIndex,
+		[](const NumberBinding& binding, ExpressionSlotIndex index) { return binding.slotIndex < index; });
+
+	if (it != numbers.end() && it->slotIndex == slotIndex)
+	{
+		it->value = value;
+	}
+	else
+	{
+		NumberBinding binding = { slotIndex, value };
+		numbers.insert(it, binding);
+	}
+}
+
+void ExpressionBindings::bindName(ExpressionSlotIndex slotIndex, Name value)
+{
+	auto it = std::lower_bound(names.begin(), names.end(), slotIndex,
+		[](const NameBinding& binding, ExpressionSlotIndex index) { return binding.slotIndex < index; });
+
+	if (it != names.end() && it->slotIndex == slotIndex)
+	{
+		it->value = value;
+	}
+	else
+	{
+		NameBinding binding = { slotIndex, value };
+		names.insert(it, binding);
+	}
+}
+
+void ExpressionBindings::bindVariable(Name variableName, const VariablePack& variables)
+{
+	const VariableLayout* layout = variables.getLayout();
+	const ExpressionSlotIndex slotIndex = layout->getIndex(variableName);
+
+	if (layout->getType(variableName) == eExpType::NUMBER)
+	{
+		bindNumber(slotIndex, variables.getVariableNumber(slotIndex));
+	}
+	else
+	{
+		bindName(slotIndex, variables.getVariableName(slotIndex));
+	}
+}
+
+const float* ExpressionBindings::findNumber(ExpressionSlotIndex slotIndex) const
+{
+	auto it = std::lower_bound(numbers.begin(), numbers.end(), slotIndex,
+		[](const NumberBinding& binding, ExpressionSlotIndex index) { return binding.slotIndex < index; });
+
+	return it != numbers.end() && it->slotIndex == slotIndex ? &it->value : nullptr;
+}
+
+const Name* ExpressionBindings::findName(ExpressionSlotIndex slotIndex) const
+{
+	auto it = std::lower_bound(names.begin(), names.end(), slotIndex,
+		[](const NameBinding& binding, ExpressionSlotIndex index) { return binding.slotIndex < index; });
+
+	return it != names.end() && it->slotIndex == slotIndex ? &it->value : nullptr;
+}
+
+
+/*
+ * ExpressionDataWriter
+ */
+
+ExpressionDataWriter::ExpressionDataWriter()
+{
+	data = new ExpressionData();
+}
+
+ExpressionDataWriter::~ExpressionDataWriter()
+{
+	if (data)
+	{
+		delete data;
+	}
+}
+
+ExpressionSlotIndex ExpressionDataWriter::addNumericConst(float value)
+{
+	for (size_t i = 0; i < data->const_floats.size(); i++)
+	{
+		if (data->const_floats[i] == value)
+		{
+			return static_cast<ExpressionSlotIndex>(i);
+		}
+	}
+
+	data->const_floats.push_back(value);
+	return static_cast<ExpressionSlotIndex>(data->const_floats.size()-1);
+}
+
+ExpressionSlotIndex ExpressionDataWriter::addNameConst(Name value)
+{
+	for (size_t i = 0; i < data->const_names.size(); i++)
+	{
+		if (data->const_names[i] == value)
+		{
+			return static_cast<ExpressionSlotIndex>(i);
+		}
+	}
+
+	data->const_names.push_back(value);
+	return static_cast<ExpressionSlotIndex>(data->const_names.size()-1);
+}
+
+ExpressionSlotIndex ExpressionDataWriter::addNumberSet(const std::vector<float>& members)
+{
+	const ExpressionSet set = { static_cast<uint32_t>(data->set_floats.size()), static_cast<uint32_t>(members.size()) };
+	data->set_floats.insert(data->set_floats.end(), members.begin(), members.end());
+
+	data->const_sets.push_back(set);
+	return static_cast<ExpressionSlotIndex>(data->const_sets.size()-1);
+}
+
+ExpressionSlotIndex ExpressionDataWriter::addNameSet(const std::vector<Name>& members)
+{
+	const ExpressionSet set = { static_cast<uint32_t>(data->set_names.size()), static_cast<uint32_t>(members.size()) };
+	data->set_names.insert(data->set_names.end(), members.begin(), members.end());
 
-	writer.emitInstr(encOp, resultRegister, leftRI.index, rightRI.index);
+	data->const_sets.push_back(set);
+	return static_cast<ExpressionSlotIndex>(data->const_sets.size()-1);
 }
 
+ExpressionSlotIndex ExpressionDataWriter::addRange(const ResultInfo& low, const ResultInfo& high)
+{
+	const ExpressionRange range = { low.index, high.index, low.source == eResultSource::Variable, high.source == eResultSource::Variable };
 
-/*
- * ASTNodeConst
- *
- */
+	data->const_ranges.push_back(range);
+	return static_cast<ExpressionSlotIndex>(data->const_ranges.size()-1);
+}
 
-void ASTNodeConstNumber::gatherConsts(ExpressionDataWriter& writer)
+void ExpressionDataWriter::addInput(eExpType type, ExpressionSlotIndex slotIndex)
 {
-	constSlotIndex = writer.addNumericConst(getValue());
+	std::vector<ExpressionSlotIndex>& inputs = type == eExpType::NAME ? data->nameInputs : data->numberInputs;
+
+	auto it = std::lower_bound(inputs.begin(), inputs.end(), slotIndex);
+	if (it == inputs.end() || *it != slotIndex)
+	{
+		inputs.insert(it, slotIndex);
+	}
 }
 
-ResultInfo ASTNodeConstNumber::getResultInfo() const
+void ExpressionDataWriter::emitInstr(eEncOpcode opcode, ExpressionSlotIndex resultReg, ExpressionSlotIndex leftOperand, ExpressionSlotIndex rightOperand)
 {
-	return ResultInfo(eResultSource::Constant, constSlotIndex);
+	uint32_t codeA = (static_cast<uint16_t>(opcode) << 16) | (resultReg & 0xffff);
+	uint32_t codeB = (leftOperand << 16) | (rightOperand & 0xffff);
+
+	data->byteCode.push_back(codeA);
+	data->byteCode.push_back(codeB);
 }
 
-void ASTNodeConstName::gatherConsts(ExpressionDataWriter& writer)
+uint32_t ExpressionDataWriter::emitJump(eEncOpcode opcode, ExpressionSlotIndex conditionReg)
 {
-	constSlotIndex = writer.addNameConst(getValue());
+	const uint32_t jumpIndex = static_cast<uint32_t>(data->byteCode.size() / 2);
+	emitInstr(opcode, 0, conditionReg, 0);
+	return jumpIndex;
 }
 
-ResultInfo ASTNodeConstName::getResultInfo() const
+void ExpressionDataWriter::patchJump(uint32_t jumpIndex)
 {
-	return ResultInfo(eResultSource::Constant, constSlotIndex);
+	const uint32_t skipCount = static_cast<uint32_t>(data->byteCode.size() / 2) - jumpIndex - 1;
+	assert(skipCount <= 0xffff);
+
+	uint32_t& codeB = data->byteCode[jumpIndex * 2 + 1];
+	codeB = (codeB & 0xffff0000) | (skipCount & 0xffff);
 }
 
-ResultInfo ASTNodeConstBool::getResultInfo() const
+ExpressionData* ExpressionDataWriter::getData()
 {
-	return ResultInfo(eResultSource::Constant, 0);
+	ExpressionData* tempData = data;
+	data = nullptr;
+
+	return tempData;
 }
 
 
 /*
- * ASTNodeID
+ * ExpressionEvaluator
  *
  */
 
-bool ASTNodeID::typeCheck(const VariableLayout& varLayout, ExpressionErrorReporter& reporter)
-{
-	if (!varLayout.variableExists(name))
-	{
-		std::ostringstream msg;
-		msg << "Variable '" << name.c_str() << "' does not exist";
-		reporter.addError(eErrorCategory::Identifier, eErrorCode::IdentifierNotFound, msg.str());
-	
-		return false;
-	}
+// Computed goto ("labels as values") is a GCC/Clang extension. Other compilers use the portable
+// fallback, which still runs from the pre-decoded stream but dispatches through a switch.
+#ifndef EXPRESSION_COMPUTED_GOTO
+#if defined(__GNUC__) || defined(__clang__)
+#define EXPRESSION_COMPUTED_GOTO 1
+#else
+#define EXPRESSION_COMPUTED_GOTO 0
+#endif
+#endif
 
-	slotIndex = varLayout.getIndex(name);
-	ExprType = varLayout.getType(name);
+#define FLOAT_DIV(LEFT,RIGHT) ((LEFT) / (RIGHT))
 
-	return true;
+// non-trapping divides for ieeeDivide expressions, recording a zero divisor in the dispatch loop's status
+#define IEEE_DIV(LEFT,RIGHT) ieeeDivide((LEFT), (RIGHT), status)
+#define IEEE_MOD(LEFT,RIGHT) ieeeModulo((LEFT), (RIGHT), status)
+
+static inline float ieeeDivide(float left, float right, uint32_t& status)
+{
+	status |= right == 0.f ? EXP_STATUS_DIVIDE_BY_ZERO : 0;
+	return FLOAT_DIV(left, right);
 }
 
-ResultInfo ASTNodeID::getResultInfo() const
+static inline float ieeeModulo(float left, float right, uint32_t& status)
 {
-	return ResultInfo(eResultSource::Variable, slotIndex);
+	status |= right == 0.f ? EXP_STATUS_DIVIDE_BY_ZERO : 0;
+	return fmodf(left, right);
 }
 
+// Handler indices, in the same order as ExpressionHandlers.inl. END terminates a threaded stream.
+enum class eHandler : uint16_t
+{
+#define OPERATION_HANDLER(OP,EXPR) OP,
+#define BOOL_HANDLER(OP,EXPR) OP,
+#define DIVIDE_HANDLER(OP,LEFT,RIGHT,FUNC) OP,
+#define JUMP_HANDLER(OP,COND) OP,
+#include "ExpressionHandlers.inl"
 
-/*
- * Node creation functions
- */
+	END,
 
-ASTNode* createNode(eASTNodeType _nodeType, ASTNode* _leftChild, ASTNode* _rightChild)
-{
-	ASTNode* retval(nullptr);
+	// fused sequences, only found in compactCode
+#define SUPERINSTRUCTION2(A,B) A##_##B,
+#define SUPERINSTRUCTION3(A,B,C) A##_##B##_##C,
+#include "ExpressionSuperinstructions.inl"
 
-	switch (_nodeType)
-	{
-	case eASTNodeType::LOGICAL_OR:	retval = new ASTNodeLogic(_nodeType, _leftChild, _rightChild); break;
-	case eASTNodeType::LOGICAL_AND:	retval = new ASTNodeLogic(_nodeType, _leftChild, _rightChild); break;
-	case eASTNodeType::LOGICAL_NOT:	retval = new ASTNodeLogic(_nodeType, _leftChild, _rightChild); break;
+	HANDLER_MAX
+};
 
-	case eASTNodeType::COMP_EQ:		retval = new ASTNodeComp(_nodeType, _leftChild, _rightChild); break;
-	case eASTNodeType::COMP_NEQ:	retval = new ASTNodeComp(_nodeType, _leftChild, _rightChild); break;
-	case eASTNodeType::COMP_LT:		retval = new ASTNodeComp(_nodeType, _leftChild, _rightChild); break;
-	case eASTNodeType::COMP_LTEQ:	retval = new ASTNodeComp(_nodeType, _leftChild, _rightChild); break;
-	case eASTNodeType::COMP_GT:		retval = new ASTNodeComp(_nodeType, _leftChild, _rightChild); break;
-	case eASTNodeType::COMP_GTEQ:	retval = new ASTNodeComp(_nodeType, _leftChild, _rightChild); break;
+static_assert(static_cast<uint16_t>(eHandler::HANDLER_MAX) <= 256, "compact instructions hold the handler index in 8 bits");
 
-	case eASTNodeType::ARITH_ADD:	retval = new ASTNodeArith(_nodeType, _leftChild, _rightChild); break;
-	case eASTNodeType::ARITH_SUB:	retval = new ASTNodeArith(_nodeType, _leftChild, _rightChild); break;
-	case eASTNodeType::ARITH_MUL:	retval = new ASTNodeArith(_nodeType, _leftChild, _rightChild); break;
-	case eASTNodeType::ARITH_DIV:	retval = new ASTNodeArith(_nodeType, _leftChild, _rightChild); break;
-	case eASTNodeType::ARITH_MOD:	retval = new ASTNodeArith(_nodeType, _leftChild, _rightChild); break;
+static eHandler getHandlerForOpcode(eEncOpcode op)
+{
+	switch (op)
+	{
+#define OPERATION_HANDLER(OP,EXPR) case eEncOpcode::OP: return eHandler::OP;
+#define BOOL_HANDLER(OP,EXPR) case eEncOpcode::OP: return eHandler::OP;
+#define DIVIDE_HANDLER(OP,LEFT,RIGHT,FUNC) case eEncOpcode::OP: return eHandler::OP;
+#define JUMP_HANDLER(OP,COND) case eEncOpcode::OP: return eHandler::OP;
+#include "ExpressionHandlers.inl"
 
 	default:
-		assert(0);
+		assert(false);
+		return eHandler::END;
 	}
-
-	return retval;
 }
 
-ASTNode *createConstNode(float _value)
+// the superinstruction starting with the handlers at code, if any, and how many words it covers
+static eHandler getSuperinstruction(const uint32_t* code, uint32_t wordsLeft, uint32_t& length)
 {
-	return new ASTNodeConstNumber(_value);
+	const eHandler first = static_cast<eHandler>(code[0] >> 24);
+	const eHandler second = wordsLeft >= 2 ? static_cast<eHandler>(code[1] >> 24) : eHandler::END;
+	const eHandler third = wordsLeft >= 3 ? static_cast<eHandler>(code[2] >> 24) : eHandler::END;
+
+	// longest match first
+#define SUPERINSTRUCTION2(A,B)
+#define SUPERINSTRUCTION3(A,B,C) \
+	if (first == eHandler::A && second == eHandler::B && third == eHandler::C) { length = 3; return eHandler::A##_##B##_##C; }
+#include "ExpressionSuperinstructions.inl"
+
+#define SUPERINSTRUCTION2(A,B) \
+	if (first == eHandler::A && second == eHandler::B) { length = 2; return eHandler::A##_##B; }
+#define SUPERINSTRUCTION3(A,B,C)
+#include "ExpressionSuperinstructions.inl"
+
+	length = 1;
+	return first;
 }
 
-ASTNode *createConstNode(bool _value)
+// the number of compact words the handler covers, more than one for a superinstruction
+static uint32_t getHandlerLength(eHandler handler)
 {
-	return new ASTNodeConstBool(_value);
-}
+	switch (handler)
+	{
+#define SUPERINSTRUCTION2(A,B) case eHandler::A##_##B: return 2;
+#define SUPERINSTRUCTION3(A,B,C) case eHandler::A##_##B##_##C: return 3;
+#include "ExpressionSuperinstructions.inl"
 
-ASTNode *createConstNode(const char *_value)
-{
-	Name nameValue(_value);
-	return new ASTNodeConstName(nameValue);
+	default:
+		return 1;
+	}
 }
 
-ASTNode *createIDNode(const char *_id)
+const char* getOpcodeAsString(eEncOpcode opcode)
 {
-	return new ASTNodeID(_id);
+	switch (opcode)
+	{
+#define OPERATION_HANDLER(OP,EXPR) case eEncOpcode::OP: return #OP;
+#define BOOL_HANDLER(OP,EXPR) case eEncOpcode::OP: return #OP;
+#define DIVIDE_HANDLER(OP,LEFT,RIGHT,FUNC) case eEncOpcode::OP: return #OP;
+#define JUMP_HANDLER(OP,COND) case eEncOpcode::OP: return #OP;
+#include "ExpressionHandlers.inl"
+
+	default:
+		return "UNKNOWN";
+	}
 }
 
-void freeNode(ASTNode *node)
+uint32_t getCompactDispatchCount(const ExpressionData& exprData)
 {
-	assert(node);
-	delete node;
+	uint32_t count(0);
+	for (uint32_t IP = 0; IP < exprData.compactCode.size(); IP += getHandlerLength(static_cast<eHandler>(exprData.compactCode[IP] >> 24)))
+	{
+		++count;
+	}
+
+	return count;
 }
 
 
+#define GET_LEFT_REG (reg[leftOp])
+#define GET_LEFT_REG_BOOL (boolReg[leftOp])
+#define GET_LEFT_NUM_VAR (variables->getVariableNumber(leftOp))
+#define GET_LEFT_NAME_VAR (variables->getVariableName(leftOp))
+#define GET_LEFT_NUM_CONST (exprData->const_floats[leftOp])
+#define GET_LEFT_NAME_CONST (exprData->const_names[leftOp])
+#define GET_RIGHT_REG (reg[rightOp])
+#define GET_RIGHT_REG_BOOL (boolReg[rightOp])
+#define GET_RIGHT_NUM_VAR (variables->getVariableNumber(rightOp))
+#define GET_RIGHT_NAME_VAR (variables->getVariableName(rightOp))
+#define GET_RIGHT_NUM_CONST (exprData->const_floats[rightOp])
+#define GET_RIGHT_NAME_CONST (exprData->const_names[rightOp])
+#define GET_CONDITION_BOOL (boolReg[outReg])
+#define IN_SET(VALUE) isSetMember(*exprData, rightOp, (VALUE))
+#define IN_RANGE(LOW_CLOSED,HIGH_CLOSED,VALUE) isInRange<LOW_CLOSED, HIGH_CLOSED>(*exprData, rightOp, variables->getNumberData(), (VALUE))
+
+/*
+ * The dispatch loops below only touch the register banks they are handed, so they are shared by
+ * ExpressionEvaluator and evaluateExpression(). Numbers are kept in reg and booleans, as 0 or 1, in
+ * boolReg - both indexed by the same register numbers. Each returns false if the expression divided
+ * by zero, and ORs the EXP_STATUS_DIVIDE_BY_ZERO of any ieeeDivide divides into status.
+ */
+
 /*
- * VariableLayout
- *
+ * Compact dispatch. Every handler is also a function of one compact word, so a superinstruction can run
+ * the handlers it fuses back to back and only the first of them costs a dispatch. Each returns false on
+ * a divide by zero, and only the jumps move IP.
  */
 
-ExpressionSlotIndex VariableLayout::addVariable(Name name, eExpType type)
+#define COMPACT_PARAMS const ExpressionData* exprData, const VariablePack* variables, float* reg, uint8_t* boolReg, uint32_t& status, \
+	const uint32_t* code, uint32_t& IP
+#define COMPACT_ARGS exprData, variables, reg, boolReg, status, code, IP
+// jumps have no result register, and some operations no right operand
+#define COMPACT_DECODE \
+	const uint32_t word = code[IP]; \
+	const ExpressionSlotIndex outReg = static_cast<ExpressionSlotIndex>((word >> 16) & 0xff); \
+	const ExpressionSlotIndex leftOp = static_cast<ExpressionSlotIndex>((word >> 8) & 0xff); \
+	const ExpressionSlotIndex rightOp = static_cast<ExpressionSlotIndex>(word & 0xff); \
+	static_cast<void>(outReg); static_cast<void>(rightOp);
+
+#define OPERATION_HANDLER(OP,EXPR) \
+static inline bool compact_##OP(COMPACT_PARAMS) \
+{ \
+	COMPACT_DECODE \
+	reg[outReg] = (EXPR); \
+	return true; \
+}
+#define BOOL_HANDLER(OP,EXPR) \
+static inline bool compact_##OP(COMPACT_PARAMS) \
+{ \
+	COMPACT_DECODE \
+	boolReg[outReg] = static_cast<uint8_t>(EXPR); \
+	return true; \
+}
+#define DIVIDE_HANDLER(OP,LEFT,RIGHT,FUNC) \
+static inline bool compact_##OP(COMPACT_PARAMS) \
+{ \
+	COMPACT_DECODE \
+	const float right = (RIGHT); \
+	if (right == 0.f) { return false; } \
+	reg[outReg] = FUNC((LEFT), right); \
+	return true; \
+}
+#define JUMP_HANDLER(OP,COND) \
+static inline bool compact_##OP(COMPACT_PARAMS) \
+{ \
+	COMPACT_DECODE \
+	if (COND) { IP += rightOp; } \
+	return true; \
+}
+#include "ExpressionHandlers.inl"
+
+// the switch loop over ExpressionData::compactCode, which already holds handler indices
+static bool runCompact(const ExpressionData* exprData, const VariablePack* variables, float* reg, uint8_t* boolReg, uint32_t& status)
 {
-	if (variableExists(name))
+	const uint32_t* code = exprData->compactCode.data();
+	const uint32_t codeLen(exprData->compactCode.size());
+
+	for (uint32_t IP = 0; IP < codeLen; ++IP)
 	{
-		assert(getType(name) == type);
-		return getIndex(name);
+		switch (static_cast<eHandler>(code[IP] >> 24))
+		{
+#define OPERATION_HANDLER(OP,EXPR) \
+		case eHandler::OP: compact_##OP(COMPACT_ARGS); continue;
+#define BOOL_HANDLER(OP,EXPR) \
+		case eHandler::OP: compact_##OP(COMPACT_ARGS); continue;
+#define DIVIDE_HANDLER(OP,LEFT,RIGHT,FUNC) \
+		case eHandler::OP: if (!compact_##OP(COMPACT_ARGS)) { return false; } continue;
+#define JUMP_HANDLER(OP,COND) \
+		case eHandler::OP: compact_##OP(COMPACT_ARGS); continue;
+#include "ExpressionHandlers.inl"
+
+#define SUPERINSTRUCTION2(A,B) \
+		case eHandler::A##_##B: \
+			if (!compact_##A(COMPACT_ARGS)) { return false; } \
+			++IP; \
+			if (!compact_##B(COMPACT_ARGS)) { return false; } \
+			continue;
+#define SUPERINSTRUCTION3(A,B,C) \
+		case eHandler::A##_##B##_##C: \
+			if (!compact_##A(COMPACT_ARGS)) { return false; } \
+			++IP; \
+			if (!compact_##B(COMPACT_ARGS)) { return false; } \
+			++IP; \
+			if (!compact_##C(COMPACT_ARGS)) { return false; } \
+			continue;
+#include "ExpressionSuperinstructions.inl"
+
+		default:
+			assert(false);
+			return true;
+		}
 	}
 
-	ExpressionSlotIndex slotIndex(0);
+	return true;
+}
 
-	if (type == eExpType::NUMBER)
-	{
-		slotIndex = numberCount;
-		numberCount += 1;
-	}
-	else if (type == eExpType::NAME)
+static bool runSwitch(const ExpressionData* exprData, const VariablePack* variables, float* reg, uint8_t* boolReg, uint32_t& status)
+{
+	if (!exprData->compactCode.empty())
 	{
-		slotIndex = nameCount;
-		nameCount += 1;
+		return runCompact(exprData, variables, reg, boolReg, status);
 	}
-	else
+
+	const uint32_t codeLen(exprData->byteCode.size());
+	assert((codeLen & 1) == 0);
+
+	for (uint32_t IP = 0; IP < codeLen; ++IP)
 	{
-		// bool variables not allowed
-		assert(false);
-		return 0;
+		const uint32_t byteCodeA = exprData->byteCode[IP];
+		const uint32_t byteCodeB = exprData->byteCode[++IP];
+
+		const eEncOpcode op = static_cast<eEncOpcode>(byteCodeA >> 16);
+		const ExpressionSlotIndex outReg = static_cast<ExpressionSlotIndex>(byteCodeA & 0xffff);
+		const ExpressionSlotIndex leftOp = static_cast<ExpressionSlotIndex>(byteCodeB >> 16);
+		const ExpressionSlotIndex rightOp = static_cast<ExpressionSlotIndex>(byteCodeB & 0xffff);
+
+		float result;
+
+		switch (op)
+		{
+#define OPERATION_HANDLER(OP,EXPR) \
+		case eEncOpcode::OP: result = (EXPR); break;
+#define BOOL_HANDLER(OP,EXPR) \
+		case eEncOpcode::OP: boolReg[outReg] = static_cast<uint8_t>(EXPR); continue;
+#define DIVIDE_HANDLER(OP,LEFT,RIGHT,FUNC) \
+		case eEncOpcode::OP: \
+			{ \
+				const float right = (RIGHT); \
+				if (right == 0.f) { return false; } \
+				result = FUNC((LEFT), right); break; \
+			}
+#define JUMP_HANDLER(OP,COND) \
+		case eEncOpcode::OP: \
+			if (COND) { IP += rightOp * 2; } \
+			continue;
+#include "ExpressionHandlers.inl"
+
+		default:
+			assert(false);
+			return true;
+		}	
+
+		reg[outReg] = result;
 	}
 
-	layout.emplace(name, Info(type, slotIndex));
-	return slotIndex;
+	return true;
 }
 
-
 /*
- * ExpressionDataWriter
+ * Threaded dispatch. Each handler ends with its own jump to the next one, so the branch predictor
+ * sees one indirect branch per opcode instead of the single shared one at the top of a switch.
+ * Called with exprData == nullptr to fetch the handler label table for prepareThreadedCode().
  */
 
-ExpressionDataWriter::ExpressionDataWriter()
-{
-	data = new ExpressionData();
-}
+#if EXPRESSION_COMPUTED_GOTO
+#define THREADED_HANDLER(OP) L_##OP:
+#define THREADED_DISPATCH() goto *reinterpret_cast<const void*>(ip->handler)
+#else
+#define THREADED_HANDLER(OP) case eHandler::OP:
+#define THREADED_DISPATCH() continue
+#endif
 
-ExpressionDataWriter::~ExpressionDataWriter()
+static bool runThreaded(const ExpressionData* exprData, const VariablePack* variables, float* reg, uint8_t* boolReg, uint32_t& status,
+	const void* const** handlerLabels = nullptr)
 {
-	if (data)
+#if EXPRESSION_COMPUTED_GOTO
+	static const void* const labels[] =
 	{
-		delete data;
+#define OPERATION_HANDLER(OP,EXPR) &&L_##OP,
+#define BOOL_HANDLER(OP,EXPR) &&L_##OP,
+#define DIVIDE_HANDLER(OP,LEFT,RIGHT,FUNC) &&L_##OP,
+#define JUMP_HANDLER(OP,COND) &&L_##OP,
+#include "ExpressionHandlers.inl"
+		&&L_END
+	};
+#endif
+
+	if (handlerLabels)
+	{
+#if EXPRESSION_COMPUTED_GOTO
+		*handlerLabels = labels;
+#else
+		*handlerLabels = nullptr;
+#endif
+		return true;
+	}
+
+	const ExpressionThreadedInstr* ip = exprData->threadedCode.data();
+
+#if EXPRESSION_COMPUTED_GOTO
+	THREADED_DISPATCH();
+	{
+#else
+	for (;;) switch (static_cast<eHandler>(ip->handler))
+	{
+#endif
+
+// the handlers with one operand don't read rightOp
+#define OPERATION_HANDLER(OP,EXPR) \
+	THREADED_HANDLER(OP) \
+		{ \
+			const ExpressionSlotIndex outReg(ip->resultReg), leftOp(ip->leftOp), rightOp(ip->rightOp); \
+			static_cast<void>(rightOp); \
+			reg[outReg] = (EXPR); \
+			++ip; \
+			THREADED_DISPATCH(); \
+		}
+#define BOOL_HANDLER(OP,EXPR) \
+	THREADED_HANDLER(OP) \
+		{ \
+			const ExpressionSlotIndex outReg(ip->resultReg), leftOp(ip->leftOp), rightOp(ip->rightOp); \
+			static_cast<void>(rightOp); \
+			boolReg[outReg] = static_cast<uint8_t>(EXPR); \
+			++ip; \
+			THREADED_DISPATCH(); \
+		}
+#define DIVIDE_HANDLER(OP,LEFT,RIGHT,FUNC) \
+	THREADED_HANDLER(OP) \
+		{ \
+			const ExpressionSlotIndex leftOp(ip->leftOp), rightOp(ip->rightOp); \
+			const float right = (RIGHT); \
+			if (right == 0.f) { return false; } \
+			reg[ip->resultReg] = FUNC((LEFT), right); \
+			++ip; \
+			THREADED_DISPATCH(); \
+		}
+#define JUMP_HANDLER(OP,COND) \
+	THREADED_HANDLER(OP) \
+		{ \
+			const ExpressionSlotIndex leftOp(ip->leftOp), rightOp(ip->rightOp); \
+			ip += (COND) ? rightOp + 1 : 1; \
+			THREADED_DISPATCH(); \
+		}
+#include "ExpressionHandlers.inl"
+
+	THREADED_HANDLER(END)
+		return true;
+
+#if !EXPRESSION_COMPUTED_GOTO
+	default:
+		assert(false);
+		return true;
+#endif
 	}
 }
 
-ExpressionSlotIndex ExpressionDataWriter::addNumericConst(float value)
+// The switch loop over the two word form, telling profile about every instruction it runs. Only used
+// to choose superinstructions, so speed doesn't matter.
+static bool runProfiled(const ExpressionData* exprData, const VariablePack* variables, float* reg, uint8_t* boolReg, uint32_t& status,
+	ExpressionOpcodeProfile& profile)
 {
-	for (size_t i = 0; i < data->const_floats.size(); i++)
+	const uint32_t codeLen(exprData->byteCode.size());
+	assert((codeLen & 1) == 0);
+
+	profile.beginSequence();
+
+	for (uint32_t IP = 0; IP < codeLen; IP += 2)
 	{
-		if (data->const_floats[i] == value)
+		const ExpressionInstr instr = decodeInstr(&exprData->byteCode[IP]);
+		const ExpressionSlotIndex outReg(instr.resultReg), leftOp(instr.leftOp), rightOp(instr.rightOp);
+
+		profile.record(instr.opcode);
+
+		switch (instr.opcode)
 		{
-			return static_cast<ExpressionSlotIndex>(i);
+#define OPERATION_HANDLER(OP,EXPR) \
+		case eEncOpcode::OP: reg[outReg] = (EXPR); break;
+#define BOOL_HANDLER(OP,EXPR) \
+		case eEncOpcode::OP: boolReg[outReg] = static_cast<uint8_t>(EXPR); break;
+#define DIVIDE_HANDLER(OP,LEFT,RIGHT,FUNC) \
+		case eEncOpcode::OP: \
+			{ \
+				const float right = (RIGHT); \
+				if (right == 0.f) { return false; } \
+				reg[outReg] = FUNC((LEFT), right); break; \
+			}
+#define JUMP_HANDLER(OP,COND) \
+		case eEncOpcode::OP: \
+			if (COND) { IP += rightOp * 2; profile.beginSequence(); } \
+			break;
+#include "ExpressionHandlers.inl"
+
+		default:
+			assert(false);
+			return true;
 		}
 	}
 
-	data->const_floats.push_back(value);
-	return static_cast<ExpressionSlotIndex>(data->const_floats.size()-1);
+	return true;
 }
 
-ExpressionSlotIndex ExpressionDataWriter::addNameConst(Name value)
+static bool runInterpreter(const ExpressionData* exprData, const VariablePack* variables, float* reg, uint8_t* boolReg, uint32_t& status)
 {
-	for (size_t i = 0; i < data->const_names.size(); i++)
+	return exprData->threadedCode.empty() ? runSwitch(exprData, variables, reg, boolReg, status) :
+		runThreaded(exprData, variables, reg, boolReg, status);
+}
+
+
+/*
+ * evaluateExpression
+ *
+ */
+
+// the native and closure code return booleans as 1.f/0.f, the interpreters leave them in the boolean bank
+static void storeReturnedResult(const ExpressionData& exprData, float value, float* registers, uint8_t* boolRegisters)
+{
+	if (exprData.resultType == eExpType::BOOL)
 	{
-		if (data->const_names[i] == value)
-		{
-			return static_cast<ExpressionSlotIndex>(i);
-		}
+		boolRegisters[0] = value != 0.f ? 1 : 0;
 	}
+	else
+	{
+		registers[0] = value;
+	}
+}
 
-	data->const_names.push_back(value);
-	return static_cast<ExpressionSlotIndex>(data->const_names.size()-1);
+static float getResultValue(const ExpressionData& exprData, const float* registers, const uint8_t* boolRegisters)
+{
+	return exprData.resultType == eExpType::BOOL ? (boolRegisters[0] ? 1.f : 0.f) : registers[0];
 }
 
-void ExpressionDataWriter::emitInstr(eEncOpcode opcode, ExpressionSlotIndex resultReg, ExpressionSlotIndex leftOperand, ExpressionSlotIndex rightOperand)
+ExpressionResult evaluateExpression(const ExpressionData& exprData, const VariablePack& variables,
+	float* registers, uint8_t* boolRegisters, uint32_t registerCount, eDispatchMode dispatchMode)
 {
-	uint32_t codeA = (static_cast<uint16_t>(opcode) << 16) | (resultReg & 0xffff);
-	uint32_t codeB = (leftOperand << 16) | (rightOperand & 0xffff);
+	ExpressionResult result = { exprData.resultType, eErrorCode::UNINITIALISED, 0.f, 0 };
+
+	if (registerCount < exprData.regCount)
+	{
+		result.error = eErrorCode::InternalError;
+		return result;
+	}
+
+	// read once - ExpressionTiering publishes an expression's new code before the mode that runs it
+	const eDispatchMode mode = dispatchMode == eDispatchMode::PerExpression ? exprData.dispatchMode.load(std::memory_order_acquire) : dispatchMode;
+	assert(mode != eDispatchMode::PerExpression);
+
+	bool succeeded;
+
+	// the native and closure code only flag a zero divisor, which fails the evaluation unless it was compiled with ieeeDivide
+	if ((mode == eDispatchMode::Native || mode == eDispatchMode::NativeVerify) && exprData.nativeCode)
+	{
+		uint32_t errorFlags(0);
+		storeReturnedResult(exprData, exprData.nativeCode->run(&variables, &errorFlags), registers, boolRegisters);
+		succeeded = errorFlags == 0 || exprData.ieeeDivide;
+		result.status = errorFlags != 0 && exprData.ieeeDivide ? EXP_STATUS_DIVIDE_BY_ZERO : 0;
+	}
+	else if (mode == eDispatchMode::Closure && exprData.closureCode)
+	{
+		bool divideByZero(false);
+		storeReturnedResult(exprData, exprData.closureCode->run(&variables, divideByZero), registers, boolRegisters);
+		succeeded = !divideByZero || exprData.ieeeDivide;
+		result.status = divideByZero && exprData.ieeeDivide ? EXP_STATUS_DIVIDE_BY_ZERO : 0;
+	}
+	else if (mode != eDispatchMode::Switch)
+	{
+		succeeded = runInterpreter(&exprData, &variables, registers, boolRegisters, result.status);
+	}
+	else
+	{
+		succeeded = runSwitch(&exprData, &variables, registers, boolRegisters, result.status);
+	}
 
-	data->byteCode.push_back(codeA);
-	data->byteCode.push_back(codeB);
-}
+	if (!succeeded)
+	{
+		result.error = eErrorCode::DivideByZero;
+	}
+	else if (exprData.regCount > 0)
+	{
+		result.value = getResultValue(exprData, registers, boolRegisters);
 
-ExpressionData* ExpressionDataWriter::getData()
-{
-	ExpressionData* tempData = data;
-	data = nullptr;
+		if (exprData.resultType == eExpType::NUMBER && !std::isfinite(result.value))
+		{
+			result.status |= EXP_STATUS_NOT_FINITE;
+		}
+	}
 
-	return tempData;
+	return result;
 }
 
 
@@ -1237,23 +4019,13 @@ ExpressionData* ExpressionDataWriter::getData()
  *
  */
 
-ExpressionEvaluator::ExpressionEvaluator(const VariablePack* _variables)
+ExpressionEvaluator::ExpressionEvaluator(const VariablePack* _variables, eDispatchMode _dispatchMode)
 	: variables(_variables)
+	, dispatchMode(_dispatchMode)
+	, status(0)
+	, profile(nullptr)
 {}
 
-#define GET_LEFT_REG (reg[leftOp])
-#define GET_LEFT_REG_BOOL (reg[leftOp] != 0.f)
-#define GET_LEFT_NUM_VAR (variables->getVariableNumber(leftOp))
-#define GET_LEFT_NAME_VAR (variables->getVariableName(leftOp))
-#define GET_LEFT_NUM_CONST (exprData->const_floats[leftOp])
-#define GET_LEFT_NAME_CONST (exprData->const_names[leftOp])
-#define GET_RIGHT_REG (reg[rightOp])
-#define GET_RIGHT_REG_BOOL (reg[rightOp] != 0.f)
-#define GET_RIGHT_NUM_VAR (variables->getVariableNumber(rightOp))
-#define GET_RIGHT_NAME_VAR (variables->getVariableName(rightOp))
-#define GET_RIGHT_NUM_CONST (exprData->const_floats[rightOp])
-#define GET_RIGHT_NAME_CONST (exprData->const_names[rightOp])
-
 void ExpressionEvaluator::evaluate(const ExpressionData* exprData)
 {
 	assert(exprData);
@@ -1261,210 +4033,143 @@ void ExpressionEvaluator::evaluate(const ExpressionData* exprData)
 
 	errorReport.reset();
 	resultType = exprData->resultType;
+	status = 0;
 
 	reg.resize(exprData->regCount, 0);
+	boolReg.resize(exprData->regCount, 0);
+
+	if (profile)
+	{
+		evaluateProfiled(exprData);
+		return;
+	}
+
+	const eDispatchMode mode = dispatchMode == eDispatchMode::PerExpression ? exprData->dispatchMode.load(std::memory_order_acquire) : dispatchMode;
+
+	if (mode == eDispatchMode::NativeVerify && exprData->nativeCode)
+	{
+		evaluateNativeVerify(exprData);
+		return;
+	}
+
+	const ExpressionResult result = evaluateExpression(*exprData, *variables, reg.data(), boolReg.data(), reg.size(), mode);
+	status = result.status;
+
+	if (result.failed())
+	{
+		assert(result.error == eErrorCode::DivideByZero);
+		logDivideByZeroError();
+	}
+}
+
+void ExpressionEvaluator::evaluateNativeVerify(const ExpressionData* exprData)
+{
+	uint32_t errorFlags(0);
+	const float nativeResult = exprData->nativeCode->run(variables, &errorFlags);
+
+	const bool interpreterFailed = !runInterpreter(exprData, variables, reg.data(), boolReg.data(), status);
+	const float interpreterResult = getResultValue(*exprData, reg.data(), boolReg.data());
+
+	// the native code flags a zero divisor the same way whether or not it is an error
+	const bool interpreterFlagged = interpreterFailed || (status & EXP_STATUS_DIVIDE_BY_ZERO) != 0;
+	const bool resultsMatch = interpreterFlagged == (errorFlags != 0) &&
+		(interpreterFailed || nativeResult == interpreterResult || (nativeResult != nativeResult && interpreterResult != interpreterResult));
+
+	if (interpreterFailed)
+	{
+		logDivideByZeroError();
+	}
+	else if (exprData->resultType == eExpType::NUMBER && !std::isfinite(interpreterResult))
+	{
+		status |= EXP_STATUS_NOT_FINITE;
+	}
+
+	if (!resultsMatch)
+	{
+		std::ostringstream msg;
+		msg << "Native code result (" << nativeResult << ") differs from the interpreter (" << interpreterResult << ")";
+		errorReport.addError(eErrorCategory::Internal, eErrorCode::InternalError, msg.str());
+	}
+}
+
+void ExpressionEvaluator::evaluateProfiled(const ExpressionData* exprData)
+{
+	if (!runProfiled(exprData, variables, reg.data(), boolReg.data(), status, *profile))
+	{
+		logDivideByZeroError();
+	}
+}
+
+void ExpressionEvaluator::prepareThreadedCode(ExpressionData* exprData)
+{
+	assert(exprData);
+
+	const void* const* labels(nullptr);
+	uint32_t unusedStatus(0);
+	runThreaded(nullptr, nullptr, nullptr, nullptr, unusedStatus, &labels);
+
+	auto getHandlerAddress = [labels](eHandler handler)
+	{
+		return labels ? reinterpret_cast<uintptr_t>(labels[static_cast<uint16_t>(handler)]) : static_cast<uintptr_t>(handler);
+	};
+
+	exprData->threadedCode.clear();
 
 	const uint32_t codeLen(exprData->byteCode.size());
 	assert((codeLen & 1) == 0);
 
-	for (uint32_t IP = 0; IP < codeLen; ++IP)
+	for (uint32_t IP = 0; IP < codeLen; IP += 2)
 	{
 		const uint32_t byteCodeA = exprData->byteCode[IP];
-		const uint32_t byteCodeB = exprData->byteCode[++IP];
-
-		const eEncOpcode op = static_cast<eEncOpcode>(byteCodeA >> 16);
-		const ExpressionSlotIndex leftOp = static_cast<ExpressionSlotIndex>(byteCodeB >> 16);
-		const ExpressionSlotIndex rightOp = static_cast<ExpressionSlotIndex>(byteCodeB & 0xffff);
-
-		float result;
+		const uint32_t byteCodeB = exprData->byteCode[IP + 1];
 
-		switch (op)
-		{
-		case eEncOpcode::ADD:			result = GET_LEFT_REG + GET_RIGHT_REG; break;
-		case eEncOpcode::ADD_LC:		result = GET_LEFT_NUM_CONST + GET_RIGHT_REG; break;
-		case eEncOpcode::ADD_LV:		result = GET_LEFT_NUM_VAR + GET_RIGHT_REG; break;
-		case eEncOpcode::ADD_LV_RV:		result = GET_LEFT_NUM_VAR + GET_RIGHT_NUM_VAR; break;
-		case eEncOpcode::ADD_LC_RV:		result = GET_LEFT_NUM_CONST + GET_RIGHT_NUM_VAR; break;
-
-		case eEncOpcode::SUB:			result = GET_LEFT_REG - GET_RIGHT_REG; break;
-		case eEncOpcode::SUB_LC:		result = GET_LEFT_NUM_CONST - GET_RIGHT_REG; break;
-		case eEncOpcode::SUB_LV:		result = GET_LEFT_NUM_VAR - GET_RIGHT_REG; break;
-		case eEncOpcode::SUB_RC:		result = GET_LEFT_REG - GET_RIGHT_NUM_CONST; break;
-		case eEncOpcode::SUB_RV:		result = GET_LEFT_REG - GET_RIGHT_NUM_VAR; break;
-		case eEncOpcode::SUB_LC_RV:		result = GET_LEFT_NUM_CONST - GET_RIGHT_NUM_VAR; break;
-		case eEncOpcode::SUB_LV_RC:		result = GET_LEFT_NUM_VAR - GET_RIGHT_NUM_CONST; break;
-		case eEncOpcode::SUB_LV_RV:		result = GET_LEFT_NUM_VAR - GET_RIGHT_NUM_VAR; break;
-
-		case eEncOpcode::MUL:			result = GET_LEFT_REG * GET_RIGHT_REG; break;
-		case eEncOpcode::MUL_LC:		result = GET_LEFT_NUM_CONST * GET_RIGHT_REG; break;
-		case eEncOpcode::MUL_LV:		result = GET_LEFT_NUM_VAR * GET_RIGHT_REG; break;
-		case eEncOpcode::MUL_LV_RV:		result = GET_LEFT_NUM_VAR * GET_RIGHT_NUM_VAR; break;
-		case eEncOpcode::MUL_LC_RV:		result = GET_LEFT_NUM_CONST * GET_RIGHT_NUM_VAR; break;
-
-		case eEncOpcode::DIV:
-			{
-				const float right = GET_RIGHT_REG;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = GET_LEFT_REG / right; break;
-			}
-		case eEncOpcode::DIV_LC:
-			{
-				const float right = GET_RIGHT_REG;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = GET_LEFT_NUM_CONST / right; break;
-			}
-		case eEncOpcode::DIV_LV:
-			{
-				const float right = GET_RIGHT_REG;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = GET_LEFT_NUM_VAR / right; break;
-			}
+		ExpressionThreadedInstr instr;
+		instr.handler = getHandlerAddress(getHandlerForOpcode(static_cast<eEncOpcode>(byteCodeA >> 16)));
+		instr.resultReg = static_cast<ExpressionSlotIndex>(byteCodeA & 0xffff);
+		instr.leftOp = static_cast<ExpressionSlotIndex>(byteCodeB >> 16);
+		instr.rightOp = static_cast<ExpressionSlotIndex>(byteCodeB & 0xffff);
 
-		case eEncOpcode::DIV_RC:
-			{
-				const float right = GET_RIGHT_NUM_CONST;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = GET_LEFT_REG / right; break;
-			}
-		case eEncOpcode::DIV_RV:
-			{
-				const float right = GET_RIGHT_NUM_VAR;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = GET_LEFT_REG / right; break;
-			}
+		exprData->threadedCode.push_back(instr);
+	}
 
-		case eEncOpcode::DIV_LC_RV:
-			{
-				const float right = GET_RIGHT_NUM_VAR;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = GET_LEFT_NUM_CONST / right; break;
-			}
-		case eEncOpcode::DIV_LV_RC:
-			{
-				const float right = GET_RIGHT_NUM_CONST;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = GET_LEFT_NUM_VAR / right; break;
-			}
-		case eEncOpcode::DIV_LV_RV:
-			{
-				const float right = GET_RIGHT_NUM_VAR;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = GET_LEFT_NUM_VAR / right; break;
-			}
+	ExpressionThreadedInstr endInstr = { getHandlerAddress(eHandler::END), 0, 0, 0 };
+	exprData->threadedCode.push_back(endInstr);
+}
 
-		case eEncOpcode::MOD:
-			{
-				const float right = GET_RIGHT_REG;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = fmodf(GET_LEFT_REG, right); break;
-			}
-		case eEncOpcode::MOD_LC:
-			{
-				const float right = GET_RIGHT_REG;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = fmodf(GET_LEFT_NUM_CONST, right); break;
-			}
-		case eEncOpcode::MOD_LV:
-			{
-				const float right = GET_RIGHT_REG;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = fmodf(GET_LEFT_NUM_VAR, right); break;
-			}
-		case eEncOpcode::MOD_RC:
-			{
-				const float right = GET_RIGHT_NUM_CONST;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = fmodf(GET_LEFT_REG, right); break;
-			}
-		case eEncOpcode::MOD_RV:
-			{
-				const float right = GET_RIGHT_NUM_VAR;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = fmodf(GET_LEFT_REG, right); break;
-			}
-		case eEncOpcode::MOD_LC_RV:
-			{
-				const float right = GET_RIGHT_NUM_VAR;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = fmodf(GET_LEFT_NUM_CONST, right); break;
-			}
-		case eEncOpcode::MOD_LV_RC:
-			{
-				const float right = GET_RIGHT_NUM_CONST;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = fmodf(GET_LEFT_NUM_VAR, right); break;
-			}
-		case eEncOpcode::MOD_LV_RV:
-			{
-				const float right = GET_RIGHT_NUM_VAR;
-				if (right == 0.f) { logDivideByZeroError(); return; }
-				result = fmodf(GET_LEFT_NUM_VAR, right); break;
-			}
+void ExpressionEvaluator::prepareCompactCode(ExpressionData* exprData, bool superinstructions)
+{
+	assert(exprData);
 
-		// Logic (Boolean)
-		case eEncOpcode::AND:			result = GET_LEFT_REG_BOOL && GET_RIGHT_REG_BOOL ? 1.f : 0.f; break;
-		case eEncOpcode::OR:			result = GET_LEFT_REG_BOOL || GET_RIGHT_REG_BOOL ? 1.f : 0.f; break;
-		case eEncOpcode::XOR:			result = GET_LEFT_REG_BOOL ^ GET_RIGHT_REG_BOOL ? 1.f : 0.f; break;
-		case eEncOpcode::NOT:			result = !GET_LEFT_REG_BOOL ? 1.f : 0.f; break;
+	exprData->compactCode.clear();
 
-		// Comparison (Names)
-		case eEncOpcode::NAME_EQ_LC_RV:  result = GET_LEFT_NAME_CONST == GET_RIGHT_NAME_VAR ? 1.f : 0.f; break;
-		case eEncOpcode::NAME_EQ_LV_RV:  result = GET_LEFT_NAME_VAR   == GET_RIGHT_NAME_VAR ? 1.f : 0.f; break;
-		case eEncOpcode::NAME_NEQ_LC_RV: result = GET_LEFT_NAME_CONST != GET_RIGHT_NAME_VAR ? 1.f : 0.f; break;
-		case eEncOpcode::NAME_NEQ_LV_RV: result = GET_LEFT_NAME_VAR   != GET_RIGHT_NAME_VAR ? 1.f : 0.f; break;
+	const uint32_t codeLen(exprData->byteCode.size());
+	assert((codeLen & 1) == 0);
 
-		// Comparison (Boolean) [NEQ is handled by XOR]
-		case eEncOpcode::BOOL_EQ:        result = GET_LEFT_REG_BOOL == GET_RIGHT_REG_BOOL ? 1.f : 0.f; break;
-		
-		// Comparison (Numeric)
-		case eEncOpcode::NUM_EQ:		result = GET_LEFT_REG       == GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_EQ_LC:		result = GET_LEFT_NUM_CONST == GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_EQ_LV:		result = GET_LEFT_NUM_VAR   == GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_EQ_LV_RV:  result = GET_LEFT_NUM_VAR   == GET_RIGHT_NUM_VAR ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_EQ_LV_RC:	result = GET_LEFT_NUM_VAR   == GET_RIGHT_NUM_CONST ? 1.f : 0.f; break;
-
-		case eEncOpcode::NUM_NEQ:		result = GET_LEFT_REG       != GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_NEQ_LC:	result = GET_LEFT_NUM_CONST != GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_NEQ_LV:	result = GET_LEFT_NUM_VAR   != GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_NEQ_LV_RV: result = GET_LEFT_NUM_VAR   != GET_RIGHT_NUM_VAR ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_NEQ_LV_RC:	result = GET_LEFT_NUM_VAR   != GET_RIGHT_NUM_CONST ? 1.f : 0.f; break;
-
-		case eEncOpcode::NUM_LT:		result = GET_LEFT_REG       < GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_LT_LC:		result = GET_LEFT_NUM_CONST < GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_LT_LV:		result = GET_LEFT_NUM_VAR   < GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_LT_LV_RV:	result = GET_LEFT_NUM_VAR   < GET_RIGHT_NUM_VAR ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_LT_LV_RC:	result = GET_LEFT_NUM_VAR   < GET_RIGHT_NUM_CONST ? 1.f : 0.f; break;
-
-		case eEncOpcode::NUM_GT:		result = GET_LEFT_REG       > GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_GT_LC:		result = GET_LEFT_NUM_CONST > GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_GT_LV:		result = GET_LEFT_NUM_VAR   > GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_GT_LV_RV:	result = GET_LEFT_NUM_VAR   > GET_RIGHT_NUM_VAR ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_GT_LV_RC:	result = GET_LEFT_NUM_VAR   > GET_RIGHT_NUM_CONST ? 1.f : 0.f; break;
-
-		case eEncOpcode::NUM_LTEQ:			result = GET_LEFT_REG       <= GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_LTEQ_LC:		result = GET_LEFT_NUM_CONST <= GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_LTEQ_LV:		result = GET_LEFT_NUM_VAR   <= GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_LTEQ_LV_RV:	result = GET_LEFT_NUM_VAR   <= GET_RIGHT_NUM_VAR ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_LTEQ_LV_RC:	result = GET_LEFT_NUM_VAR   <= GET_RIGHT_NUM_CONST ? 1.f : 0.f; break;
-
-		case eEncOpcode::NUM_GTEQ:			result = GET_LEFT_REG       >= GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_GTEQ_LC:		result = GET_LEFT_NUM_CONST >= GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_GTEQ_LV:		result = GET_LEFT_NUM_VAR   >= GET_RIGHT_REG ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_GTEQ_LV_RV:	result = GET_LEFT_NUM_VAR   >= GET_RIGHT_NUM_VAR ? 1.f : 0.f; break;
-		case eEncOpcode::NUM_GTEQ_LV_RC:	result = GET_LEFT_NUM_VAR   >= GET_RIGHT_NUM_CONST ? 1.f : 0.f; break;
-
-		// value operations (for const expressions)
-		case eEncOpcode::NUM_VAL_LC:		result = GET_LEFT_NUM_CONST; break;
-		case eEncOpcode::BOOL_VAL_LC:		result = leftOp > 0 ? 1.f : 0.f; break;
+	std::vector<uint32_t> compactCode;
+	compactCode.reserve(codeLen / 2);
 
-		default:
-			assert(false);
+	for (uint32_t IP = 0; IP < codeLen; IP += 2)
+	{
+		const ExpressionInstr instr = decodeInstr(&exprData->byteCode[IP]);
+		if (instr.resultReg > 0xff || instr.leftOp > 0xff || instr.rightOp > 0xff)
+		{
 			return;
-		}	
+		}
 
-		const ExpressionSlotIndex outReg = static_cast<ExpressionSlotIndex>(byteCodeA & 0xffff);
-		reg[outReg] = result;
+		const uint32_t handler = static_cast<uint16_t>(getHandlerForOpcode(instr.opcode));
+		compactCode.push_back((handler << 24) | (instr.resultReg << 16) | (instr.leftOp << 8) | instr.rightOp);
+	}
+
+	// peephole pass - mark the start of each run of instructions that has a superinstruction
+	for (uint32_t IP = 0; superinstructions && IP < compactCode.size(); )
+	{
+		uint32_t length(1);
+		const uint32_t handler = static_cast<uint16_t>(getSuperinstruction(&compactCode[IP], compactCode.size() - IP, length));
+		compactCode[IP] = (handler << 24) | (compactCode[IP] & 0xffffff);
+		IP += length;
 	}
+
+	exprData->compactCode.swap(compactCode);
 }
 
 void ExpressionEvaluator::logDivideByZeroError()
@@ -1472,6 +4177,12 @@ void ExpressionEvaluator::logDivideByZeroError()
 	errorReport.addError(eErrorCategory::Math, eErrorCode::DivideByZero, "Divide by zero error");
 }
 
+void ExpressionEvaluator::reset()
+{
+	errorReport.reset();
+	status = 0;
+}
+
 
 /*
  * ExpressionCompiler
@@ -1484,13 +4195,14 @@ void ExpressionEvaluator::logDivideByZeroError()
 int yyparse(ASTNode **expression, yyscan_t scanner);
 
 
-ExpressionCompiler::ExpressionCompiler(const VariableLayout* _layout)
+ExpressionCompiler::ExpressionCompiler(const VariableLayout* _layout, const ExpressionCompileOptions& _options)
 	: layout(_layout)
+	, options(_options)
 {
 	assert(layout != nullptr);
 }
 
-ExpressionData* ExpressionCompiler::compile(const char* expressionText)
+ASTNode* ExpressionCompiler::buildTree(const char* expressionText, const ExpressionBindings* bindings)
 {
 	// parse the expression
 	ASTNode *expression(nullptr);
@@ -1524,50 +4236,144 @@ ExpressionData* ExpressionCompiler::compile(const char* expressionText)
 	assert(expression != nullptr);
 
 	// perform AST passes
-	if (!expression->typeCheck(*layout, errorReport) ||
-		!expression->constFold(&expression, errorReport))
+	if (!expression->typeCheck(*layout, errorReport))
 	{
 		freeNode(expression);
 		return nullptr;
 	}
 
-	ExpressionDataWriter expWriter;
-
-	expression->gatherConsts(expWriter);
-	uint32_t maxRegister(0);
-	expression->allocateRegisters(0, maxRegister);
+	if (bindings)
+	{
+		ASTNode *unbound(expression);
+		expression->bindConstants(&expression, *bindings);
+		if (expression != unbound)
+		{
+			freeNode(unbound);
+		}
+	}
 
-	// generate code
-	if (expression->exprType() == eExpType::NAME)
+	if (!expression->constFold(&expression, errorReport))
 	{
-		errorReport.addError(eErrorCategory::Const, eErrorCode::ConstNameExpression, "Expressions that evalute to a Name type are not supported");
 		freeNode(expression);
 		return nullptr;
 	}
-	else if (expression->isConstant())
+
+	if (options.simplify)
+	{
+		ASTNode *unsimplified(expression);
+		const bool simplified = expression->simplify(&expression, options, errorReport);
+		if (expression != unsimplified)
+		{
+			freeNode(unsimplified);
+		}
+
+		if (!simplified)
+		{
+			freeNode(expression);
+			return nullptr;
+		}
+	}
+
+	if (options.fuseIntervals)
+	{
+		ASTNode *unfused(expression);
+		expression->fuseIntervals(&expression);
+		if (expression != unfused)
+		{
+			freeNode(unfused);
+		}
+	}
+
+	if (options.analyseRanges)
+	{
+		RangeAnalysis analysis;
+		expression->analyseRanges(analysis);
+	}
+
+	return expression;
+}
+
+// emits the code for a whole expression tree, leaving its result in resultRegister
+static void generateRootCode(ASTNode* expression, ExpressionSlotIndex resultRegister, ExpressionDataWriter& expWriter)
+{
+	if (expression->isConstant())
 	{
 		if (expression->exprType() == eExpType::BOOL)
 		{
 			bool val = static_cast<ASTNodeConstBool*>(expression)->getValue();
 			// we don't have a separate boolean consts array (why bother when there are only two possible values?) so encode as the slot number instead
-			expWriter.emitInstr(encodeOp(eSimpleOp::BOOL_VAL, eResultSource::Constant, eResultSource::Constant), 0, val ? 1 : 0 , 0);
+			expWriter.emitInstr(encodeOp(eSimpleOp::BOOL_VAL, eResultSource::Constant, eResultSource::Constant), resultRegister, val ? 1 : 0 , 0);
 		}
-		else if (expression->exprType() == eExpType::NUMBER)
+		else
 		{
+			assert(expression->exprType() == eExpType::NUMBER);
 			ASTNodeConstNumber *numNode = static_cast<ASTNodeConstNumber*>(expression);
 			assert(numNode->getResultInfo().source == eResultSource::Constant);
-			expWriter.emitInstr(encodeOp(eSimpleOp::NUM_VAL, eResultSource::Constant, eResultSource::Constant), 0, numNode->getResultInfo().index, 0);
-		}
-		else
-		{
-			assert(false);
-			return nullptr;
+			expWriter.emitInstr(encodeOp(eSimpleOp::NUM_VAL, eResultSource::Constant, eResultSource::Constant), resultRegister, numNode->getResultInfo().index, 0);
 		}
 	}
+	else if (expression->nodeType() == eASTNodeType::IDENT)
+	{
+		// a lone number variable, e.g. what's left of "NumA * 1"
+		assert(expression->exprType() == eExpType::NUMBER);
+		expWriter.emitInstr(encodeOp(eSimpleOp::NUM_VAL, eResultSource::Variable, eResultSource::Constant), resultRegister, expression->getResultInfo().index, 0);
+	}
 	else
 	{
+		assert(expression->getResultInfo().index == resultRegister);
 		expression->generateCode(expWriter);
 	}
+}
+
+ExpressionData* ExpressionCompiler::compile(const char* expressionText)
+{
+	return generate(buildTree(expressionText));
+}
+
+ExpressionData* ExpressionCompiler::specialise(const char* expressionText, const ExpressionBindings& bindings)
+{
+	return generate(buildTree(expressionText, &bindings));
+}
+
+ExpressionData* ExpressionCompiler::generate(ASTNode* expression)
+{
+	if (!expression)
+	{
+		return nullptr;
+	}
+
+	if (expression->exprType() == eExpType::NAME)
+	{
+		errorReport.addError(eErrorCategory::Const, eErrorCode::ConstNameExpression, "Expressions that evalute to a Name type are not supported");
+		freeNode(expression);
+		return nullptr;
+	}
+
+	SubexpressionSharing sharing;
+	if (options.shareSubexpressions)
+	{
+		expression->numberValues(sharing);
+		expression->shareSubexpressions(&expression, sharing);
+	}
+
+	ExpressionDataWriter expWriter;
+	expWriter.setIeeeDivide(options.ieeeDivide);
+
+	expression->gatherConsts(expWriter);
+	uint32_t maxRegister(0);
+	expression->labelRegisterNeed();
+	expression->allocateRegisters(0, maxRegister);
+
+	// shared values are kept above the registers the tree works in
+	if (options.shareSubexpressions)
+	{
+		sharing.firstRegister = maxRegister + 1;
+		sharing.maxRegister = maxRegister;
+		expression->allocateSharedRegisters(sharing);
+		maxRegister = sharing.maxRegister;
+	}
+
+	generateRootCode(expression, 0, expWriter);
 
 	// get generated program data and add remaining params
 	ExpressionData *expData = expWriter.getData();
@@ -1576,5 +4382,109 @@ ExpressionData* ExpressionCompiler::compile(const char* expressionText)
 	expData->regCount = maxRegister + 1;
 	expData->resultType = expression->exprType();
 
+	ExpressionEvaluator::prepareThreadedCode(expData);
+	if (options.compactCode)
+	{
+		ExpressionEvaluator::prepareCompactCode(expData, options.superinstructions);
+	}
+
+	// lower the same tree for the closure backend
+	if (options.closureCode)
+	{
+		ExpressionClosureBuilder closureBuilder(options.ieeeDivide);
+		expData->closureCode.reset(closureBuilder.finish(expression->lowerToClosure(closureBuilder)));
+	}
+
+	freeNode(expression);
 	return expData;
 }
+
+ExpressionNetwork* ExpressionCompiler::compileNetwork(const char* const* expressionTexts, uint32_t expressionCount)
+{
+	std::unique_ptr<ExpressionNetwork> network(new ExpressionNetwork());
+	std::vector<ASTNode*> roots;
+
+	for (uint32_t index = 0; index < expressionCount; ++index)
+	{
+		ExpressionData* expression = compile(expressionTexts[index]);
+		if (!expression)
+		{
+			for (ASTNode* root : roots)
+			{
+				freeNode(root);
+			}
+			return nullptr;
+		}
+
+		network->expressions.emplace_back(expression);
+
+		// it compiled once, so building the tree again can't fail
+		roots.push_back(buildTree(expressionTexts[index]));
+		assert(roots.back());
+	}
+
+	// Each expression's tree is walked in turn with one set of value numbers, so anything an earlier
+	// expression computes outside a && or || guard is shared with every later one
+	SubexpressionSharing sharing;
+	if (options.shareSubexpressions)
+	{
+		for (ASTNode*& root : roots)
+		{
+			root->numberValues(sharing);
+		}
+
+		for (ASTNode*& root : roots)
+		{
+			ASTNode *unshared(root);
+			root->shareSubexpressions(&root, sharing);
+			if (root != unshared)
+			{
+				freeNode(unshared);
+			}
+		}
+	}
+
+	// every expression works in the same low registers, with the shared values and results above them
+	ExpressionDataWriter expWriter;
+	expWriter.setIeeeDivide(options.ieeeDivide);
+	uint32_t maxRegister(0);
+
+	for (ASTNode* root : roots)
+	{
+		root->gatherConsts(expWriter);
+		root->labelRegisterNeed();
+		root->allocateRegisters(0, maxRegister);
+		root->holdSharedResult();
+	}
+
+	sharing.firstRegister = maxRegister + 1;
+	sharing.maxRegister = maxRegister;
+
+	for (ASTNode* root : roots)
+	{
+		root->allocateSharedRegisters(sharing);
+
+		const ResultInfo resultInfo = root->getResultInfo();
+		network->resultRegisters.push_back(resultInfo.source == eResultSource::Register ? resultInfo.index : sharing.acquireRegister());
+
+		generateRootCode(root, network->resultRegisters.back(), expWriter);
+	}
+
+	// later trees can point into earlier ones, so none are freed until all the code is generated
+	for (ASTNode* root : roots)
+	{
+		freeNode(root);
+	}
+
+	network->program.reset(expWriter.getData());
+	network->program->regCount = sharing.maxRegister + 1;
+	network->program->resultType = eExpType::UNINITIALISED;
+
+	ExpressionEvaluator::prepareThreadedCode(network->program.get());
+	if (options.compactCode)
+	{
+		ExpressionEvaluator::prepareCompactCode(network->program.get(), options.superinstructions);
+	}
+
+	return network.release();
+}
@@ -5,8 +5,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 #include <vector>
+#include <memory>
 #include <unordered_map>
 
 #include "AST.h"
@@ -21,6 +26,10 @@
 typedef uint16_t ExpressionSlotIndex;
 #define EXP_SLOT_INDEX_MAX UINT16_MAX
 
+// Bits of the status mask reported with every evaluation, see ExpressionResult::status
+#define EXP_STATUS_DIVIDE_BY_ZERO	0x1		// a / or % compiled with ieeeDivide had a zero divisor
+#define EXP_STATUS_NOT_FINITE		0x2		// the result is a number and is inf or NaN
+
 
 enum class eExpType
 {
@@ -31,15 +40,118 @@ enum class eExpType
 	BOOL
 };
 
+// One pre-decoded instruction for the threaded dispatch loop. The handler is the address of the
+// opcode's label when computed goto is available, otherwise the handler's index in ExpressionHandlers.inl
+struct ExpressionThreadedInstr
+{
+	uintptr_t handler;
+	ExpressionSlotIndex resultReg;
+	ExpressionSlotIndex leftOp;
+	ExpressionSlotIndex rightOp;
+};
+
+// Which backend ExpressionEvaluator runs an expression with
+enum class eDispatchMode
+{
+	Switch,		// decode each bytecode instruction, from compactCode when there is one, and switch on the opcode
+	Threaded,	// jump straight between handlers using ExpressionData::threadedCode
+	Native,		// call ExpressionData::nativeCode when present, otherwise as Threaded
+	NativeVerify,	// run the native code and the threaded loop side by side and report any difference
+	Closure,	// call through the tree of specialised nodes in ExpressionData::closureCode
+	PerExpression,	// use the mode chosen for each expression in ExpressionData::dispatchMode
+};
+
+class ExpressionNativeCode;
+class ExpressionClosureCode;
+
+// The members of one "in (...)" test, a run of ExpressionData::set_floats or set_names. The run is
+// sorted, names by their interned string's address, so a lookup is a binary search - see isSetMember.
+struct ExpressionSet
+{
+	uint32_t first;
+	uint32_t count;
+};
+
+// The bounds of one NUM_IN_RANGE test, each an index into ExpressionData::const_floats or, if it is a
+// variable, the number variables. Whether the bounds themselves are in range is part of the opcode.
+struct ExpressionRange
+{
+	ExpressionSlotIndex low;
+	ExpressionSlotIndex high;
+	bool lowVariable;
+	bool highVariable;
+};
+
 struct ExpressionData
 {
 	eExpType resultType;
-	ExpressionSlotIndex regCount;
+	ExpressionSlotIndex regCount;		// entries needed in each register bank, numbers and booleans
+	std::atomic<eDispatchMode> dispatchMode;	// only used by evaluators in PerExpression mode. Switch unless set by the owner or ExpressionTiering
+	std::atomic<uint32_t> executionCount;		// evaluations counted by ExpressionTiering, up to its threshold
+	std::atomic<bool> promotionRequested;
 	std::vector<uint32_t> byteCode;
+	std::vector<uint32_t> compactCode;		// byteCode at one word per instruction, empty unless every index fits in 8 bits
 	std::vector<float> const_floats;
 	std::vector<Name> const_names;
+	std::vector<ExpressionSet> const_sets;		// indexed by the right operand of NUM_IN_SET and NAME_IN_SET
+	std::vector<float> set_floats;
+	std::vector<Name> set_names;
+	std::vector<ExpressionRange> const_ranges;		// indexed by the right operand of the NUM_IN_RANGE ops
+	std::vector<ExpressionSlotIndex> numberInputs;		// the variable slots the expression reads, sorted
+	std::vector<ExpressionSlotIndex> nameInputs;
+	std::vector<ExpressionThreadedInstr> threadedCode;
+	std::shared_ptr<ExpressionNativeCode> nativeCode;	// optional, see ExpressionJIT
+	std::shared_ptr<ExpressionClosureCode> closureCode;	// see ExpressionClosure
+	bool ieeeDivide;		// compiled with ExpressionCompileOptions::ieeeDivide, so evaluation never fails
+};
+
+// true if value is one of the count sorted members of a set
+bool isSetMember(const float* members, uint32_t count, float value);
+bool isSetMember(const Name* members, uint32_t count, Name value);
+
+// orders names the way the members of a set are sorted
+bool setNameLess(const Name& lhs, const Name& rhs);
+
+// true if value lies between low and high, including each if the test is closed at that end. Both
+// comparisons are made and ANDed without a branch, and a NaN fails them the same as separate ones would.
+template<bool LOW_CLOSED, bool HIGH_CLOSED>
+inline bool isInRange(float value, float low, float high)
+{
+	return (LOW_CLOSED ? value >= low : value > low) & (HIGH_CLOSED ? value <= high : value < high);
+}
+
+
+// Inclusive bounds on a number. The compiler works these out for every number subexpression, starting
+// from the ranges declared for variables, and uses them to leave out divide by zero checks it can
+// prove are never needed. nonZero records a divisor known to be non-zero when the bounds don't show it,
+// e.g. a variable the expression has already tested with "!= 0".
+struct ValueRange
+{
+	float minValue;
+	float maxValue;
+	bool nonZero;
+
+	ValueRange();
+	ValueRange(float _minValue, float _maxValue);
+
+	bool excludesZero() const { return nonZero || minValue > 0.f || maxValue < 0.f; }
+	bool isUnbounded() const;
+
+	// whether value is one the range allows. Anything, NaN included, is in an unbounded range
+	bool contains(float value) const;
+
+	// the values allowed by both ranges
+	ValueRange intersect(const ValueRange& other) const;
+
+	// the values allowed by either range
+	ValueRange unite(const ValueRange& other) const;
+
+	// value if the range allows it, otherwise the nearer bound - or for a zero the range excludes, the
+	// upper bound if that's positive and the lower one if not
+	float clamp(float value) const;
 };
 
+class ExpressionErrorReporter;
 
 class VariableLayout
 {
@@ -48,37 +160,93 @@ public:
 	{
 		eExpType type;
 		ExpressionSlotIndex index;
+		ValueRange range;
 
-		Info(eExpType _type, ExpressionSlotIndex _index) : type(_type), index(_index) {}
+		Info(eExpType _type, ExpressionSlotIndex _index, const ValueRange& _range) : type(_type), index(_index), range(_range) {}
+	};
+
+	// a number variable whose value is worked out from other variables, see addDerivedVariable()
+	struct DerivedVariable
+	{
+		ExpressionSlotIndex slotIndex;
+		std::shared_ptr<const ExpressionData> expression;
 	};
 
 private:
 	std::unordered_map<Name, Info> layout;
 	ExpressionSlotIndex numberCount, nameCount;
 
+	std::vector<DerivedVariable> derivedVariables;		// in the order they were added, which they can be computed in
+	std::vector<std::vector<uint32_t>> numberDependents;	// per slot, the derived variables reading it directly or not
+	std::vector<std::vector<uint32_t>> nameDependents;
+	std::vector<bool> derivedSlots;		// per number slot
+	std::vector<ValueRange> numberRanges;	// per number slot, the same as each variable's Info::range
+
 public:
 	VariableLayout();
 
 	ExpressionSlotIndex addVariable(Name name, eExpType type);
 
+	// Adds a number variable whose value is promised to stay within range in every pack. Expressions
+	// compiled against the layout may skip divide by zero checks on the strength of it, so a value
+	// outside the range can give inf or NaN where an unranged variable would fail with DivideByZero.
+	ExpressionSlotIndex addVariable(Name name, const ValueRange& range);
+
+	// Adds a number variable holding the result of formula, which can read any variable added before it.
+	// Every pack works it out when it is created and again whenever a variable it depends on changes, so
+	// expressions read it like any other variable and it is never set directly. A division by zero gives
+	// inf or NaN, as with ieeeDivide. Returns EXP_SLOT_INDEX_MAX, with the reason in errors if given, if
+	// the formula doesn't compile or isn't a number.
+	ExpressionSlotIndex addDerivedVariable(Name name, const char* formula, ExpressionErrorReporter* errors = nullptr);
+
 	bool variableExists(const Name& variableName) const;
 	eExpType getType(const Name& variableName) const;
 	ExpressionSlotIndex getIndex(const Name& variableName) const;
+	ValueRange getRange(const Name& variableName) const;
+	const ValueRange& getRange(ExpressionSlotIndex numberSlot) const;
+
+	// the variable of the given type in slotIndex, or an empty Name if there isn't one. A linear search,
+	// for tools rather than evaluation.
+	Name getVariableAt(eExpType type, ExpressionSlotIndex slotIndex) const;
 
 	ExpressionSlotIndex getNumberCount() const { return numberCount; }
 	ExpressionSlotIndex getNameCount() const { return nameCount; }
+
+	uint32_t getDerivedCount() const { return static_cast<uint32_t>(derivedVariables.size()); }
+	const DerivedVariable& getDerived(uint32_t derivedIndex) const { return derivedVariables[derivedIndex]; }
+	bool isDerived(ExpressionSlotIndex numberSlot) const { return numberSlot < derivedSlots.size() && derivedSlots[numberSlot]; }
+
+	// the derived variables to recompute when a slot changes, in an order they can be computed in
+	const std::vector<uint32_t>& getNumberDependents(ExpressionSlotIndex slotIndex) const;
+	const std::vector<uint32_t>& getNameDependents(ExpressionSlotIndex slotIndex) const;
 };
 
 
+// Every write that changes a variable moves the pack on to a new version and stamps the slot with it,
+// so whether any of a set of slots has changed since a given version can be told from their stamps.
+// A write of the value a slot already holds changes nothing, and one that does recomputes the derived
+// variables depending on it there and then.
 class VariablePack
 {
 	std::vector<float> floatVars;
 	std::vector<Name> nameVars;
+	std::vector<uint64_t> numberStamps;
+	std::vector<uint64_t> nameStamps;
+	uint64_t version;
 	const VariableLayout* layout;
 
+	bool storeNumber(ExpressionSlotIndex slotIndex, float value);
+	void computeDerived(const std::vector<uint32_t>& derivedIndices, bool stamp);
+
 public:
 	VariablePack(const VariableLayout* _layout, Name initName, float initNumber);
 	VariablePack(const VariablePack& rhs);
+
+	// takes rhs's values, stamping each slot that changes with a version past both packs' so results
+	// memoized against either are seen as out of date
+	VariablePack& operator=(const VariablePack& rhs);
+
+	const VariableLayout* getLayout() const { return layout; }
 	
 	void setVariable(Name variableName, Name value);
 	void setVariable(Name variableName, float value);
@@ -89,6 +257,49 @@ public:
 	float getVariableNumber(Name variableName) const;
 	Name getVariableName(ExpressionSlotIndex slotIndex) const;
 	float getVariableNumber(ExpressionSlotIndex slotIndex) const;
+
+	// raw slot storage, for code that reads variables without going through the accessors
+	const float* getNumberData() const { return floatVars.data(); }
+	const Name* getNameData() const { return nameVars.data(); }
+
+	uint64_t getVersion() const { return version; }
+	uint64_t getNumberStamp(ExpressionSlotIndex slotIndex) const { return numberStamps[slotIndex]; }	// the version that last changed the slot
+	uint64_t getNameStamp(ExpressionSlotIndex slotIndex) const { return nameStamps[slotIndex]; }
+};
+
+
+// Values for variables known not to change, e.g. those fixed per archetype such as maxHealth or faction.
+// ExpressionCompiler::specialise compiles them in as constants. Kept sorted by slot.
+class ExpressionBindings
+{
+	struct NumberBinding
+	{
+		ExpressionSlotIndex slotIndex;
+		float value;
+	};
+
+	struct NameBinding
+	{
+		ExpressionSlotIndex slotIndex;
+		Name value;
+	};
+
+	std::vector<NumberBinding> numbers;
+	std::vector<NameBinding> names;
+
+public:
+	// binding a slot again replaces its value
+	void bindNumber(ExpressionSlotIndex slotIndex, float value);
+	void bindName(ExpressionSlotIndex slotIndex, Name value);
+
+	// binds a variable to the value it has in variables
+	void bindVariable(Name variableName, const VariablePack& variables);
+
+	// nullptr if the slot isn't bound
+	const float* findNumber(ExpressionSlotIndex slotIndex) const;
+	const Name* findName(ExpressionSlotIndex slotIndex) const;
+
+	bool empty() const { return numbers.empty() && names.empty(); }
 };
 
 
@@ -99,16 +310,22 @@ public:
 
 enum class eErrorCategory
 {
+	UNINITIALISED,
+
 	Internal,
 	Syntax,
 	TypeCheck,
 	Identifier,
 	Math,
 	Const,
+
+	MAX
 };
 
 enum class eErrorCode
 {
+	UNINITIALISED,
+
 	InternalError,
 	SyntaxError,
 	IdentifierNotFound,
@@ -116,8 +333,13 @@ enum class eErrorCode
 	ArithmeticTypeError,
 	ComparisonTypeError,
 	LogicTypeError,
+	SelectTypeError,
+	SetMemberNotConstant,
 	DivideByZero,
 	ConstNameExpression,
+	DerivedVariableType,
+
+	MAX
 };
 
 class ExpressionErrorReporter
@@ -150,39 +372,151 @@ public:
  *
  */
 
+struct ExpressionCompileOptions
+{
+	// Run the algebraic simplification pass: identities (x+0, x*1, 0*x, ...), double negation, folding
+	// of constant chains such as (1+x)+2, and x/c to x*(1/c) when 1/c is exact. Reassociated chains can
+	// round differently in the last bit, and 0*x is only removed when x has no divide and a finite range.
+	bool simplify;
+
+	// also replace x/c with x*(1/c) when 1/c isn't exactly representable
+	bool inexactReciprocals;
+
+	// Turn a variable tested against a lower and an upper bound, as in "x >= lo && x < hi" or
+	// "lo < x && x <= hi", into one NUM_IN_RANGE instruction. The bounds must be constants or variables.
+	bool fuseIntervals;
+
+	// Compute repeated subexpressions once, e.g. the a - b in "a - b > 10 && a - b < 50". Each shared
+	// value needs a register of its own for as long as it's in use, so this can raise regCount.
+	bool shareSubexpressions;
+
+	// Work out the range of every number subexpression and drop the divide by zero check from / and %
+	// when the divisor can't be zero - a constant, a variable declared with a range that excludes zero,
+	// or one tested by the left side of an enclosing && or ||, as in "a != 0 && b / a > 2".
+	bool analyseRanges;
+
+	// Divide as IEEE 754 does instead of failing with DivideByZero: x/0 gives inf (or NaN for 0/0), x%0
+	// gives NaN, and the evaluation carries on with EXP_STATUS_DIVIDE_BY_ZERO set in its status. No
+	// error is reported, so nothing is allocated and there is no early exit. Dividing a
+	// constant by a constant zero is still a compile error.
+	bool ieeeDivide;
+
+	// Also store the program in the one word per instruction form the Switch dispatch mode runs, when
+	// every register, constant, variable and jump distance fits in 8 bits. Halves the code the
+	// interpreter reads. Expressions that don't fit keep running from the two word form.
+	bool compactCode;
+
+	// Fuse the common opcode sequences listed in ExpressionSuperinstructions.inl in the compact code, so
+	// each runs in one dispatch. Only applies with compactCode.
+	bool superinstructions;
+
+	// Also lower the expression for the Closure dispatch mode. Turning it off saves the time and memory
+	// for large sets of expressions left to ExpressionTiering, which then promotes them to native code or
+	// the threaded interpreter instead.
+	bool closureCode;
+
+	ExpressionCompileOptions() : simplify(true), inexactReciprocals(false), fuseIntervals(true), shareSubexpressions(true), analyseRanges(true), ieeeDivide(false),
+		compactCode(true), superinstructions(true), closureCode(true) {}
+};
+
+class ASTNode;
+class ExpressionNetwork;
+
 class ExpressionCompiler
 {
 	ExpressionErrorReporter errorReport;
 	const VariableLayout* layout;
+	ExpressionCompileOptions options;
+
+	// parses the expression and runs the type check and optimisation passes, nullptr on error. Variables
+	// bound in bindings are replaced with their values before anything is folded.
+	ASTNode* buildTree(const char* expressionText, const ExpressionBindings* bindings = nullptr);
+
+	// generates the code for a tree from buildTree and frees it, nullptr if the tree is
+	ExpressionData* generate(ASTNode* expression);
 
 public:
-	ExpressionCompiler(const VariableLayout* _layout);
+	ExpressionCompiler(const VariableLayout* _layout, const ExpressionCompileOptions& _options = ExpressionCompileOptions());
 
 	ExpressionData* compile(const char* expressionText);
+
+	// Compiles the expression with the variables in bindings taken as constants, so it only fits packs
+	// holding those values. Whatever they decide is folded away, e.g. "faction == 'Orc' && hp < maxHealth / 2"
+	// with faction bound to 'Goblin' compiles to false. Fails as compile() does, and also if a bound value
+	// makes a constant division by zero.
+	ExpressionData* specialise(const char* expressionText, const ExpressionBindings& bindings);
+
+	// Compiles a set of expressions into one network, see ExpressionNetwork.h. Returns nullptr if any of
+	// them fails to compile.
+	ExpressionNetwork* compileNetwork(const char* const* expressionTexts, uint32_t expressionCount);
+
 	const ExpressionErrorReporter& errors() const { return errorReport; }
 };
 
 
+/*
+ * Stateless evaluation
+ *
+ */
+
+struct ExpressionResult
+{
+	eExpType type;
+	eErrorCode error;	// UNINITIALISED unless the evaluation failed
+	float value;		// booleans are stored as 1.f/0.f
+	uint32_t status;	// EXP_STATUS_* bits
+
+	bool failed() const { return error != eErrorCode::UNINITIALISED; }
+	bool getBoolResult() const;
+	float getNumericResult() const;
+};
+
+// Evaluates exprData against variables, using registers for numbers and boolRegisters for booleans -
+// both must hold registerCount entries. Nothing is allocated and no state is kept between calls, so any
+// number of threads can evaluate the same ExpressionData at once as long as each passes its own registers.
+// Fails with InternalError if registerCount is less than exprData.regCount, or DivideByZero. NativeVerify
+// runs as Native - verification needs an ExpressionEvaluator.
+ExpressionResult evaluateExpression(const ExpressionData& exprData, const VariablePack& variables,
+	float* registers, uint8_t* boolRegisters, uint32_t registerCount, eDispatchMode dispatchMode = eDispatchMode::PerExpression);
+
+
 /*
  * ExpressionEvaluator
  *
  */
 
+class ExpressionOpcodeProfile;
+
 class ExpressionEvaluator
 {
 	const VariablePack* variables;
 	ExpressionErrorReporter errorReport;
 	std::vector<float> reg;
+	std::vector<uint8_t> boolReg;
 	eExpType resultType;
+	eDispatchMode dispatchMode;
+	uint32_t status;
+	ExpressionOpcodeProfile* profile;
 
+	void evaluateNativeVerify(const ExpressionData* exprData);
+	void evaluateProfiled(const ExpressionData* exprData);
 	void logDivideByZeroError();
 
 public:
-	ExpressionEvaluator(const VariablePack* _variables);
+	ExpressionEvaluator(const VariablePack* _variables, eDispatchMode _dispatchMode = eDispatchMode::Switch);
+
+	static void prepareThreadedCode(ExpressionData* exprData);
+	static void prepareCompactCode(ExpressionData* exprData, bool superinstructions = true);
+
+	// While set, every evaluation runs through a recording interpreter, whatever the dispatch mode, and
+	// adds its opcode sequences to profile. See ExpressionProfile.h.
+	void setProfile(ExpressionOpcodeProfile* _profile) { profile = _profile; }
 
 	void evaluate(const ExpressionData* exprData);
+	void reset();
 
 	const ExpressionErrorReporter& errors() const { return errorReport; }
+	uint32_t getStatus() const { return status; }	// EXP_STATUS_* bits from the last evaluation
 	eExpType getResultType() const;
 	bool getBoolResult() const;
 	float getNumericResult() const;
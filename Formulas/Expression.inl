@@ -1,3 +1,128 @@
+/*
+ * ValueRange
+ */
+
+inline ValueRange::ValueRange()
+	: minValue(-std::numeric_limits<float>::infinity())
+	, maxValue(std::numeric_limits<float>::infinity())
+	, nonZero(false)
+{}
+
+inline ValueRange::ValueRange(float _minValue, float _maxValue)
+	: minValue(_minValue)
+	, maxValue(_maxValue)
+	, nonZero(false)
+{
+	assert(minValue <= maxValue);
+}
+
+inline bool ValueRange::isUnbounded() const
+{
+	return !nonZero && minValue == -std::numeric_limits<float>::infinity() && maxValue == std::numeric_limits<float>::infinity();
+}
+
+inline bool ValueRange::contains(float value) const
+{
+	return isUnbounded() || (value >= minValue && value <= maxValue && !(nonZero && value == 0.f));
+}
+
+inline ValueRange ValueRange::intersect(const ValueRange& other) const
+{
+	ValueRange result(*this);
+	result.minValue = minValue > other.minValue ? minValue : other.minValue;
+	result.maxValue = maxValue < other.maxValue ? maxValue : other.maxValue;
+	result.nonZero = nonZero || other.nonZero;
+	return result;
+}
+
+inline ValueRange ValueRange::unite(const ValueRange& other) const
+{
+	ValueRange result(*this);
+	result.minValue = minValue < other.minValue ? minValue : other.minValue;
+	result.maxValue = maxValue > other.maxValue ? maxValue : other.maxValue;
+	result.nonZero = excludesZero() && other.excludesZero();
+	return result;
+}
+
+inline float ValueRange::clamp(float value) const
+{
+	if (contains(value))
+	{
+		return value;
+	}
+
+	if (value < minValue || (value != value && std::isfinite(minValue)))
+	{
+		return minValue;
+	}
+
+	if (value > maxValue || value != value)
+	{
+		return maxValue;
+	}
+
+	return maxValue > 0.f ? maxValue : minValue;
+}
+
+
+/*
+ * Sets
+ */
+
+inline bool setNameLess(const Name& lhs, const Name& rhs)
+{
+	return std::hash<Name>()(lhs) < std::hash<Name>()(rhs);
+}
+
+// a short set is quicker to scan than to search
+#define EXP_SET_SCAN_MAX 8
+
+inline bool isSetMember(const float* members, uint32_t count, float value)
+{
+	if (count <= EXP_SET_SCAN_MAX)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (members[i] == value) return true;
+		}
+		return false;
+	}
+
+	// a NaN compares false with everything, so the search ends at the first member and doesn't match it
+	uint32_t low(0), high(count);
+	while (low < high)
+	{
+		const uint32_t middle = (low + high) / 2;
+		if (members[middle] < value) low = middle + 1;
+		else high = middle;
+	}
+
+	return low < count && members[low] == value;
+}
+
+inline bool isSetMember(const Name* members, uint32_t count, Name value)
+{
+	if (count <= EXP_SET_SCAN_MAX)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (members[i] == value) return true;
+		}
+		return false;
+	}
+
+	uint32_t low(0), high(count);
+	while (low < high)
+	{
+		const uint32_t middle = (low + high) / 2;
+		if (setNameLess(members[middle], value)) low = middle + 1;
+		else high = middle;
+	}
+
+	return low < count && members[low] == value;
+}
+
+
 /*
  * VariableLayout
  *
@@ -37,50 +162,177 @@ inline ExpressionSlotIndex VariableLayout::getIndex(const Name& variableName) co
 	return it->second.index;
 }
 
+inline const std::vector<uint32_t>& VariableLayout::getNumberDependents(ExpressionSlotIndex slotIndex) const
+{
+	static const std::vector<uint32_t> none;
+	return slotIndex < numberDependents.size() ? numberDependents[slotIndex] : none;
+}
+
+inline const std::vector<uint32_t>& VariableLayout::getNameDependents(ExpressionSlotIndex slotIndex) const
+{
+	static const std::vector<uint32_t> none;
+	return slotIndex < nameDependents.size() ? nameDependents[slotIndex] : none;
+}
+
+inline ValueRange VariableLayout::getRange(const Name& variableName) const
+{
+	auto it = layout.find(variableName);
+	if (it == layout.end())
+	{
+		assert(false);
+		return ValueRange();
+	}
+
+	return it->second.range;
+}
+
+inline const ValueRange& VariableLayout::getRange(ExpressionSlotIndex numberSlot) const
+{
+	assert(numberSlot < numberRanges.size());
+	return numberRanges[numberSlot];
+}
+
 
 /*
  * VariablePack
  */
 
 inline VariablePack::VariablePack(const VariableLayout* _layout, Name initName, float initNumber)
-	: layout(_layout)
+	: version(0)
+	, layout(_layout)
 {
 	assert(layout != nullptr);
 
-	floatVars.resize(layout->getNumberCount(), initNumber);
+	// a ranged slot starts within its range, as setVariable would insist
+	floatVars.resize(layout->getNumberCount());
+	for (ExpressionSlotIndex slotIndex = 0; slotIndex < floatVars.size(); ++slotIndex)
+	{
+		floatVars[slotIndex] = layout->getRange(slotIndex).clamp(initNumber);
+	}
 	nameVars.resize(layout->getNameCount(), initName);
+	numberStamps.resize(layout->getNumberCount(), 0);
+	nameStamps.resize(layout->getNameCount(), 0);
+
+	if (layout->getDerivedCount() > 0)
+	{
+		std::vector<uint32_t> allDerived(layout->getDerivedCount());
+		for (uint32_t i = 0; i < allDerived.size(); ++i)
+		{
+			allDerived[i] = i;
+		}
+		computeDerived(allDerived, false);
+	}
 }
 
 inline VariablePack::VariablePack(const VariablePack& rhs)
 	: floatVars(rhs.floatVars)
 	, nameVars(rhs.nameVars)
+	, numberStamps(rhs.numberStamps)
+	, nameStamps(rhs.nameStamps)
+	, version(rhs.version)
 	, layout(rhs.layout)
 {}
 
+inline VariablePack& VariablePack::operator=(const VariablePack& rhs)
+{
+	if (this == &rhs)
+	{
+		return *this;
+	}
+
+	const uint64_t newVersion = (version > rhs.version ? version : rhs.version) + 1;
+
+	if (layout != rhs.layout)
+	{
+		floatVars = rhs.floatVars;
+		nameVars = rhs.nameVars;
+		numberStamps.assign(floatVars.size(), newVersion);
+		nameStamps.assign(nameVars.size(), newVersion);
+		layout = rhs.layout;
+	}
+	else
+	{
+		for (ExpressionSlotIndex slotIndex = 0; slotIndex < floatVars.size(); ++slotIndex)
+		{
+			// bit for bit, as storeNumber compares them
+			if (memcmp(&floatVars[slotIndex], &rhs.floatVars[slotIndex], sizeof(float)) != 0)
+			{
+				floatVars[slotIndex] = rhs.floatVars[slotIndex];
+				numberStamps[slotIndex] = newVersion;
+			}
+		}
+
+		for (ExpressionSlotIndex slotIndex = 0; slotIndex < nameVars.size(); ++slotIndex)
+		{
+			if (nameVars[slotIndex] != rhs.nameVars[slotIndex])
+			{
+				nameVars[slotIndex] = rhs.nameVars[slotIndex];
+				nameStamps[slotIndex] = newVersion;
+			}
+		}
+	}
+
+	version = newVersion;
+	return *this;
+}
+
 inline void VariablePack::setVariable(Name variableName, Name value)
 {
-	ExpressionSlotIndex idx = layout->getIndex(variableName);
-	assert(idx < nameVars.size());
-	nameVars[idx] = value;
+	setVariable(layout->getIndex(variableName), value);
 }
 
 inline void VariablePack::setVariable(Name variableName, float value)
 {
-	ExpressionSlotIndex idx = layout->getIndex(variableName);
-	assert(idx < floatVars.size());
-	floatVars[idx] = value;
+	setVariable(layout->getIndex(variableName), value);
 }
 
 inline void VariablePack::setVariable(ExpressionSlotIndex slotIndex, Name value)
 {
 	assert(slotIndex < nameVars.size());
-	nameVars[slotIndex] = value;
+	if (nameVars[slotIndex] != value)
+	{
+		nameVars[slotIndex] = value;
+		nameStamps[slotIndex] = ++version;
+
+		const std::vector<uint32_t>& dependents = layout->getNameDependents(slotIndex);
+		if (!dependents.empty())
+		{
+			computeDerived(dependents, true);
+		}
+	}
 }
 
 inline void VariablePack::setVariable(ExpressionSlotIndex slotIndex, float value)
 {
 	assert(slotIndex < floatVars.size());
+	assert(!layout->isDerived(slotIndex));
+	assert(layout->getRange(slotIndex).contains(value));	// expressions may have dropped divide checks on the strength of the range
+
+	if (storeNumber(slotIndex, value))
+	{
+		const std::vector<uint32_t>& dependents = layout->getNumberDependents(slotIndex);
+		if (!dependents.empty())
+		{
+			computeDerived(dependents, true);
+		}
+	}
+}
+
+inline bool VariablePack::storeNumber(ExpressionSlotIndex slotIndex, float value)
+{
+	// compared bit for bit, so 0 and -0 are different values and a NaN written over itself is not a change
+	uint32_t oldBits, newBits;
+	memcpy(&oldBits, &floatVars[slotIndex], sizeof(float));
+	memcpy(&newBits, &value, sizeof(float));
+
+	if (oldBits == newBits)
+	{
+		return false;
+	}
+
 	floatVars[slotIndex] = value;
+	numberStamps[slotIndex] = ++version;
+	return true;
 }
 
 inline Name VariablePack::getVariableName(Name variableName) const
@@ -129,6 +381,22 @@ inline const ExpressionErrorReporter::Info& ExpressionErrorReporter::error(uint3
 	return errors[errorIndex]; 
 }
 
+/*
+ * ExpressionResult
+ */
+
+inline bool ExpressionResult::getBoolResult() const
+{
+	assert(type == eExpType::BOOL);
+	return !failed() && value != 0.f;
+}
+
+inline float ExpressionResult::getNumericResult() const
+{
+	assert(type == eExpType::NUMBER);
+	return value;
+}
+
 /*
  * ExpressionEvaluator
  */
@@ -141,7 +409,7 @@ inline eExpType ExpressionEvaluator::getResultType() const
 inline bool ExpressionEvaluator::getBoolResult() const
 {
 	assert(resultType == eExpType::BOOL);
-	return reg.size() ? reg[0] != 0.f : false;
+	return boolReg.size() ? boolReg[0] != 0 : false;
 }
 
 inline float ExpressionEvaluator::getNumericResult() const
@@ -0,0 +1,152 @@
+/*
+ * ExpressionArchetype.cpp
+ *
+ */
+
+#include "stdafx.h"
+
+#include <cstring>
+#include <sstream>
+
+#include "ExpressionArchetype.h"
+
+
+/*
+ * ExpressionArchetypeCache
+ */
+
+ExpressionArchetypeCache::ExpressionArchetypeCache(const VariableLayout* _layout, const ExpressionCompileOptions& _options)
+	: layout(_layout)
+	, options(_options)
+{
+	assert(layout);
+}
+
+uint32_t ExpressionArchetypeCache::addExpression(const char* expressionText, ExpressionErrorReporter* errors)
+{
+	ExpressionCompiler compiler(layout, options);
+	ExpressionData* exprData = compiler.compile(expressionText);
+
+	if (!exprData)
+	{
+		if (errors)
+		{
+			for (uint32_t errorIndex = 0; errorIndex < compiler.errors().errorCount(); ++errorIndex)
+			{
+				const ExpressionErrorReporter::Info& info = compiler.errors().error(errorIndex);
+				errors->addError(info.category, info.code, info.message);
+			}
+		}
+
+		return UINT32_MAX;
+	}
+
+	expressionTexts.push_back(expressionText);
+	generic.emplace_back(exprData);
+
+	for (Archetype& archetype : archetypes)
+	{
+		archetype.variants.push_back(nullptr);
+	}
+
+	return static_cast<uint32_t>(generic.size() - 1);
+}
+
+uint32_t ExpressionArchetypeCache::addArchetype(Name archetypeName, const ExpressionBindings& bindings)
+{
+	auto it = archetypeIndices.find(archetypeName);
+	if (it != archetypeIndices.end())
+	{
+		// the variants made for the old bindings stay in the cache for any other archetype sharing them
+		Archetype& archetype = archetypes[it->second];
+		archetype.bindings = bindings;
+		archetype.variants.assign(generic.size(), nullptr);
+
+		return it->second;
+	}
+
+	Archetype archetype;
+	archetype.bindings = bindings;
+	archetype.variants.resize(generic.size(), nullptr);
+	archetypes.push_back(archetype);
+
+	const uint32_t archetypeIndex = static_cast<uint32_t>(archetypes.size() - 1);
+	archetypeIndices[archetypeName] = archetypeIndex;
+
+	return archetypeIndex;
+}
+
+uint32_t ExpressionArchetypeCache::getArchetypeIndex(Name archetypeName) const
+{
+	auto it = archetypeIndices.find(archetypeName);
+	return it != archetypeIndices.end() ? it->second : UINT32_MAX;
+}
+
+const ExpressionData* ExpressionArchetypeCache::getExpression(uint32_t archetypeIndex, uint32_t expressionIndex)
+{
+	assert(archetypeIndex < archetypes.size() && expressionIndex < generic.size());
+
+	Archetype& archetype = archetypes[archetypeIndex];
+	const ExpressionData*& variant = archetype.variants[expressionIndex];
+
+	if (!variant)
+	{
+		variant = specialise(expressionIndex, archetype.bindings);
+	}
+
+	return variant;
+}
+
+const ExpressionData* ExpressionArchetypeCache::specialise(uint32_t expressionIndex, const ExpressionBindings& bindings)
+{
+	const ExpressionData& exprData = *generic[expressionIndex];
+
+	// Only the bindings of the variables the expression reads can change its code, so they make the key.
+	// Values are keyed by their bits, so that NaN finds itself.
+	std::ostringstream key;
+	key << expressionIndex;
+	bool anyBound(false);
+
+	for (ExpressionSlotIndex slotIndex : exprData.numberInputs)
+	{
+		const float* value = bindings.findNumber(slotIndex);
+		if (value)
+		{
+			uint32_t bits;
+			memcpy(&bits, value, sizeof(bits));
+			key << " n" << slotIndex << '=' << bits;
+			anyBound = true;
+		}
+	}
+
+	for (ExpressionSlotIndex slotIndex : exprData.nameInputs)
+	{
+		const Name* value = bindings.findName(slotIndex);
+		if (value)
+		{
+			key << " s" << slotIndex << '=' << value->c_str() << '\'';
+			anyBound = true;
+		}
+	}
+
+	if (!anyBound)
+	{
+		return &exprData;
+	}
+
+	std::unique_ptr<ExpressionData>& variant = specialised[key.str()];
+	if (!variant)
+	{
+		ExpressionCompiler compiler(layout, options);
+		variant.reset(compiler.specialise(expressionTexts[expressionIndex].c_str(), bindings));
+
+		if (!variant)
+		{
+			// a bound value made a constant division by zero, which the generic expression fails on at run time
+			specialised.erase(key.str());
+			return &exprData;
+		}
+	}
+
+	return variant.get();
+}
@@ -0,0 +1,68 @@
+/*
+ * ExpressionArchetype.h
+ * Expressions specialised to the variables each archetype fixes.
+ *
+ * Many variables never change for a given kind of agent - its faction, maxHealth or aggroRange - yet a
+ * generic compile has to load them on every evaluation. An ExpressionArchetypeCache holds a set of
+ * expressions and a set of archetypes, each with the bindings it fixes, and hands out each expression
+ * compiled with its archetype's bindings folded in. Variants are compiled the first time they are asked
+ * for. One that reads none of the archetype's bound variables is the generic expression itself, and
+ * archetypes binding an expression's inputs to the same values share one variant.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Expression.h"
+
+
+class ExpressionArchetypeCache
+{
+	struct Archetype
+	{
+		ExpressionBindings bindings;
+		std::vector<const ExpressionData*> variants;	// per expression, nullptr until first asked for
+	};
+
+	const VariableLayout* layout;
+	ExpressionCompileOptions options;
+	std::vector<std::string> expressionTexts;
+	std::vector<std::unique_ptr<ExpressionData>> generic;
+	std::vector<Archetype> archetypes;
+	std::unordered_map<Name, uint32_t> archetypeIndices;
+	std::unordered_map<std::string, std::unique_ptr<ExpressionData>> specialised;	// keyed by expression and the values bound to its inputs
+
+	const ExpressionData* specialise(uint32_t expressionIndex, const ExpressionBindings& bindings);
+
+public:
+	ExpressionArchetypeCache(const VariableLayout* _layout, const ExpressionCompileOptions& _options = ExpressionCompileOptions());
+
+	// Adds an expression and returns the index to look it up by, or UINT32_MAX with the reasons in errors
+	// if given if it doesn't compile
+	uint32_t addExpression(const char* expressionText, ExpressionErrorReporter* errors = nullptr);
+
+	// Adds an archetype, or replaces the bindings of one already added, and returns its index. Variables
+	// left unbound are read from the pack as usual.
+	uint32_t addArchetype(Name archetypeName, const ExpressionBindings& bindings);
+
+	// UINT32_MAX if there is no such archetype
+	uint32_t getArchetypeIndex(Name archetypeName) const;
+
+	// The expression as compiled for the archetype, valid for as long as the cache. It must only be
+	// evaluated against packs holding the archetype's bound values. Compiles it if this is the first time
+	// it was asked for, and falls back on the generic expression if a bound value makes it fail to.
+	const ExpressionData* getExpression(uint32_t archetypeIndex, uint32_t expressionIndex);
+
+	const ExpressionData* getGenericExpression(uint32_t expressionIndex) const { return generic[expressionIndex].get(); }
+
+	uint32_t getExpressionCount() const { return static_cast<uint32_t>(generic.size()); }
+	uint32_t getArchetypeCount() const { return static_cast<uint32_t>(archetypes.size()); }
+
+	// how many distinct specialised expressions have been compiled
+	uint32_t getSpecialisedCount() const { return static_cast<uint32_t>(specialised.size()); }
+};
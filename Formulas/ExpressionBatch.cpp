@@ -0,0 +1,397 @@
+/*
+ * ExpressionBatch.cpp
+ *
+ */
+
+#include "stdafx.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "ExpressionBatch.h"
+#include "ExpressionBytecode.h"
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <xmmintrin.h>
+#define EXPRESSION_PREFETCH(ADDR) _mm_prefetch(reinterpret_cast<const char*>(ADDR), _MM_HINT_T0)
+#elif defined(__GNUC__) || defined(__clang__)
+#define EXPRESSION_PREFETCH(ADDR) __builtin_prefetch(ADDR)
+#else
+#define EXPRESSION_PREFETCH(ADDR)
+#endif
+
+
+namespace
+{
+	typedef ExpressionBatchEvaluator::DecodedInstr DecodedInstr;
+	const uint32_t chunkSize = ExpressionBatchEvaluator::chunkSize;
+
+	// adapters so the chunk loop works on arrays of packs and arrays of pack pointers alike
+	struct PackArray
+	{
+		const VariablePack* packs;
+		const VariablePack& operator[](uint32_t i) const { return packs[i]; }
+	};
+
+	struct PackPointerArray
+	{
+		const VariablePack* const* packs;
+		const VariablePack& operator[](uint32_t i) const { return *packs[i]; }
+	};
+
+	// A resolved operand for one chunk - lane i reads values[i * stride]. Constants have a stride of
+	// zero, variables are gathered out of the packs into a lane buffer first.
+	template<class T>
+	struct Operand
+	{
+		const T* values;
+		uint32_t stride;
+
+		T operator[](uint32_t lane) const { return values[lane * stride]; }
+	};
+
+	template<class PACK_ACCESS>
+	Operand<float> resolveNumber(uint8_t source, ExpressionSlotIndex index, const float* reg, const ExpressionData* exprData,
+		const PACK_ACCESS& packs, uint32_t first, uint32_t laneCount, float* gatherBuffer)
+	{
+		Operand<float> op = { nullptr, 1 };
+
+		switch (source)
+		{
+		case OPERAND_SOURCE_REG:
+			op.values = reg + index * chunkSize;
+			break;
+
+		case OPERAND_SOURCE_CONST:
+			op.values = &exprData->const_floats[index];
+			op.stride = 0;
+			break;
+
+		default:
+			for (uint32_t lane = 0; lane < laneCount; ++lane)
+			{
+				gatherBuffer[lane] = packs[first + lane].getNumberData()[index];
+			}
+			op.values = gatherBuffer;
+			break;
+		}
+
+		return op;
+	}
+
+	template<class PACK_ACCESS>
+	Operand<Name> resolveName(uint8_t source, ExpressionSlotIndex index, const ExpressionData* exprData,
+		const PACK_ACCESS& packs, uint32_t first, uint32_t laneCount, Name* gatherBuffer)
+	{
+		Operand<Name> op = { nullptr, 1 };
+
+		if (source == OPERAND_SOURCE_CONST)
+		{
+			op.values = &exprData->const_names[index];
+			op.stride = 0;
+		}
+		else
+		{
+			for (uint32_t lane = 0; lane < laneCount; ++lane)
+			{
+				gatherBuffer[lane] = packs[first + lane].getNameData()[index];
+			}
+			op.values = gatherBuffer;
+		}
+
+		return op;
+	}
+
+	template<class PACK_ACCESS>
+	void prefetchPacks(const PACK_ACCESS& packs, uint32_t first, uint32_t laneCount)
+	{
+		for (uint32_t lane = 0; lane < laneCount; ++lane)
+		{
+			EXPRESSION_PREFETCH(packs[first + lane].getNumberData());
+		}
+	}
+
+} // anonymous namespace
+
+
+/*
+ * ExpressionBatchEvaluator
+ */
+
+template<class PACK_ACCESS>
+void ExpressionBatchEvaluator::evaluateChunks(const ExpressionData* exprData, const PACK_ACCESS& packs, uint32_t packCount, float* results, uint8_t* errors)
+{
+	assert(exprData);
+	assert(results && errors);
+
+	// decode once for the whole batch
+	const uint32_t codeLen(exprData->byteCode.size());
+	assert((codeLen & 1) == 0);
+
+	program.clear();
+	uint32_t jumpCount(0);
+	for (uint32_t IP = 0; IP < codeLen; IP += 2)
+	{
+		const ExpressionInstr instr = decodeInstr(&exprData->byteCode[IP]);
+		DecodedInstr decoded = { static_cast<uint16_t>(instr.opcode), instr.resultReg, instr.leftOp, instr.rightOp };
+		program.push_back(decoded);
+		jumpCount += isJumpOp(getSimpleOp(instr.opcode)) ? 1 : 0;
+	}
+
+	if (reg.size() < static_cast<size_t>(exprData->regCount) * chunkSize)
+	{
+		reg.resize(static_cast<size_t>(exprData->regCount) * chunkSize);
+		boolReg.resize(static_cast<size_t>(exprData->regCount) * chunkSize);
+	}
+
+	// jumps only go forward, so each runs at most once a chunk and there can't be more pending than there are jumps
+	if (pendingTargets.size() < jumpCount)
+	{
+		pendingTargets.resize(jumpCount);
+		pendingMasks.resize(static_cast<size_t>(jumpCount) * chunkSize);
+	}
+
+	float leftGather[chunkSize], rightGather[chunkSize], boundGather[chunkSize];
+	Name leftNameGather[chunkSize], rightNameGather[chunkSize];
+	uint8_t chunkErrors[chunkSize];
+	uint8_t active[chunkSize];
+
+	for (uint32_t first = 0; first < packCount; first += chunkSize)
+	{
+		const uint32_t laneCount = packCount - first < chunkSize ? packCount - first : chunkSize;
+
+		if (first + laneCount < packCount)
+		{
+			const uint32_t nextFirst = first + laneCount;
+			prefetchPacks(packs, nextFirst, packCount - nextFirst < chunkSize ? packCount - nextFirst : chunkSize);
+		}
+
+		for (uint32_t lane = 0; lane < laneCount; ++lane)
+		{
+			chunkErrors[lane] = 0;
+			active[lane] = 1;
+		}
+
+		uint32_t pendingCount(0);
+		const uint32_t programLen = static_cast<uint32_t>(program.size());
+
+		for (uint32_t instrIndex = 0; instrIndex < programLen; ++instrIndex)
+		{
+			while (pendingCount > 0 && pendingTargets[pendingCount - 1] == instrIndex)
+			{
+				--pendingCount;
+				memcpy(active, &pendingMasks[pendingCount * chunkSize], laneCount);
+			}
+
+			const DecodedInstr& instr = program[instrIndex];
+			const eEncOpcode opcode = static_cast<eEncOpcode>(instr.opcode);
+			const eSimpleOp simpleOp = getSimpleOp(opcode);
+			const uint8_t leftSource = getLeftSource(opcode);
+			const uint8_t rightSource = getRightSource(opcode);
+			float* out = &reg[instr.resultReg * chunkSize];
+			uint8_t* boolOut = &boolReg[instr.resultReg * chunkSize];
+
+#define RESOLVE_NUMBERS \
+			const Operand<float> left = resolveNumber(leftSource, instr.leftOp, reg.data(), exprData, packs, first, laneCount, leftGather); \
+			const Operand<float> right = resolveNumber(rightSource, instr.rightOp, reg.data(), exprData, packs, first, laneCount, rightGather);
+#define LANE_LOOP(EXPR) for (uint32_t lane = 0; lane < laneCount; ++lane) { out[lane] = (EXPR); }
+#define BOOL_LANE_LOOP(EXPR) for (uint32_t lane = 0; lane < laneCount; ++lane) { boolOut[lane] = static_cast<uint8_t>(EXPR); }
+#define NUMBER_OP(EXPR) { RESOLVE_NUMBERS LANE_LOOP(EXPR) } break;
+#define COMPARE_OP(EXPR) { RESOLVE_NUMBERS BOOL_LANE_LOOP(EXPR) } break;
+
+			switch (simpleOp)
+			{
+			case eSimpleOp::ADD:		NUMBER_OP(left[lane] + right[lane])
+			case eSimpleOp::SUB:		NUMBER_OP(left[lane] - right[lane])
+			case eSimpleOp::MUL:		NUMBER_OP(left[lane] * right[lane])
+
+			case eSimpleOp::DIV:
+				{
+					RESOLVE_NUMBERS
+					for (uint32_t lane = 0; lane < laneCount; ++lane)
+					{
+						const float divisor = right[lane];
+						chunkErrors[lane] |= active[lane] & (divisor == 0.f);
+						out[lane] = divisor != 0.f ? left[lane] / divisor : 0.f;
+					}
+				}
+				break;
+
+			case eSimpleOp::MOD:
+				{
+					RESOLVE_NUMBERS
+					for (uint32_t lane = 0; lane < laneCount; ++lane)
+					{
+						const float divisor = right[lane];
+						chunkErrors[lane] |= active[lane] & (divisor == 0.f);
+						out[lane] = divisor != 0.f ? fmodf(left[lane], divisor) : 0.f;
+					}
+				}
+				break;
+
+			// the compiler has proven these divisors non-zero for every lane that is still active
+			case eSimpleOp::DIV_NZ:		NUMBER_OP(left[lane] / right[lane])
+			case eSimpleOp::MOD_NZ:		NUMBER_OP(fmodf(left[lane], right[lane]))
+
+			// ieeeDivide - lanes with a zero divisor get inf or NaN and aren't errors
+			case eSimpleOp::DIV_IEEE:	NUMBER_OP(left[lane] / right[lane])
+			case eSimpleOp::MOD_IEEE:	NUMBER_OP(fmodf(left[lane], right[lane]))
+
+			case eSimpleOp::NUM_EQ:		COMPARE_OP(left[lane] == right[lane])
+			case eSimpleOp::NUM_NEQ:	COMPARE_OP(left[lane] != right[lane])
+			case eSimpleOp::NUM_LT:		COMPARE_OP(left[lane] <  right[lane])
+			case eSimpleOp::NUM_GT:		COMPARE_OP(left[lane] >  right[lane])
+			case eSimpleOp::NUM_LTEQ:	COMPARE_OP(left[lane] <= right[lane])
+			case eSimpleOp::NUM_GTEQ:	COMPARE_OP(left[lane] >= right[lane])
+
+			// there is no right operand to resolve - with no constants, its index would be past the end of const_floats
+			case eSimpleOp::NUM_VAL:
+				{
+					const Operand<float> left = resolveNumber(leftSource, instr.leftOp, reg.data(), exprData, packs, first, laneCount, leftGather);
+					LANE_LOOP(left[lane])
+				}
+				break;
+
+			// the condition is in the boolean bank under the result register
+			case eSimpleOp::SELECT:		NUMBER_OP(boolOut[lane] ? left[lane] : right[lane])
+
+			case eSimpleOp::AND:
+			case eSimpleOp::OR:
+			case eSimpleOp::XOR:
+			case eSimpleOp::BOOL_EQ:
+			case eSimpleOp::NOT:
+			case eSimpleOp::BOOL_SELECT:
+				{
+					// boolean lanes are bytes of 0 or 1, so these are plain bitwise loops
+					const uint8_t* left = &boolReg[instr.leftOp * chunkSize];
+					const uint8_t* right = &boolReg[instr.rightOp * chunkSize];
+
+					switch (simpleOp)
+					{
+					case eSimpleOp::AND:		BOOL_LANE_LOOP(left[lane] & right[lane]) break;
+					case eSimpleOp::OR:			BOOL_LANE_LOOP(left[lane] | right[lane]) break;
+					case eSimpleOp::XOR:		BOOL_LANE_LOOP(left[lane] ^ right[lane]) break;
+					case eSimpleOp::BOOL_EQ:	BOOL_LANE_LOOP(left[lane] ^ right[lane] ^ 1) break;
+					case eSimpleOp::BOOL_SELECT:	BOOL_LANE_LOOP((boolOut[lane] & left[lane]) | ((boolOut[lane] ^ 1) & right[lane])) break;
+					default:					BOOL_LANE_LOOP(left[lane] ^ 1) break;
+					}
+				}
+				break;
+
+			case eSimpleOp::NAME_EQ:
+			case eSimpleOp::NAME_NEQ:
+				{
+					const Operand<Name> left = resolveName(leftSource, instr.leftOp, exprData, packs, first, laneCount, leftNameGather);
+					const Operand<Name> right = resolveName(rightSource, instr.rightOp, exprData, packs, first, laneCount, rightNameGather);
+					const bool equal = simpleOp == eSimpleOp::NAME_EQ;
+
+					BOOL_LANE_LOOP((left[lane] == right[lane]) == equal)
+				}
+				break;
+
+			// the right operand is the set's index, not a value to resolve
+			case eSimpleOp::NUM_IN_SET:
+				{
+					const Operand<float> left = resolveNumber(leftSource, instr.leftOp, reg.data(), exprData, packs, first, laneCount, leftGather);
+					BOOL_LANE_LOOP(isSetMember(*exprData, instr.rightOp, left[lane]))
+				}
+				break;
+
+			case eSimpleOp::NAME_IN_SET:
+				{
+					const Operand<Name> left = resolveName(leftSource, instr.leftOp, exprData, packs, first, laneCount, leftNameGather);
+					BOOL_LANE_LOOP(isSetMember(*exprData, instr.rightOp, left[lane]))
+				}
+				break;
+
+			// and the range's, with each bound resolved like an operand of its own
+			case eSimpleOp::NUM_IN_RANGE_CC:
+			case eSimpleOp::NUM_IN_RANGE_CO:
+			case eSimpleOp::NUM_IN_RANGE_OC:
+			case eSimpleOp::NUM_IN_RANGE_OO:
+				{
+					const ExpressionRange& range = exprData->const_ranges[instr.rightOp];
+					const Operand<float> value = resolveNumber(leftSource, instr.leftOp, reg.data(), exprData, packs, first, laneCount, leftGather);
+					const Operand<float> low = resolveNumber(range.lowVariable ? OPERAND_SOURCE_VAR : OPERAND_SOURCE_CONST, range.low, reg.data(), exprData, packs, first, laneCount, rightGather);
+					const Operand<float> high = resolveNumber(range.highVariable ? OPERAND_SOURCE_VAR : OPERAND_SOURCE_CONST, range.high, reg.data(), exprData, packs, first, laneCount, boundGather);
+
+					switch (simpleOp)
+					{
+					case eSimpleOp::NUM_IN_RANGE_CC:	BOOL_LANE_LOOP((isInRange<true, true>(value[lane], low[lane], high[lane]))) break;
+					case eSimpleOp::NUM_IN_RANGE_CO:	BOOL_LANE_LOOP((isInRange<true, false>(value[lane], low[lane], high[lane]))) break;
+					case eSimpleOp::NUM_IN_RANGE_OC:	BOOL_LANE_LOOP((isInRange<false, true>(value[lane], low[lane], high[lane]))) break;
+					default:							BOOL_LANE_LOOP((isInRange<false, false>(value[lane], low[lane], high[lane]))) break;
+					}
+				}
+				break;
+
+			case eSimpleOp::BOOL_VAL:
+				{
+					const uint8_t value = instr.leftOp > 0 ? 1 : 0;
+					BOOL_LANE_LOOP(value)
+				}
+				break;
+
+			case eSimpleOp::JUMP_IF_FALSE:
+			case eSimpleOp::JUMP_IF_TRUE:
+				{
+					const uint8_t* condition = &boolReg[instr.leftOp * chunkSize];
+					const uint8_t jumpIfTrue = simpleOp == eSimpleOp::JUMP_IF_TRUE ? 1 : 0;
+					const uint32_t target = instrIndex + 1 + instr.rightOp;
+
+					uint8_t staying[chunkSize];
+					uint32_t stayingCount(0), activeCount(0);
+					for (uint32_t lane = 0; lane < laneCount; ++lane)
+					{
+						staying[lane] = active[lane] & (condition[lane] ^ jumpIfTrue);
+						stayingCount += staying[lane];
+						activeCount += active[lane];
+					}
+
+					if (stayingCount == 0)
+					{
+						instrIndex = target - 1;
+					}
+					else if (stayingCount != activeCount)
+					{
+						assert(pendingCount < pendingTargets.size());
+						memcpy(&pendingMasks[pendingCount * chunkSize], active, laneCount);
+						pendingTargets[pendingCount++] = target;
+						memcpy(active, staying, laneCount);
+					}
+				}
+				break;
+
+			default:
+				assert(false);
+				break;
+			}
+
+#undef RESOLVE_NUMBERS
+#undef LANE_LOOP
+#undef BOOL_LANE_LOOP
+#undef NUMBER_OP
+#undef COMPARE_OP
+		}
+
+		const bool boolResult = exprData->resultType == eExpType::BOOL;
+		for (uint32_t lane = 0; lane < laneCount; ++lane)
+		{
+			const float value = boolResult ? (boolReg[lane] ? 1.f : 0.f) : reg[lane];
+			errors[first + lane] = chunkErrors[lane];
+			results[first + lane] = chunkErrors[lane] ? 0.f : value;
+		}
+	}
+}
+
+void ExpressionBatchEvaluator::evaluate(const ExpressionData* exprData, const VariablePack* packs, uint32_t packCount, float* results, uint8_t* errors)
+{
+	const PackArray access = { packs };
+	evaluateChunks(exprData, access, packCount, results, errors);
+}
+
+void ExpressionBatchEvaluator::evaluate(const ExpressionData* exprData, const VariablePack* const* packs, uint32_t packCount, float* results, uint8_t* errors)
+{
+	const PackPointerArray access = { packs };
+	evaluateChunks(exprData, access, packCount, results, errors);
+}
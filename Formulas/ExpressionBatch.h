@@ -0,0 +1,55 @@
+/*
+ * ExpressionBatch.h
+ * Evaluation of one expression over many VariablePacks.
+ *
+ * Rather than running the whole program once per pack, the batch evaluator runs each instruction
+ * across a chunk of packs before moving on to the next, so the program is decoded once per batch and
+ * each opcode's loop only does arithmetic. The packs for the next chunk are prefetched while the
+ * current one is being worked on.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Expression.h"
+
+
+class ExpressionBatchEvaluator
+{
+public:
+	struct DecodedInstr
+	{
+		uint16_t opcode;
+		ExpressionSlotIndex resultReg;
+		ExpressionSlotIndex leftOp;
+		ExpressionSlotIndex rightOp;
+	};
+
+	static const uint32_t chunkSize = 64;
+
+private:
+	// kept between calls so that a batch evaluator in steady use doesn't allocate
+	std::vector<DecodedInstr> program;
+	std::vector<float> reg;		// regCount rows of chunkSize lanes
+	std::vector<uint8_t> boolReg;	// the same for booleans, one byte of 0 or 1 per lane
+
+	// lanes that disagree at a jump still run the skipped instructions, with the jumping lanes switched
+	// off until the target is reached. Each entry is a target instruction and the lane mask to restore.
+	std::vector<uint32_t> pendingTargets;
+	std::vector<uint8_t> pendingMasks;
+
+	template<class PACK_ACCESS>
+	void evaluateChunks(const ExpressionData* exprData, const PACK_ACCESS& packs, uint32_t packCount, float* results, uint8_t* errors);
+
+public:
+	ExpressionBatchEvaluator() {}
+
+	// Evaluates exprData once for each pack. results receives one value per pack, with booleans
+	// written as 1.f/0.f, and errors is set non-zero for packs whose evaluation divided by zero
+	// (their result is 0.f). An expression compiled with ieeeDivide never fails - its packs get the
+	// inf or NaN instead, without a status. All packs must use the layout the expression was compiled against.
+	void evaluate(const ExpressionData* exprData, const VariablePack* packs, uint32_t packCount, float* results, uint8_t* errors);
+	void evaluate(const ExpressionData* exprData, const VariablePack* const* packs, uint32_t packCount, float* results, uint8_t* errors);
+};
@@ -0,0 +1,899 @@
+/*
+ * Benchmarks for the Expresion system
+ *
+ * Run with "bench" on the command line. Timings are only meaningful in a Release build.
+ */
+
+#include "stdafx.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+
+#include "ExpressionBenchmarks.h"
+
+#include "Expression.h"
+#include "ExpressionArchetype.h"
+#include "ExpressionBatch.h"
+#include "ExpressionBytecode.h"
+#include "ExpressionJIT.h"
+#include "ExpressionMemo.h"
+#include "ExpressionNetwork.h"
+#include "ExpressionProfile.h"
+#include "ExpressionSIMD.h"
+#include "ExpressionTiering.h"
+#include "VariableTable.h"
+
+
+/*
+ * Corpus - the expressions from ExecutionTests that read at least one variable
+ */
+
+static const char* const benchmarkCorpus[] =
+{
+	"2+NumA",
+	"NumA+4.5",
+	"NumA+NumB",
+	"4-NumA",
+	"4-NumB",
+	"NumA-NumB",
+	"NumA--3",
+	"4*NumA",
+	"NumA*2",
+	"NumA*NumB",
+	"NumA/2",
+	"10/NumA",
+	"NumA/NumC",
+	"NumA % 2",
+	"12 % NumA",
+	"NumA % NumC",
+	"NumA == 5",
+	"5==NumA",
+	"NumA == 10/2",
+	"10/2 == NumA",
+	"NumB == 5",
+	"5==NumB",
+	"NumB == 10/2",
+	"10/2 == NumB",
+	"NumB != 5",
+	"5!=NumB",
+	"88 != 10/NumC",
+	"10/NumC !=88",
+	"NumB != 10/NumC",
+	"10/NumC != NumB",
+	"NumA != 5",
+	"5!=NumA",
+	"5 != 10/NumC",
+	"10/NumC !=5",
+	"NumA != 10/NumC",
+	"10/NumC != NumA",
+	"NumA < 7",
+	"3 < NumA",
+	"3 < NumC*3",
+	"20/NumA < 5",
+	"20/NumA < NumA",
+	"NumA < NumC*3",
+	"NumA < 3",
+	"5 < NumA",
+	"10 < NumC*3",
+	"20/NumC < 1",
+	"20/NumC < NumA",
+	"NumA < 1+NumC",
+	"NumA <= 7",
+	"NumA <= 5",
+	"3 <= NumA",
+	"5 <= NumA",
+	"3 <= NumC*3",
+	"6 <= NumC*3",
+	"10/NumC <= 10",
+	"10/NumC <= 5",
+	"20/NumA <= NumA",
+	"10/NumC <= NumA",
+	"NumA <= NumC*3",
+	"NumA <= NumC+3",
+	"NumA <= 3",
+	"6 <= NumA",
+	"10 <= NumC*3",
+	"10/NumC <= 1",
+	"100/NumC <= NumA",
+	"NumA <= 1+NumC",
+	"NumA > 3",
+	"10 > NumA",
+	"10 > NumC*3",
+	"10/NumC > 1",
+	"100/NumC > NumA",
+	"NumA > 1+NumC",
+	"NumA > 7",
+	"3 > NumA",
+	"3 > NumC*3",
+	"10/NumC > 5",
+	"10/NumC > NumA",
+	"NumA > NumC*3",
+	"NumA >= 3",
+	"NumA >= 5",
+	"10 >= NumA",
+	"5 >= NumA",
+	"10 >= NumC*3",
+	"6 >= NumC*3",
+	"10/NumC >= 1",
+	"10/NumC >= 5",
+	"20/NumC >= NumA",
+	"10/NumC >= NumA",
+	"NumA >= 1+NumC",
+	"NumA >= NumC+3",
+	"NumA >= 7",
+	"3 >= NumA",
+	"3 >= NumC*3",
+	"NumA >= NumC*3",
+	"NameC == 'C'",
+	"NameC == 'A'",
+	"NameC != 'C'",
+	"'C' == NameC",
+	"'A' == NameC",
+	"'C' != NameC",
+	"NameC == NameC2",
+	"NameC == NameD",
+	"NameC != NameC2",
+	"(NumA == 5) == (NumB < 0)",
+	"(NumA == 5) != (NumB < 0)",
+	"(NumA == 5) == (NumB > 0)",
+	"(NumA == 5) != (NumB > 0)",
+	"NumA==5 && 3>2",
+	"NumA==5 && 3<2",
+	"NumA==6 && 3>2",
+	"NumA==6 && 3<2",
+	"NumA==5 && NumB<0",
+	"NumA!=5 && NumB<0",
+	"NumA==5 && NumB>0",
+	"NumA==5 || 3>2",
+	"NumA==5 || 3<2",
+	"NumA!=5 || 3>2",
+	"NumA!=5 || 3<2",
+	"3>2 || NumA==5",
+	"3<2 || NumA==5",
+	"3>2 || NumA!=5",
+	"3<2 || NumA!=5",
+	"NumA==5 || NumB<0",
+	"NumA==5 || NumB>0",
+	"NumA!=5 || NumB<0",
+	"NumA!=5 || NumB>0",
+	"NumA!=5 && 10/(NumA-5) > 1",
+	"NumA==5 || 10/(NumA-5) > 1",
+	"NumA==5 && (NumB<0 || NumA/(NumB+3) > 0)",
+	"(NumA==5 && NumB>0) || (NumC==2 && NumB<0)",
+	"(NumA!=5 || NumB>0) && NumC==2",
+	"(NumA==5 || NumB>0) && (NumC!=2 || NumB<0)",
+	"((NumA==5 && NumB<0) && NumC==2) && NumB!=0",
+	"NumA==5 && (NumB>0 || (NumC==2 && NumA>NumC))",
+	"!(NumA==5 && NumB<0) || (NumC==2) != (NumA>NumC && NumB>0)",
+	"NumA!=5 || NumB>0 || NumC!=2 || NumA<NumC",
+	"(NumA + 1) * 2 - 2 * 1 + 0",
+	"NumA / 4 + (NumB - 1) - 3",
+	"((NumA * 2) * 3) / 2 > NumB + 0",
+	"-(-NumA) * 1 + (10 - (NumC - 4))",
+	"!!(NumA > 2) && 0 * NumB + NumC >= 1",
+	"(NumA - NumB) > 10 && (NumA - NumB) < 50",
+	"(NumA + NumB) * (NumA + NumB) - NumC * (NumA + NumB)",
+	"NumA / (NumB * NumC + 1) > 2 || NumA / (NumB * NumC + 1) < -2",
+};
+
+
+/*
+ * ExpressionBenchmark
+ */
+
+class ExpressionBenchmark
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+protected:
+	VariableLayout layout;
+	VariablePack* vars;
+	std::vector<std::unique_ptr<ExpressionData>> corpus;
+
+	static const uint32_t iterations = 20000;
+	static const uint32_t populationSize = 100000;
+
+	double nanosecondsPerEvaluation(Clock::time_point start, Clock::time_point end) const;
+
+public:
+	ExpressionBenchmark();
+	~ExpressionBenchmark();
+
+	bool setup();
+	void reportRegisters() const;
+	void reportInstructions() const;
+	bool benchmarkDispatch();
+	bool benchmarkEncoding();
+	void profileOpcodes(ExpressionOpcodeProfile& profile) const;
+	bool benchmarkPopulation();
+	bool benchmarkNetwork();
+	bool benchmarkMemo();
+	bool benchmarkArchetype();
+	bool benchmarkTiering();
+};
+
+ExpressionBenchmark::ExpressionBenchmark()
+	: vars(nullptr)
+{}
+
+ExpressionBenchmark::~ExpressionBenchmark()
+{
+	delete vars;
+}
+
+bool ExpressionBenchmark::setup()
+{
+	// same layout and values as the execution tests
+	layout.addVariable(Name("NumA"), eExpType::NUMBER);
+	layout.addVariable(Name("NumB"), eExpType::NUMBER);
+	layout.addVariable(Name("NumC"), eExpType::NUMBER);
+
+	layout.addVariable(Name("NameC"), eExpType::NAME);
+	layout.addVariable(Name("NameC2"), eExpType::NAME);
+	layout.addVariable(Name("NameD"), eExpType::NAME);
+
+	vars = new VariablePack(&layout, Name(), 0);
+
+	vars->setVariable(Name("NumA"), 5.f);
+	vars->setVariable(Name("NumB"), -3.f);
+	vars->setVariable(Name("NumC"), 2.f);
+
+	vars->setVariable(Name("NameC"), Name("C"));
+	vars->setVariable(Name("NameC2"), Name("C"));
+	vars->setVariable(Name("NameD"), Name("D"));
+
+	for (const char* expressionText : benchmarkCorpus)
+	{
+		ExpressionCompiler comp(&layout);
+		ExpressionData* expData = comp.compile(expressionText);
+
+		if (expData == nullptr)
+		{
+			std::cout << "Failed to compile benchmark expression: " << expressionText << std::endl;
+			return false;
+		}
+
+		ExpressionJIT::compile(expData);
+		corpus.emplace_back(expData);
+	}
+
+	return true;
+}
+
+double ExpressionBenchmark::nanosecondsPerEvaluation(Clock::time_point start, Clock::time_point end) const
+{
+	const double totalNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	return totalNs / (static_cast<double>(iterations) * corpus.size());
+}
+
+void ExpressionBenchmark::reportRegisters() const
+{
+	uint32_t total(0), maximum(0);
+	for (const auto& expData : corpus)
+	{
+		total += expData->regCount;
+		maximum = expData->regCount > maximum ? expData->regCount : maximum;
+	}
+
+	std::cout << "Registers (" << corpus.size() << " expressions)" << std::endl;
+	std::cout << "    total " << total << ", max " << maximum << ", mean " << std::fixed << std::setprecision(2) <<
+		static_cast<double>(total) / corpus.size() << std::endl;
+}
+
+// instruction counts for the corpus as each optimisation pass is switched on
+void ExpressionBenchmark::reportInstructions() const
+{
+	size_t counts[3] = { 0, 0, 0 };
+	size_t divideCount(0), uncheckedCount(0);
+
+	for (int pass = 0; pass < 3; ++pass)
+	{
+		ExpressionCompileOptions options;
+		options.simplify = pass >= 1;
+		options.shareSubexpressions = pass >= 2;
+
+		for (const char* expressionText : benchmarkCorpus)
+		{
+			ExpressionCompiler comp(&layout, options);
+			std::unique_ptr<ExpressionData> expData(comp.compile(expressionText));
+			counts[pass] += expData ? expData->byteCode.size() / 2 : 0;
+
+			for (size_t IP = 0; pass == 2 && expData && IP < expData->byteCode.size(); IP += 2)
+			{
+				const eSimpleOp op = getSimpleOp(decodeInstr(&expData->byteCode[IP]).opcode);
+				divideCount += op == eSimpleOp::DIV || op == eSimpleOp::MOD || op == eSimpleOp::DIV_NZ || op == eSimpleOp::MOD_NZ;
+				uncheckedCount += op == eSimpleOp::DIV_NZ || op == eSimpleOp::MOD_NZ;
+			}
+		}
+	}
+
+	std::cout << "Instructions (" << corpus.size() << " expressions)" << std::endl;
+	std::cout << "    unoptimised " << counts[0] << ", simplified " << counts[1] << ", shared subexpressions " << counts[2] << std::endl;
+	std::cout << "    divides " << divideCount << ", without a divide by zero check " << uncheckedCount << std::endl;
+}
+
+bool ExpressionBenchmark::benchmarkDispatch()
+{
+	const eDispatchMode modes[] = { eDispatchMode::Switch, eDispatchMode::Threaded, eDispatchMode::Native, eDispatchMode::Closure };
+	const char* modeNames[] = { "switch", "threaded", "native", "closure" };
+	const int modeCount = sizeof(modes) / sizeof(modes[0]);
+	double timings[modeCount];
+	float checksums[modeCount];
+
+	for (int m = 0; m < modeCount; ++m)
+	{
+		ExpressionEvaluator eval(vars, modes[m]);
+		float checksum(0.f);
+
+		const Clock::time_point start = Clock::now();
+		for (uint32_t i = 0; i < iterations; ++i)
+		{
+			for (const auto& expData : corpus)
+			{
+				eval.evaluate(expData.get());
+				checksum += expData->resultType == eExpType::BOOL ? (eval.getBoolResult() ? 1.f : 0.f) : eval.getNumericResult();
+			}
+		}
+		const Clock::time_point end = Clock::now();
+
+		timings[m] = nanosecondsPerEvaluation(start, end);
+		checksums[m] = checksum;
+	}
+
+	std::cout << "Dispatch (" << corpus.size() << " expressions x " << iterations << " iterations)" << std::endl;
+	for (int m = 0; m < modeCount; ++m)
+	{
+		std::cout << "    " << std::setw(10) << std::left << modeNames[m] << std::right << std::fixed << std::setprecision(2) << std::setw(8) << timings[m] << " ns/eval";
+		if (m > 0)
+		{
+			std::cout << std::setw(8) << timings[0] / timings[m] << "x";
+		}
+		std::cout << std::endl;
+	}
+
+	for (int m = 1; m < modeCount; ++m)
+	{
+		if (checksums[m] != checksums[0])
+		{
+			std::cout << "Error: " << modeNames[m] << " dispatch produced different results" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// switch dispatch over the one word compact encoding against the same corpus compiled to wide instructions
+bool ExpressionBenchmark::benchmarkEncoding()
+{
+	std::vector<std::unique_ptr<ExpressionData>> wideCorpus, unfusedCorpus;
+	size_t wideBytes(0), compactBytes(0), compactCount(0), instructionCount(0), dispatchCount(0);
+
+	ExpressionCompileOptions wideOptions;
+	wideOptions.compactCode = false;
+	ExpressionCompileOptions unfusedOptions;
+	unfusedOptions.superinstructions = false;
+
+	for (size_t i = 0; i < corpus.size(); ++i)
+	{
+		ExpressionCompiler wideComp(&layout, wideOptions);
+		wideCorpus.emplace_back(wideComp.compile(benchmarkCorpus[i]));
+		ExpressionCompiler unfusedComp(&layout, unfusedOptions);
+		unfusedCorpus.emplace_back(unfusedComp.compile(benchmarkCorpus[i]));
+
+		const ExpressionData* expData = corpus[i].get();
+		wideBytes += expData->byteCode.size() * sizeof(uint32_t);
+		compactBytes += (expData->compactCode.empty() ? expData->byteCode.size() : expData->compactCode.size()) * sizeof(uint32_t);
+		compactCount += expData->compactCode.empty() ? 0 : 1;
+		instructionCount += expData->byteCode.size() / 2;
+		dispatchCount += expData->compactCode.empty() ? expData->byteCode.size() / 2 : getCompactDispatchCount(*expData);
+	}
+
+	std::vector<std::unique_ptr<ExpressionData>>* corpora[] = { &wideCorpus, &unfusedCorpus, &corpus };
+	const int corpusCount = sizeof(corpora) / sizeof(corpora[0]);
+	double timings[corpusCount];
+	float checksums[corpusCount];
+
+	for (int c = 0; c < corpusCount; ++c)
+	{
+		ExpressionEvaluator eval(vars, eDispatchMode::Switch);
+		float checksum(0.f);
+
+		const Clock::time_point start = Clock::now();
+		for (uint32_t i = 0; i < iterations; ++i)
+		{
+			for (const auto& expData : *corpora[c])
+			{
+				eval.evaluate(expData.get());
+				checksum += expData->resultType == eExpType::BOOL ? (eval.getBoolResult() ? 1.f : 0.f) : eval.getNumericResult();
+			}
+		}
+		const Clock::time_point end = Clock::now();
+
+		timings[c] = nanosecondsPerEvaluation(start, end);
+		checksums[c] = checksum;
+	}
+
+	std::cout << "Encoding (" << compactCount << " of " << corpus.size() << " expressions compact)" << std::endl;
+	std::cout << "    bytecode bytes: wide " << wideBytes << ", compact " << compactBytes << std::endl;
+	std::cout << "    instructions " << instructionCount << ", dispatches with superinstructions " << dispatchCount << " (" <<
+		std::fixed << std::setprecision(1) << 100.0 * (instructionCount - dispatchCount) / instructionCount << "% fewer)" << std::endl;
+	std::cout << "    switch dispatch: wide " << std::setprecision(2) << timings[0] << " ns/eval, compact " << timings[1] <<
+		" ns/eval (" << timings[0] / timings[1] << "x), superinstructions " << timings[2] << " ns/eval (" << timings[0] / timings[2] << "x)" << std::endl;
+
+	for (int c = 1; c < corpusCount; ++c)
+	{
+		if (checksums[c] != checksums[0])
+		{
+			std::cout << "Error: compact encoding produced different results" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// the corpus against a spread of variable values, so both sides of the && and || jumps are seen
+void ExpressionBenchmark::profileOpcodes(ExpressionOpcodeProfile& profile) const
+{
+	VariablePack pack(*vars);
+	ExpressionEvaluator eval(&pack);
+	eval.setProfile(&profile);
+
+	// every combination of the values benchmarkPopulation() uses
+	for (int i = 0; i < 11 * 7; ++i)
+	{
+		pack.setVariable(Name("NumA"), static_cast<float>(i % 11) - 5.f);
+		pack.setVariable(Name("NumB"), static_cast<float>(i % 7) - 3.f);
+
+		for (const auto& expData : corpus)
+		{
+			eval.evaluate(expData.get());
+		}
+	}
+}
+
+bool ExpressionBenchmark::benchmarkPopulation()
+{
+	// the same population stored both ways: one VariablePack per entity, and as columns
+	std::vector<VariablePack> packs;
+	VariableTable table(&layout, Name(), 0.f);
+
+	packs.reserve(populationSize);
+	table.reserve(populationSize);
+
+	for (uint32_t i = 0; i < populationSize; ++i)
+	{
+		packs.emplace_back(*vars);
+		packs.back().setVariable(Name("NumA"), static_cast<float>(i % 11) - 5.f);
+		packs.back().setVariable(Name("NumB"), static_cast<float>(i % 7) - 3.f);
+
+		table.getRow(table.addRow()).copyFrom(packs.back());
+	}
+
+	std::vector<float> results(populationSize);
+	std::vector<uint8_t> errors(populationSize);
+
+	auto nanosecondsPerRow = [](Clock::time_point start, Clock::time_point end, size_t evaluations)
+	{
+		return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / evaluations;
+	};
+
+	const size_t evaluations = static_cast<size_t>(populationSize) * corpus.size();
+
+	// baseline: the interpreter once per pack
+	float baseChecksum(0.f);
+	const Clock::time_point baseStart = Clock::now();
+	for (const auto& expData : corpus)
+	{
+		for (const VariablePack& pack : packs)
+		{
+			ExpressionEvaluator eval(&pack);
+			eval.evaluate(expData.get());
+			if (eval.errors().errorCount() == 0)
+			{
+				baseChecksum += expData->resultType == eExpType::BOOL ? (eval.getBoolResult() ? 1.f : 0.f) : eval.getNumericResult();
+			}
+		}
+	}
+	const double baseTiming = nanosecondsPerRow(baseStart, Clock::now(), evaluations);
+
+	std::cout << "Population (" << corpus.size() << " expressions x " << populationSize << " entities)" << std::endl;
+	std::cout << "    " << std::setw(10) << std::left << "per-pack" << std::right << std::fixed << std::setprecision(2) << std::setw(8) << baseTiming << " ns/row" << std::endl;
+
+	// one batch call per expression over all the packs
+	{
+		ExpressionBatchEvaluator batchEval;
+		float checksum(0.f);
+
+		const Clock::time_point start = Clock::now();
+		for (const auto& expData : corpus)
+		{
+			batchEval.evaluate(expData.get(), packs.data(), populationSize, results.data(), errors.data());
+			for (float result : results)
+			{
+				checksum += result;
+			}
+		}
+		const double timing = nanosecondsPerRow(start, Clock::now(), evaluations);
+
+		std::cout << "    " << std::setw(10) << std::left << "batch" << std::right << std::setw(8) << timing << " ns/row" << std::setw(8) << baseTiming / timing << "x" << std::endl;
+
+		if (checksum != baseChecksum)
+		{
+			std::cout << "Error: batch evaluation produced different results" << std::endl;
+			return false;
+		}
+	}
+
+	const eSimdLevel levels[] = { eSimdLevel::Scalar, eSimdLevel::SSE2, eSimdLevel::AVX2, eSimdLevel::AVX512 };
+	for (eSimdLevel level : levels)
+	{
+		if (level > ExpressionSIMD::getSupportedLevel())
+		{
+			break;
+		}
+
+		float checksum(0.f);
+		const Clock::time_point start = Clock::now();
+		for (const auto& expData : corpus)
+		{
+			ExpressionSIMD::evaluate(expData.get(), &table, 0, populationSize, results.data(), errors.data(), level);
+			for (float result : results)
+			{
+				checksum += result;
+			}
+		}
+		const double timing = nanosecondsPerRow(start, Clock::now(), evaluations);
+
+		std::cout << "    " << std::setw(10) << std::left << ExpressionSIMD::getLevelAsString(level) << std::right << std::setw(8) << timing << " ns/row" << std::setw(8) << baseTiming / timing << "x" << std::endl;
+
+		if (checksum != baseChecksum)
+		{
+			std::cout << "Error: " << ExpressionSIMD::getLevelAsString(level) << " produced different results" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// the whole corpus evaluated once per round, as separate expressions and as one network
+bool ExpressionBenchmark::benchmarkNetwork()
+{
+	ExpressionCompiler comp(&layout);
+	std::unique_ptr<ExpressionNetwork> network(comp.compileNetwork(benchmarkCorpus, sizeof(benchmarkCorpus) / sizeof(benchmarkCorpus[0])));
+
+	if (!network)
+	{
+		std::cout << "Failed to compile the benchmark network" << std::endl;
+		return false;
+	}
+
+	size_t separateInstructions(0);
+	for (const auto& expData : corpus)
+	{
+		separateInstructions += expData->byteCode.size() / 2;
+	}
+
+	std::vector<float> registers(network->getRegisterCount());
+	std::vector<uint8_t> boolRegisters(network->getRegisterCount());
+	float separateChecksum(0.f);
+
+	const Clock::time_point separateStart = Clock::now();
+	for (uint32_t i = 0; i < iterations; ++i)
+	{
+		for (const auto& expData : corpus)
+		{
+			const ExpressionResult result = evaluateExpression(*expData, *vars, registers.data(), boolRegisters.data(),
+				static_cast<uint32_t>(registers.size()), eDispatchMode::Threaded);
+			separateChecksum += result.failed() ? 0.f : result.value;
+		}
+	}
+	const Clock::time_point separateEnd = Clock::now();
+
+	ExpressionNetworkEvaluator networkEval(network.get(), eDispatchMode::Threaded);
+	float networkChecksum(0.f);
+
+	const Clock::time_point networkStart = Clock::now();
+	for (uint32_t i = 0; i < iterations; ++i)
+	{
+		networkEval.evaluate(*vars);
+		for (const ExpressionResult& result : networkEval.getResults())
+		{
+			networkChecksum += result.failed() ? 0.f : result.value;
+		}
+	}
+	const Clock::time_point networkEnd = Clock::now();
+
+	const double separateTiming = nanosecondsPerEvaluation(separateStart, separateEnd);
+	const double networkTiming = nanosecondsPerEvaluation(networkStart, networkEnd);
+
+	std::cout << "Network (" << corpus.size() << " expressions x " << iterations << " iterations)" << std::endl;
+	std::cout << "    " << std::setw(10) << std::left << "separate" << std::right << std::fixed << std::setprecision(2) << std::setw(8) << separateTiming << " ns/eval, " <<
+		separateInstructions << " instructions" << std::endl;
+	std::cout << "    " << std::setw(10) << std::left << "network" << std::right << std::setw(8) << networkTiming << " ns/eval, " <<
+		network->getProgram().byteCode.size() / 2 << " instructions" << std::setw(8) << separateTiming / networkTiming << "x" << std::endl;
+
+	if (networkChecksum != separateChecksum)
+	{
+		std::cout << "Error: network evaluation produced different results" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// A quiet scene - every variable is written each round but only NumC changes, and only every 8th round
+bool ExpressionBenchmark::benchmarkMemo()
+{
+	const uint32_t changeInterval = 8;
+	std::vector<float> registers(4);
+	std::vector<uint8_t> boolRegisters(4);
+
+	for (const auto& expData : corpus)
+	{
+		registers.resize(std::max<size_t>(registers.size(), expData->regCount));
+		boolRegisters.resize(registers.size());
+	}
+
+	const ExpressionSlotIndex numA = layout.getIndex(Name("NumA"));
+	const ExpressionSlotIndex numB = layout.getIndex(Name("NumB"));
+	const ExpressionSlotIndex numC = layout.getIndex(Name("NumC"));
+	const ExpressionSlotIndex nameD = layout.getIndex(Name("NameD"));
+	const Name valueD("D");
+
+	auto writeRound = [&](uint32_t round)
+	{
+		vars->setVariable(numA, 5.f);
+		vars->setVariable(numB, -3.f);
+		vars->setVariable(numC, (round / changeInterval) & 1 ? 3.f : 2.f);
+		vars->setVariable(nameD, valueD);
+	};
+
+	float plainChecksum(0.f);
+
+	const Clock::time_point plainStart = Clock::now();
+	for (uint32_t i = 0; i < iterations; ++i)
+	{
+		writeRound(i);
+		for (const auto& expData : corpus)
+		{
+			const ExpressionResult result = evaluateExpression(*expData, *vars, registers.data(), boolRegisters.data(),
+				static_cast<uint32_t>(registers.size()), eDispatchMode::Threaded);
+			plainChecksum += result.failed() ? 0.f : result.value;
+		}
+	}
+	const Clock::time_point plainEnd = Clock::now();
+
+	ExpressionMemoEvaluator memoEval(vars, eDispatchMode::Threaded);
+	for (const auto& expData : corpus)
+	{
+		memoEval.addExpression(expData.get());
+	}
+
+	float memoChecksum(0.f);
+
+	const Clock::time_point memoStart = Clock::now();
+	for (uint32_t i = 0; i < iterations; ++i)
+	{
+		writeRound(i);
+		for (uint32_t index = 0; index < corpus.size(); ++index)
+		{
+			const ExpressionResult& result = memoEval.evaluate(index);
+			memoChecksum += result.failed() ? 0.f : result.value;
+		}
+	}
+	const Clock::time_point memoEnd = Clock::now();
+
+	writeRound(0);
+
+	const double plainTiming = nanosecondsPerEvaluation(plainStart, plainEnd);
+	const double memoTiming = nanosecondsPerEvaluation(memoStart, memoEnd);
+	const double evaluatedShare = 100.0 * memoEval.getEvaluationCount() / (static_cast<double>(iterations) * corpus.size());
+
+	std::cout << "Memoized (NumC changing every " << changeInterval << " rounds)" << std::endl;
+	std::cout << "    " << std::setw(10) << std::left << "plain" << std::right << std::fixed << std::setprecision(2) << std::setw(8) << plainTiming << " ns/eval" << std::endl;
+	std::cout << "    " << std::setw(10) << std::left << "memoized" << std::right << std::setw(8) << memoTiming << " ns/eval, " <<
+		evaluatedShare << "% evaluated" << std::setw(8) << plainTiming / memoTiming << "x" << std::endl;
+
+	if (memoChecksum != plainChecksum)
+	{
+		std::cout << "Error: memoized evaluation produced different results" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+// the corpus specialised to an archetype fixing NumC and the names, against the generic compile
+bool ExpressionBenchmark::benchmarkArchetype()
+{
+	ExpressionBindings bindings;
+	bindings.bindVariable(Name("NumC"), *vars);
+	bindings.bindVariable(Name("NameC"), *vars);
+	bindings.bindVariable(Name("NameC2"), *vars);
+	bindings.bindVariable(Name("NameD"), *vars);
+
+	ExpressionArchetypeCache cache(&layout);
+	for (const char* expressionText : benchmarkCorpus)
+	{
+		cache.addExpression(expressionText);
+	}
+	const uint32_t archetype = cache.addArchetype(Name("Archetype"), bindings);
+
+	std::vector<const ExpressionData*> variants;
+	size_t genericInstructions(0), specialisedInstructions(0), constantCount(0);
+	std::vector<float> registers(1);
+	std::vector<uint8_t> boolRegisters(1);
+
+	for (uint32_t index = 0; index < cache.getExpressionCount(); ++index)
+	{
+		variants.push_back(cache.getExpression(archetype, index));
+		genericInstructions += cache.getGenericExpression(index)->byteCode.size() / 2;
+		specialisedInstructions += variants.back()->byteCode.size() / 2;
+		constantCount += variants.back()->numberInputs.empty() && variants.back()->nameInputs.empty();
+
+		registers.resize(std::max<size_t>(registers.size(), cache.getGenericExpression(index)->regCount));
+		boolRegisters.resize(registers.size());
+	}
+
+	double timings[2];
+	float checksums[2];
+
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		float checksum(0.f);
+
+		const Clock::time_point start = Clock::now();
+		for (uint32_t i = 0; i < iterations; ++i)
+		{
+			for (uint32_t index = 0; index < variants.size(); ++index)
+			{
+				const ExpressionData* expData = pass == 0 ? cache.getGenericExpression(index) : variants[index];
+				const ExpressionResult result = evaluateExpression(*expData, *vars, registers.data(), boolRegisters.data(),
+					static_cast<uint32_t>(registers.size()), eDispatchMode::Threaded);
+				checksum += result.failed() ? 0.f : result.value;
+			}
+		}
+		const Clock::time_point end = Clock::now();
+
+		timings[pass] = nanosecondsPerEvaluation(start, end);
+		checksums[pass] = checksum;
+	}
+
+	std::cout << "Archetype (NumC and the names bound, " << cache.getSpecialisedCount() << " specialised, " << constantCount << " constant)" << std::endl;
+	std::cout << "    " << std::setw(12) << std::left << "generic" << std::right << std::fixed << std::setprecision(2) << std::setw(8) << timings[0] <<
+		" ns/eval, " << genericInstructions << " instructions" << std::endl;
+	std::cout << "    " << std::setw(12) << std::left << "specialised" << std::right << std::setw(8) << timings[1] <<
+		" ns/eval, " << specialisedInstructions << " instructions" << std::setw(8) << timings[0] / timings[1] << "x" << std::endl;
+
+	if (checksums[0] != checksums[1])
+	{
+		std::cout << "Error: specialised evaluation produced different results" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+// The corpus compiled without closure code and run through the interpreter, against the same expressions
+// promoted synchronously once they have run promoteThreshold times. The first tiered pass includes
+// generating the native code, the second is after every expression has been promoted.
+bool ExpressionBenchmark::benchmarkTiering()
+{
+	ExpressionCompileOptions options;
+	options.closureCode = false;
+
+	std::vector<std::unique_ptr<ExpressionData>> expressions;
+	std::vector<float> registers(1);
+	std::vector<uint8_t> boolRegisters(1);
+
+	for (const char* expressionText : benchmarkCorpus)
+	{
+		ExpressionCompiler comp(&layout, options);
+		expressions.emplace_back(comp.compile(expressionText));
+
+		registers.resize(std::max<size_t>(registers.size(), expressions.back()->regCount));
+		boolRegisters.resize(registers.size());
+	}
+
+	ExpressionTierPolicy policy;
+	policy.promoteThreshold = 200;
+	policy.promotion = eTierPromotion::Synchronous;
+	ExpressionTiering tiering(policy);
+
+	double timings[3];
+	float checksums[3];
+
+	for (int pass = 0; pass < 3; ++pass)
+	{
+		float checksum(0.f);
+
+		const Clock::time_point start = Clock::now();
+		for (uint32_t i = 0; i < iterations; ++i)
+		{
+			for (const auto& expData : expressions)
+			{
+				const ExpressionResult result = pass == 0 ?
+					evaluateExpression(*expData, *vars, registers.data(), boolRegisters.data(), static_cast<uint32_t>(registers.size()), eDispatchMode::Switch) :
+					tiering.evaluate(*expData, *vars, registers.data(), boolRegisters.data(), static_cast<uint32_t>(registers.size()));
+				checksum += result.failed() ? 0.f : result.value;
+			}
+		}
+		const Clock::time_point end = Clock::now();
+
+		timings[pass] = nanosecondsPerEvaluation(start, end);
+		checksums[pass] = checksum;
+	}
+
+	uint32_t nativeCount(0);
+	for (const auto& expData : expressions)
+	{
+		nativeCount += expData->dispatchMode == eDispatchMode::Native;
+	}
+
+	std::cout << "Tiered (promoted after " << policy.promoteThreshold << " evaluations, " << nativeCount << " of " <<
+		tiering.getPromotedCount() << " to native code)" << std::endl;
+	std::cout << "    " << std::setw(12) << std::left << "interpreted" << std::right << std::fixed << std::setprecision(2) << std::setw(8) << timings[0] << " ns/eval" << std::endl;
+	std::cout << "    " << std::setw(12) << std::left << "promoting" << std::right << std::setw(8) << timings[1] << " ns/eval" <<
+		std::setw(8) << timings[0] / timings[1] << "x" << std::endl;
+	std::cout << "    " << std::setw(12) << std::left << "promoted" << std::right << std::setw(8) << timings[2] << " ns/eval" <<
+		std::setw(8) << timings[0] / timings[2] << "x" << std::endl;
+
+	if (checksums[0] != checksums[1] || checksums[0] != checksums[2])
+	{
+		std::cout << "Error: tiered evaluation produced different results" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+int runExpressionBenchmarks()
+{
+	ExpressionBenchmark bench;
+
+	if (!bench.setup())
+	{
+		return -1;
+	}
+
+	bench.reportRegisters();
+	bench.reportInstructions();
+
+	if (!bench.benchmarkDispatch() ||
+		!bench.benchmarkEncoding() ||
+		!bench.benchmarkPopulation() ||
+		!bench.benchmarkNetwork() ||
+		!bench.benchmarkMemo() ||
+		!bench.benchmarkArchetype() ||
+		!bench.benchmarkTiering())
+	{
+		return -1;
+	}
+
+	return 0;
+}
+
+int generateSuperinstructions(uint32_t count)
+{
+	ExpressionBenchmark bench;
+
+	if (!bench.setup())
+	{
+		return -1;
+	}
+
+	ExpressionOpcodeProfile profile;
+	bench.profileOpcodes(profile);
+	profile.writeSuperinstructions(std::cout, count);
+
+	return 0;
+}
@@ -0,0 +1,14 @@
+/*
+ * Benchmarks for the Expresion system
+ */
+
+#pragma once
+
+#include <cstdint>
+
+int runExpressionBenchmarks();
+
+// Profiles the benchmark corpus and prints ExpressionSuperinstructions.inl for its count most common
+// opcode sequences. Run with "superinstructions [count]" and redirect the output over the file, then
+// rebuild.
+int generateSuperinstructions(uint32_t count);
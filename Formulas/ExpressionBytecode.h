@@ -0,0 +1,384 @@
+/*
+ * ExpressionBytecode.h
+ * Encoding of the expression VM instructions. Internal to the expression system - shared by the
+ * compiler, the evaluator and the native code generator.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "Expression.h"
+
+
+/* 
+ * Bytecode values
+ */
+
+#define LEFT_REG_BITS    0x00
+#define LEFT_CONST_BITS  0x04 // 0b00000100
+#define LEFT_VAR_BITS    0x08 // 0b00001000
+#define RIGHT_REG_BITS   0x00
+#define RIGHT_CONST_BITS 0x01 // 0b00000001
+#define RIGHT_VAR_BITS   0x02 // 0b00000010
+
+#define OP_FLAG_BITS 4
+#define OPCODE(OP,LEFT,RIGHT) ((((uint8_t)OP)<<(OP_FLAG_BITS))|(LEFT)|(RIGHT))
+
+
+enum class eSimpleOp : uint8_t
+{
+	UNINITIALISED,
+
+	ADD,
+	SUB,
+	MUL,
+	DIV,
+	MOD,
+	DIV_NZ,		// divisor proven non-zero by the compiler, so not checked
+	MOD_NZ,
+	DIV_IEEE,	// ExpressionCompileOptions::ieeeDivide - a zero divisor gives inf or NaN and sets a status bit
+	MOD_IEEE,
+
+	AND,
+	OR,
+	XOR,
+	NOT,
+
+	NAME_EQ,
+	NAME_NEQ,
+	BOOL_EQ,
+	NUM_EQ,
+	NUM_NEQ,
+	NUM_LT,
+	NUM_GT,
+	NUM_LTEQ,
+	NUM_GTEQ,
+	NUM_IN_SET,		// left is a member of the set ExpressionData::const_sets[right]
+	NAME_IN_SET,
+	NUM_IN_RANGE_CC,	// left lies between the bounds ExpressionData::const_ranges[right], C closed and O open
+	NUM_IN_RANGE_CO,
+	NUM_IN_RANGE_OC,
+	NUM_IN_RANGE_OO,
+
+	NUM_VAL,
+	BOOL_VAL,
+
+	SELECT,			// cond ? left : right, taking cond from the boolean register with the result's index
+	BOOL_SELECT,
+
+	JUMP_IF_FALSE,
+	JUMP_IF_TRUE
+};
+
+
+enum class eEncOpcode : uint16_t
+{
+	UNINITIALISED = static_cast<uint16_t>(eSimpleOp::UNINITIALISED),
+
+	// Arithmetic (Numeric)
+	ADD			= OPCODE(eSimpleOp::ADD,LEFT_REG_BITS,  RIGHT_REG_BITS),
+	ADD_LC		= OPCODE(eSimpleOp::ADD,LEFT_CONST_BITS,RIGHT_REG_BITS),
+	ADD_LV		= OPCODE(eSimpleOp::ADD,LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	ADD_LV_RV	= OPCODE(eSimpleOp::ADD,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+	ADD_LC_RV   = OPCODE(eSimpleOp::ADD,LEFT_CONST_BITS,RIGHT_VAR_BITS),
+
+	SUB			= OPCODE(eSimpleOp::SUB,LEFT_REG_BITS,  RIGHT_REG_BITS),
+	SUB_LC		= OPCODE(eSimpleOp::SUB,LEFT_CONST_BITS,RIGHT_REG_BITS),
+	SUB_LV		= OPCODE(eSimpleOp::SUB,LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	SUB_RC		= OPCODE(eSimpleOp::SUB,LEFT_REG_BITS,  RIGHT_CONST_BITS),
+	SUB_RV		= OPCODE(eSimpleOp::SUB,LEFT_REG_BITS,  RIGHT_VAR_BITS),
+	SUB_LC_RV	= OPCODE(eSimpleOp::SUB,LEFT_CONST_BITS,RIGHT_VAR_BITS),
+	SUB_LV_RC	= OPCODE(eSimpleOp::SUB,LEFT_VAR_BITS,  RIGHT_CONST_BITS),
+	SUB_LV_RV	= OPCODE(eSimpleOp::SUB,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+	
+	MUL			= OPCODE(eSimpleOp::MUL,LEFT_REG_BITS,  RIGHT_REG_BITS),
+	MUL_LC		= OPCODE(eSimpleOp::MUL,LEFT_CONST_BITS,RIGHT_REG_BITS),
+	MUL_LV		= OPCODE(eSimpleOp::MUL,LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	MUL_LV_RV	= OPCODE(eSimpleOp::MUL,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+	MUL_LC_RV	= OPCODE(eSimpleOp::MUL,LEFT_CONST_BITS,RIGHT_VAR_BITS),
+
+	DIV			= OPCODE(eSimpleOp::DIV,LEFT_REG_BITS,  RIGHT_REG_BITS),
+	DIV_LC		= OPCODE(eSimpleOp::DIV,LEFT_CONST_BITS,RIGHT_REG_BITS),
+	DIV_LV		= OPCODE(eSimpleOp::DIV,LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	DIV_RC		= OPCODE(eSimpleOp::DIV,LEFT_REG_BITS,  RIGHT_CONST_BITS),
+	DIV_RV		= OPCODE(eSimpleOp::DIV,LEFT_REG_BITS,  RIGHT_VAR_BITS),
+	DIV_LC_RV	= OPCODE(eSimpleOp::DIV,LEFT_CONST_BITS,RIGHT_VAR_BITS),
+	DIV_LV_RC	= OPCODE(eSimpleOp::DIV,LEFT_VAR_BITS,  RIGHT_CONST_BITS),
+	DIV_LV_RV	= OPCODE(eSimpleOp::DIV,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+
+	MOD			= OPCODE(eSimpleOp::MOD,LEFT_REG_BITS,  RIGHT_REG_BITS),
+	MOD_LC		= OPCODE(eSimpleOp::MOD,LEFT_CONST_BITS,RIGHT_REG_BITS),
+	MOD_LV		= OPCODE(eSimpleOp::MOD,LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	MOD_RC		= OPCODE(eSimpleOp::MOD,LEFT_REG_BITS,  RIGHT_CONST_BITS),
+	MOD_RV		= OPCODE(eSimpleOp::MOD,LEFT_REG_BITS,  RIGHT_VAR_BITS),
+	MOD_LC_RV	= OPCODE(eSimpleOp::MOD,LEFT_CONST_BITS,RIGHT_VAR_BITS),
+	MOD_LV_RC	= OPCODE(eSimpleOp::MOD,LEFT_VAR_BITS,  RIGHT_CONST_BITS),
+	MOD_LV_RV	= OPCODE(eSimpleOp::MOD,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+
+	// Arithmetic with a divisor the compiler has proven non-zero
+	DIV_NZ			= OPCODE(eSimpleOp::DIV_NZ,LEFT_REG_BITS,  RIGHT_REG_BITS),
+	DIV_NZ_LC		= OPCODE(eSimpleOp::DIV_NZ,LEFT_CONST_BITS,RIGHT_REG_BITS),
+	DIV_NZ_LV		= OPCODE(eSimpleOp::DIV_NZ,LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	DIV_NZ_RC		= OPCODE(eSimpleOp::DIV_NZ,LEFT_REG_BITS,  RIGHT_CONST_BITS),
+	DIV_NZ_RV		= OPCODE(eSimpleOp::DIV_NZ,LEFT_REG_BITS,  RIGHT_VAR_BITS),
+	DIV_NZ_LC_RV	= OPCODE(eSimpleOp::DIV_NZ,LEFT_CONST_BITS,RIGHT_VAR_BITS),
+	DIV_NZ_LV_RC	= OPCODE(eSimpleOp::DIV_NZ,LEFT_VAR_BITS,  RIGHT_CONST_BITS),
+	DIV_NZ_LV_RV	= OPCODE(eSimpleOp::DIV_NZ,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+
+	MOD_NZ			= OPCODE(eSimpleOp::MOD_NZ,LEFT_REG_BITS,  RIGHT_REG_BITS),
+	MOD_NZ_LC		= OPCODE(eSimpleOp::MOD_NZ,LEFT_CONST_BITS,RIGHT_REG_BITS),
+	MOD_NZ_LV		= OPCODE(eSimpleOp::MOD_NZ,LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	MOD_NZ_RC		= OPCODE(eSimpleOp::MOD_NZ,LEFT_REG_BITS,  RIGHT_CONST_BITS),
+	MOD_NZ_RV		= OPCODE(eSimpleOp::MOD_NZ,LEFT_REG_BITS,  RIGHT_VAR_BITS),
+	MOD_NZ_LC_RV	= OPCODE(eSimpleOp::MOD_NZ,LEFT_CONST_BITS,RIGHT_VAR_BITS),
+	MOD_NZ_LV_RC	= OPCODE(eSimpleOp::MOD_NZ,LEFT_VAR_BITS,  RIGHT_CONST_BITS),
+	MOD_NZ_LV_RV	= OPCODE(eSimpleOp::MOD_NZ,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+
+	// Arithmetic that doesn't fail on a zero divisor
+	DIV_IEEE		= OPCODE(eSimpleOp::DIV_IEEE,LEFT_REG_BITS,  RIGHT_REG_BITS),
+	DIV_IEEE_LC		= OPCODE(eSimpleOp::DIV_IEEE,LEFT_CONST_BITS,RIGHT_REG_BITS),
+	DIV_IEEE_LV		= OPCODE(eSimpleOp::DIV_IEEE,LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	DIV_IEEE_RC		= OPCODE(eSimpleOp::DIV_IEEE,LEFT_REG_BITS,  RIGHT_CONST_BITS),
+	DIV_IEEE_RV		= OPCODE(eSimpleOp::DIV_IEEE,LEFT_REG_BITS,  RIGHT_VAR_BITS),
+	DIV_IEEE_LC_RV	= OPCODE(eSimpleOp::DIV_IEEE,LEFT_CONST_BITS,RIGHT_VAR_BITS),
+	DIV_IEEE_LV_RC	= OPCODE(eSimpleOp::DIV_IEEE,LEFT_VAR_BITS,  RIGHT_CONST_BITS),
+	DIV_IEEE_LV_RV	= OPCODE(eSimpleOp::DIV_IEEE,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+
+	MOD_IEEE		= OPCODE(eSimpleOp::MOD_IEEE,LEFT_REG_BITS,  RIGHT_REG_BITS),
+	MOD_IEEE_LC		= OPCODE(eSimpleOp::MOD_IEEE,LEFT_CONST_BITS,RIGHT_REG_BITS),
+	MOD_IEEE_LV		= OPCODE(eSimpleOp::MOD_IEEE,LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	MOD_IEEE_RC		= OPCODE(eSimpleOp::MOD_IEEE,LEFT_REG_BITS,  RIGHT_CONST_BITS),
+	MOD_IEEE_RV		= OPCODE(eSimpleOp::MOD_IEEE,LEFT_REG_BITS,  RIGHT_VAR_BITS),
+	MOD_IEEE_LC_RV	= OPCODE(eSimpleOp::MOD_IEEE,LEFT_CONST_BITS,RIGHT_VAR_BITS),
+	MOD_IEEE_LV_RC	= OPCODE(eSimpleOp::MOD_IEEE,LEFT_VAR_BITS,  RIGHT_CONST_BITS),
+	MOD_IEEE_LV_RV	= OPCODE(eSimpleOp::MOD_IEEE,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+
+	// Logic (Boolean)
+	AND			= OPCODE(eSimpleOp::AND,LEFT_REG_BITS,  RIGHT_REG_BITS),
+	OR			= OPCODE(eSimpleOp::OR,LEFT_REG_BITS,  RIGHT_REG_BITS),
+	XOR			= OPCODE(eSimpleOp::XOR,LEFT_REG_BITS, RIGHT_REG_BITS),
+	NOT			= OPCODE(eSimpleOp::NOT,LEFT_REG_BITS, RIGHT_REG_BITS), // right not used
+
+	// Comparison (Names)
+	NAME_EQ_LC_RV  = OPCODE(eSimpleOp::NAME_EQ ,LEFT_CONST_BITS,RIGHT_VAR_BITS),
+	NAME_EQ_LV_RV  = OPCODE(eSimpleOp::NAME_EQ ,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+	NAME_NEQ_LC_RV = OPCODE(eSimpleOp::NAME_NEQ,LEFT_CONST_BITS,RIGHT_VAR_BITS),
+	NAME_NEQ_LV_RV = OPCODE(eSimpleOp::NAME_NEQ,LEFT_VAR_BITS  ,RIGHT_VAR_BITS),
+
+	// Comparison (Boolean)	[NEQ is handled by XOR]
+	BOOL_EQ		  = OPCODE(eSimpleOp::BOOL_EQ ,LEFT_REG_BITS,RIGHT_REG_BITS),
+
+	// Comparison (Numeric)
+	NUM_EQ			= OPCODE(eSimpleOp::NUM_EQ,  LEFT_REG_BITS,  RIGHT_REG_BITS),
+	NUM_EQ_LC		= OPCODE(eSimpleOp::NUM_EQ,  LEFT_CONST_BITS,RIGHT_REG_BITS),
+	NUM_EQ_LV		= OPCODE(eSimpleOp::NUM_EQ,  LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	NUM_EQ_LV_RV	= OPCODE(eSimpleOp::NUM_EQ,  LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+	NUM_EQ_LV_RC	= OPCODE(eSimpleOp::NUM_EQ,  LEFT_VAR_BITS,  RIGHT_CONST_BITS),
+
+	NUM_NEQ			= OPCODE(eSimpleOp::NUM_NEQ,  LEFT_REG_BITS,  RIGHT_REG_BITS),
+	NUM_NEQ_LC		= OPCODE(eSimpleOp::NUM_NEQ,  LEFT_CONST_BITS,RIGHT_REG_BITS),
+	NUM_NEQ_LV		= OPCODE(eSimpleOp::NUM_NEQ,  LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	NUM_NEQ_LV_RV	= OPCODE(eSimpleOp::NUM_NEQ,  LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+	NUM_NEQ_LV_RC	= OPCODE(eSimpleOp::NUM_NEQ,  LEFT_VAR_BITS,  RIGHT_CONST_BITS),
+
+	NUM_LT			= OPCODE(eSimpleOp::NUM_LT,  LEFT_REG_BITS,  RIGHT_REG_BITS),
+	NUM_LT_LC		= OPCODE(eSimpleOp::NUM_LT,  LEFT_CONST_BITS,RIGHT_REG_BITS),
+	NUM_LT_LV		= OPCODE(eSimpleOp::NUM_LT,  LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	NUM_LT_LV_RV	= OPCODE(eSimpleOp::NUM_LT,  LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+	NUM_LT_LV_RC	= OPCODE(eSimpleOp::NUM_LT,  LEFT_VAR_BITS,  RIGHT_CONST_BITS),
+
+	NUM_GT			= OPCODE(eSimpleOp::NUM_GT,  LEFT_REG_BITS,  RIGHT_REG_BITS),
+	NUM_GT_LC		= OPCODE(eSimpleOp::NUM_GT,  LEFT_CONST_BITS,RIGHT_REG_BITS),
+	NUM_GT_LV		= OPCODE(eSimpleOp::NUM_GT,  LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	NUM_GT_LV_RV	= OPCODE(eSimpleOp::NUM_GT,  LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+	NUM_GT_LV_RC	= OPCODE(eSimpleOp::NUM_GT,  LEFT_VAR_BITS,  RIGHT_CONST_BITS),
+
+	NUM_LTEQ		= OPCODE(eSimpleOp::NUM_LTEQ,LEFT_REG_BITS,  RIGHT_REG_BITS),
+	NUM_LTEQ_LC		= OPCODE(eSimpleOp::NUM_LTEQ,LEFT_CONST_BITS,RIGHT_REG_BITS),
+	NUM_LTEQ_LV		= OPCODE(eSimpleOp::NUM_LTEQ,LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	NUM_LTEQ_LV_RV	= OPCODE(eSimpleOp::NUM_LTEQ,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+	NUM_LTEQ_LV_RC	= OPCODE(eSimpleOp::NUM_LTEQ,LEFT_VAR_BITS,  RIGHT_CONST_BITS),
+
+	NUM_GTEQ		= OPCODE(eSimpleOp::NUM_GTEQ,LEFT_REG_BITS,  RIGHT_REG_BITS),
+	NUM_GTEQ_LC		= OPCODE(eSimpleOp::NUM_GTEQ,LEFT_CONST_BITS,RIGHT_REG_BITS),
+	NUM_GTEQ_LV		= OPCODE(eSimpleOp::NUM_GTEQ,LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	NUM_GTEQ_LV_RV	= OPCODE(eSimpleOp::NUM_GTEQ,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+	NUM_GTEQ_LV_RC	= OPCODE(eSimpleOp::NUM_GTEQ,LEFT_VAR_BITS,  RIGHT_CONST_BITS),
+
+	// Set membership - the right operand indexes ExpressionData::const_sets rather than const_floats
+	NUM_IN_SET_RC		= OPCODE(eSimpleOp::NUM_IN_SET, LEFT_REG_BITS,RIGHT_CONST_BITS),
+	NUM_IN_SET_LV_RC	= OPCODE(eSimpleOp::NUM_IN_SET, LEFT_VAR_BITS,RIGHT_CONST_BITS),
+	NAME_IN_SET_LV_RC	= OPCODE(eSimpleOp::NAME_IN_SET,LEFT_VAR_BITS,RIGHT_CONST_BITS),
+
+	// Intervals - the right operand indexes ExpressionData::const_ranges, lo <= left < hi is NUM_IN_RANGE_CO
+	NUM_IN_RANGE_CC_LV_RC	= OPCODE(eSimpleOp::NUM_IN_RANGE_CC,LEFT_VAR_BITS,RIGHT_CONST_BITS),
+	NUM_IN_RANGE_CO_LV_RC	= OPCODE(eSimpleOp::NUM_IN_RANGE_CO,LEFT_VAR_BITS,RIGHT_CONST_BITS),
+	NUM_IN_RANGE_OC_LV_RC	= OPCODE(eSimpleOp::NUM_IN_RANGE_OC,LEFT_VAR_BITS,RIGHT_CONST_BITS),
+	NUM_IN_RANGE_OO_LV_RC	= OPCODE(eSimpleOp::NUM_IN_RANGE_OO,LEFT_VAR_BITS,RIGHT_CONST_BITS),
+
+	// Value operations (for const and single variable expressions)
+	NUM_VAL_LC		= OPCODE(eSimpleOp::NUM_VAL, LEFT_CONST_BITS,RIGHT_CONST_BITS),
+	NUM_VAL_LV		= OPCODE(eSimpleOp::NUM_VAL, LEFT_VAR_BITS,  RIGHT_CONST_BITS),
+	BOOL_VAL_LC     = OPCODE(eSimpleOp::BOOL_VAL,LEFT_CONST_BITS,RIGHT_CONST_BITS),
+
+	// Selection - the result register's boolean holds the condition on entry, and the result is left
+	// if it is true or right if not. Both operands have already been computed, so there is no jump.
+	SELECT			= OPCODE(eSimpleOp::SELECT,LEFT_REG_BITS,  RIGHT_REG_BITS),
+	SELECT_LC		= OPCODE(eSimpleOp::SELECT,LEFT_CONST_BITS,RIGHT_REG_BITS),
+	SELECT_LV		= OPCODE(eSimpleOp::SELECT,LEFT_VAR_BITS,  RIGHT_REG_BITS),
+	SELECT_RC		= OPCODE(eSimpleOp::SELECT,LEFT_REG_BITS,  RIGHT_CONST_BITS),
+	SELECT_RV		= OPCODE(eSimpleOp::SELECT,LEFT_REG_BITS,  RIGHT_VAR_BITS),
+	SELECT_LC_RC	= OPCODE(eSimpleOp::SELECT,LEFT_CONST_BITS,RIGHT_CONST_BITS),
+	SELECT_LC_RV	= OPCODE(eSimpleOp::SELECT,LEFT_CONST_BITS,RIGHT_VAR_BITS),
+	SELECT_LV_RC	= OPCODE(eSimpleOp::SELECT,LEFT_VAR_BITS,  RIGHT_CONST_BITS),
+	SELECT_LV_RV	= OPCODE(eSimpleOp::SELECT,LEFT_VAR_BITS,  RIGHT_VAR_BITS),
+	BOOL_SELECT		= OPCODE(eSimpleOp::BOOL_SELECT,LEFT_REG_BITS,RIGHT_REG_BITS),
+
+	// Control flow - left is the condition register, right is the number of following instructions to
+	// skip when the jump is taken. Jumps only ever go forwards and write no result register.
+	JUMP_IF_FALSE	= OPCODE(eSimpleOp::JUMP_IF_FALSE,LEFT_REG_BITS,RIGHT_REG_BITS),
+	JUMP_IF_TRUE	= OPCODE(eSimpleOp::JUMP_IF_TRUE, LEFT_REG_BITS,RIGHT_REG_BITS),
+
+	OPCODE_MAX
+};
+
+
+/*
+ * Instruction decoding
+ *
+ * Each instruction is two words: [opcode:16 | result register:16] [left operand:16 | right operand:16]
+ *
+ * ExpressionData::compactCode holds the same program at one word per instruction,
+ * [handler:8 | result register:8 | left operand:8 | right operand:8], where handler is the opcode's
+ * index in ExpressionHandlers.inl. Only the evaluator's switch dispatch reads it. A run of instructions
+ * listed in ExpressionSuperinstructions.inl has its first word's handler replaced with the fused one,
+ * which carries out the whole run in one dispatch. The other words are left alone, so jump distances
+ * don't change and a jump into the middle of the run still works.
+ */
+
+#define OPERAND_SOURCE_REG   0x00
+#define OPERAND_SOURCE_CONST 0x01
+#define OPERAND_SOURCE_VAR   0x02
+
+struct ExpressionInstr
+{
+	eEncOpcode opcode;
+	ExpressionSlotIndex resultReg;
+	ExpressionSlotIndex leftOp;
+	ExpressionSlotIndex rightOp;
+};
+
+inline ExpressionInstr decodeInstr(const uint32_t* code)
+{
+	ExpressionInstr instr;
+	instr.opcode = static_cast<eEncOpcode>(code[0] >> 16);
+	instr.resultReg = static_cast<ExpressionSlotIndex>(code[0] & 0xffff);
+	instr.leftOp = static_cast<ExpressionSlotIndex>(code[1] >> 16);
+	instr.rightOp = static_cast<ExpressionSlotIndex>(code[1] & 0xffff);
+	return instr;
+}
+
+// the opcode's name as written in ExpressionHandlers.inl
+const char* getOpcodeAsString(eEncOpcode opcode);
+
+// Dispatches it takes to run straight through compactCode, where a superinstruction counts once for
+// all its words. Zero if there is no compact code.
+uint32_t getCompactDispatchCount(const ExpressionData& exprData);
+
+inline eSimpleOp getSimpleOp(eEncOpcode opcode)
+{
+	return static_cast<eSimpleOp>(static_cast<uint16_t>(opcode) >> OP_FLAG_BITS);
+}
+
+inline bool isJumpOp(eSimpleOp simpleOp)
+{
+	return simpleOp == eSimpleOp::JUMP_IF_FALSE || simpleOp == eSimpleOp::JUMP_IF_TRUE;
+}
+
+// true for the operations that write the boolean register bank rather than the number one
+inline bool isBooleanResult(eSimpleOp simpleOp)
+{
+	switch (simpleOp)
+	{
+	case eSimpleOp::AND:
+	case eSimpleOp::OR:
+	case eSimpleOp::XOR:
+	case eSimpleOp::NOT:
+	case eSimpleOp::NAME_EQ:
+	case eSimpleOp::NAME_NEQ:
+	case eSimpleOp::BOOL_EQ:
+	case eSimpleOp::NUM_EQ:
+	case eSimpleOp::NUM_NEQ:
+	case eSimpleOp::NUM_LT:
+	case eSimpleOp::NUM_GT:
+	case eSimpleOp::NUM_LTEQ:
+	case eSimpleOp::NUM_GTEQ:
+	case eSimpleOp::NUM_IN_SET:
+	case eSimpleOp::NAME_IN_SET:
+	case eSimpleOp::NUM_IN_RANGE_CC:
+	case eSimpleOp::NUM_IN_RANGE_CO:
+	case eSimpleOp::NUM_IN_RANGE_OC:
+	case eSimpleOp::NUM_IN_RANGE_OO:
+	case eSimpleOp::BOOL_VAL:
+	case eSimpleOp::BOOL_SELECT:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+// membership tests for NUM_IN_SET and NAME_IN_SET
+inline bool isSetMember(const ExpressionData& data, ExpressionSlotIndex setIndex, float value)
+{
+	const ExpressionSet& set = data.const_sets[setIndex];
+	return isSetMember(data.set_floats.data() + set.first, set.count, value);
+}
+
+inline bool isSetMember(const ExpressionData& data, ExpressionSlotIndex setIndex, Name value)
+{
+	const ExpressionSet& set = data.const_sets[setIndex];
+	return isSetMember(data.set_names.data() + set.first, set.count, value);
+}
+
+// whether a NUM_IN_RANGE op includes its lower and upper bounds
+inline bool isLowBoundClosed(eSimpleOp simpleOp)
+{
+	return simpleOp == eSimpleOp::NUM_IN_RANGE_CC || simpleOp == eSimpleOp::NUM_IN_RANGE_CO;
+}
+
+inline bool isHighBoundClosed(eSimpleOp simpleOp)
+{
+	return simpleOp == eSimpleOp::NUM_IN_RANGE_CC || simpleOp == eSimpleOp::NUM_IN_RANGE_OC;
+}
+
+// the bounds of range rangeIndex, each read from the constants or the number variables
+inline float getRangeLow(const ExpressionData& data, ExpressionSlotIndex rangeIndex, const float* numberVars)
+{
+	const ExpressionRange& range = data.const_ranges[rangeIndex];
+	return range.lowVariable ? numberVars[range.low] : data.const_floats[range.low];
+}
+
+inline float getRangeHigh(const ExpressionData& data, ExpressionSlotIndex rangeIndex, const float* numberVars)
+{
+	const ExpressionRange& range = data.const_ranges[rangeIndex];
+	return range.highVariable ? numberVars[range.high] : data.const_floats[range.high];
+}
+
+template<bool LOW_CLOSED, bool HIGH_CLOSED>
+inline bool isInRange(const ExpressionData& data, ExpressionSlotIndex rangeIndex, const float* numberVars, float value)
+{
+	return isInRange<LOW_CLOSED, HIGH_CLOSED>(value, getRangeLow(data, rangeIndex, numberVars), getRangeHigh(data, rangeIndex, numberVars));
+}
+
+// returns one of the OPERAND_SOURCE_ values
+inline uint8_t getLeftSource(eEncOpcode opcode)
+{
+	return (static_cast<uint16_t>(opcode) >> 2) & 0x03;
+}
+
+inline uint8_t getRightSource(eEncOpcode opcode)
+{
+	return static_cast<uint16_t>(opcode) & 0x03;
+}
@@ -0,0 +1,492 @@
+/*
+ * ExpressionClosure.cpp
+ *
+ * Node functions and the builder for the closure backend. Every node function is an instantiation
+ * of one of the templates below, picked by the builder from the operation and operand kinds.
+ *
+ */
+
+#include "stdafx.h"
+
+#include <math.h>
+
+#include "ExpressionClosure.h"
+
+
+namespace
+{
+	typedef ExpressionClosureNode Node;
+	typedef ExpressionClosureOperand Operand;
+	typedef ExpressionClosureContext Context;
+	typedef ExpressionClosureBuilder::eValueKind eValueKind;
+
+
+	/*
+	 * Operand accessors
+	 */
+
+	struct NumConst
+	{
+		static float get(const Operand& op, Context& context) { return op.number; }
+	};
+
+	struct NumVar
+	{
+		static float get(const Operand& op, Context& context) { return context.numberVars[op.slot]; }
+	};
+
+	struct NumNode
+	{
+		static float get(const Operand& op, Context& context) { return op.node->func(op.node, context); }
+	};
+
+	struct NameConst
+	{
+		static Name get(const Operand& op, Context& context) { return op.name; }
+	};
+
+	struct NameVar
+	{
+		static Name get(const Operand& op, Context& context) { return context.nameVars[op.slot]; }
+	};
+
+
+	/*
+	 * Operations - booleans are passed around as 1.f/0.f, the same as ExpressionResult::value
+	 */
+
+	inline float fromBool(bool value) { return value ? 1.f : 0.f; }
+
+	struct OpAdd	{ static float apply(float l, float r, Context&) { return l + r; } };
+	struct OpSub	{ static float apply(float l, float r, Context&) { return l - r; } };
+	struct OpMul	{ static float apply(float l, float r, Context&) { return l * r; } };
+
+	struct OpDiv
+	{
+		static float apply(float l, float r, Context& context)
+		{
+			if (r == 0.f) { context.divideByZero = true; return 0.f; }
+			return l / r;
+		}
+	};
+
+	struct OpMod
+	{
+		static float apply(float l, float r, Context& context)
+		{
+			if (r == 0.f) { context.divideByZero = true; return 0.f; }
+			return fmodf(l, r);
+		}
+	};
+
+	// ieeeDivide - a zero divisor is only flagged, the result is whatever IEEE division gives
+	struct OpDivIeee
+	{
+		static float apply(float l, float r, Context& context)
+		{
+			context.divideByZero |= r == 0.f;
+			return l / r;
+		}
+	};
+
+	struct OpModIeee
+	{
+		static float apply(float l, float r, Context& context)
+		{
+			context.divideByZero |= r == 0.f;
+			return fmodf(l, r);
+		}
+	};
+
+	struct OpXor	{ static float apply(float l, float r, Context&) { return fromBool((l != 0.f) != (r != 0.f)); } };
+	struct OpBoolEq	{ static float apply(float l, float r, Context&) { return fromBool((l != 0.f) == (r != 0.f)); } };
+	struct OpNot	{ static float apply(float l, Context&) { return fromBool(l == 0.f); } };
+
+	struct OpNumEq		{ static float apply(float l, float r, Context&) { return fromBool(l == r); } };
+	struct OpNumNeq		{ static float apply(float l, float r, Context&) { return fromBool(l != r); } };
+	struct OpNumLt		{ static float apply(float l, float r, Context&) { return fromBool(l < r); } };
+	struct OpNumLtEq	{ static float apply(float l, float r, Context&) { return fromBool(l <= r); } };
+	struct OpNumGt		{ static float apply(float l, float r, Context&) { return fromBool(l > r); } };
+	struct OpNumGtEq	{ static float apply(float l, float r, Context&) { return fromBool(l >= r); } };
+
+	struct OpNameEq		{ static float apply(Name l, Name r, Context&) { return fromBool(l == r); } };
+	struct OpNameNeq	{ static float apply(Name l, Name r, Context&) { return fromBool(l != r); } };
+
+
+	/*
+	 * Node functions
+	 */
+
+	template<class OP, class LEFT, class RIGHT>
+	float evalBinary(const Node* node, Context& context)
+	{
+		return OP::apply(LEFT::get(node->left, context), RIGHT::get(node->right, context), context);
+	}
+
+	// && and || only evaluate the right side if the left doesn't decide the result, the same as the VM
+	template<bool DECIDING_VALUE, class LEFT, class RIGHT>
+	float evalShortCircuit(const Node* node, Context& context)
+	{
+		if ((LEFT::get(node->left, context) != 0.f) == DECIDING_VALUE)
+		{
+			return fromBool(DECIDING_VALUE);
+		}
+
+		return fromBool(RIGHT::get(node->right, context) != 0.f);
+	}
+
+	// A node has only two operands, so the sides of a select are held by a node of their own in its
+	// right operand, which is never called itself. Only the chosen side is evaluated.
+	template<class COND, class TRUE_SIDE, class FALSE_SIDE>
+	float evalSelect(const Node* node, Context& context)
+	{
+		const Node* sides = node->right.node;
+		return COND::get(node->left, context) != 0.f ? TRUE_SIDE::get(sides->left, context) : FALSE_SIDE::get(sides->right, context);
+	}
+
+	template<class OP, class LEFT>
+	float evalUnary(const Node* node, Context& context)
+	{
+		return OP::apply(LEFT::get(node->left, context), context);
+	}
+
+	template<class LEFT>
+	float evalNumberInSet(const Node* node, Context& context)
+	{
+		const ExpressionSet& set = node->right.set;
+		return fromBool(isSetMember(context.setNumbers + set.first, set.count, LEFT::get(node->left, context)));
+	}
+
+	template<class LEFT>
+	float evalNameInSet(const Node* node, Context& context)
+	{
+		const ExpressionSet& set = node->right.set;
+		return fromBool(isSetMember(context.setNames + set.first, set.count, LEFT::get(node->left, context)));
+	}
+
+	// the bounds are held by a node of their own in the right operand, like the sides of a select
+	template<bool LOW_CLOSED, bool HIGH_CLOSED, class LOW, class HIGH>
+	float evalNumberInRange(const Node* node, Context& context)
+	{
+		const Node* bounds = node->right.node;
+		return fromBool(isInRange<LOW_CLOSED, HIGH_CLOSED>(NumVar::get(node->left, context), LOW::get(bounds->left, context), HIGH::get(bounds->right, context)));
+	}
+
+	template<class LEFT>
+	float evalValue(const Node* node, Context& context)
+	{
+		return LEFT::get(node->left, context);
+	}
+
+
+	/*
+	 * Specialisation selection
+	 */
+
+	template<class OP, class LEFT>
+	Node::Func selectNumericRight(eValueKind right)
+	{
+		switch (right)
+		{
+		case eValueKind::Constant:	return &evalBinary<OP, LEFT, NumConst>;
+		case eValueKind::Variable:	return &evalBinary<OP, LEFT, NumVar>;
+		default:					return &evalBinary<OP, LEFT, NumNode>;
+		}
+	}
+
+	template<class OP>
+	Node::Func selectNumeric(eValueKind left, eValueKind right)
+	{
+		switch (left)
+		{
+		case eValueKind::Constant:	return selectNumericRight<OP, NumConst>(right);
+		case eValueKind::Variable:	return selectNumericRight<OP, NumVar>(right);
+		default:					return selectNumericRight<OP, NumNode>(right);
+		}
+	}
+
+	template<bool DECIDING_VALUE, class LEFT>
+	Node::Func selectShortCircuitRight(eValueKind right)
+	{
+		switch (right)
+		{
+		case eValueKind::Constant:	return &evalShortCircuit<DECIDING_VALUE, LEFT, NumConst>;
+		default:					return &evalShortCircuit<DECIDING_VALUE, LEFT, NumNode>;
+		}
+	}
+
+	// there are no boolean variables, so the operands are always nodes or constants
+	template<bool DECIDING_VALUE>
+	Node::Func selectShortCircuit(eValueKind left, eValueKind right)
+	{
+		assert(left != eValueKind::Variable && right != eValueKind::Variable);
+
+		switch (left)
+		{
+		case eValueKind::Constant:	return selectShortCircuitRight<DECIDING_VALUE, NumConst>(right);
+		default:					return selectShortCircuitRight<DECIDING_VALUE, NumNode>(right);
+		}
+	}
+
+	template<class TRUE_SIDE>
+	Node::Func selectSelectFalse(eValueKind ifFalse)
+	{
+		switch (ifFalse)
+		{
+		case eValueKind::Constant:	return &evalSelect<NumNode, TRUE_SIDE, NumConst>;
+		case eValueKind::Variable:	return &evalSelect<NumNode, TRUE_SIDE, NumVar>;
+		default:					return &evalSelect<NumNode, TRUE_SIDE, NumNode>;
+		}
+	}
+
+	template<bool LOW_CLOSED, bool HIGH_CLOSED, class LOW>
+	Node::Func selectRangeHigh(eValueKind high)
+	{
+		return high == eValueKind::Constant ? &evalNumberInRange<LOW_CLOSED, HIGH_CLOSED, LOW, NumConst> : &evalNumberInRange<LOW_CLOSED, HIGH_CLOSED, LOW, NumVar>;
+	}
+
+	// the bounds are constants or variables, never nodes
+	template<bool LOW_CLOSED, bool HIGH_CLOSED>
+	Node::Func selectRange(eValueKind low, eValueKind high)
+	{
+		assert(low != eValueKind::Node && high != eValueKind::Node);
+		return low == eValueKind::Constant ? selectRangeHigh<LOW_CLOSED, HIGH_CLOSED, NumConst>(high) : selectRangeHigh<LOW_CLOSED, HIGH_CLOSED, NumVar>(high);
+	}
+
+	// the condition is never constant, const folding would have removed the select, nor a variable
+	Node::Func selectSelect(eValueKind condition, eValueKind ifTrue, eValueKind ifFalse)
+	{
+		assert(condition == eValueKind::Node);
+
+		switch (ifTrue)
+		{
+		case eValueKind::Constant:	return selectSelectFalse<NumConst>(ifFalse);
+		case eValueKind::Variable:	return selectSelectFalse<NumVar>(ifFalse);
+		default:					return selectSelectFalse<NumNode>(ifFalse);
+		}
+	}
+
+	template<class OP>
+	Node::Func selectName(eValueKind left, eValueKind right)
+	{
+		assert(left != eValueKind::Node && right != eValueKind::Node);
+
+		if (left == eValueKind::Constant)
+		{
+			return right == eValueKind::Constant ? &evalBinary<OP, NameConst, NameConst> : &evalBinary<OP, NameConst, NameVar>;
+		}
+
+		return right == eValueKind::Constant ? &evalBinary<OP, NameVar, NameConst> : &evalBinary<OP, NameVar, NameVar>;
+	}
+
+	template<class OP>
+	Node::Func selectUnary(eValueKind left)
+	{
+		switch (left)
+		{
+		case eValueKind::Constant:	return &evalUnary<OP, NumConst>;
+		case eValueKind::Variable:	return &evalUnary<OP, NumVar>;
+		default:					return &evalUnary<OP, NumNode>;
+		}
+	}
+
+	Node::Func selectValue(eExpType type, eValueKind kind)
+	{
+		if (type == eExpType::NAME)
+		{
+			assert(false);
+			return nullptr;
+		}
+
+		switch (kind)
+		{
+		case eValueKind::Constant:	return &evalValue<NumConst>;
+		case eValueKind::Variable:	return &evalValue<NumVar>;
+		default:					return &evalValue<NumNode>;
+		}
+	}
+
+} // anonymous namespace
+
+
+/*
+ * ExpressionClosureBuilder::Value
+ */
+
+ExpressionClosureBuilder::Value ExpressionClosureBuilder::Value::makeConst(float number)
+{
+	Value value = { eValueKind::Constant, eExpType::NUMBER, number, Name(), 0, UINT32_MAX };
+	return value;
+}
+
+ExpressionClosureBuilder::Value ExpressionClosureBuilder::Value::makeConst(bool boolValue)
+{
+	Value value = { eValueKind::Constant, eExpType::BOOL, boolValue ? 1.f : 0.f, Name(), 0, UINT32_MAX };
+	return value;
+}
+
+ExpressionClosureBuilder::Value ExpressionClosureBuilder::Value::makeConst(Name name)
+{
+	Value value = { eValueKind::Constant, eExpType::NAME, 0.f, name, 0, UINT32_MAX };
+	return value;
+}
+
+ExpressionClosureBuilder::Value ExpressionClosureBuilder::Value::makeVariable(eExpType type, ExpressionSlotIndex slot)
+{
+	Value value = { eValueKind::Variable, type, 0.f, Name(), slot, UINT32_MAX };
+	return value;
+}
+
+
+/*
+ * ExpressionClosureBuilder
+ */
+
+ExpressionClosureOperand ExpressionClosureBuilder::makeOperand(const Value& value) const
+{
+	// the node pointer is filled in by finish(), once the node array has stopped moving
+	ExpressionClosureOperand op = { nullptr, value.number, value.name, value.slot, { 0, 0 } };
+	return op;
+}
+
+ExpressionClosureBuilder::Value ExpressionClosureBuilder::addNode(ExpressionClosureNode::Func func, eExpType type, const Value& left, const Value& right)
+{
+	ExpressionClosureNode node = { func, makeOperand(left), makeOperand(right) };
+
+	nodes.push_back(node);
+	leftChildren.push_back(left.kind == eValueKind::Node ? left.nodeIndex : UINT32_MAX);
+	rightChildren.push_back(right.kind == eValueKind::Node ? right.nodeIndex : UINT32_MAX);
+
+	Value value = { eValueKind::Node, type, 0.f, Name(), 0, static_cast<uint32_t>(nodes.size() - 1) };
+	return value;
+}
+
+ExpressionClosureBuilder::Value ExpressionClosureBuilder::addOperation(eASTNodeType nodeType, const Value& left, const Value& right)
+{
+	ExpressionClosureNode::Func func(nullptr);
+	eExpType resultType(eExpType::BOOL);
+
+	switch (nodeType)
+	{
+	case eASTNodeType::LOGICAL_NOT:	func = selectUnary<OpNot>(left.kind); break;
+	case eASTNodeType::LOGICAL_AND:	func = selectShortCircuit<false>(left.kind, right.kind); break;
+	case eASTNodeType::LOGICAL_OR:	func = selectShortCircuit<true>(left.kind, right.kind); break;
+
+	case eASTNodeType::COMP_EQ:
+	case eASTNodeType::COMP_NEQ:
+		{
+			const bool isEq = nodeType == eASTNodeType::COMP_EQ;
+
+			switch (left.type)
+			{
+			case eExpType::NUMBER:	func = isEq ? selectNumeric<OpNumEq>(left.kind, right.kind) : selectNumeric<OpNumNeq>(left.kind, right.kind); break;
+			case eExpType::NAME:	func = isEq ? selectName<OpNameEq>(left.kind, right.kind) : selectName<OpNameNeq>(left.kind, right.kind); break;
+			case eExpType::BOOL:	func = isEq ? selectNumeric<OpBoolEq>(left.kind, right.kind) : selectNumeric<OpXor>(left.kind, right.kind); break;
+
+			default:
+				assert(false);
+			}
+		}
+		break;
+
+	case eASTNodeType::COMP_LT:		func = selectNumeric<OpNumLt>(left.kind, right.kind); break;
+	case eASTNodeType::COMP_LTEQ:	func = selectNumeric<OpNumLtEq>(left.kind, right.kind); break;
+	case eASTNodeType::COMP_GT:		func = selectNumeric<OpNumGt>(left.kind, right.kind); break;
+	case eASTNodeType::COMP_GTEQ:	func = selectNumeric<OpNumGtEq>(left.kind, right.kind); break;
+
+	case eASTNodeType::ARITH_ADD:	func = selectNumeric<OpAdd>(left.kind, right.kind); resultType = eExpType::NUMBER; break;
+	case eASTNodeType::ARITH_SUB:	func = selectNumeric<OpSub>(left.kind, right.kind); resultType = eExpType::NUMBER; break;
+	case eASTNodeType::ARITH_MUL:	func = selectNumeric<OpMul>(left.kind, right.kind); resultType = eExpType::NUMBER; break;
+	case eASTNodeType::ARITH_DIV:
+		func = ieeeDivide ? selectNumeric<OpDivIeee>(left.kind, right.kind) : selectNumeric<OpDiv>(left.kind, right.kind);
+		resultType = eExpType::NUMBER;
+		break;
+
+	case eASTNodeType::ARITH_MOD:
+		func = ieeeDivide ? selectNumeric<OpModIeee>(left.kind, right.kind) : selectNumeric<OpMod>(left.kind, right.kind);
+		resultType = eExpType::NUMBER;
+		break;
+
+	default:
+		assert(false);
+	}
+
+	return addNode(func, resultType, left, nodeType == eASTNodeType::LOGICAL_NOT ? left : right);
+}
+
+ExpressionClosureBuilder::Value ExpressionClosureBuilder::addSelect(const Value& condition, const Value& ifTrue, const Value& ifFalse)
+{
+	const Value sides = addNode(selectValue(ifTrue.type, ifTrue.kind), ifTrue.type, ifTrue, ifFalse);
+	return addNode(selectSelect(condition.kind, ifTrue.kind, ifFalse.kind), ifTrue.type, condition, sides);
+}
+
+ExpressionClosureBuilder::Value ExpressionClosureBuilder::addSetTest(const Value& value, const std::vector<float>& members)
+{
+	// a constant value would have been folded, so it is a variable or the number a node worked out
+	assert(value.kind != eValueKind::Constant);
+
+	const ExpressionSet set = { static_cast<uint32_t>(setNumbers.size()), static_cast<uint32_t>(members.size()) };
+	setNumbers.insert(setNumbers.end(), members.begin(), members.end());
+
+	const Value result = addNode(value.kind == eValueKind::Variable ? &evalNumberInSet<NumVar> : &evalNumberInSet<NumNode>, eExpType::BOOL, value, value);
+	nodes[result.nodeIndex].right.set = set;
+
+	return result;
+}
+
+ExpressionClosureBuilder::Value ExpressionClosureBuilder::addSetTest(const Value& value, const std::vector<Name>& members)
+{
+	// there are no name nodes, and a constant value would have been folded
+	assert(value.kind == eValueKind::Variable);
+
+	const ExpressionSet set = { static_cast<uint32_t>(setNames.size()), static_cast<uint32_t>(members.size()) };
+	setNames.insert(setNames.end(), members.begin(), members.end());
+
+	const Value result = addNode(&evalNameInSet<NameVar>, eExpType::BOOL, value, value);
+	nodes[result.nodeIndex].right.set = set;
+
+	return result;
+}
+
+ExpressionClosureBuilder::Value ExpressionClosureBuilder::addRangeTest(const Value& value, const Value& low, bool lowClosed, const Value& high, bool highClosed)
+{
+	assert(value.kind == eValueKind::Variable);
+
+	Node::Func func;
+	if (lowClosed)
+	{
+		func = highClosed ? selectRange<true, true>(low.kind, high.kind) : selectRange<true, false>(low.kind, high.kind);
+	}
+	else
+	{
+		func = highClosed ? selectRange<false, true>(low.kind, high.kind) : selectRange<false, false>(low.kind, high.kind);
+	}
+
+	const Value bounds = addNode(selectValue(eExpType::NUMBER, low.kind), eExpType::NUMBER, low, high);
+	return addNode(func, eExpType::BOOL, value, bounds);
+}
+
+ExpressionClosureCode* ExpressionClosureBuilder::finish(const Value& root)
+{
+	// a constant or a single variable still needs a node to return it
+	if (root.kind != eValueKind::Node || root.nodeIndex != nodes.size() - 1)
+	{
+		addNode(selectValue(root.type, root.kind), root.type, root, root);
+	}
+
+	ExpressionClosureCode* code = new ExpressionClosureCode();
+	code->nodes.swap(nodes);
+	code->setNumbers.swap(setNumbers);
+	code->setNames.swap(setNames);
+
+	for (size_t i = 0; i < code->nodes.size(); ++i)
+	{
+		if (leftChildren[i] != UINT32_MAX) code->nodes[i].left.node = &code->nodes[leftChildren[i]];
+		if (rightChildren[i] != UINT32_MAX) code->nodes[i].right.node = &code->nodes[rightChildren[i]];
+	}
+
+	leftChildren.clear();
+	rightChildren.clear();
+
+	return code;
+}
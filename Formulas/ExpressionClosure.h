@@ -0,0 +1,165 @@
+/*
+ * ExpressionClosure.h
+ * Portable closure-compiled backend for expressions.
+ *
+ * The compiler lowers the type checked and const folded AST into a tree of nodes, each holding a
+ * pointer to a function specialised for its operation and the kinds of its operands. Constants are
+ * captured by value and variables by slot index, so evaluating a node never decodes an instruction -
+ * it reads its operands and calls straight into its children.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Expression.h"
+
+
+/*
+ * ExpressionClosureNode
+ */
+
+struct ExpressionClosureNode;
+
+struct ExpressionClosureContext
+{
+	const float* numberVars;
+	const Name* nameVars;
+	const float* setNumbers;
+	const Name* setNames;
+	bool divideByZero;
+};
+
+// one operand of a node - which member is used depends on the function the node was specialised to
+struct ExpressionClosureOperand
+{
+	const ExpressionClosureNode* node;
+	float number;
+	Name name;
+	ExpressionSlotIndex slot;
+	ExpressionSet set;	// the members of an in test, in ExpressionClosureCode's set arrays
+};
+
+struct ExpressionClosureNode
+{
+	typedef float (*Func)(const ExpressionClosureNode* node, ExpressionClosureContext& context);
+
+	Func func;
+	ExpressionClosureOperand left;
+	ExpressionClosureOperand right;
+};
+
+
+/*
+ * ExpressionClosureCode - the lowered form of one expression, owned by its ExpressionData
+ */
+
+class ExpressionClosureCode
+{
+	friend class ExpressionClosureBuilder;
+
+	std::vector<ExpressionClosureNode> nodes;	// children always precede their parent, the root is last
+	std::vector<float> setNumbers;
+	std::vector<Name> setNames;
+
+	ExpressionClosureCode() {}
+	ExpressionClosureCode(const ExpressionClosureCode&);
+	ExpressionClosureCode& operator=(const ExpressionClosureCode&);
+
+public:
+	// booleans are returned as 1.f/0.f like ExpressionResult::value. divideByZero is set if the expression
+	// divided by zero, the return value is then undefined unless it was built with ieeeDivide
+	float run(const VariablePack* variables, bool& divideByZero) const;
+	// the same, reading variables from arrays laid out like a VariablePack's
+	float run(const float* numberVars, const Name* nameVars, bool& divideByZero) const;
+
+	size_t getNodeCount() const { return nodes.size(); }
+};
+
+
+/*
+ * ExpressionClosureBuilder
+ */
+
+class ExpressionClosureBuilder
+{
+public:
+	enum class eValueKind
+	{
+		Constant,
+		Variable,
+		Node
+	};
+
+	// the result of lowering an AST node. Constants and variables don't get a node of their own,
+	// they are folded into the operands of whichever node uses them
+	struct Value
+	{
+		eValueKind kind;
+		eExpType type;
+		float number;
+		Name name;
+		ExpressionSlotIndex slot;
+		uint32_t nodeIndex;
+
+		static Value makeConst(float number);
+		static Value makeConst(bool value);
+		static Value makeConst(Name name);
+		static Value makeVariable(eExpType type, ExpressionSlotIndex slot);
+	};
+
+private:
+	std::vector<ExpressionClosureNode> nodes;
+	std::vector<float> setNumbers;
+	std::vector<Name> setNames;
+	std::vector<uint32_t> leftChildren;
+	std::vector<uint32_t> rightChildren;
+	bool ieeeDivide;
+
+	ExpressionClosureOperand makeOperand(const Value& value) const;
+	Value addNode(ExpressionClosureNode::Func func, eExpType type, const Value& left, const Value& right);
+
+public:
+	// with ieeeDivide, / and % give the IEEE result for a zero divisor and divideByZero only flags it
+	ExpressionClosureBuilder(bool _ieeeDivide = false) : ieeeDivide(_ieeeDivide) {}
+
+	// right is ignored for LOGICAL_NOT
+	Value addOperation(eASTNodeType nodeType, const Value& left, const Value& right);
+
+	// condition ? ifTrue : ifFalse, evaluating only the side that is chosen
+	Value addSelect(const Value& condition, const Value& ifTrue, const Value& ifFalse);
+
+	// value in (members...), the members sorted the way isSetMember expects
+	Value addSetTest(const Value& value, const std::vector<float>& members);
+	Value addSetTest(const Value& value, const std::vector<Name>& members);
+
+	// low <= value <= high, or < at either end that isn't closed. The bounds are constants or variables
+	Value addRangeTest(const Value& value, const Value& low, bool lowClosed, const Value& high, bool highClosed);
+
+	// returns the finished code, with root as its result
+	ExpressionClosureCode* finish(const Value& root);
+};
+
+
+/*
+ * ExpressionClosureCode
+ */
+
+inline float ExpressionClosureCode::run(const VariablePack* variables, bool& divideByZero) const
+{
+	return run(variables->getNumberData(), variables->getNameData(), divideByZero);
+}
+
+inline float ExpressionClosureCode::run(const float* numberVars, const Name* nameVars, bool& divideByZero) const
+{
+	assert(!nodes.empty());
+
+	ExpressionClosureContext context = { numberVars, nameVars, setNumbers.data(), setNames.data(), false };
+	const ExpressionClosureNode* root = &nodes.back();
+
+	const float result = root->func(root, context);
+	divideByZero = context.divideByZero;
+
+	return result;
+}
@@ -0,0 +1,188 @@
+/*
+ * ExpressionHandlers.inl
+ * Table of opcode handlers for the expression VM.
+ *
+ * Each opcode is described exactly once here and the table is expanded into every dispatch loop in
+ * Expression.cpp. Before including this file define:
+ *
+ *   OPERATION_HANDLER(OP, EXPR)                - result = EXPR
+ *   BOOL_HANDLER(OP, EXPR)                     - boolean result = EXPR, written to the boolean register bank
+ *   DIVIDE_HANDLER(OP, LEFT, RIGHT, FUNC)      - result = FUNC(LEFT, RIGHT), failing if RIGHT is zero
+ *   JUMP_HANDLER(OP, COND)                     - skip the next rightOp instructions if COND holds
+ *
+ * Booleans live in a bank of their own, one byte per register holding 0 or 1, so comparisons store
+ * their result without converting it to a float and the logic operations are plain bitwise ones.
+ *
+ * The operand expressions use the GET_LEFT_* / GET_RIGHT_* accessors, GET_CONDITION_BOOL (the boolean
+ * register with the result's index, which the selects read their condition from), IN_SET(VALUE) (whether
+ * VALUE is a member of the set the right operand indexes), IN_RANGE(LOW_CLOSED, HIGH_CLOSED, VALUE) (whether
+ * VALUE lies between the bounds the right operand indexes) and the FLOAT_DIV, IEEE_DIV and IEEE_MOD
+ * operations, which the includer must also provide. All the handler macros are undefined again at the end of this file.
+ */
+
+// Arithmetic (Numeric)
+OPERATION_HANDLER(ADD,			GET_LEFT_REG + GET_RIGHT_REG)
+OPERATION_HANDLER(ADD_LC,		GET_LEFT_NUM_CONST + GET_RIGHT_REG)
+OPERATION_HANDLER(ADD_LV,		GET_LEFT_NUM_VAR + GET_RIGHT_REG)
+OPERATION_HANDLER(ADD_LV_RV,	GET_LEFT_NUM_VAR + GET_RIGHT_NUM_VAR)
+OPERATION_HANDLER(ADD_LC_RV,	GET_LEFT_NUM_CONST + GET_RIGHT_NUM_VAR)
+
+OPERATION_HANDLER(SUB,			GET_LEFT_REG - GET_RIGHT_REG)
+OPERATION_HANDLER(SUB_LC,		GET_LEFT_NUM_CONST - GET_RIGHT_REG)
+OPERATION_HANDLER(SUB_LV,		GET_LEFT_NUM_VAR - GET_RIGHT_REG)
+OPERATION_HANDLER(SUB_RC,		GET_LEFT_REG - GET_RIGHT_NUM_CONST)
+OPERATION_HANDLER(SUB_RV,		GET_LEFT_REG - GET_RIGHT_NUM_VAR)
+OPERATION_HANDLER(SUB_LC_RV,	GET_LEFT_NUM_CONST - GET_RIGHT_NUM_VAR)
+OPERATION_HANDLER(SUB_LV_RC,	GET_LEFT_NUM_VAR - GET_RIGHT_NUM_CONST)
+OPERATION_HANDLER(SUB_LV_RV,	GET_LEFT_NUM_VAR - GET_RIGHT_NUM_VAR)
+
+OPERATION_HANDLER(MUL,			GET_LEFT_REG * GET_RIGHT_REG)
+OPERATION_HANDLER(MUL_LC,		GET_LEFT_NUM_CONST * GET_RIGHT_REG)
+OPERATION_HANDLER(MUL_LV,		GET_LEFT_NUM_VAR * GET_RIGHT_REG)
+OPERATION_HANDLER(MUL_LV_RV,	GET_LEFT_NUM_VAR * GET_RIGHT_NUM_VAR)
+OPERATION_HANDLER(MUL_LC_RV,	GET_LEFT_NUM_CONST * GET_RIGHT_NUM_VAR)
+
+DIVIDE_HANDLER(DIV,				GET_LEFT_REG,		GET_RIGHT_REG,			FLOAT_DIV)
+DIVIDE_HANDLER(DIV_LC,			GET_LEFT_NUM_CONST,	GET_RIGHT_REG,			FLOAT_DIV)
+DIVIDE_HANDLER(DIV_LV,			GET_LEFT_NUM_VAR,	GET_RIGHT_REG,			FLOAT_DIV)
+DIVIDE_HANDLER(DIV_RC,			GET_LEFT_REG,		GET_RIGHT_NUM_CONST,	FLOAT_DIV)
+DIVIDE_HANDLER(DIV_RV,			GET_LEFT_REG,		GET_RIGHT_NUM_VAR,		FLOAT_DIV)
+DIVIDE_HANDLER(DIV_LC_RV,		GET_LEFT_NUM_CONST,	GET_RIGHT_NUM_VAR,		FLOAT_DIV)
+DIVIDE_HANDLER(DIV_LV_RC,		GET_LEFT_NUM_VAR,	GET_RIGHT_NUM_CONST,	FLOAT_DIV)
+DIVIDE_HANDLER(DIV_LV_RV,		GET_LEFT_NUM_VAR,	GET_RIGHT_NUM_VAR,		FLOAT_DIV)
+
+DIVIDE_HANDLER(MOD,				GET_LEFT_REG,		GET_RIGHT_REG,			fmodf)
+DIVIDE_HANDLER(MOD_LC,			GET_LEFT_NUM_CONST,	GET_RIGHT_REG,			fmodf)
+DIVIDE_HANDLER(MOD_LV,			GET_LEFT_NUM_VAR,	GET_RIGHT_REG,			fmodf)
+DIVIDE_HANDLER(MOD_RC,			GET_LEFT_REG,		GET_RIGHT_NUM_CONST,	fmodf)
+DIVIDE_HANDLER(MOD_RV,			GET_LEFT_REG,		GET_RIGHT_NUM_VAR,		fmodf)
+DIVIDE_HANDLER(MOD_LC_RV,		GET_LEFT_NUM_CONST,	GET_RIGHT_NUM_VAR,		fmodf)
+DIVIDE_HANDLER(MOD_LV_RC,		GET_LEFT_NUM_VAR,	GET_RIGHT_NUM_CONST,	fmodf)
+DIVIDE_HANDLER(MOD_LV_RV,		GET_LEFT_NUM_VAR,	GET_RIGHT_NUM_VAR,		fmodf)
+
+// Arithmetic with a divisor the compiler has proven non-zero
+OPERATION_HANDLER(DIV_NZ,			FLOAT_DIV(GET_LEFT_REG, GET_RIGHT_REG))
+OPERATION_HANDLER(DIV_NZ_LC,		FLOAT_DIV(GET_LEFT_NUM_CONST, GET_RIGHT_REG))
+OPERATION_HANDLER(DIV_NZ_LV,		FLOAT_DIV(GET_LEFT_NUM_VAR, GET_RIGHT_REG))
+OPERATION_HANDLER(DIV_NZ_RC,		FLOAT_DIV(GET_LEFT_REG, GET_RIGHT_NUM_CONST))
+OPERATION_HANDLER(DIV_NZ_RV,		FLOAT_DIV(GET_LEFT_REG, GET_RIGHT_NUM_VAR))
+OPERATION_HANDLER(DIV_NZ_LC_RV,		FLOAT_DIV(GET_LEFT_NUM_CONST, GET_RIGHT_NUM_VAR))
+OPERATION_HANDLER(DIV_NZ_LV_RC,		FLOAT_DIV(GET_LEFT_NUM_VAR, GET_RIGHT_NUM_CONST))
+OPERATION_HANDLER(DIV_NZ_LV_RV,		FLOAT_DIV(GET_LEFT_NUM_VAR, GET_RIGHT_NUM_VAR))
+
+OPERATION_HANDLER(MOD_NZ,			fmodf(GET_LEFT_REG, GET_RIGHT_REG))
+OPERATION_HANDLER(MOD_NZ_LC,		fmodf(GET_LEFT_NUM_CONST, GET_RIGHT_REG))
+OPERATION_HANDLER(MOD_NZ_LV,		fmodf(GET_LEFT_NUM_VAR, GET_RIGHT_REG))
+OPERATION_HANDLER(MOD_NZ_RC,		fmodf(GET_LEFT_REG, GET_RIGHT_NUM_CONST))
+OPERATION_HANDLER(MOD_NZ_RV,		fmodf(GET_LEFT_REG, GET_RIGHT_NUM_VAR))
+OPERATION_HANDLER(MOD_NZ_LC_RV,		fmodf(GET_LEFT_NUM_CONST, GET_RIGHT_NUM_VAR))
+OPERATION_HANDLER(MOD_NZ_LV_RC,		fmodf(GET_LEFT_NUM_VAR, GET_RIGHT_NUM_CONST))
+OPERATION_HANDLER(MOD_NZ_LV_RV,		fmodf(GET_LEFT_NUM_VAR, GET_RIGHT_NUM_VAR))
+
+// Arithmetic that doesn't fail on a zero divisor (ExpressionCompileOptions::ieeeDivide)
+OPERATION_HANDLER(DIV_IEEE,			IEEE_DIV(GET_LEFT_REG, GET_RIGHT_REG))
+OPERATION_HANDLER(DIV_IEEE_LC,		IEEE_DIV(GET_LEFT_NUM_CONST, GET_RIGHT_REG))
+OPERATION_HANDLER(DIV_IEEE_LV,		IEEE_DIV(GET_LEFT_NUM_VAR, GET_RIGHT_REG))
+OPERATION_HANDLER(DIV_IEEE_RC,		IEEE_DIV(GET_LEFT_REG, GET_RIGHT_NUM_CONST))
+OPERATION_HANDLER(DIV_IEEE_RV,		IEEE_DIV(GET_LEFT_REG, GET_RIGHT_NUM_VAR))
+OPERATION_HANDLER(DIV_IEEE_LC_RV,	IEEE_DIV(GET_LEFT_NUM_CONST, GET_RIGHT_NUM_VAR))
+OPERATION_HANDLER(DIV_IEEE_LV_RC,	IEEE_DIV(GET_LEFT_NUM_VAR, GET_RIGHT_NUM_CONST))
+OPERATION_HANDLER(DIV_IEEE_LV_RV,	IEEE_DIV(GET_LEFT_NUM_VAR, GET_RIGHT_NUM_VAR))
+
+OPERATION_HANDLER(MOD_IEEE,			IEEE_MOD(GET_LEFT_REG, GET_RIGHT_REG))
+OPERATION_HANDLER(MOD_IEEE_LC,		IEEE_MOD(GET_LEFT_NUM_CONST, GET_RIGHT_REG))
+OPERATION_HANDLER(MOD_IEEE_LV,		IEEE_MOD(GET_LEFT_NUM_VAR, GET_RIGHT_REG))
+OPERATION_HANDLER(MOD_IEEE_RC,		IEEE_MOD(GET_LEFT_REG, GET_RIGHT_NUM_CONST))
+OPERATION_HANDLER(MOD_IEEE_RV,		IEEE_MOD(GET_LEFT_REG, GET_RIGHT_NUM_VAR))
+OPERATION_HANDLER(MOD_IEEE_LC_RV,	IEEE_MOD(GET_LEFT_NUM_CONST, GET_RIGHT_NUM_VAR))
+OPERATION_HANDLER(MOD_IEEE_LV_RC,	IEEE_MOD(GET_LEFT_NUM_VAR, GET_RIGHT_NUM_CONST))
+OPERATION_HANDLER(MOD_IEEE_LV_RV,	IEEE_MOD(GET_LEFT_NUM_VAR, GET_RIGHT_NUM_VAR))
+
+// Logic (Boolean)
+BOOL_HANDLER(AND,				GET_LEFT_REG_BOOL & GET_RIGHT_REG_BOOL)
+BOOL_HANDLER(OR,				GET_LEFT_REG_BOOL | GET_RIGHT_REG_BOOL)
+BOOL_HANDLER(XOR,				GET_LEFT_REG_BOOL ^ GET_RIGHT_REG_BOOL)
+BOOL_HANDLER(NOT,				GET_LEFT_REG_BOOL ^ 1)
+
+// Comparison (Names)
+BOOL_HANDLER(NAME_EQ_LC_RV,			GET_LEFT_NAME_CONST == GET_RIGHT_NAME_VAR)
+BOOL_HANDLER(NAME_EQ_LV_RV,			GET_LEFT_NAME_VAR   == GET_RIGHT_NAME_VAR)
+BOOL_HANDLER(NAME_NEQ_LC_RV,		GET_LEFT_NAME_CONST != GET_RIGHT_NAME_VAR)
+BOOL_HANDLER(NAME_NEQ_LV_RV,		GET_LEFT_NAME_VAR   != GET_RIGHT_NAME_VAR)
+
+// Comparison (Boolean) [NEQ is handled by XOR]
+BOOL_HANDLER(BOOL_EQ,			GET_LEFT_REG_BOOL ^ GET_RIGHT_REG_BOOL ^ 1)
+
+// Comparison (Numeric)
+BOOL_HANDLER(NUM_EQ,				GET_LEFT_REG       == GET_RIGHT_REG)
+BOOL_HANDLER(NUM_EQ_LC,				GET_LEFT_NUM_CONST == GET_RIGHT_REG)
+BOOL_HANDLER(NUM_EQ_LV,				GET_LEFT_NUM_VAR   == GET_RIGHT_REG)
+BOOL_HANDLER(NUM_EQ_LV_RV,			GET_LEFT_NUM_VAR   == GET_RIGHT_NUM_VAR)
+BOOL_HANDLER(NUM_EQ_LV_RC,			GET_LEFT_NUM_VAR   == GET_RIGHT_NUM_CONST)
+
+BOOL_HANDLER(NUM_NEQ,				GET_LEFT_REG       != GET_RIGHT_REG)
+BOOL_HANDLER(NUM_NEQ_LC,			GET_LEFT_NUM_CONST != GET_RIGHT_REG)
+BOOL_HANDLER(NUM_NEQ_LV,			GET_LEFT_NUM_VAR   != GET_RIGHT_REG)
+BOOL_HANDLER(NUM_NEQ_LV_RV,			GET_LEFT_NUM_VAR   != GET_RIGHT_NUM_VAR)
+BOOL_HANDLER(NUM_NEQ_LV_RC,			GET_LEFT_NUM_VAR   != GET_RIGHT_NUM_CONST)
+
+BOOL_HANDLER(NUM_LT,				GET_LEFT_REG       < GET_RIGHT_REG)
+BOOL_HANDLER(NUM_LT_LC,				GET_LEFT_NUM_CONST < GET_RIGHT_REG)
+BOOL_HANDLER(NUM_LT_LV,				GET_LEFT_NUM_VAR   < GET_RIGHT_REG)
+BOOL_HANDLER(NUM_LT_LV_RV,			GET_LEFT_NUM_VAR   < GET_RIGHT_NUM_VAR)
+BOOL_HANDLER(NUM_LT_LV_RC,			GET_LEFT_NUM_VAR   < GET_RIGHT_NUM_CONST)
+
+BOOL_HANDLER(NUM_GT,				GET_LEFT_REG       > GET_RIGHT_REG)
+BOOL_HANDLER(NUM_GT_LC,				GET_LEFT_NUM_CONST > GET_RIGHT_REG)
+BOOL_HANDLER(NUM_GT_LV,				GET_LEFT_NUM_VAR   > GET_RIGHT_REG)
+BOOL_HANDLER(NUM_GT_LV_RV,			GET_LEFT_NUM_VAR   > GET_RIGHT_NUM_VAR)
+BOOL_HANDLER(NUM_GT_LV_RC,			GET_LEFT_NUM_VAR   > GET_RIGHT_NUM_CONST)
+
+BOOL_HANDLER(NUM_LTEQ,				GET_LEFT_REG       <= GET_RIGHT_REG)
+BOOL_HANDLER(NUM_LTEQ_LC,			GET_LEFT_NUM_CONST <= GET_RIGHT_REG)
+BOOL_HANDLER(NUM_LTEQ_LV,			GET_LEFT_NUM_VAR   <= GET_RIGHT_REG)
+BOOL_HANDLER(NUM_LTEQ_LV_RV,		GET_LEFT_NUM_VAR   <= GET_RIGHT_NUM_VAR)
+BOOL_HANDLER(NUM_LTEQ_LV_RC,		GET_LEFT_NUM_VAR   <= GET_RIGHT_NUM_CONST)
+
+BOOL_HANDLER(NUM_GTEQ,				GET_LEFT_REG       >= GET_RIGHT_REG)
+BOOL_HANDLER(NUM_GTEQ_LC,			GET_LEFT_NUM_CONST >= GET_RIGHT_REG)
+BOOL_HANDLER(NUM_GTEQ_LV,			GET_LEFT_NUM_VAR   >= GET_RIGHT_REG)
+BOOL_HANDLER(NUM_GTEQ_LV_RV,		GET_LEFT_NUM_VAR   >= GET_RIGHT_NUM_VAR)
+BOOL_HANDLER(NUM_GTEQ_LV_RC,		GET_LEFT_NUM_VAR   >= GET_RIGHT_NUM_CONST)
+
+// Set membership
+BOOL_HANDLER(NUM_IN_SET_RC,			IN_SET(GET_LEFT_REG))
+BOOL_HANDLER(NUM_IN_SET_LV_RC,		IN_SET(GET_LEFT_NUM_VAR))
+BOOL_HANDLER(NAME_IN_SET_LV_RC,		IN_SET(GET_LEFT_NAME_VAR))
+
+// Intervals
+BOOL_HANDLER(NUM_IN_RANGE_CC_LV_RC,	IN_RANGE(true,  true,  GET_LEFT_NUM_VAR))
+BOOL_HANDLER(NUM_IN_RANGE_CO_LV_RC,	IN_RANGE(true,  false, GET_LEFT_NUM_VAR))
+BOOL_HANDLER(NUM_IN_RANGE_OC_LV_RC,	IN_RANGE(false, true,  GET_LEFT_NUM_VAR))
+BOOL_HANDLER(NUM_IN_RANGE_OO_LV_RC,	IN_RANGE(false, false, GET_LEFT_NUM_VAR))
+
+// Value operations (for const and single variable expressions)
+OPERATION_HANDLER(NUM_VAL_LC,		GET_LEFT_NUM_CONST)
+OPERATION_HANDLER(NUM_VAL_LV,		GET_LEFT_NUM_VAR)
+BOOL_HANDLER(BOOL_VAL_LC,			leftOp > 0)
+
+// Selection (cond ? left : right) - both sides have been computed, GET_CONDITION_BOOL picks one
+OPERATION_HANDLER(SELECT,			GET_CONDITION_BOOL ? GET_LEFT_REG       : GET_RIGHT_REG)
+OPERATION_HANDLER(SELECT_LC,		GET_CONDITION_BOOL ? GET_LEFT_NUM_CONST : GET_RIGHT_REG)
+OPERATION_HANDLER(SELECT_LV,		GET_CONDITION_BOOL ? GET_LEFT_NUM_VAR   : GET_RIGHT_REG)
+OPERATION_HANDLER(SELECT_RC,		GET_CONDITION_BOOL ? GET_LEFT_REG       : GET_RIGHT_NUM_CONST)
+OPERATION_HANDLER(SELECT_RV,		GET_CONDITION_BOOL ? GET_LEFT_REG       : GET_RIGHT_NUM_VAR)
+OPERATION_HANDLER(SELECT_LC_RC,		GET_CONDITION_BOOL ? GET_LEFT_NUM_CONST : GET_RIGHT_NUM_CONST)
+OPERATION_HANDLER(SELECT_LC_RV,		GET_CONDITION_BOOL ? GET_LEFT_NUM_CONST : GET_RIGHT_NUM_VAR)
+OPERATION_HANDLER(SELECT_LV_RC,		GET_CONDITION_BOOL ? GET_LEFT_NUM_VAR   : GET_RIGHT_NUM_CONST)
+OPERATION_HANDLER(SELECT_LV_RV,		GET_CONDITION_BOOL ? GET_LEFT_NUM_VAR   : GET_RIGHT_NUM_VAR)
+BOOL_HANDLER(BOOL_SELECT,			(GET_CONDITION_BOOL & GET_LEFT_REG_BOOL) | ((GET_CONDITION_BOOL ^ 1) & GET_RIGHT_REG_BOOL))
+
+// Control flow (short-circuit && and ||)
+JUMP_HANDLER(JUMP_IF_FALSE,		!GET_LEFT_REG_BOOL)
+JUMP_HANDLER(JUMP_IF_TRUE,		GET_LEFT_REG_BOOL)
+
+#undef OPERATION_HANDLER
+#undef BOOL_HANDLER
+#undef DIVIDE_HANDLER
+#undef JUMP_HANDLER
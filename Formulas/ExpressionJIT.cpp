@@ -0,0 +1,963 @@
+/*
+ * ExpressionJIT.cpp
+ *
+ * x86-64 native code generation for expressions. Each VM register maps directly onto an xmm register
+ * (register N lives in xmmN, so the result is already in xmm0 at the end), xmm14 and xmm15 are scratch.
+ * Number variables are addressed relative to the first argument, name variables relative to the
+ * second, and constants are copied into a data block placed after the code and read RIP-relative.
+ * On Windows the prologue saves the callee saved xmm registers it uses, and the block carries the
+ * unwind data describing that, registered with RtlAddFunctionTable so stack walks can step out of it.
+ *
+ */
+
+#include "stdafx.h"
+
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "ExpressionJIT.h"
+#include "ExpressionBytecode.h"
+
+#if EXPRESSION_JIT_X64
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+
+#if EXPRESSION_JIT_X64
+
+namespace
+{
+	/*
+	 * Registers
+	 */
+
+	enum eGPR : uint8_t
+	{
+		RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+		R8 = 8, R9 = 9,
+	};
+
+#ifdef _WIN32
+	const eGPR ARG_NUMBER_VARS = RCX;
+	const eGPR ARG_NAME_VARS = RDX;
+	const eGPR ARG_ERROR_FLAGS = R8;
+	const uint8_t FIRST_CALLEE_SAVED_XMM = 6;	// xmm6-xmm15 are callee saved in the Windows x64 ABI
+
+	// UNWIND_CODE operations, see the Windows x64 exception handling documentation
+	const uint8_t UWOP_ALLOC_LARGE = 1;
+	const uint8_t UWOP_ALLOC_SMALL = 2;
+	const uint8_t UWOP_SAVE_XMM128 = 8;
+#else
+	const eGPR ARG_NUMBER_VARS = RDI;
+	const eGPR ARG_NAME_VARS = RSI;
+	const eGPR ARG_ERROR_FLAGS = RDX;
+#endif
+
+	const uint8_t XMM_SCRATCH_A = 14;
+	const uint8_t XMM_SCRATCH_B = 15;
+	const uint32_t MAX_MAPPED_REGISTERS = 14;
+
+	// in tests are unrolled into a compare per member, larger sets are left to the interpreter's search
+	const uint32_t MAX_UNROLLED_SET_MEMBERS = 16;
+
+	// cmpss predicates
+	const uint8_t CMP_EQ = 0;
+	const uint8_t CMP_LT = 1;
+	const uint8_t CMP_LE = 2;
+	const uint8_t CMP_NEQ = 4;
+
+
+	/*
+	 * Operand - an xmm/general register, [base + disp32] or an entry in the data block
+	 */
+
+	struct Operand
+	{
+		enum class eKind { Reg, Mem, Data };
+
+		eKind kind;
+		uint8_t reg;
+		int32_t disp;
+
+		static Operand makeReg(uint8_t reg) { Operand op = { eKind::Reg, reg, 0 }; return op; }
+		static Operand makeMem(eGPR base, int32_t disp) { Operand op = { eKind::Mem, base, disp }; return op; }
+		static Operand makeData(int32_t offset) { Operand op = { eKind::Data, 0, offset }; return op; }
+	};
+
+
+	/*
+	 * X64Emitter - just enough of the instruction encoding for the expression JIT
+	 */
+
+	class X64Emitter
+	{
+		struct Fixup
+		{
+			size_t position;		// position of the rel32 field
+			size_t instrEnd;		// the address the displacement is relative to
+			int32_t target;			// label index, or offset into the data block
+		};
+
+		std::vector<uint8_t> code;
+		std::vector<uint8_t> data;
+		std::vector<Fixup> dataFixups;
+		std::vector<Fixup> labelFixups;
+		std::vector<size_t> labels;
+
+		void emitByte(uint8_t b) { code.push_back(b); }
+		void emitInt32(int32_t v);
+		void emitRex(bool wide, uint8_t reg, const Operand& rm, bool forceRex = false);
+		void emitModRM(uint8_t reg, const Operand& rm, size_t trailingBytes);
+
+	public:
+		static const size_t dataAlignment = 16;
+
+		int32_t addData(const void* bytes, size_t size, size_t alignment);
+
+		size_t getCodeSize() const { return code.size(); }
+
+		int allocateLabel();
+		void bindLabel(int label);
+
+		// SSE instruction: [prefix] [rex] 0F op modrm [imm8]
+		void sse(uint8_t prefix, uint8_t op, uint8_t xmm, const Operand& rm);
+		void sseImm(uint8_t prefix, uint8_t op, uint8_t xmm, const Operand& rm, uint8_t imm);
+
+		void movss(uint8_t xmm, const Operand& src)		{ sse(0xF3, 0x10, xmm, src); }
+		void addss(uint8_t xmm, const Operand& src)		{ sse(0xF3, 0x58, xmm, src); }
+		void subss(uint8_t xmm, const Operand& src)		{ sse(0xF3, 0x5C, xmm, src); }
+		void mulss(uint8_t xmm, const Operand& src)		{ sse(0xF3, 0x59, xmm, src); }
+		void divss(uint8_t xmm, const Operand& src)		{ sse(0xF3, 0x5E, xmm, src); }
+		void andps(uint8_t xmm, const Operand& src)		{ sse(0x00, 0x54, xmm, src); }
+		void andnps(uint8_t xmm, const Operand& src)	{ sse(0x00, 0x55, xmm, src); }
+		void orps(uint8_t xmm, const Operand& src)		{ sse(0x00, 0x56, xmm, src); }
+		void xorps(uint8_t xmm, const Operand& src)		{ sse(0x00, 0x57, xmm, src); }
+		void ucomiss(uint8_t xmm, const Operand& src)	{ sse(0x00, 0x2E, xmm, src); }
+		void cmpss(uint8_t xmm, const Operand& src, uint8_t predicate) { sseImm(0xF3, 0xC2, xmm, src, predicate); }
+		void movupsLoad(uint8_t xmm, const Operand& src)	{ sse(0x00, 0x10, xmm, src); }
+		void movupsStore(const Operand& dst, uint8_t xmm)	{ sse(0x00, 0x11, xmm, dst); }
+		void cvtsi2ss(uint8_t xmm, eGPR src)			{ sse(0xF3, 0x2A, xmm, Operand::makeReg(src)); }
+
+		void movLoad64(eGPR dst, const Operand& src);
+		void cmp64(eGPR left, const Operand& right);
+		void setccAL(uint8_t condition);
+		void movzxEAX_AL();
+		void movStoreImm32(const Operand& dst, int32_t value);
+#ifdef _WIN32
+		// only the Windows ABI has callee saved xmm registers to make room for
+		void addRSP(int32_t value);
+		void subRSP(int32_t value);
+#endif
+		void ret() { emitByte(0xC3); }
+
+		// condition codes for jcc/setcc
+		static const uint8_t CC_E = 0x4;
+		static const uint8_t CC_NE = 0x5;
+		static const uint8_t CC_P = 0xA;
+		static const uint8_t CC_NP = 0xB;
+
+		void jmp(int label);
+		void jcc(uint8_t condition, int label);
+
+		// lays code and data out into one block and resolves all fixups
+		bool link(std::vector<uint8_t>& image, size_t& dataStart);
+	};
+
+	void X64Emitter::emitInt32(int32_t v)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			emitByte(static_cast<uint8_t>(v >> (i * 8)));
+		}
+	}
+
+	void X64Emitter::emitRex(bool wide, uint8_t reg, const Operand& rm, bool forceRex)
+	{
+		uint8_t rex = 0x40;
+		if (wide) rex |= 0x08;
+		if (reg >= 8) rex |= 0x04;
+		if (rm.kind != Operand::eKind::Data && rm.reg >= 8) rex |= 0x01;
+
+		if (rex != 0x40 || forceRex)
+		{
+			emitByte(rex);
+		}
+	}
+
+	void X64Emitter::emitModRM(uint8_t reg, const Operand& rm, size_t trailingBytes)
+	{
+		switch (rm.kind)
+		{
+		case Operand::eKind::Reg:
+			emitByte(0xC0 | ((reg & 7) << 3) | (rm.reg & 7));
+			break;
+
+		case Operand::eKind::Mem:
+			emitByte(0x80 | ((reg & 7) << 3) | (rm.reg & 7));
+			if ((rm.reg & 7) == RSP)
+			{
+				emitByte(0x24);	// SIB: base only
+			}
+			emitInt32(rm.disp);
+			break;
+
+		case Operand::eKind::Data:
+			{
+				emitByte(0x05 | ((reg & 7) << 3));	// [rip + disp32]
+				Fixup fixup = { code.size(), code.size() + 4 + trailingBytes, rm.disp };
+				dataFixups.push_back(fixup);
+				emitInt32(0);
+			}
+			break;
+		}
+	}
+
+	int32_t X64Emitter::addData(const void* bytes, size_t size, size_t alignment)
+	{
+		while (data.size() % alignment)
+		{
+			data.push_back(0);
+		}
+
+		const int32_t offset = static_cast<int32_t>(data.size());
+		const uint8_t* src = static_cast<const uint8_t*>(bytes);
+		data.insert(data.end(), src, src + size);
+
+		return offset;
+	}
+
+	int X64Emitter::allocateLabel()
+	{
+		labels.push_back(SIZE_MAX);
+		return static_cast<int>(labels.size() - 1);
+	}
+
+	void X64Emitter::bindLabel(int label)
+	{
+		labels[label] = code.size();
+	}
+
+	void X64Emitter::sse(uint8_t prefix, uint8_t op, uint8_t xmm, const Operand& rm)
+	{
+		if (prefix) emitByte(prefix);
+		emitRex(false, xmm, rm);
+		emitByte(0x0F);
+		emitByte(op);
+		emitModRM(xmm, rm, 0);
+	}
+
+	void X64Emitter::sseImm(uint8_t prefix, uint8_t op, uint8_t xmm, const Operand& rm, uint8_t imm)
+	{
+		if (prefix) emitByte(prefix);
+		emitRex(false, xmm, rm);
+		emitByte(0x0F);
+		emitByte(op);
+		emitModRM(xmm, rm, 1);
+		emitByte(imm);
+	}
+
+	void X64Emitter::movLoad64(eGPR dst, const Operand& src)
+	{
+		emitRex(true, dst, src);
+		emitByte(0x8B);
+		emitModRM(dst, src, 0);
+	}
+
+	void X64Emitter::cmp64(eGPR left, const Operand& right)
+	{
+		emitRex(true, left, right);
+		emitByte(0x3B);
+		emitModRM(left, right, 0);
+	}
+
+	void X64Emitter::setccAL(uint8_t condition)
+	{
+		emitByte(0x0F);
+		emitByte(0x90 | condition);
+		emitByte(0xC0);	// al
+	}
+
+	void X64Emitter::movzxEAX_AL()
+	{
+		emitByte(0x0F);
+		emitByte(0xB6);
+		emitByte(0xC0);
+	}
+
+	void X64Emitter::movStoreImm32(const Operand& dst, int32_t value)
+	{
+		emitRex(false, 0, dst);
+		emitByte(0xC7);
+		emitModRM(0, dst, 4);
+		emitInt32(value);
+	}
+
+#ifdef _WIN32
+	void X64Emitter::addRSP(int32_t value)
+	{
+		emitByte(0x48); emitByte(0x81); emitByte(0xC4);
+		emitInt32(value);
+	}
+
+	void X64Emitter::subRSP(int32_t value)
+	{
+		emitByte(0x48); emitByte(0x81); emitByte(0xEC);
+		emitInt32(value);
+	}
+#endif
+
+	void X64Emitter::jmp(int label)
+	{
+		emitByte(0xE9);
+		Fixup fixup = { code.size(), code.size() + 4, label };
+		labelFixups.push_back(fixup);
+		emitInt32(0);
+	}
+
+	void X64Emitter::jcc(uint8_t condition, int label)
+	{
+		emitByte(0x0F);
+		emitByte(0x80 | condition);
+		Fixup fixup = { code.size(), code.size() + 4, label };
+		labelFixups.push_back(fixup);
+		emitInt32(0);
+	}
+
+	bool X64Emitter::link(std::vector<uint8_t>& image, size_t& dataStart)
+	{
+		dataStart = (code.size() + dataAlignment - 1) & ~(dataAlignment - 1);
+
+		image = code;
+		image.resize(dataStart, 0xCC);	// int3 padding
+		image.insert(image.end(), data.begin(), data.end());
+
+		auto patch = [&image](size_t position, int64_t value)
+		{
+			if (value < INT32_MIN || value > INT32_MAX) return false;
+			const int32_t v = static_cast<int32_t>(value);
+			memcpy(&image[position], &v, sizeof(v));
+			return true;
+		};
+
+		for (const Fixup& fixup : dataFixups)
+		{
+			if (!patch(fixup.position, static_cast<int64_t>(dataStart + fixup.target) - static_cast<int64_t>(fixup.instrEnd))) return false;
+		}
+
+		for (const Fixup& fixup : labelFixups)
+		{
+			assert(labels[fixup.target] != SIZE_MAX);
+			if (!patch(fixup.position, static_cast<int64_t>(labels[fixup.target]) - static_cast<int64_t>(fixup.instrEnd))) return false;
+		}
+
+		return true;
+	}
+
+
+	/*
+	 * ExpressionCodeGen - translates one ExpressionData
+	 */
+
+	class ExpressionCodeGen
+	{
+		const ExpressionData* exprData;
+		X64Emitter emitter;
+
+		int32_t oneData;		// four copies of 1.f, for turning the boolean result's mask into 0/1
+		int32_t allOnesData;	// four all-ones masks, the register value of true
+		std::vector<int32_t> floatConstData;
+		std::vector<int32_t> nameConstData;
+
+		int epilogueLabel;
+		int errorLabel;
+		std::vector<int> instrLabels;	// one per bytecode instruction plus one for the end, for jump targets
+		uint32_t instrIndex;
+
+		uint32_t savedXmmCount;
+#ifdef _WIN32
+		uint32_t frameSize;
+		std::vector<uint8_t> prologueEnds;	// code offset after each prologue instruction, for the unwind codes
+		size_t functionTableOffset;
+
+		std::vector<uint8_t> buildUnwindInfo() const;
+#endif
+
+		Operand numberOperand(uint8_t source, ExpressionSlotIndex index) const;
+		Operand nameOperand(uint8_t source, ExpressionSlotIndex index) const;
+
+		void emitPrologue();
+		void emitEpilogue();
+		bool emitInstr(const ExpressionInstr& instr);
+
+	public:
+		ExpressionCodeGen(const ExpressionData* _exprData);
+
+		bool generate(std::vector<uint8_t>& image);
+
+#ifdef _WIN32
+		// where generate() put the RUNTIME_FUNCTION for the code in the image
+		size_t getFunctionTableOffset() const { return functionTableOffset; }
+#endif
+	};
+
+	ExpressionCodeGen::ExpressionCodeGen(const ExpressionData* _exprData)
+		: exprData(_exprData)
+		, oneData(0)
+		, allOnesData(0)
+		, epilogueLabel(-1)
+		, errorLabel(-1)
+		, instrIndex(0)
+		, savedXmmCount(0)
+#ifdef _WIN32
+		, frameSize(0)
+		, functionTableOffset(0)
+#endif
+	{}
+
+	Operand ExpressionCodeGen::numberOperand(uint8_t source, ExpressionSlotIndex index) const
+	{
+		switch (source)
+		{
+		case OPERAND_SOURCE_REG:	return Operand::makeReg(static_cast<uint8_t>(index));
+		case OPERAND_SOURCE_CONST:	return Operand::makeData(floatConstData[index]);
+		default:					return Operand::makeMem(ARG_NUMBER_VARS, index * sizeof(float));
+		}
+	}
+
+	Operand ExpressionCodeGen::nameOperand(uint8_t source, ExpressionSlotIndex index) const
+	{
+		if (source == OPERAND_SOURCE_CONST)
+		{
+			return Operand::makeData(nameConstData[index]);
+		}
+
+		assert(source == OPERAND_SOURCE_VAR);
+		return Operand::makeMem(ARG_NAME_VARS, index * sizeof(Name));
+	}
+
+	void ExpressionCodeGen::emitPrologue()
+	{
+#ifdef _WIN32
+		// save the callee saved xmm registers this function is going to touch (always includes the scratch pair)
+		savedXmmCount = 16 - FIRST_CALLEE_SAVED_XMM;
+		if (exprData->regCount < FIRST_CALLEE_SAVED_XMM)
+		{
+			savedXmmCount = 2;
+		}
+
+		// the extra 8 bytes realign the stack after the return address, so the save slots are 16 byte aligned
+		frameSize = savedXmmCount * 16 + 8;
+		emitter.subRSP(frameSize);
+		prologueEnds.push_back(static_cast<uint8_t>(emitter.getCodeSize()));
+		for (uint32_t i = 0; i < savedXmmCount; ++i)
+		{
+			emitter.movupsStore(Operand::makeMem(RSP, i * 16), static_cast<uint8_t>(16 - savedXmmCount + i));
+			prologueEnds.push_back(static_cast<uint8_t>(emitter.getCodeSize()));
+		}
+#endif
+	}
+
+	void ExpressionCodeGen::emitEpilogue()
+	{
+#ifdef _WIN32
+		for (uint32_t i = 0; i < savedXmmCount; ++i)
+		{
+			emitter.movupsLoad(static_cast<uint8_t>(16 - savedXmmCount + i), Operand::makeMem(RSP, i * 16));
+		}
+		emitter.addRSP(frameSize);	// add rsp then ret, the epilogue form the unwinder recognises
+#endif
+		emitter.ret();
+	}
+
+#ifdef _WIN32
+	std::vector<uint8_t> ExpressionCodeGen::buildUnwindInfo() const
+	{
+		// the codes undo the prologue, so they are listed from its last instruction back to its first
+		std::vector<uint8_t> codes;
+		for (uint32_t i = savedXmmCount; i-- > 0;)
+		{
+			const uint8_t xmm = static_cast<uint8_t>(16 - savedXmmCount + i);
+			codes.push_back(prologueEnds[i + 1]);
+			codes.push_back(static_cast<uint8_t>(UWOP_SAVE_XMM128 | (xmm << 4)));
+			codes.push_back(static_cast<uint8_t>(i));	// the slot's offset from rsp, in 16 byte units
+			codes.push_back(0);
+		}
+
+		codes.push_back(prologueEnds[0]);
+		if (frameSize <= 128)
+		{
+			codes.push_back(static_cast<uint8_t>(UWOP_ALLOC_SMALL | (((frameSize - 8) / 8) << 4)));
+		}
+		else
+		{
+			codes.push_back(UWOP_ALLOC_LARGE);
+			codes.push_back(static_cast<uint8_t>((frameSize / 8) & 0xFF));
+			codes.push_back(static_cast<uint8_t>((frameSize / 8) >> 8));
+		}
+
+		const uint8_t codeCount = static_cast<uint8_t>(codes.size() / 2);
+		if (codeCount & 1)
+		{
+			codes.push_back(0);
+			codes.push_back(0);
+		}
+
+		// UNWIND_INFO: version 1 with no flags, the prologue size, the code count and no frame register
+		std::vector<uint8_t> unwindInfo;
+		unwindInfo.push_back(1);
+		unwindInfo.push_back(prologueEnds.back());
+		unwindInfo.push_back(codeCount);
+		unwindInfo.push_back(0);
+		unwindInfo.insert(unwindInfo.end(), codes.begin(), codes.end());
+		return unwindInfo;
+	}
+#endif
+
+	bool ExpressionCodeGen::emitInstr(const ExpressionInstr& instr)
+	{
+		const eSimpleOp simpleOp = getSimpleOp(instr.opcode);
+		const uint8_t leftSource = getLeftSource(instr.opcode);
+		const uint8_t rightSource = getRightSource(instr.opcode);
+		const uint8_t dst = static_cast<uint8_t>(instr.resultReg);
+
+		const uint8_t A = XMM_SCRATCH_A;
+		const uint8_t B = XMM_SCRATCH_B;
+		const Operand one = Operand::makeData(oneData);
+		const Operand allOnes = Operand::makeData(allOnesData);
+
+		switch (simpleOp)
+		{
+		case eSimpleOp::ADD:
+		case eSimpleOp::SUB:
+		case eSimpleOp::MUL:
+			{
+				emitter.movss(B, numberOperand(leftSource, instr.leftOp));
+				const Operand right = numberOperand(rightSource, instr.rightOp);
+				if (simpleOp == eSimpleOp::ADD) emitter.addss(B, right);
+				else if (simpleOp == eSimpleOp::SUB) emitter.subss(B, right);
+				else emitter.mulss(B, right);
+				emitter.movss(dst, Operand::makeReg(B));
+			}
+			break;
+
+		case eSimpleOp::DIV:
+		case eSimpleOp::DIV_NZ:
+		case eSimpleOp::DIV_IEEE:
+			{
+				const bool knownNonZero = simpleOp == eSimpleOp::DIV_NZ ||
+					(rightSource == OPERAND_SOURCE_CONST && exprData->const_floats[instr.rightOp] != 0.f);
+
+				emitter.movss(A, numberOperand(rightSource, instr.rightOp));
+				if (!knownNonZero)
+				{
+					// matches the interpreter's "right == 0.f" - a NaN divisor is unordered and not an error
+					const int divideLabel = emitter.allocateLabel();
+					emitter.xorps(B, Operand::makeReg(B));
+					emitter.ucomiss(A, Operand::makeReg(B));
+					emitter.jcc(X64Emitter::CC_P, divideLabel);
+					if (simpleOp == eSimpleOp::DIV_IEEE)
+					{
+						// only flagged - the division still runs and gives inf or NaN
+						emitter.jcc(X64Emitter::CC_NE, divideLabel);
+						emitter.movStoreImm32(Operand::makeMem(ARG_ERROR_FLAGS, 0), 1);
+					}
+					else
+					{
+						emitter.jcc(X64Emitter::CC_E, errorLabel);
+					}
+					emitter.bindLabel(divideLabel);
+				}
+				emitter.movss(B, numberOperand(leftSource, instr.leftOp));
+				emitter.divss(B, Operand::makeReg(A));
+				emitter.movss(dst, Operand::makeReg(B));
+			}
+			break;
+
+		// Boolean registers hold the lane masks cmpss produces - all ones for true, zero for false - so the
+		// logic ops are bitwise ones and comparisons store their mask as it is.
+		case eSimpleOp::AND:
+		case eSimpleOp::OR:
+		case eSimpleOp::XOR:
+			emitter.movss(B, Operand::makeReg(static_cast<uint8_t>(instr.leftOp)));
+			if (simpleOp == eSimpleOp::AND) emitter.andps(B, Operand::makeReg(static_cast<uint8_t>(instr.rightOp)));
+			else if (simpleOp == eSimpleOp::OR) emitter.orps(B, Operand::makeReg(static_cast<uint8_t>(instr.rightOp)));
+			else emitter.xorps(B, Operand::makeReg(static_cast<uint8_t>(instr.rightOp)));
+			emitter.movss(dst, Operand::makeReg(B));
+			break;
+
+		case eSimpleOp::NOT:
+			emitter.movss(B, Operand::makeReg(static_cast<uint8_t>(instr.leftOp)));
+			emitter.xorps(B, allOnes);
+			emitter.movss(dst, Operand::makeReg(B));
+			break;
+
+		case eSimpleOp::BOOL_EQ:
+			emitter.movss(B, Operand::makeReg(static_cast<uint8_t>(instr.leftOp)));
+			emitter.xorps(B, Operand::makeReg(static_cast<uint8_t>(instr.rightOp)));
+			emitter.xorps(B, allOnes);
+			emitter.movss(dst, Operand::makeReg(B));
+			break;
+
+		case eSimpleOp::NUM_EQ:
+		case eSimpleOp::NUM_NEQ:
+		case eSimpleOp::NUM_LT:
+		case eSimpleOp::NUM_LTEQ:
+		case eSimpleOp::NUM_GT:
+		case eSimpleOp::NUM_GTEQ:
+			{
+				Operand left = numberOperand(leftSource, instr.leftOp);
+				Operand right = numberOperand(rightSource, instr.rightOp);
+				uint8_t predicate(CMP_EQ);
+
+				switch (simpleOp)
+				{
+				case eSimpleOp::NUM_EQ:		predicate = CMP_EQ; break;
+				case eSimpleOp::NUM_NEQ:	predicate = CMP_NEQ; break;
+				case eSimpleOp::NUM_LT:		predicate = CMP_LT; break;
+				case eSimpleOp::NUM_LTEQ:	predicate = CMP_LE; break;
+				// a > b is evaluated as b < a so that NaN operands still compare false
+				case eSimpleOp::NUM_GT:		predicate = CMP_LT; std::swap(left, right); break;
+				case eSimpleOp::NUM_GTEQ:	predicate = CMP_LE; std::swap(left, right); break;
+				default:
+					break;
+				}
+
+				emitter.movss(B, left);
+				emitter.cmpss(B, right, predicate);
+				emitter.movss(dst, Operand::makeReg(B));
+			}
+			break;
+
+		case eSimpleOp::NAME_EQ:
+		case eSimpleOp::NAME_NEQ:
+			emitter.movLoad64(RAX, nameOperand(rightSource, instr.rightOp));
+			emitter.cmp64(RAX, nameOperand(leftSource, instr.leftOp));
+			emitter.setccAL(simpleOp == eSimpleOp::NAME_EQ ? X64Emitter::CC_E : X64Emitter::CC_NE);
+			emitter.movzxEAX_AL();
+			emitter.cvtsi2ss(B, RAX);
+			emitter.cmpss(B, one, CMP_EQ);		// 1.f/0.f to a mask
+			emitter.movss(dst, Operand::makeReg(B));
+			break;
+
+		case eSimpleOp::NUM_IN_SET:
+			{
+				const ExpressionSet& set = exprData->const_sets[instr.rightOp];
+				if (set.count > MAX_UNROLLED_SET_MEMBERS) return false;
+
+				// the value may be in dst, so it is read before dst is used for each member's mask
+				emitter.movss(A, numberOperand(leftSource, instr.leftOp));
+				emitter.xorps(B, Operand::makeReg(B));
+				for (uint32_t i = 0; i < set.count; ++i)
+				{
+					const float member = exprData->set_floats[set.first + i];
+					emitter.movss(dst, Operand::makeReg(A));
+					emitter.cmpss(dst, Operand::makeData(emitter.addData(&member, sizeof(member), sizeof(member))), CMP_EQ);
+					emitter.orps(B, Operand::makeReg(dst));
+				}
+				emitter.movss(dst, Operand::makeReg(B));
+			}
+			break;
+
+		case eSimpleOp::NUM_IN_RANGE_CC:
+		case eSimpleOp::NUM_IN_RANGE_CO:
+		case eSimpleOp::NUM_IN_RANGE_OC:
+		case eSimpleOp::NUM_IN_RANGE_OO:
+			{
+				// low <= value and value <= high, with the bound on the left for the low test so a NaN fails both
+				const ExpressionRange& range = exprData->const_ranges[instr.rightOp];
+				const Operand value = numberOperand(leftSource, instr.leftOp);
+
+				emitter.movss(B, numberOperand(range.lowVariable ? OPERAND_SOURCE_VAR : OPERAND_SOURCE_CONST, range.low));
+				emitter.cmpss(B, value, isLowBoundClosed(simpleOp) ? CMP_LE : CMP_LT);
+				emitter.movss(A, value);
+				emitter.cmpss(A, numberOperand(range.highVariable ? OPERAND_SOURCE_VAR : OPERAND_SOURCE_CONST, range.high), isHighBoundClosed(simpleOp) ? CMP_LE : CMP_LT);
+				emitter.andps(B, Operand::makeReg(A));
+				emitter.movss(dst, Operand::makeReg(B));
+			}
+			break;
+
+		case eSimpleOp::NAME_IN_SET:
+			{
+				const ExpressionSet& set = exprData->const_sets[instr.rightOp];
+				if (set.count > MAX_UNROLLED_SET_MEMBERS) return false;
+
+				const int foundLabel = emitter.allocateLabel();
+				const int doneLabel = emitter.allocateLabel();
+
+				emitter.movLoad64(RAX, nameOperand(leftSource, instr.leftOp));
+				for (uint32_t i = 0; i < set.count; ++i)
+				{
+					const Name& member = exprData->set_names[set.first + i];
+					emitter.cmp64(RAX, Operand::makeData(emitter.addData(&member, sizeof(member), sizeof(member))));
+					emitter.jcc(X64Emitter::CC_E, foundLabel);
+				}
+				emitter.xorps(B, Operand::makeReg(B));
+				emitter.jmp(doneLabel);
+				emitter.bindLabel(foundLabel);
+				emitter.movss(B, allOnes);
+				emitter.bindLabel(doneLabel);
+				emitter.movss(dst, Operand::makeReg(B));
+			}
+			break;
+
+		case eSimpleOp::NUM_VAL:
+			emitter.movss(dst, numberOperand(leftSource, instr.leftOp));
+			break;
+
+		case eSimpleOp::BOOL_VAL:
+			if (instr.leftOp > 0)
+			{
+				emitter.movss(dst, allOnes);
+			}
+			else
+			{
+				emitter.xorps(dst, Operand::makeReg(dst));
+			}
+			break;
+
+		// the condition mask is already in dst - (left & mask) | (right & ~mask), for numbers and masks alike
+		case eSimpleOp::SELECT:
+		case eSimpleOp::BOOL_SELECT:
+			emitter.movss(B, numberOperand(leftSource, instr.leftOp));
+			emitter.andps(B, Operand::makeReg(dst));
+			emitter.movss(A, numberOperand(rightSource, instr.rightOp));
+			emitter.andnps(dst, Operand::makeReg(A));
+			emitter.orps(dst, Operand::makeReg(B));
+			break;
+
+		case eSimpleOp::JUMP_IF_FALSE:
+		case eSimpleOp::JUMP_IF_TRUE:
+			// an all-ones mask is a NaN, so comparing the condition with zero is unordered exactly when it's true
+			emitter.xorps(B, Operand::makeReg(B));
+			emitter.ucomiss(static_cast<uint8_t>(instr.leftOp), Operand::makeReg(B));
+			emitter.jcc(simpleOp == eSimpleOp::JUMP_IF_FALSE ? X64Emitter::CC_NP : X64Emitter::CC_P,
+				instrLabels[instrIndex + 1 + instr.rightOp]);
+			break;
+
+		default:
+			// MOD would need a call out to fmodf - leave those expressions to the interpreter
+			return false;
+		}
+
+		return true;
+	}
+
+	bool ExpressionCodeGen::generate(std::vector<uint8_t>& image)
+	{
+		if (exprData->regCount > MAX_MAPPED_REGISTERS)
+		{
+			return false;
+		}
+
+		// data block: the 1.f and all-ones masks must be 16 byte aligned for andps/xorps
+		const float ones[4] = { 1.f, 1.f, 1.f, 1.f };
+		oneData = emitter.addData(ones, sizeof(ones), 16);
+
+		const uint32_t masks[4] = { UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX };
+		allOnesData = emitter.addData(masks, sizeof(masks), 16);
+
+		for (float value : exprData->const_floats)
+		{
+			floatConstData.push_back(emitter.addData(&value, sizeof(value), sizeof(value)));
+		}
+
+		for (const Name& value : exprData->const_names)
+		{
+			nameConstData.push_back(emitter.addData(&value, sizeof(value), sizeof(value)));
+		}
+
+		epilogueLabel = emitter.allocateLabel();
+		errorLabel = emitter.allocateLabel();
+
+		const uint32_t codeLen(exprData->byteCode.size());
+		assert((codeLen & 1) == 0);
+
+		for (uint32_t i = 0; i <= codeLen / 2; ++i)
+		{
+			instrLabels.push_back(emitter.allocateLabel());
+		}
+
+		emitPrologue();
+
+		for (instrIndex = 0; instrIndex < codeLen / 2; ++instrIndex)
+		{
+			emitter.bindLabel(instrLabels[instrIndex]);
+			if (!emitInstr(decodeInstr(&exprData->byteCode[instrIndex * 2])))
+			{
+				return false;
+			}
+		}
+
+		emitter.bindLabel(instrLabels[instrIndex]);
+		if (exprData->resultType == eExpType::BOOL)
+		{
+			// callers get booleans as 1.f/0.f
+			emitter.andps(0, Operand::makeData(oneData));
+		}
+		emitter.bindLabel(epilogueLabel);
+		emitEpilogue();
+
+		emitter.bindLabel(errorLabel);
+		emitter.movStoreImm32(Operand::makeMem(ARG_ERROR_FLAGS, 0), 1);
+		emitter.jmp(epilogueLabel);
+
+#ifdef _WIN32
+		// the RUNTIME_FUNCTION covers all the code, and is filled in once the layout is known
+		const std::vector<uint8_t> unwindInfo = buildUnwindInfo();
+		const int32_t unwindInfoData = emitter.addData(unwindInfo.data(), unwindInfo.size(), sizeof(DWORD));
+
+		RUNTIME_FUNCTION function = {};
+		const int32_t functionData = emitter.addData(&function, sizeof(function), sizeof(DWORD));
+		const size_t codeSize = emitter.getCodeSize();
+#endif
+
+		size_t dataStart(0);
+		if (!emitter.link(image, dataStart))
+		{
+			return false;
+		}
+
+#ifdef _WIN32
+		function.BeginAddress = 0;
+		function.EndAddress = static_cast<DWORD>(codeSize);
+		function.UnwindData = static_cast<DWORD>(dataStart + unwindInfoData);
+		functionTableOffset = dataStart + functionData;
+		memcpy(&image[functionTableOffset], &function, sizeof(function));
+#endif
+
+		return true;
+	}
+
+
+	/*
+	 * Executable memory
+	 */
+
+	// on Windows functionTableOffset locates the block's RUNTIME_FUNCTION, which is registered along with it
+	void* allocateExecutable(const std::vector<uint8_t>& image, size_t functionTableOffset, size_t& size, void*& functionTable)
+	{
+		size = image.size();
+
+#ifdef _WIN32
+		void* memory = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		if (memory == nullptr) return nullptr;
+
+		memcpy(memory, image.data(), size);
+
+		DWORD oldProtect;
+		if (!VirtualProtect(memory, size, PAGE_EXECUTE_READ, &oldProtect))
+		{
+			VirtualFree(memory, 0, MEM_RELEASE);
+			return nullptr;
+		}
+		FlushInstructionCache(GetCurrentProcess(), memory, size);
+
+		RUNTIME_FUNCTION* function = reinterpret_cast<RUNTIME_FUNCTION*>(static_cast<uint8_t*>(memory) + functionTableOffset);
+		if (!RtlAddFunctionTable(function, 1, reinterpret_cast<DWORD64>(memory)))
+		{
+			VirtualFree(memory, 0, MEM_RELEASE);
+			return nullptr;
+		}
+		functionTable = function;
+#else
+		void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED) return nullptr;
+
+		memcpy(memory, image.data(), size);
+
+		if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0)
+		{
+			munmap(memory, size);
+			return nullptr;
+		}
+
+		// the System V code neither moves rsp nor saves registers, so a stack walk steps out of it from [rsp]
+		(void)functionTableOffset;
+		functionTable = nullptr;
+#endif
+
+		return memory;
+	}
+
+	void freeExecutable(void* memory, size_t size, void* functionTable)
+	{
+#ifdef _WIN32
+		RtlDeleteFunctionTable(static_cast<RUNTIME_FUNCTION*>(functionTable));
+		VirtualFree(memory, 0, MEM_RELEASE);
+#else
+		munmap(memory, size);
+#endif
+	}
+
+} // anonymous namespace
+
+#endif // EXPRESSION_JIT_X64
+
+
+/*
+ * ExpressionNativeCode
+ */
+
+ExpressionNativeCode::ExpressionNativeCode(void* _memory, size_t _memorySize, void* _functionTable)
+	: memory(_memory)
+	, memorySize(_memorySize)
+	, functionTable(_functionTable)
+	, entryPoint(reinterpret_cast<EntryPoint>(_memory))
+{}
+
+ExpressionNativeCode::~ExpressionNativeCode()
+{
+#if EXPRESSION_JIT_X64
+	freeExecutable(memory, memorySize, functionTable);
+#endif
+}
+
+
+/*
+ * ExpressionJIT
+ */
+
+bool ExpressionJIT::isSupported()
+{
+	return EXPRESSION_JIT_X64 != 0;
+}
+
+bool ExpressionJIT::compile(ExpressionData* exprData)
+{
+	assert(exprData);
+
+#if EXPRESSION_JIT_X64
+	static_assert(sizeof(Name) == sizeof(void*), "name comparisons assume a Name is a single pointer");
+
+	std::vector<uint8_t> image;
+	ExpressionCodeGen codeGen(exprData);
+	if (!codeGen.generate(image))
+	{
+		return false;
+	}
+
+	size_t functionTableOffset(0);
+#ifdef _WIN32
+	functionTableOffset = codeGen.getFunctionTableOffset();
+#endif
+
+	size_t memorySize(0);
+	void* functionTable(nullptr);
+	void* memory = allocateExecutable(image, functionTableOffset, memorySize, functionTable);
+	if (memory == nullptr)
+	{
+		return false;
+	}
+
+	exprData->nativeCode.reset(new ExpressionNativeCode(memory, memorySize, functionTable));
+	return true;
+#else
+	return false;
+#endif
+}
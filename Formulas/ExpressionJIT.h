@@ -0,0 +1,83 @@
+/*
+ * ExpressionJIT.h
+ * Optional native code generator for compiled expressions.
+ *
+ * Translates the bytecode of an ExpressionData into x86-64 SSE scalar code. The generated function
+ * reads variables straight out of the VariablePack storage and returns the result in xmm0. Booleans are
+ * kept as the masks cmpss produces and only turned into 1.f/0.f on the way out. Expressions
+ * that use an instruction the JIT doesn't handle, or more registers than it can map onto xmm registers,
+ * are left without native code and keep running in the interpreter.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "Expression.h"
+
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define EXPRESSION_JIT_X64 1
+#else
+#define EXPRESSION_JIT_X64 0
+#endif
+
+
+/*
+ * ExpressionNativeCode - an executable block generated for one ExpressionData
+ */
+
+class ExpressionNativeCode
+{
+	friend class ExpressionJIT;
+
+public:
+	// errorFlags is set non-zero if the expression divided by zero; the return value is then undefined,
+	// unless the expression was compiled with ieeeDivide and the division went ahead
+	typedef float (*EntryPoint)(const float* numberVars, const Name* nameVars, uint32_t* errorFlags);
+
+private:
+	void* memory;
+	size_t memorySize;
+	void* functionTable;	// the unwind data registered for the code on Windows, otherwise nullptr
+	EntryPoint entryPoint;
+
+	ExpressionNativeCode(void* _memory, size_t _memorySize, void* _functionTable);
+
+	ExpressionNativeCode(const ExpressionNativeCode&);
+	ExpressionNativeCode& operator=(const ExpressionNativeCode&);
+
+public:
+	~ExpressionNativeCode();
+
+	float run(const VariablePack* variables, uint32_t* errorFlags) const;
+
+	size_t getCodeSize() const { return memorySize; }
+};
+
+
+/*
+ * ExpressionJIT
+ *
+ */
+
+class ExpressionJIT
+{
+public:
+	// true if native code can be generated on this platform at all
+	static bool isSupported();
+
+	// generates native code into exprData->nativeCode. Returns false, leaving exprData untouched, if
+	// the expression can't be translated - it is then evaluated by the interpreter as before.
+	static bool compile(ExpressionData* exprData);
+};
+
+
+/*
+ * ExpressionNativeCode
+ */
+
+inline float ExpressionNativeCode::run(const VariablePack* variables, uint32_t* errorFlags) const
+{
+	return entryPoint(variables->getNumberData(), variables->getNameData(), errorFlags);
+}
@@ -0,0 +1,68 @@
+/*
+ * ExpressionMemo.cpp
+ *
+ */
+
+#include "stdafx.h"
+
+#include "ExpressionMemo.h"
+
+
+/*
+ * ExpressionMemoEvaluator
+ */
+
+ExpressionMemoEvaluator::ExpressionMemoEvaluator(const VariablePack* _variables, eDispatchMode _dispatchMode)
+	: variables(_variables)
+	, dispatchMode(_dispatchMode)
+	, evaluationCount(0)
+{
+	assert(variables);
+}
+
+uint32_t ExpressionMemoEvaluator::addExpression(const ExpressionData* exprData)
+{
+	assert(exprData);
+
+	if (registers.size() < exprData->regCount)
+	{
+		registers.resize(exprData->regCount, 0.f);
+		boolRegisters.resize(exprData->regCount, 0);
+	}
+
+	Entry entry = { exprData, false, 0, { exprData->resultType, eErrorCode::UNINITIALISED, 0.f, 0 } };
+	entries.push_back(entry);
+
+	return static_cast<uint32_t>(entries.size() - 1);
+}
+
+bool ExpressionMemoEvaluator::inputsChangedSince(const ExpressionData& exprData, uint64_t version) const
+{
+	for (ExpressionSlotIndex slotIndex : exprData.numberInputs)
+	{
+		if (variables->getNumberStamp(slotIndex) > version) return true;
+	}
+
+	for (ExpressionSlotIndex slotIndex : exprData.nameInputs)
+	{
+		if (variables->getNameStamp(slotIndex) > version) return true;
+	}
+
+	return false;
+}
+
+void ExpressionMemoEvaluator::refresh(Entry& entry, uint64_t version)
+{
+	// other variables changed, so the result is current as of now and the next call is a single compare
+	if (entry.evaluated && !inputsChangedSince(*entry.exprData, entry.version))
+	{
+		entry.version = version;
+		return;
+	}
+
+	++evaluationCount;
+
+	entry.evaluated = true;
+	entry.version = version;
+	entry.result = evaluateExpression(*entry.exprData, *variables, registers.data(), boolRegisters.data(), static_cast<uint32_t>(registers.size()), dispatchMode);
+}
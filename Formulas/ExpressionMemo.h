@@ -0,0 +1,70 @@
+/*
+ * ExpressionMemo.h
+ * Evaluation that skips expressions none of whose variables have changed.
+ *
+ * The compiler records the variable slots each ExpressionData reads (numberInputs and nameInputs), and
+ * a VariablePack stamps each slot with the pack's version whenever a write changes it. An
+ * ExpressionMemoEvaluator keeps the result of each of its expressions with the version of the pack it
+ * was current at. While the pack hasn't moved on the result is returned after a single compare, and
+ * once it has only the expression's own inputs are checked - an expression is run again only when one
+ * of them was changed after its result was stored.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Expression.h"
+
+
+class ExpressionMemoEvaluator
+{
+	struct Entry
+	{
+		const ExpressionData* exprData;
+		bool evaluated;
+		uint64_t version;		// the pack's version when result was last known to be current
+		ExpressionResult result;
+	};
+
+	const VariablePack* variables;
+	eDispatchMode dispatchMode;
+	std::vector<float> registers;
+	std::vector<uint8_t> boolRegisters;
+	std::vector<Entry> entries;
+	uint32_t evaluationCount;
+
+	bool inputsChangedSince(const ExpressionData& exprData, uint64_t version) const;
+	void refresh(Entry& entry, uint64_t version);
+
+public:
+	ExpressionMemoEvaluator(const VariablePack* _variables, eDispatchMode _dispatchMode = eDispatchMode::Switch);
+
+	// Adds an expression, which must outlive the evaluator, and returns the index to evaluate it by
+	uint32_t addExpression(const ExpressionData* exprData);
+
+	// Returns the expression's result against the pack, evaluating it only if this is the first time or
+	// a variable it reads has changed since. Doesn't allocate.
+	const ExpressionResult& evaluate(uint32_t index);
+
+	// how many of the calls to evaluate() actually ran their expression
+	uint32_t getEvaluationCount() const { return evaluationCount; }
+};
+
+
+// the common case, nothing written since the last call, is kept inline
+inline const ExpressionResult& ExpressionMemoEvaluator::evaluate(uint32_t index)
+{
+	assert(index < entries.size());
+
+	Entry& entry = entries[index];
+	const uint64_t version = variables->getVersion();
+
+	if (!entry.evaluated || entry.version != version)
+	{
+		refresh(entry, version);
+	}
+
+	return entry.result;
+}
@@ -0,0 +1,76 @@
+/*
+ * ExpressionNetwork.cpp
+ *
+ */
+
+#include "stdafx.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ExpressionNetwork.h"
+
+
+/*
+ * ExpressionNetwork
+ */
+
+uint32_t ExpressionNetwork::getRegisterCount() const
+{
+	uint32_t count(program->regCount);
+	for (const auto& expression : expressions)
+	{
+		count = std::max<uint32_t>(count, expression->regCount);
+	}
+
+	return count;
+}
+
+
+/*
+ * ExpressionNetworkEvaluator
+ */
+
+ExpressionNetworkEvaluator::ExpressionNetworkEvaluator(const ExpressionNetwork* _network, eDispatchMode _dispatchMode)
+	: network(_network)
+	, dispatchMode(_dispatchMode)
+	, registers(_network->getRegisterCount(), 0.f)
+	, boolRegisters(_network->getRegisterCount(), 0)
+	, results(_network->getExpressionCount())
+{}
+
+void ExpressionNetworkEvaluator::evaluate(const VariablePack& variables)
+{
+	const uint32_t expressionCount = network->getExpressionCount();
+	const uint32_t registerCount = static_cast<uint32_t>(registers.size());
+
+	// the program has no native or closure code, so every dispatch mode runs it through the interpreter
+	const ExpressionResult programResult = evaluateExpression(network->getProgram(), variables, registers.data(), boolRegisters.data(), registerCount, dispatchMode);
+
+	if (!programResult.failed())
+	{
+		for (uint32_t index = 0; index < expressionCount; ++index)
+		{
+			ExpressionResult& result = results[index];
+			result.type = network->getExpression(index).resultType;
+			result.error = eErrorCode::UNINITIALISED;
+			const ExpressionSlotIndex resultRegister = network->getResultRegister(index);
+			result.value = result.type == eExpType::BOOL ? (boolRegisters[resultRegister] ? 1.f : 0.f) : registers[resultRegister];
+
+			// a zero divisor can't be traced back to the expressions that shared it, so all of them get the flag
+			result.status = programResult.status & EXP_STATUS_DIVIDE_BY_ZERO;
+			if (result.type == eExpType::NUMBER && !std::isfinite(result.value))
+			{
+				result.status |= EXP_STATUS_NOT_FINITE;
+			}
+		}
+	}
+	else
+	{
+		// something divided by zero - run the expressions one at a time to find out which
+		for (uint32_t index = 0; index < expressionCount; ++index)
+		{
+			results[index] = evaluateExpression(network->getExpression(index), variables, registers.data(), boolRegisters.data(), registerCount, dispatchMode);
+		}
+	}
+}
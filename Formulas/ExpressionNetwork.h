@@ -0,0 +1,64 @@
+/*
+ * ExpressionNetwork.h
+ * A set of expressions compiled together so that what they have in common is only evaluated once.
+ *
+ * ExpressionCompiler::compileNetwork() puts every expression of a set into a single program, sharing
+ * any subexpression that more than one of them (or one of them more than once) computes - the same
+ * comparison used by hundreds of conditions becomes one instruction. Running the program once per
+ * pack leaves every expression's result in its own register, which ExpressionNetworkEvaluator copies
+ * out into a result vector. All the expressions must be compiled against the same VariableLayout.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Expression.h"
+
+
+class ExpressionNetwork
+{
+	friend class ExpressionCompiler;
+
+	std::unique_ptr<ExpressionData> program;
+	std::vector<ExpressionSlotIndex> resultRegisters;
+
+	// each expression compiled on its own, to find out which ones failed when the program divides by zero
+	std::vector<std::unique_ptr<ExpressionData>> expressions;
+
+	ExpressionNetwork() {}
+
+public:
+	uint32_t getExpressionCount() const { return static_cast<uint32_t>(expressions.size()); }
+
+	const ExpressionData& getProgram() const { return *program; }
+	const ExpressionData& getExpression(uint32_t index) const { return *expressions[index]; }
+	ExpressionSlotIndex getResultRegister(uint32_t index) const { return resultRegisters[index]; }
+
+	// registers needed to evaluate the program or any of the expressions on their own
+	uint32_t getRegisterCount() const;
+};
+
+
+class ExpressionNetworkEvaluator
+{
+	const ExpressionNetwork* network;
+	eDispatchMode dispatchMode;
+	std::vector<float> registers;
+	std::vector<uint8_t> boolRegisters;
+	std::vector<ExpressionResult> results;
+
+public:
+	ExpressionNetworkEvaluator(const ExpressionNetwork* _network, eDispatchMode _dispatchMode = eDispatchMode::Switch);
+
+	// Evaluates every expression in the network against variables. Doesn't allocate. An expression that
+	// divides by zero fails on its own, the others still get their results.
+	void evaluate(const VariablePack& variables);
+
+	// One result per expression, in the order they were given to compileNetwork(). In a network compiled
+	// with ieeeDivide every result has EXP_STATUS_DIVIDE_BY_ZERO set if any expression divided by zero.
+	const std::vector<ExpressionResult>& getResults() const { return results; }
+	const ExpressionResult& getResult(uint32_t index) const { return results[index]; }
+};
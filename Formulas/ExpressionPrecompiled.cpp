@@ -0,0 +1,355 @@
+/*
+ * ExpressionPrecompiled.cpp
+ *
+ */
+
+#include "stdafx.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "ExpressionPrecompiled.h"
+#include "ExpressionBytecode.h"
+
+
+/*
+ * Writing
+ */
+
+static const uint32_t valuesPerLine = 8;
+
+static uint32_t getFloatBits(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static const char* getTypeSymbol(eExpType type)
+{
+	switch (type)
+	{
+	case eExpType::NUMBER:	return "eExpType::NUMBER";
+	case eExpType::NAME:	return "eExpType::NAME";
+	case eExpType::BOOL:	return "eExpType::BOOL";
+
+	default:
+		assert(false);
+		return "eExpType::UNINITIALISED";
+	}
+}
+
+static void writeString(std::ostream& out, const char* text)
+{
+	out << '"';
+	for (const char* c = text; *c; ++c)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			out << '\\';
+		}
+		out << *c;
+	}
+	out << '"';
+}
+
+static void writeHex(std::ostream& out, uint32_t value)
+{
+	out << "0x" << std::hex << std::setw(8) << std::setfill('0') << value << std::dec << std::setfill(' ') << 'u';
+}
+
+// "static const type symbol_suffix[] = { ... };" for a non-empty array, each value written by writeValue
+template<typename T, typename WriteValue>
+static void writeArray(std::ostream& out, const std::string& symbol, const char* suffix, const char* type, const std::vector<T>& values, WriteValue writeValue)
+{
+	if (values.empty())
+	{
+		return;
+	}
+
+	out << "static const " << type << ' ' << symbol << '_' << suffix << "[] =\n{";
+	for (size_t index = 0; index < values.size(); ++index)
+	{
+		out << (index % valuesPerLine == 0 ? "\n\t" : " ");
+		writeValue(values[index]);
+		out << ',';
+	}
+	out << "\n};\n";
+}
+
+// the pointer and count members for an array written by writeArray
+static void writeArrayReference(std::ostream& out, const std::string& symbol, const char* suffix, size_t count)
+{
+	out << "\t";
+	if (count == 0)
+	{
+		out << "nullptr, 0,\n";
+	}
+	else
+	{
+		out << symbol << '_' << suffix << ", " << count << ",\n";
+	}
+}
+
+static void writeExpression(std::ostream& out, const std::string& symbol, const std::string& text, const ExpressionData& exprData, const VariableLayout& layout)
+{
+	std::vector<uint32_t> constFloatBits, setFloatBits;
+	std::transform(exprData.const_floats.begin(), exprData.const_floats.end(), std::back_inserter(constFloatBits), getFloatBits);
+	std::transform(exprData.set_floats.begin(), exprData.set_floats.end(), std::back_inserter(setFloatBits), getFloatBits);
+
+	std::vector<ExpressionPrecompiledVariable> inputs;
+	auto addInput = [&](eExpType type, ExpressionSlotIndex slotIndex)
+	{
+		const Name name = layout.getVariableAt(type, slotIndex);
+		const ValueRange range = layout.getRange(name);
+		ExpressionPrecompiledVariable input = { name.c_str(), type, slotIndex, getFloatBits(range.minValue), getFloatBits(range.maxValue), range.nonZero };
+		inputs.push_back(input);
+	};
+
+	for (ExpressionSlotIndex slotIndex : exprData.numberInputs)
+	{
+		addInput(eExpType::NUMBER, slotIndex);
+	}
+	for (ExpressionSlotIndex slotIndex : exprData.nameInputs)
+	{
+		addInput(eExpType::NAME, slotIndex);
+	}
+
+	out << "\n// " << text << "\n";
+
+	writeArray(out, symbol, "byteCode", "uint32_t", exprData.byteCode, [&](uint32_t word) { writeHex(out, word); });
+	writeArray(out, symbol, "constFloats", "uint32_t", constFloatBits, [&](uint32_t bits) { writeHex(out, bits); });
+	writeArray(out, symbol, "constNames", "char* const", exprData.const_names, [&](const Name& name) { writeString(out, name.c_str()); });
+	writeArray(out, symbol, "constSets", "ExpressionSet", exprData.const_sets, [&](const ExpressionSet& set) { out << "{ " << set.first << ", " << set.count << " }"; });
+	writeArray(out, symbol, "setFloats", "uint32_t", setFloatBits, [&](uint32_t bits) { writeHex(out, bits); });
+	writeArray(out, symbol, "setNames", "char* const", exprData.set_names, [&](const Name& name) { writeString(out, name.c_str()); });
+	writeArray(out, symbol, "constRanges", "ExpressionRange", exprData.const_ranges, [&](const ExpressionRange& range)
+	{
+		out << "{ " << range.low << ", " << range.high << ", " << (range.lowVariable ? "true" : "false") << ", " << (range.highVariable ? "true" : "false") << " }";
+	});
+	writeArray(out, symbol, "inputs", "ExpressionPrecompiledVariable", inputs, [&](const ExpressionPrecompiledVariable& input)
+	{
+		out << "{ ";
+		writeString(out, input.name);
+		out << ", " << getTypeSymbol(input.type) << ", " << input.slotIndex << ", ";
+		writeHex(out, input.minBits);
+		out << ", ";
+		writeHex(out, input.maxBits);
+		out << ", " << (input.nonZero ? "true" : "false") << " }";
+	});
+
+	out << "static const ExpressionPrecompiled " << symbol << " =\n{\n\t";
+	writeString(out, text.c_str());
+	out << ",\n";
+	out << "\t" << static_cast<uint32_t>(eEncOpcode::OPCODE_MAX) << ", " << getTypeSymbol(exprData.resultType) << ", " << exprData.regCount << ", " <<
+		(exprData.ieeeDivide ? "true" : "false") << ",\n";
+
+	writeArrayReference(out, symbol, "byteCode", exprData.byteCode.size());
+	writeArrayReference(out, symbol, "constFloats", constFloatBits.size());
+	writeArrayReference(out, symbol, "constNames", exprData.const_names.size());
+	writeArrayReference(out, symbol, "constSets", exprData.const_sets.size());
+	writeArrayReference(out, symbol, "setFloats", setFloatBits.size());
+	writeArrayReference(out, symbol, "setNames", exprData.set_names.size());
+	writeArrayReference(out, symbol, "constRanges", exprData.const_ranges.size());
+	writeArrayReference(out, symbol, "inputs", inputs.size());
+	out << "};\n";
+}
+
+static void addLineError(ExpressionErrorReporter& errors, uint32_t lineNumber, eErrorCategory category, eErrorCode code, const std::string& message)
+{
+	std::ostringstream msg;
+	msg << "line " << lineNumber << ": " << message;
+	errors.addError(category, code, msg.str());
+}
+
+static void addLineErrors(ExpressionErrorReporter& errors, uint32_t lineNumber, const ExpressionErrorReporter& lineErrors)
+{
+	for (uint32_t errorIndex = 0; errorIndex < lineErrors.errorCount(); ++errorIndex)
+	{
+		const ExpressionErrorReporter::Info& info = lineErrors.error(errorIndex);
+		addLineError(errors, lineNumber, info.category, info.code, info.message);
+	}
+}
+
+bool writePrecompiledExpressions(std::istream& in, std::ostream& out, ExpressionErrorReporter& errors)
+{
+	VariableLayout layout;
+	std::ostringstream tables;
+	std::string line;
+
+	for (uint32_t lineNumber = 1; std::getline(in, line); ++lineNumber)
+	{
+		std::istringstream words(line);
+		std::string kind, name, rest;
+
+		if (!(words >> kind) || kind[0] == '#')
+		{
+			continue;
+		}
+
+		if (!(words >> name))
+		{
+			addLineError(errors, lineNumber, eErrorCategory::Syntax, eErrorCode::SyntaxError, "Expected a name after '" + kind + "'");
+			return false;
+		}
+
+		std::getline(words, rest);
+		rest.erase(0, rest.find_first_not_of(" \t"));
+
+		if (kind == "number")
+		{
+			std::istringstream bounds(rest);
+			float minValue, maxValue;
+
+			if (bounds >> minValue >> maxValue)
+			{
+				layout.addVariable(Name(name), ValueRange(minValue, maxValue));
+			}
+			else
+			{
+				layout.addVariable(Name(name), eExpType::NUMBER);
+			}
+		}
+		else if (kind == "name")
+		{
+			layout.addVariable(Name(name), eExpType::NAME);
+		}
+		else if (kind == "derived")
+		{
+			ExpressionErrorReporter lineErrors;
+			if (layout.addDerivedVariable(Name(name), rest.c_str(), &lineErrors) == EXP_SLOT_INDEX_MAX)
+			{
+				addLineErrors(errors, lineNumber, lineErrors);
+				return false;
+			}
+		}
+		else if (kind == "formula")
+		{
+			ExpressionCompiler compiler(&layout);
+			std::unique_ptr<ExpressionData> exprData(compiler.compile(rest.c_str()));
+
+			if (!exprData)
+			{
+				addLineErrors(errors, lineNumber, compiler.errors());
+				return false;
+			}
+
+			writeExpression(tables, name, rest, *exprData, layout);
+		}
+		else
+		{
+			addLineError(errors, lineNumber, eErrorCategory::Syntax, eErrorCode::SyntaxError, "Unknown entry '" + kind + "'");
+			return false;
+		}
+	}
+
+	out << "/*\n";
+	out << " * Precompiled expressions, see ExpressionPrecompiled.h. Generated by the precompiler from its spec\n";
+	out << " * at build time - edit the spec rather than this.\n";
+	out << " */\n";
+	out << tables.str();
+
+	return true;
+}
+
+
+/*
+ * Loading
+ */
+
+template<typename T>
+static void assignArray(std::vector<T>& values, const T* source, uint32_t count)
+{
+	values.assign(source, source + count);
+}
+
+static void assignFloats(std::vector<float>& values, const uint32_t* bits, uint32_t count)
+{
+	values.resize(count);
+	if (count > 0)
+	{
+		memcpy(values.data(), bits, count * sizeof(float));
+	}
+}
+
+static void assignNames(std::vector<Name>& values, const char* const* names, uint32_t count)
+{
+	values.clear();
+	values.reserve(count);
+
+	for (uint32_t index = 0; index < count; ++index)
+	{
+		values.push_back(Name(names[index]));
+	}
+}
+
+ExpressionData* loadPrecompiledExpression(const ExpressionPrecompiled& precompiled, const VariableLayout& layout)
+{
+	if (precompiled.opcodeMax != static_cast<uint32_t>(eEncOpcode::OPCODE_MAX))
+	{
+		return nullptr;
+	}
+
+	for (uint32_t inputIndex = 0; inputIndex < precompiled.inputCount; ++inputIndex)
+	{
+		const ExpressionPrecompiledVariable& input = precompiled.inputs[inputIndex];
+		const Name name(input.name);
+
+		if (!layout.variableExists(name) || layout.getType(name) != input.type || layout.getIndex(name) != input.slotIndex)
+		{
+			return nullptr;
+		}
+
+		// divide checks the table leaves out for the declared range are needed for any value outside it
+		const ValueRange range = layout.getRange(name);
+		float minValue, maxValue;
+		memcpy(&minValue, &input.minBits, sizeof(float));
+		memcpy(&maxValue, &input.maxBits, sizeof(float));
+
+		if (range.minValue < minValue || range.maxValue > maxValue || (input.nonZero && !range.excludesZero()))
+		{
+			return nullptr;
+		}
+	}
+
+	std::unique_ptr<ExpressionData> exprData(new ExpressionData());
+	exprData->resultType = precompiled.resultType;
+	exprData->regCount = precompiled.regCount;
+	exprData->ieeeDivide = precompiled.ieeeDivide;
+
+	assignArray(exprData->byteCode, precompiled.byteCode, precompiled.byteCodeSize);
+	assignFloats(exprData->const_floats, precompiled.constFloatBits, precompiled.constFloatCount);
+	assignNames(exprData->const_names, precompiled.constNames, precompiled.constNameCount);
+	assignArray(exprData->const_sets, precompiled.constSets, precompiled.constSetCount);
+	assignFloats(exprData->set_floats, precompiled.setFloatBits, precompiled.setFloatCount);
+	assignNames(exprData->set_names, precompiled.setNames, precompiled.setNameCount);
+	assignArray(exprData->const_ranges, precompiled.constRanges, precompiled.constRangeCount);
+
+	// name sets are sorted by the address of each interned string, which is particular to this process
+	for (size_t IP = 0; IP < exprData->byteCode.size(); IP += 2)
+	{
+		const ExpressionInstr instr = decodeInstr(&exprData->byteCode[IP]);
+		if (getSimpleOp(instr.opcode) == eSimpleOp::NAME_IN_SET)
+		{
+			const ExpressionSet& set = exprData->const_sets[instr.rightOp];
+			std::sort(exprData->set_names.begin() + set.first, exprData->set_names.begin() + set.first + set.count, setNameLess);
+		}
+	}
+
+	for (uint32_t inputIndex = 0; inputIndex < precompiled.inputCount; ++inputIndex)
+	{
+		const ExpressionPrecompiledVariable& input = precompiled.inputs[inputIndex];
+		(input.type == eExpType::NUMBER ? exprData->numberInputs : exprData->nameInputs).push_back(input.slotIndex);
+	}
+
+	ExpressionEvaluator::prepareThreadedCode(exprData.get());
+	ExpressionEvaluator::prepareCompactCode(exprData.get());
+
+	return exprData.release();
+}
@@ -0,0 +1,79 @@
+/*
+ * ExpressionPrecompiled.h
+ * Expressions compiled when the program is built rather than when it runs.
+ *
+ * Formulas that are part of the program itself needn't be parsed and optimised at every start. Listed
+ * in a spec file with the layout they are compiled against, the precompiler (Precompiler/main.cpp, built
+ * from these engine sources) compiles them with the usual compiler and writes each one's ExpressionData
+ * as constant tables to a .inl that is built in. The projects run it over their specs as a custom build
+ * step ahead of compiling, so a formula that doesn't compile fails the build with the line it is on, and
+ * the tables are rewritten whenever the spec or the precompiler changes. At run time
+ * loadPrecompiledExpression() turns a table back into an ExpressionData with no parsing or optimisation
+ * - the names are interned, and the threaded and compact code rebuilt from the stored bytecode.
+ *
+ * The spec file has one entry per line, with # starting a comment:
+ *
+ *   number <name> [<min> <max>]    - a number variable, with an optional declared range
+ *   name <name>                    - a name variable
+ *   derived <name> <formula>       - a derived number variable, see VariableLayout::addDerivedVariable
+ *   formula <symbol> <formula>     - a formula, written out as "static const ExpressionPrecompiled <symbol>"
+ *
+ * Variables are added in the order they are listed, which must match the layout the formulas are
+ * loaded against. Precompiled expressions have no closure code, so the Closure dispatch mode runs them
+ * in the threaded interpreter.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+
+#include "Expression.h"
+
+
+// the range is the one the variable was declared with, which the compiler may have relied on to drop checks
+struct ExpressionPrecompiledVariable
+{
+	const char* name;
+	eExpType type;
+	ExpressionSlotIndex slotIndex;
+	uint32_t minBits;
+	uint32_t maxBits;
+	bool nonZero;
+};
+
+// Every array is nullptr when its count is zero. Floats are kept as their bit patterns so that each
+// constant, inf and NaN included, comes back exactly.
+struct ExpressionPrecompiled
+{
+	const char* text;			// the formula, to compile at run time if the table can't be loaded
+	uint32_t opcodeMax;			// eEncOpcode::OPCODE_MAX when it was written, to catch a table older than the VM
+	eExpType resultType;
+	ExpressionSlotIndex regCount;
+	bool ieeeDivide;
+	const uint32_t* byteCode;
+	uint32_t byteCodeSize;
+	const uint32_t* constFloatBits;
+	uint32_t constFloatCount;
+	const char* const* constNames;
+	uint32_t constNameCount;
+	const ExpressionSet* constSets;
+	uint32_t constSetCount;
+	const uint32_t* setFloatBits;
+	uint32_t setFloatCount;
+	const char* const* setNames;
+	uint32_t setNameCount;
+	const ExpressionRange* constRanges;
+	uint32_t constRangeCount;
+	const ExpressionPrecompiledVariable* inputs;	// the variables the expression reads, for checking the layout
+	uint32_t inputCount;
+};
+
+// Reads a spec from in, compiles its formulas and writes the tables to out. Returns false at the first
+// line that can't be read or formula that doesn't compile, with the reason in errors.
+bool writePrecompiledExpressions(std::istream& in, std::ostream& out, ExpressionErrorReporter& errors);
+
+// Rebuilds the expression from its table, or returns nullptr if the table was written by a different
+// version of the VM, or one of the variables it reads isn't in the same slot of layout or is declared
+// there with a wider range - compile precompiled.text instead then.
+ExpressionData* loadPrecompiledExpression(const ExpressionPrecompiled& precompiled, const VariableLayout& layout);
@@ -0,0 +1,124 @@
+/*
+ * ExpressionProfile.cpp
+ *
+ */
+
+#include "stdafx.h"
+
+#include <algorithm>
+
+#include "ExpressionProfile.h"
+
+
+ExpressionOpcodeProfile::ExpressionOpcodeProfile()
+{
+	reset();
+}
+
+void ExpressionOpcodeProfile::reset()
+{
+	pairCounts.clear();
+	tripleCounts.clear();
+	dispatchCount = 0;
+	historyLength = 0;
+}
+
+void ExpressionOpcodeProfile::record(eEncOpcode opcode)
+{
+	const uint64_t code = static_cast<uint16_t>(opcode);
+	++dispatchCount;
+
+	if (historyLength >= 1)
+	{
+		++pairCounts[static_cast<uint32_t>((static_cast<uint16_t>(history[1]) << 16) | code)];
+	}
+	if (historyLength >= 2)
+	{
+		++tripleCounts[(static_cast<uint64_t>(static_cast<uint16_t>(history[0])) << 32) | (static_cast<uint64_t>(static_cast<uint16_t>(history[1])) << 16) | code];
+	}
+
+	history[0] = history[1];
+	history[1] = opcode;
+	historyLength = std::min<uint32_t>(historyLength + 1, 2);
+}
+
+std::vector<ExpressionOpcodeProfile::Sequence> ExpressionOpcodeProfile::getTopSequences(uint32_t count) const
+{
+	std::vector<Sequence> sequences;
+
+	auto addSequence = [&sequences](uint64_t key, uint32_t length, uint64_t sequenceCount)
+	{
+		Sequence sequence;
+		sequence.length = length;
+		sequence.count = sequenceCount;
+
+		for (uint32_t i = 0; i < length; ++i)
+		{
+			sequence.opcodes[i] = static_cast<eEncOpcode>((key >> ((length - 1 - i) * 16)) & 0xffff);
+			if (i + 1 < length && isJumpOp(getSimpleOp(sequence.opcodes[i])))
+			{
+				return;
+			}
+		}
+
+		sequences.push_back(sequence);
+	};
+
+	for (const auto& pair : pairCounts)
+	{
+		addSequence(pair.first, 2, pair.second);
+	}
+	for (const auto& triple : tripleCounts)
+	{
+		addSequence(triple.first, 3, triple.second);
+	}
+
+	// ties are broken on the opcodes, so the generated file doesn't depend on hash map order
+	std::sort(sequences.begin(), sequences.end(), [](const Sequence& lhs, const Sequence& rhs)
+	{
+		if (lhs.getSaving() != rhs.getSaving()) return lhs.getSaving() > rhs.getSaving();
+		if (lhs.length != rhs.length) return lhs.length < rhs.length;
+		return std::lexicographical_compare(lhs.opcodes, lhs.opcodes + lhs.length, rhs.opcodes, rhs.opcodes + rhs.length);
+	});
+
+	if (sequences.size() > count)
+	{
+		sequences.resize(count);
+	}
+
+	return sequences;
+}
+
+void ExpressionOpcodeProfile::writeSuperinstructions(std::ostream& out, uint32_t count) const
+{
+	const std::vector<Sequence> sequences = getTopSequences(count);
+
+	out << "/*" << std::endl;
+	out << " * ExpressionSuperinstructions.inl" << std::endl;
+	out << " * Fused opcode sequences for the expression VM's compact switch dispatch." << std::endl;
+	out << " *" << std::endl;
+	out << " * Generated by \"Formulas superinstructions " << count << "\" from the opcode profile of the benchmark" << std::endl;
+	out << " * corpus - regenerate it rather than editing it. Before including this file define:" << std::endl;
+	out << " *" << std::endl;
+	out << " *   SUPERINSTRUCTION2(A, B)                    - A then B in one dispatch" << std::endl;
+	out << " *   SUPERINSTRUCTION3(A, B, C)                 - A, B then C in one dispatch" << std::endl;
+	out << " *" << std::endl;
+	out << " * Each line is commented with the dispatches it saved over the profile (" << dispatchCount << " in total)." << std::endl;
+	out << " * Only the last opcode of a sequence is ever a jump. Both macros are undefined again at the end of this file." << std::endl;
+	out << " */" << std::endl;
+	out << std::endl;
+
+	for (const Sequence& sequence : sequences)
+	{
+		out << "SUPERINSTRUCTION" << sequence.length << "(";
+		for (uint32_t i = 0; i < sequence.length; ++i)
+		{
+			out << (i > 0 ? ", " : "") << getOpcodeAsString(sequence.opcodes[i]);
+		}
+		out << ")\t// " << sequence.getSaving() << std::endl;
+	}
+
+	out << std::endl;
+	out << "#undef SUPERINSTRUCTION2" << std::endl;
+	out << "#undef SUPERINSTRUCTION3" << std::endl;
+}
@@ -0,0 +1,57 @@
+/*
+ * ExpressionProfile.h
+ * Opcode sequence counts for choosing the expression VM's superinstructions.
+ *
+ * An ExpressionEvaluator given a profile runs every expression through a recording interpreter, which
+ * counts each opcode pair and triple executed back to back. A taken jump starts a new sequence, so only
+ * opcodes that sit next to each other in the bytecode are counted together - the ones the compiler's
+ * peephole pass can fuse. writeSuperinstructions() turns the most common sequences into
+ * ExpressionSuperinstructions.inl, see "superinstructions" in ExpressionBenchmarks.h.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "ExpressionBytecode.h"
+
+
+class ExpressionOpcodeProfile
+{
+	std::unordered_map<uint32_t, uint64_t> pairCounts;		// first << 16 | second
+	std::unordered_map<uint64_t, uint64_t> tripleCounts;	// first << 32 | second << 16 | third
+	uint64_t dispatchCount;
+
+	eEncOpcode history[2];
+	uint32_t historyLength;
+
+public:
+	struct Sequence
+	{
+		eEncOpcode opcodes[3];
+		uint32_t length;
+		uint64_t count;
+
+		// dispatches a superinstruction for this sequence would have saved over the profile
+		uint64_t getSaving() const { return count * (length - 1); }
+	};
+
+	ExpressionOpcodeProfile();
+
+	// start of an evaluation, or the instruction after a taken jump
+	void beginSequence() { historyLength = 0; }
+	void record(eEncOpcode opcode);
+	void reset();
+
+	uint64_t getDispatchCount() const { return dispatchCount; }
+
+	// The sequences that would save the most dispatches as superinstructions, best first. Jumps can only
+	// end a sequence, since a taken jump must skip the rest of it.
+	std::vector<Sequence> getTopSequences(uint32_t count) const;
+
+	// writes ExpressionSuperinstructions.inl for the top count sequences
+	void writeSuperinstructions(std::ostream& out, uint32_t count) const;
+};
@@ -0,0 +1,381 @@
+/*
+ * ExpressionSIMD.cpp
+ *
+ * Vector traits for each instruction set and the runtime selection between them. The kernel itself
+ * lives in ExpressionSIMDKernel.inl. Booleans are kept as each instruction set's native lane mask - a
+ * compare result vector for SSE2 and AVX2, a mask register for AVX-512 - and only turned into 1.f/0.f
+ * lanes for the final result.
+ *
+ */
+
+#include "stdafx.h"
+
+#include <math.h>
+
+#include "ExpressionSIMD.h"
+#include "ExpressionBytecode.h"
+
+#if EXPRESSION_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+
+// GCC and Clang only allow the wider intrinsics inside functions compiled for that instruction set
+#if EXPRESSION_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET_BEGIN(TARGET) _Pragma("GCC push_options") _Pragma(TARGET)
+#define SIMD_TARGET_END _Pragma("GCC pop_options")
+#else
+#define SIMD_TARGET_BEGIN(TARGET)
+#define SIMD_TARGET_END
+#endif
+
+
+/*
+ * Scalar - one lane, used for the rows left over after the vector kernel
+ */
+
+struct ScalarVec
+{
+	typedef float Type;
+	typedef bool Mask;
+	static const uint32_t width = 1;
+
+	static Type zero() { return 0.f; }
+	static Type set1(float value) { return value; }
+	static Type load(const float* src) { return *src; }
+	static void store(float* dst, Type value) { *dst = value; }
+
+	static Type add(Type l, Type r) { return l + r; }
+	static Type sub(Type l, Type r) { return l - r; }
+	static Type mul(Type l, Type r) { return l * r; }
+	static Type div(Type l, Type r) { return l / r; }	// inf or NaN for a zero divisor, like the vector sets
+
+	static Type bitAnd(Type l, Type r) { return l != 0.f && r != 0.f ? 1.f : 0.f; }
+	static Type bitOr(Type l, Type r) { return l != 0.f || r != 0.f ? 1.f : 0.f; }
+	static Type bitXor(Type l, Type r) { return (l != 0.f) != (r != 0.f) ? 1.f : 0.f; }
+
+	static Mask cmpEq(Type l, Type r) { return l == r; }
+	static Mask cmpNeq(Type l, Type r) { return l != r; }
+	static Mask cmpLt(Type l, Type r) { return l < r; }
+	static Mask cmpLtEq(Type l, Type r) { return l <= r; }
+
+	static Mask maskAll() { return true; }
+	static Mask maskNone() { return false; }
+	static Mask maskAnd(Mask l, Mask r) { return l && r; }
+	static Mask maskOr(Mask l, Mask r) { return l || r; }
+	static Mask maskXor(Mask l, Mask r) { return l != r; }
+	static Mask maskNot(Mask m) { return !m; }
+	static uint32_t maskBits(Mask m) { return m ? 1 : 0; }
+	static Type maskToNumber(Mask m) { return m ? 1.f : 0.f; }
+	static Type blend(Mask m, Type ifTrue, Type ifFalse) { return m ? ifTrue : ifFalse; }
+};
+
+#define SIMD_NAMESPACE ScalarKernel
+#define SIMD_VEC ScalarVec
+#include "ExpressionSIMDKernel.inl"
+
+
+#if EXPRESSION_SIMD_X86
+
+/*
+ * SSE2 - 4 lanes
+ */
+
+SIMD_TARGET_BEGIN("GCC target(\"sse2\")")
+
+struct SSE2Vec
+{
+	typedef __m128 Type;
+	typedef __m128 Mask;
+	static const uint32_t width = 4;
+
+	static Type zero() { return _mm_setzero_ps(); }
+	static Type set1(float value) { return _mm_set1_ps(value); }
+	static Type load(const float* src) { return _mm_loadu_ps(src); }
+	static void store(float* dst, Type value) { _mm_storeu_ps(dst, value); }
+
+	static Type add(Type l, Type r) { return _mm_add_ps(l, r); }
+	static Type sub(Type l, Type r) { return _mm_sub_ps(l, r); }
+	static Type mul(Type l, Type r) { return _mm_mul_ps(l, r); }
+	static Type div(Type l, Type r) { return _mm_div_ps(l, r); }
+
+	static Type bitAnd(Type l, Type r) { return _mm_and_ps(l, r); }
+	static Type bitOr(Type l, Type r) { return _mm_or_ps(l, r); }
+	static Type bitXor(Type l, Type r) { return _mm_xor_ps(l, r); }
+
+	static Mask cmpEq(Type l, Type r) { return _mm_cmpeq_ps(l, r); }
+	static Mask cmpNeq(Type l, Type r) { return _mm_cmpneq_ps(l, r); }
+	static Mask cmpLt(Type l, Type r) { return _mm_cmplt_ps(l, r); }
+	static Mask cmpLtEq(Type l, Type r) { return _mm_cmple_ps(l, r); }
+
+	static Mask maskAll() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+	static Mask maskNone() { return _mm_setzero_ps(); }
+	static Mask maskAnd(Mask l, Mask r) { return _mm_and_ps(l, r); }
+	static Mask maskOr(Mask l, Mask r) { return _mm_or_ps(l, r); }
+	static Mask maskXor(Mask l, Mask r) { return _mm_xor_ps(l, r); }
+	static Mask maskNot(Mask m) { return _mm_xor_ps(m, maskAll()); }
+	static uint32_t maskBits(Mask m) { return static_cast<uint32_t>(_mm_movemask_ps(m)); }
+	static Type maskToNumber(Mask m) { return _mm_and_ps(m, _mm_set1_ps(1.f)); }
+	static Type blend(Mask m, Type ifTrue, Type ifFalse) { return _mm_or_ps(_mm_and_ps(m, ifTrue), _mm_andnot_ps(m, ifFalse)); }	// no blendv before SSE4.1
+};
+
+#define SIMD_NAMESPACE SSE2Kernel
+#define SIMD_VEC SSE2Vec
+#include "ExpressionSIMDKernel.inl"
+
+SIMD_TARGET_END
+
+
+/*
+ * AVX2 - 8 lanes
+ */
+
+SIMD_TARGET_BEGIN("GCC target(\"avx2\")")
+
+struct AVX2Vec
+{
+	typedef __m256 Type;
+	typedef __m256 Mask;
+	static const uint32_t width = 8;
+
+	static Type zero() { return _mm256_setzero_ps(); }
+	static Type set1(float value) { return _mm256_set1_ps(value); }
+	static Type load(const float* src) { return _mm256_loadu_ps(src); }
+	static void store(float* dst, Type value) { _mm256_storeu_ps(dst, value); }
+
+	static Type add(Type l, Type r) { return _mm256_add_ps(l, r); }
+	static Type sub(Type l, Type r) { return _mm256_sub_ps(l, r); }
+	static Type mul(Type l, Type r) { return _mm256_mul_ps(l, r); }
+	static Type div(Type l, Type r) { return _mm256_div_ps(l, r); }
+
+	static Type bitAnd(Type l, Type r) { return _mm256_and_ps(l, r); }
+	static Type bitOr(Type l, Type r) { return _mm256_or_ps(l, r); }
+	static Type bitXor(Type l, Type r) { return _mm256_xor_ps(l, r); }
+
+	// ordered predicates, except != which like the C operator is true for NaN
+	static Mask cmpEq(Type l, Type r) { return _mm256_cmp_ps(l, r, _CMP_EQ_OQ); }
+	static Mask cmpNeq(Type l, Type r) { return _mm256_cmp_ps(l, r, _CMP_NEQ_UQ); }
+	static Mask cmpLt(Type l, Type r) { return _mm256_cmp_ps(l, r, _CMP_LT_OQ); }
+	static Mask cmpLtEq(Type l, Type r) { return _mm256_cmp_ps(l, r, _CMP_LE_OQ); }
+
+	static Mask maskAll() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+	static Mask maskNone() { return _mm256_setzero_ps(); }
+	static Mask maskAnd(Mask l, Mask r) { return _mm256_and_ps(l, r); }
+	static Mask maskOr(Mask l, Mask r) { return _mm256_or_ps(l, r); }
+	static Mask maskXor(Mask l, Mask r) { return _mm256_xor_ps(l, r); }
+	static Mask maskNot(Mask m) { return _mm256_xor_ps(m, maskAll()); }
+	static uint32_t maskBits(Mask m) { return static_cast<uint32_t>(_mm256_movemask_ps(m)); }
+	static Type maskToNumber(Mask m) { return _mm256_and_ps(m, _mm256_set1_ps(1.f)); }
+	static Type blend(Mask m, Type ifTrue, Type ifFalse) { return _mm256_blendv_ps(ifFalse, ifTrue, m); }
+};
+
+#define SIMD_NAMESPACE AVX2Kernel
+#define SIMD_VEC AVX2Vec
+#include "ExpressionSIMDKernel.inl"
+
+SIMD_TARGET_END
+
+
+/*
+ * AVX-512 - 16 lanes. Only AVX-512F is assumed, so the bitwise ops go through the integer forms
+ */
+
+#if EXPRESSION_SIMD_AVX512
+
+SIMD_TARGET_BEGIN("GCC target(\"avx512f\")")
+
+struct AVX512Vec
+{
+	typedef __m512 Type;
+	typedef __mmask16 Mask;
+	static const uint32_t width = 16;
+
+	static Type zero() { return _mm512_setzero_ps(); }
+	static Type set1(float value) { return _mm512_set1_ps(value); }
+	static Type load(const float* src) { return _mm512_loadu_ps(src); }
+	static void store(float* dst, Type value) { _mm512_storeu_ps(dst, value); }
+
+	static Type add(Type l, Type r) { return _mm512_add_ps(l, r); }
+	static Type sub(Type l, Type r) { return _mm512_sub_ps(l, r); }
+	static Type mul(Type l, Type r) { return _mm512_mul_ps(l, r); }
+	static Type div(Type l, Type r) { return _mm512_div_ps(l, r); }
+
+	static Type bitAnd(Type l, Type r) { return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(l), _mm512_castps_si512(r))); }
+	static Type bitOr(Type l, Type r) { return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(l), _mm512_castps_si512(r))); }
+	static Type bitXor(Type l, Type r) { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(l), _mm512_castps_si512(r))); }
+
+	static Mask cmpEq(Type l, Type r) { return _mm512_cmp_ps_mask(l, r, _CMP_EQ_OQ); }
+	static Mask cmpNeq(Type l, Type r) { return _mm512_cmp_ps_mask(l, r, _CMP_NEQ_UQ); }
+	static Mask cmpLt(Type l, Type r) { return _mm512_cmp_ps_mask(l, r, _CMP_LT_OQ); }
+	static Mask cmpLtEq(Type l, Type r) { return _mm512_cmp_ps_mask(l, r, _CMP_LE_OQ); }
+
+	static Mask maskAll() { return static_cast<Mask>(0xffff); }
+	static Mask maskNone() { return static_cast<Mask>(0); }
+	static Mask maskAnd(Mask l, Mask r) { return _mm512_kand(l, r); }
+	static Mask maskOr(Mask l, Mask r) { return _mm512_kor(l, r); }
+	static Mask maskXor(Mask l, Mask r) { return _mm512_kxor(l, r); }
+	static Mask maskNot(Mask m) { return _mm512_knot(m); }
+	static uint32_t maskBits(Mask m) { return static_cast<uint32_t>(m); }
+	static Type maskToNumber(Mask m) { return _mm512_maskz_mov_ps(m, _mm512_set1_ps(1.f)); }
+	static Type blend(Mask m, Type ifTrue, Type ifFalse) { return _mm512_mask_blend_ps(m, ifFalse, ifTrue); }
+};
+
+#define SIMD_NAMESPACE AVX512Kernel
+#define SIMD_VEC AVX512Vec
+#include "ExpressionSIMDKernel.inl"
+
+SIMD_TARGET_END
+
+#endif // EXPRESSION_SIMD_AVX512
+
+#endif // EXPRESSION_SIMD_X86
+
+
+/*
+ * CPU feature detection
+ */
+
+#if EXPRESSION_SIMD_X86
+static eSimdLevel detectSimdLevel()
+{
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_cpu_init();
+
+#if EXPRESSION_SIMD_AVX512
+	if (__builtin_cpu_supports("avx512f")) return eSimdLevel::AVX512;
+#endif
+	if (__builtin_cpu_supports("avx2")) return eSimdLevel::AVX2;
+	if (__builtin_cpu_supports("sse2")) return eSimdLevel::SSE2;
+	return eSimdLevel::Scalar;
+#else
+	int info[4];
+	__cpuid(info, 0);
+	const int maxLeaf = info[0];
+
+	__cpuid(info, 1);
+	const bool sse2 = (info[3] & (1 << 26)) != 0;
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+
+	// the OS must also save the wider registers on a context switch
+	const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+	const bool osAVX = (xcr0 & 0x6) == 0x6;
+	const bool osAVX512 = (xcr0 & 0xe6) == 0xe6;
+
+	bool avx2(false), avx512f(false);
+	if (maxLeaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+		avx512f = (info[1] & (1 << 16)) != 0;
+	}
+
+#if EXPRESSION_SIMD_AVX512
+	if (avx && avx512f && osAVX512) return eSimdLevel::AVX512;
+#endif
+	if (avx && avx2 && osAVX) return eSimdLevel::AVX2;
+	if (sse2) return eSimdLevel::SSE2;
+	return eSimdLevel::Scalar;
+#endif
+}
+#endif
+
+
+/*
+ * ExpressionSIMD
+ */
+
+eSimdLevel ExpressionSIMD::getSupportedLevel()
+{
+#if EXPRESSION_SIMD_X86
+	static const eSimdLevel supportedLevel = detectSimdLevel();
+	return supportedLevel;
+#else
+	return eSimdLevel::Scalar;
+#endif
+}
+
+uint32_t ExpressionSIMD::getLaneCount(eSimdLevel level)
+{
+	switch (level)
+	{
+	case eSimdLevel::SSE2:		return 4;
+	case eSimdLevel::AVX2:		return 8;
+	case eSimdLevel::AVX512:	return 16;
+
+	default:
+		return 1;
+	}
+}
+
+const char* ExpressionSIMD::getLevelAsString(eSimdLevel level)
+{
+	switch (level)
+	{
+	case eSimdLevel::Scalar:	return "scalar";
+	case eSimdLevel::SSE2:		return "sse2";
+	case eSimdLevel::AVX2:		return "avx2";
+	case eSimdLevel::AVX512:	return "avx512";
+
+	default:
+		return "!ERROR!";
+	}
+}
+
+bool ExpressionSIMD::evaluate(const ExpressionData* exprData, const VariableTable* table, uint32_t firstRow, uint32_t rowCount,
+	float* results, uint8_t* errors, eSimdLevel level)
+{
+	assert(exprData && table && results && errors);
+	assert(firstRow + rowCount <= table->getRowCount());
+
+	if (exprData->regCount > EXPRESSION_SIMD_MAX_REGISTERS)
+	{
+		return false;
+	}
+
+	// the kernel keeps a fixed stack of the jumps its lanes disagreed at, one entry per jump at most
+	uint32_t jumpCount(0);
+	for (size_t IP = 0; IP < exprData->byteCode.size(); IP += 2)
+	{
+		jumpCount += isJumpOp(getSimpleOp(decodeInstr(&exprData->byteCode[IP]).opcode)) ? 1 : 0;
+	}
+
+	if (jumpCount > EXPRESSION_SIMD_MAX_REGISTERS)
+	{
+		return false;
+	}
+
+	if (level > getSupportedLevel())
+	{
+		level = getSupportedLevel();
+	}
+
+	const uint32_t laneCount = getLaneCount(level);
+	const uint32_t vectorRows = rowCount - rowCount % laneCount;
+
+	if (vectorRows > 0)
+	{
+		switch (level)
+		{
+#if EXPRESSION_SIMD_X86
+		case eSimdLevel::SSE2:		SSE2Kernel::evaluateRows(exprData, table, firstRow, vectorRows, results, errors); break;
+		case eSimdLevel::AVX2:		AVX2Kernel::evaluateRows(exprData, table, firstRow, vectorRows, results, errors); break;
+#if EXPRESSION_SIMD_AVX512
+		case eSimdLevel::AVX512:	AVX512Kernel::evaluateRows(exprData, table, firstRow, vectorRows, results, errors); break;
+#endif
+#endif
+		default:
+			ScalarKernel::evaluateRows(exprData, table, firstRow, vectorRows, results, errors); break;
+		}
+	}
+
+	if (vectorRows < rowCount)
+	{
+		ScalarKernel::evaluateRows(exprData, table, firstRow + vectorRows, rowCount - vectorRows, results + vectorRows, errors + vectorRows);
+	}
+
+	return true;
+}
@@ -0,0 +1,65 @@
+/*
+ * ExpressionSIMD.h
+ * Lane-parallel evaluation of one expression across the rows of a VariableTable.
+ *
+ * Each bytecode instruction is executed for a whole block of rows at once - 4 with SSE2, 8 with AVX2
+ * and 16 with AVX-512 where the compiler has it - reading variables straight out of the table's columns. A divide or mod by
+ * zero only fails the lanes it happened in. The instruction set is picked at runtime from what the
+ * CPU supports, with a scalar kernel for the rows left over at the end and for other platforms.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "Expression.h"
+#include "VariableTable.h"
+
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define EXPRESSION_SIMD_X86 1
+#else
+#define EXPRESSION_SIMD_X86 0
+#endif
+
+// AVX-512 intrinsics arrived with VS2017 - older compilers stop at AVX2
+#if EXPRESSION_SIMD_X86 && ((defined(_MSC_VER) && _MSC_VER >= 1910) || defined(__GNUC__) || defined(__clang__))
+#define EXPRESSION_SIMD_AVX512 1
+#else
+#define EXPRESSION_SIMD_AVX512 0
+#endif
+
+// expressions needing more registers, or with more jumps, than this are rejected by ExpressionSIMD::evaluate
+#define EXPRESSION_SIMD_MAX_REGISTERS 64
+
+
+enum class eSimdLevel
+{
+	Scalar,
+	SSE2,
+	AVX2,
+	AVX512,
+};
+
+
+class ExpressionSIMD
+{
+public:
+	// the widest instruction set this CPU and OS can run
+	static eSimdLevel getSupportedLevel();
+	static uint32_t getLaneCount(eSimdLevel level);
+	static const char* getLevelAsString(eSimdLevel level);
+
+	// Evaluates exprData for rowCount rows of table starting at firstRow. results receives one value
+	// per row, with booleans written as 1.f/0.f, and errors is set non-zero for rows that divided by
+	// zero (their result is 0.f) - with ieeeDivide they get inf or NaN instead. Levels above getSupportedLevel() are clamped to it. Returns false
+	// without writing anything if the expression uses too many registers or jumps.
+	static bool evaluate(const ExpressionData* exprData, const VariableTable* table, uint32_t firstRow, uint32_t rowCount,
+		float* results, uint8_t* errors, eSimdLevel level);
+
+	static bool evaluate(const ExpressionData* exprData, const VariableTable* table, uint32_t firstRow, uint32_t rowCount,
+		float* results, uint8_t* errors)
+	{
+		return evaluate(exprData, table, firstRow, rowCount, results, errors, getSupportedLevel());
+	}
+};
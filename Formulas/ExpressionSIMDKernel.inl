@@ -0,0 +1,297 @@
+/*
+ * ExpressionSIMDKernel.inl
+ * Lane-parallel evaluation kernel, included once per instruction set by ExpressionSIMD.cpp.
+ *
+ * Before including this file define:
+ *
+ *   SIMD_NAMESPACE     - namespace the kernel is placed in
+ *   SIMD_VEC           - vector traits type (see ScalarVec in ExpressionSIMD.cpp for the interface)
+ *
+ * The kernel is written once and instantiated inside each instruction set's target region so that
+ * the compiler can inline the intrinsics. Both macros are undefined again at the end of this file.
+ */
+
+namespace SIMD_NAMESPACE
+{
+	typedef SIMD_VEC Vec;
+	typedef Vec::Type VecType;
+	typedef Vec::Mask VecMask;
+
+	inline VecType getNumber(uint8_t source, ExpressionSlotIndex index, const VecType* reg,
+		const ExpressionData* exprData, const VariableTable* table, uint32_t row)
+	{
+		switch (source)
+		{
+		case OPERAND_SOURCE_REG:	return reg[index];
+		case OPERAND_SOURCE_CONST:	return Vec::set1(exprData->const_floats[index]);
+		default:					return Vec::load(table->getNumberColumn(index) + row);
+		}
+	}
+
+	inline Name getName(uint8_t source, ExpressionSlotIndex index, uint32_t lane,
+		const ExpressionData* exprData, const VariableTable* table, uint32_t row)
+	{
+		return source == OPERAND_SOURCE_CONST ? exprData->const_names[index] : table->getNameColumn(index)[row + lane];
+	}
+
+	// names are pointer sized, so they are compared a lane at a time
+	inline VecMask compareNames(const ExpressionInstr& instr, bool equal,
+		const ExpressionData* exprData, const VariableTable* table, uint32_t row)
+	{
+		float lanes[Vec::width];
+		for (uint32_t lane = 0; lane < Vec::width; ++lane)
+		{
+			const Name left = getName(getLeftSource(instr.opcode), instr.leftOp, lane, exprData, table, row);
+			const Name right = getName(getRightSource(instr.opcode), instr.rightOp, lane, exprData, table, row);
+			lanes[lane] = (left == right) == equal ? 1.f : 0.f;
+		}
+
+		return Vec::cmpNeq(Vec::load(lanes), Vec::zero());
+	}
+
+	// a short set is compared with every lane at once, member by member, a longer one searched a lane at a time
+	inline VecMask numberInSet(VecType value, const ExpressionSet& set, const ExpressionData* exprData)
+	{
+		const float* members = exprData->set_floats.data() + set.first;
+
+		if (set.count <= EXP_SET_SCAN_MAX)
+		{
+			VecMask found = Vec::maskNone();
+			for (uint32_t i = 0; i < set.count; ++i)
+			{
+				found = Vec::maskOr(found, Vec::cmpEq(value, Vec::set1(members[i])));
+			}
+			return found;
+		}
+
+		float lanes[Vec::width];
+		Vec::store(lanes, value);
+		for (uint32_t lane = 0; lane < Vec::width; ++lane)
+		{
+			lanes[lane] = isSetMember(members, set.count, lanes[lane]) ? 1.f : 0.f;
+		}
+
+		return Vec::cmpNeq(Vec::load(lanes), Vec::zero());
+	}
+
+	inline VecMask nameInSet(const ExpressionInstr& instr, const ExpressionData* exprData, const VariableTable* table, uint32_t row)
+	{
+		float lanes[Vec::width];
+		for (uint32_t lane = 0; lane < Vec::width; ++lane)
+		{
+			const Name value = getName(getLeftSource(instr.opcode), instr.leftOp, lane, exprData, table, row);
+			lanes[lane] = isSetMember(*exprData, instr.rightOp, value) ? 1.f : 0.f;
+		}
+
+		return Vec::cmpNeq(Vec::load(lanes), Vec::zero());
+	}
+
+	inline VecMask numberInRange(eSimpleOp simpleOp, VecType value, const ExpressionRange& range,
+		const ExpressionData* exprData, const VariableTable* table, uint32_t row)
+	{
+		const VecType low = getNumber(range.lowVariable ? OPERAND_SOURCE_VAR : OPERAND_SOURCE_CONST, range.low, nullptr, exprData, table, row);
+		const VecType high = getNumber(range.highVariable ? OPERAND_SOURCE_VAR : OPERAND_SOURCE_CONST, range.high, nullptr, exprData, table, row);
+
+		const VecMask aboveLow = isLowBoundClosed(simpleOp) ? Vec::cmpLtEq(low, value) : Vec::cmpLt(low, value);
+		const VecMask belowHigh = isHighBoundClosed(simpleOp) ? Vec::cmpLtEq(value, high) : Vec::cmpLt(value, high);
+		return Vec::maskAnd(aboveLow, belowHigh);
+	}
+
+	// there is no vector fmod, so the remainder is taken a lane at a time. Lanes with a zero divisor
+	// get 0.f, or NaN like fmodf itself for ieee.
+	inline VecType modLanes(VecType left, VecType right, bool ieee = false)
+	{
+		float leftLanes[Vec::width], rightLanes[Vec::width];
+		Vec::store(leftLanes, left);
+		Vec::store(rightLanes, right);
+
+		for (uint32_t lane = 0; lane < Vec::width; ++lane)
+		{
+			leftLanes[lane] = rightLanes[lane] != 0.f || ieee ? fmodf(leftLanes[lane], rightLanes[lane]) : 0.f;
+		}
+
+		return Vec::load(leftLanes);
+	}
+
+	// A jump taken by some lanes but not others - the instructions up to target are still run for the
+	// whole block, but with the jumping lanes switched off so that they can't report errors
+	struct PendingJump
+	{
+		uint32_t target;
+		VecMask activeBefore;
+	};
+
+	// evaluates rowCount rows, which must be a multiple of the lane count
+	void evaluateRows(const ExpressionData* exprData, const VariableTable* table, uint32_t firstRow, uint32_t rowCount,
+		float* results, uint8_t* errors)
+	{
+		assert(rowCount % Vec::width == 0);
+		assert(exprData->regCount <= EXPRESSION_SIMD_MAX_REGISTERS);
+
+		// numbers and booleans are kept in separate banks, indexed by the same register numbers
+		VecType reg[EXPRESSION_SIMD_MAX_REGISTERS];
+		VecMask masks[EXPRESSION_SIMD_MAX_REGISTERS];
+		const VecType zero = Vec::zero();
+
+		const uint32_t codeLen(exprData->byteCode.size());
+		assert((codeLen & 1) == 0);
+
+		for (uint32_t block = 0; block < rowCount; block += Vec::width)
+		{
+			const uint32_t row = firstRow + block;
+			VecMask errorMask = Vec::maskNone();
+			VecMask active = Vec::maskAll();
+
+			PendingJump pending[EXPRESSION_SIMD_MAX_REGISTERS];
+			uint32_t pendingCount(0);
+
+			// a select still blends in the side its jump skipped, so registers that code would have
+			// written have to hold something - the lanes that skipped it never keep that side
+			for (uint32_t regIndex = 0; regIndex < exprData->regCount; ++regIndex)
+			{
+				reg[regIndex] = zero;
+				masks[regIndex] = Vec::maskNone();
+			}
+
+			for (uint32_t IP = 0; IP < codeLen; IP += 2)
+			{
+				while (pendingCount > 0 && pending[pendingCount - 1].target == IP)
+				{
+					active = pending[--pendingCount].activeBefore;
+				}
+
+				const ExpressionInstr instr = decodeInstr(&exprData->byteCode[IP]);
+				const uint8_t leftSource = getLeftSource(instr.opcode);
+				const uint8_t rightSource = getRightSource(instr.opcode);
+
+#define LEFT_NUM getNumber(leftSource, instr.leftOp, reg, exprData, table, row)
+#define RIGHT_NUM getNumber(rightSource, instr.rightOp, reg, exprData, table, row)
+
+				VecType result;
+				VecMask maskResult;
+
+				switch (getSimpleOp(instr.opcode))
+				{
+				case eSimpleOp::ADD:		result = Vec::add(LEFT_NUM, RIGHT_NUM); break;
+				case eSimpleOp::SUB:		result = Vec::sub(LEFT_NUM, RIGHT_NUM); break;
+				case eSimpleOp::MUL:		result = Vec::mul(LEFT_NUM, RIGHT_NUM); break;
+
+				case eSimpleOp::DIV:
+				case eSimpleOp::MOD:
+					{
+						const VecType left = LEFT_NUM;
+						const VecType right = RIGHT_NUM;
+
+						// lanes dividing by zero are flagged and carry on with a junk value
+						errorMask = Vec::maskOr(errorMask, Vec::maskAnd(Vec::cmpEq(right, zero), active));
+						result = getSimpleOp(instr.opcode) == eSimpleOp::DIV ? Vec::div(left, right) : modLanes(left, right);
+					}
+					break;
+
+				// the compiler has proven these divisors non-zero for every lane that is still active
+				case eSimpleOp::DIV_NZ:		result = Vec::div(LEFT_NUM, RIGHT_NUM); break;
+				case eSimpleOp::MOD_NZ:		result = modLanes(LEFT_NUM, RIGHT_NUM); break;
+
+				// ieeeDivide - lanes with a zero divisor get inf or NaN and aren't errors
+				case eSimpleOp::DIV_IEEE:	result = Vec::div(LEFT_NUM, RIGHT_NUM); break;
+				case eSimpleOp::MOD_IEEE:	result = modLanes(LEFT_NUM, RIGHT_NUM, true); break;
+
+				case eSimpleOp::NUM_VAL:	result = LEFT_NUM; break;
+
+				// the condition is in the mask bank under the result register
+				case eSimpleOp::SELECT:		result = Vec::blend(masks[instr.resultReg], LEFT_NUM, RIGHT_NUM); break;
+
+				// boolean results go to the mask bank
+				case eSimpleOp::AND:		maskResult = Vec::maskAnd(masks[instr.leftOp], masks[instr.rightOp]); break;
+				case eSimpleOp::OR:			maskResult = Vec::maskOr(masks[instr.leftOp], masks[instr.rightOp]); break;
+				case eSimpleOp::XOR:		maskResult = Vec::maskXor(masks[instr.leftOp], masks[instr.rightOp]); break;
+				case eSimpleOp::NOT:		maskResult = Vec::maskNot(masks[instr.leftOp]); break;
+				case eSimpleOp::BOOL_EQ:	maskResult = Vec::maskNot(Vec::maskXor(masks[instr.leftOp], masks[instr.rightOp])); break;
+				case eSimpleOp::BOOL_SELECT:
+					{
+						const VecMask condition = masks[instr.resultReg];
+						maskResult = Vec::maskOr(Vec::maskAnd(condition, masks[instr.leftOp]), Vec::maskAnd(Vec::maskNot(condition), masks[instr.rightOp]));
+					}
+					break;
+
+				case eSimpleOp::NAME_EQ:	maskResult = compareNames(instr, true, exprData, table, row); break;
+				case eSimpleOp::NAME_NEQ:	maskResult = compareNames(instr, false, exprData, table, row); break;
+
+				case eSimpleOp::NUM_EQ:		maskResult = Vec::cmpEq(LEFT_NUM, RIGHT_NUM); break;
+				case eSimpleOp::NUM_NEQ:	maskResult = Vec::cmpNeq(LEFT_NUM, RIGHT_NUM); break;
+				case eSimpleOp::NUM_LT:		maskResult = Vec::cmpLt(LEFT_NUM, RIGHT_NUM); break;
+				case eSimpleOp::NUM_LTEQ:	maskResult = Vec::cmpLtEq(LEFT_NUM, RIGHT_NUM); break;
+				case eSimpleOp::NUM_GT:		maskResult = Vec::cmpLt(RIGHT_NUM, LEFT_NUM); break;
+				case eSimpleOp::NUM_GTEQ:	maskResult = Vec::cmpLtEq(RIGHT_NUM, LEFT_NUM); break;
+
+				case eSimpleOp::NUM_IN_SET:		maskResult = numberInSet(LEFT_NUM, exprData->const_sets[instr.rightOp], exprData); break;
+				case eSimpleOp::NAME_IN_SET:	maskResult = nameInSet(instr, exprData, table, row); break;
+
+				case eSimpleOp::NUM_IN_RANGE_CC:
+				case eSimpleOp::NUM_IN_RANGE_CO:
+				case eSimpleOp::NUM_IN_RANGE_OC:
+				case eSimpleOp::NUM_IN_RANGE_OO:
+					maskResult = numberInRange(getSimpleOp(instr.opcode), LEFT_NUM, exprData->const_ranges[instr.rightOp], exprData, table, row);
+					break;
+
+				case eSimpleOp::BOOL_VAL:	maskResult = instr.leftOp > 0 ? Vec::maskAll() : Vec::maskNone(); break;
+
+				case eSimpleOp::JUMP_IF_FALSE:
+				case eSimpleOp::JUMP_IF_TRUE:
+					{
+						const VecMask condition = getSimpleOp(instr.opcode) == eSimpleOp::JUMP_IF_TRUE ?
+							masks[instr.leftOp] : Vec::maskNot(masks[instr.leftOp]);
+						const VecMask jumping = Vec::maskAnd(condition, active);
+						const VecMask staying = Vec::maskXor(active, jumping);
+						const uint32_t target = IP + 2 + instr.rightOp * 2;
+
+						if (Vec::maskBits(staying) == 0)
+						{
+							IP = target - 2;
+						}
+						else if (Vec::maskBits(jumping) != 0)
+						{
+							assert(pendingCount < EXPRESSION_SIMD_MAX_REGISTERS);
+							pending[pendingCount].target = target;
+							pending[pendingCount].activeBefore = active;
+							++pendingCount;
+							active = staying;
+						}
+					}
+					continue;
+
+				default:
+					assert(false);
+					continue;
+				}
+
+#undef LEFT_NUM
+#undef RIGHT_NUM
+
+				if (isBooleanResult(getSimpleOp(instr.opcode)))
+				{
+					masks[instr.resultReg] = maskResult;
+				}
+				else
+				{
+					reg[instr.resultReg] = result;
+				}
+			}
+
+			float resultLanes[Vec::width];
+			Vec::store(resultLanes, exprData->resultType == eExpType::BOOL ? Vec::maskToNumber(masks[0]) : reg[0]);
+			const uint32_t errorBits = Vec::maskBits(errorMask);
+
+			for (uint32_t lane = 0; lane < Vec::width; ++lane)
+			{
+				const bool failed = (errorBits >> lane & 1) != 0;
+				errors[block + lane] = failed ? 1 : 0;
+				results[block + lane] = failed ? 0.f : resultLanes[lane];
+			}
+		}
+	}
+
+} // namespace SIMD_NAMESPACE
+
+#undef SIMD_NAMESPACE
+#undef SIMD_VEC
@@ -0,0 +1,49 @@
+/*
+ * ExpressionSuperinstructions.inl
+ * Fused opcode sequences for the expression VM's compact switch dispatch.
+ *
+ * Generated by "Formulas superinstructions 32" from the opcode profile of the benchmark
+ * corpus - regenerate it rather than editing it. Before including this file define:
+ *
+ *   SUPERINSTRUCTION2(A, B)                    - A then B in one dispatch
+ *   SUPERINSTRUCTION3(A, B, C)                 - A, B then C in one dispatch
+ *
+ * Each line is commented with the dispatches it saved over the profile (20794 in total).
+ * Only the last opcode of a sequence is ever a jump. Both macros are undefined again at the end of this file.
+ */
+
+SUPERINSTRUCTION2(NUM_EQ_LV_RC, JUMP_IF_FALSE)	// 617
+SUPERINSTRUCTION2(NUM_NEQ_LV_RC, JUMP_IF_TRUE)	// 345
+SUPERINSTRUCTION2(DIV_LC_RV, NUM_NEQ_LC)	// 308
+SUPERINSTRUCTION2(DIV_LC_RV, NUM_NEQ_LV)	// 308
+SUPERINSTRUCTION2(NUM_EQ_LV_RC, JUMP_IF_TRUE)	// 308
+SUPERINSTRUCTION3(SUB_LV_RC, DIV_LC, NUM_LT_LC)	// 280
+SUPERINSTRUCTION2(MUL_LC_RV, NUM_LTEQ_LC)	// 231
+SUPERINSTRUCTION2(MUL_LC_RV, NUM_GTEQ_LC)	// 231
+SUPERINSTRUCTION2(DIV_LC_RV, NUM_GTEQ_LC)	// 231
+SUPERINSTRUCTION2(DIV_LC_RV, NUM_GTEQ_LV)	// 224
+SUPERINSTRUCTION2(NUM_LT_LV_RC, AND)	// 165
+SUPERINSTRUCTION2(NUM_GT_LV_RC, OR)	// 161
+SUPERINSTRUCTION2(ADD_LC_RV, NUM_LTEQ_LV)	// 154
+SUPERINSTRUCTION2(ADD_LC_RV, NUM_GTEQ_LV)	// 154
+SUPERINSTRUCTION2(MUL_LC_RV, NUM_LT_LC)	// 154
+SUPERINSTRUCTION2(MUL_LC_RV, NUM_LT_LV)	// 154
+SUPERINSTRUCTION2(MUL_LC_RV, NUM_GT_LC)	// 154
+SUPERINSTRUCTION2(DIV_LC_RV, NUM_LT_LC)	// 154
+SUPERINSTRUCTION2(DIV_LC_RV, NUM_LT_LV)	// 154
+SUPERINSTRUCTION2(DIV_LC_RV, NUM_LTEQ_LC)	// 154
+SUPERINSTRUCTION2(DIV_LC_RV, NUM_LTEQ_LV)	// 154
+SUPERINSTRUCTION2(NUM_EQ_LV_RC, NUM_LT_LV_RC)	// 154
+SUPERINSTRUCTION2(NUM_EQ_LV_RC, NUM_GT_LV_RC)	// 154
+SUPERINSTRUCTION2(NUM_NEQ_LV_RC, JUMP_IF_FALSE)	// 154
+SUPERINSTRUCTION3(ADD_LC, DIV_LV, NUM_LT_LC)	// 154
+SUPERINSTRUCTION3(ADD_LC_RV, MUL_LC, SUB_RC)	// 154
+SUPERINSTRUCTION3(ADD_LV_RV, MUL, MUL_LV)	// 154
+SUPERINSTRUCTION3(SUB_LV_RC, ADD, SUB_RC)	// 154
+SUPERINSTRUCTION3(SUB_LV_RV, NUM_LT_LC, JUMP_IF_FALSE)	// 154
+SUPERINSTRUCTION3(MUL, MUL_LV, SUB)	// 154
+SUPERINSTRUCTION3(MUL_LC_RV, SUB_LV_RC, ADD)	// 154
+SUPERINSTRUCTION3(MUL_LV_RV, ADD_LC, DIV_LV)	// 154
+
+#undef SUPERINSTRUCTION2
+#undef SUPERINSTRUCTION3
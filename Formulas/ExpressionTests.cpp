@@ -4,13 +4,83 @@
 
 #include "stdafx.h"
 
+#include <atomic>
+#include <cstdlib>
+#include <new>
 #include <sstream>
+#include <thread>
 #include <memory>
+#include <vector>
 
 #include "ExpressionTests.h"
 #include "TestRunner.h"
 
 #include "Expression.h"
+#include "ExpressionArchetype.h"
+#include "ExpressionBatch.h"
+#include "ExpressionBytecode.h"
+#include "ExpressionJIT.h"
+#include "ExpressionMemo.h"
+#include "ExpressionNetwork.h"
+#include "ExpressionPrecompiled.h"
+#include "ExpressionProfile.h"
+#include "ExpressionSIMD.h"
+#include "ExpressionTiering.h"
+#include "VariableTable.h"
+
+
+/*
+ * Allocation counting, so the tests can check that evaluation doesn't touch the heap
+ */
+
+// atomic because the tiering tests allocate on more than one thread
+static std::atomic<uint32_t> allocationCount(0);
+
+// VS2013 has no noexcept
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define TEST_NOEXCEPT throw()
+#else
+#define TEST_NOEXCEPT noexcept
+#endif
+
+static void* countedAllocate(size_t size)
+{
+	++allocationCount;
+	void* p = malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size)
+{
+	return countedAllocate(size);
+}
+
+void* operator new[](size_t size)
+{
+	return countedAllocate(size);
+}
+
+// every form of delete is replaced, so whichever one the compiler picks matches the new above
+void operator delete(void* p) TEST_NOEXCEPT
+{
+	free(p);
+}
+
+void operator delete[](void* p) TEST_NOEXCEPT
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) TEST_NOEXCEPT
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) TEST_NOEXCEPT
+{
+	free(p);
+}
 
 
 /*
@@ -22,16 +92,18 @@ class ExpressionTestBase : public TestFixture
 protected:
 	VariableLayout layout;
 
-	ExpressionData* compile(const char* expressionText, size_t line, const char* functionName, const char* fileName);
+	ExpressionData* compile(const char* expressionText, size_t line, const char* functionName, const char* fileName,
+		const ExpressionCompileOptions& options = ExpressionCompileOptions());
 	void trialCompile(const char* expressionText, size_t line, const char* functionName, const char* fileName);
 	void trialCompileExpectFail(const char* expressionText, size_t line, const char* functionName, const char* fileName, eErrorCode expectedErrorCode);
 	
 	virtual void setupFixture();
 };
 
-ExpressionData* ExpressionTestBase::compile(const char* expressionText, size_t line, const char* functionName, const char* fileName)
+ExpressionData* ExpressionTestBase::compile(const char* expressionText, size_t line, const char* functionName, const char* fileName,
+	const ExpressionCompileOptions& options)
 {
-	ExpressionCompiler comp(&layout);
+	ExpressionCompiler comp(&layout, options);
 	std::unique_ptr<ExpressionData> expData(comp.compile(expressionText));
 
 	if (comp.errors().errorCount() > 0) 
@@ -40,6 +112,11 @@ ExpressionData* ExpressionTestBase::compile(const char* expressionText, size_t l
 		msg << "Compile error - " << comp.errors().error(0).message;
 		genericFail(msg.str().c_str(), line, functionName, fileName);
 	}
+	else
+	{
+		// native code is optional, the Native dispatch modes fall back to the interpreter without it
+		ExpressionJIT::compile(expData.get());
+	}
 
 	return expData.release();
 }
@@ -70,6 +147,7 @@ void ExpressionTestBase::setupFixture()
 	layout.addVariable(Name("NumA"), eExpType::NUMBER);
 	layout.addVariable(Name("NumB"), eExpType::NUMBER);
 	layout.addVariable(Name("NumC"), eExpType::NUMBER);
+	layout.addVariable(Name("NumPos"), ValueRange(1.f, 100.f));
 
 	layout.addVariable(Name("NameC"), eExpType::NAME);
 	layout.addVariable(Name("NameC2"), eExpType::NAME);
@@ -84,10 +162,75 @@ void ExpressionTestBase::setupFixture()
 class CompileTests : public ExpressionTestBase
 {
 protected:
+	void checkRegisterCount(const char* expressionText, size_t line, const char* functionName, const char* fileName, ExpressionSlotIndex expectedCount);
+	void checkInstructionCount(const char* expressionText, size_t line, const char* functionName, const char* fileName, size_t expectedCount,
+		const ExpressionCompileOptions& options);
+	void checkUncheckedDivides(const char* expressionText, size_t line, const char* functionName, const char* fileName, size_t expectedCount);
+
 	virtual void test();
 };
 
+void CompileTests::checkRegisterCount(const char* expressionText, size_t line, const char* functionName, const char* fileName, ExpressionSlotIndex expectedCount)
+{
+	std::unique_ptr<ExpressionData> expData(compile(expressionText, line, functionName, fileName));
+	if (didFail()) return;
+
+	if (expData->regCount != expectedCount)
+	{
+		std::ostringstream msg;
+		msg << "Expected " << expectedCount << " registers, actual: " << expData->regCount;
+		genericFail(msg.str().c_str(), line, functionName, fileName);
+	}
+}
+
+void CompileTests::checkInstructionCount(const char* expressionText, size_t line, const char* functionName, const char* fileName, size_t expectedCount,
+	const ExpressionCompileOptions& options)
+{
+	ExpressionCompiler comp(&layout, options);
+	std::unique_ptr<ExpressionData> expData(comp.compile(expressionText));
+
+	if (comp.errors().errorCount() > 0)
+	{
+		std::ostringstream msg;
+		msg << "Compile error - " << comp.errors().error(0).message;
+		genericFail(msg.str().c_str(), line, functionName, fileName);
+	}
+	else if (expData->byteCode.size() / 2 != expectedCount)
+	{
+		std::ostringstream msg;
+		msg << "Expected " << expectedCount << " instructions, actual: " << expData->byteCode.size() / 2;
+		genericFail(msg.str().c_str(), line, functionName, fileName);
+	}
+}
+
+// counts the / and % instructions compiled without a divide by zero check
+void CompileTests::checkUncheckedDivides(const char* expressionText, size_t line, const char* functionName, const char* fileName, size_t expectedCount)
+{
+	std::unique_ptr<ExpressionData> expData(compile(expressionText, line, functionName, fileName));
+	if (didFail()) return;
+
+	size_t uncheckedCount(0);
+	for (size_t IP = 0; IP < expData->byteCode.size(); IP += 2)
+	{
+		const eSimpleOp op = getSimpleOp(decodeInstr(&expData->byteCode[IP]).opcode);
+		if (op == eSimpleOp::DIV_NZ || op == eSimpleOp::MOD_NZ)
+		{
+			++uncheckedCount;
+		}
+	}
+
+	if (uncheckedCount != expectedCount)
+	{
+		std::ostringstream msg;
+		msg << "Expected " << expectedCount << " unchecked divides, actual: " << uncheckedCount;
+		genericFail(msg.str().c_str(), line, functionName, fileName);
+	}
+}
+
 #define TEST_COMPILE(EXP) { compile(EXP, __LINE__, __FUNCTION__, __FILE__); if (didFail()) return; }
+#define TEST_REGISTER_COUNT(EXP,COUNT) { checkRegisterCount(EXP, __LINE__, __FUNCTION__, __FILE__, COUNT); if (didFail()) return; }
+#define TEST_INSTRUCTION_COUNT(EXP,COUNT,OPTIONS) { checkInstructionCount(EXP, __LINE__, __FUNCTION__, __FILE__, COUNT, OPTIONS); if (didFail()) return; }
+#define TEST_UNCHECKED_DIVIDES(EXP,COUNT) { checkUncheckedDivides(EXP, __LINE__, __FUNCTION__, __FILE__, COUNT); if (didFail()) return; }
 
 void CompileTests::test()
 {
@@ -107,6 +250,121 @@ void CompileTests::test()
 	TEST_COMPILE("4 == NumA && NumA<=NumB");
 	TEST_COMPILE("4 == NumA && NumA<=NumB/2");
 	TEST_COMPILE("NumA > 3 || NumB > 3 && NumA<0");
+	TEST_COMPILE("NumA > 0 ? NumB : NumC");
+	TEST_COMPILE("NumA > 0 ? 1 : NumB > 0 ? 2 : 3");
+	TEST_COMPILE("NumA in (1, 2, 3)");
+	TEST_COMPILE("NameC in ('C', 'D') && NumA in (5)");
+
+	// the heavier side is evaluated first, so right-leaning chains don't need a register per level
+	TEST_REGISTER_COUNT("NumA + NumB", 1);
+	TEST_REGISTER_COUNT("NumA + NumB * NumC", 1);
+	TEST_REGISTER_COUNT("NumA - (NumB - (NumC - (NumA / NumB)))", 1);
+	TEST_REGISTER_COUNT("(NumA + NumB) * (NumC + NumA)", 2);
+	TEST_REGISTER_COUNT("NumA * 2 + (NumB - (NumC + NumA) * (NumB + NumC))", 2);
+	TEST_REGISTER_COUNT("NumA < 1 && (NumB < 2 && (NumC < 3 && NumA < NumB))", 4);
+
+	// algebraic simplification
+	ExpressionCompileOptions unsimplified;
+	unsimplified.simplify = false;
+	ExpressionCompileOptions simplified;
+	ExpressionCompileOptions reciprocals;
+	reciprocals.inexactReciprocals = true;
+
+	TEST_INSTRUCTION_COUNT("NumA * 1 + 0", 2, unsimplified);
+	TEST_INSTRUCTION_COUNT("NumA * 1 + 0", 1, simplified);
+	TEST_INSTRUCTION_COUNT("((NumA + 1) + 2) - 3 + NumB", 4, unsimplified);
+	TEST_INSTRUCTION_COUNT("((NumA + 1) + 2) - 3 + NumB", 1, simplified);
+	TEST_INSTRUCTION_COUNT("(2 * NumA) * 3 < 4 - (NumB - 1)", 3, simplified);
+	TEST_INSTRUCTION_COUNT("-(-NumA) * NumB", 1, simplified);
+	TEST_INSTRUCTION_COUNT("!!(NumA > NumB)", 1, simplified);
+	TEST_INSTRUCTION_COUNT("0 * (NumPos - 1) + NumC", 1, simplified);
+	TEST_INSTRUCTION_COUNT("0 * (NumA + NumB) + NumC", 3, simplified);
+	TEST_INSTRUCTION_COUNT("0 * (NumA / NumB) + NumC", 3, simplified);
+	TEST_INSTRUCTION_COUNT("NumA / 4 / 2", 1, simplified);
+	TEST_INSTRUCTION_COUNT("NumA / 3 / 2", 2, simplified);
+	TEST_INSTRUCTION_COUNT("NumA / 3 / 2", 1, reciprocals);
+	TEST_INSTRUCTION_COUNT("1 < 2 ? NumA + NumB : NumC", 1, simplified);
+	TEST_INSTRUCTION_COUNT("NumA > NumB ? NumA : NumB", 2, simplified);
+	TEST_INSTRUCTION_COUNT("NumA > 0 ? 1 < 2 : NumB > 0", 4, simplified);
+	TEST_INSTRUCTION_COUNT("NameC == 'A' || NameC == 'B' || NameC == 'C'", 1, simplified);
+	TEST_INSTRUCTION_COUNT("NumA == 1 || 2 == NumA || NumA in (3, 4)", 1, simplified);
+	TEST_INSTRUCTION_COUNT("NumA > 4 || NumA == 1 || NumA == 2", 4, simplified);
+	TEST_INSTRUCTION_COUNT("NumA == 1 || NumB == 2", 4, simplified);
+
+	// interval fusion
+	ExpressionCompileOptions unfused;
+	unfused.fuseIntervals = false;
+	TEST_INSTRUCTION_COUNT("NumA >= 0 && NumA < 10", 4, unfused);
+	TEST_INSTRUCTION_COUNT("NumA >= 0 && NumA < 10", 1, simplified);
+	TEST_INSTRUCTION_COUNT("1 < NumA && NumA <= NumC", 1, simplified);
+	TEST_INSTRUCTION_COUNT("NumB > 0 && NumA > NumB && 10 >= NumA", 4, simplified);
+	TEST_INSTRUCTION_COUNT("NumA < 10 && NumA < 20", 4, simplified);
+	TEST_INSTRUCTION_COUNT("NumA > 0 && NumB < 10", 4, simplified);
+	TEST_INSTRUCTION_COUNT("NumA > 0 && NumA < NumB + 1", 5, simplified);
+
+	// common subexpressions
+	ExpressionCompileOptions unshared;
+	unshared.shareSubexpressions = false;
+
+	TEST_INSTRUCTION_COUNT("(NumA - NumB) > 10 && (NumA - NumB) < 50", 6, unshared);
+	TEST_INSTRUCTION_COUNT("(NumA - NumB) > 10 && (NumA - NumB) < 50", 5, simplified);
+	TEST_INSTRUCTION_COUNT("(NumA + NumB) * (NumB + NumA)", 3, unshared);
+	TEST_INSTRUCTION_COUNT("(NumA + NumB) * (NumB + NumA)", 2, simplified);
+	TEST_INSTRUCTION_COUNT("(NumA + NumB) * (NumA + NumB) + (NumB * NumC) * (NumB * NumC)", 5, simplified);
+	TEST_INSTRUCTION_COUNT("NumA - NumB > 0 == NumA - NumB > 0", 3, simplified);
+	TEST_INSTRUCTION_COUNT("NumB - NumA + (NumA - NumB)", 3, simplified);
+
+	// a value computed on the right of && or || can't be reused outside it
+	TEST_INSTRUCTION_COUNT("(NumA < 1 && NumB - NumC < 0) || NumB - NumC < 0", 9, simplified);
+	TEST_INSTRUCTION_COUNT("NumB - NumC < 0 && (NumB - NumC) * 2 < -5", 6, simplified);
+
+	// values that are dead by the time the next is computed share a register
+	TEST_REGISTER_COUNT("(NumA + NumB) * (NumA + NumB) + (NumB * NumC) * (NumB * NumC)", 3);
+
+	// divide by zero checks the range analysis can prove unnecessary
+	TEST_UNCHECKED_DIVIDES("NumA / NumB", 0);
+	TEST_UNCHECKED_DIVIDES("NumA / 3", 1);
+	TEST_UNCHECKED_DIVIDES("NumA % 3", 1);
+	TEST_UNCHECKED_DIVIDES("NumA / NumPos + NumB % (NumPos - 1)", 1);
+	TEST_UNCHECKED_DIVIDES("NumA / (NumPos * NumPos + 1) + NumA / (NumPos % 3 + 1)", 3);
+	TEST_UNCHECKED_DIVIDES("NumA / -NumPos", 1);
+	TEST_UNCHECKED_DIVIDES("NumA / (NumPos - 200)", 1);
+	TEST_UNCHECKED_DIVIDES("NumA / (NumPos - 50)", 0);
+	TEST_UNCHECKED_DIVIDES("NumA != 0 && NumB / NumA > 2", 1);
+	TEST_UNCHECKED_DIVIDES("0 != NumA && NumB / NumA > 2", 1);
+	TEST_UNCHECKED_DIVIDES("NumA == 0 || NumB % NumA > 2", 1);
+	TEST_UNCHECKED_DIVIDES("!(NumA <= 0) && NumB / NumA > 2", 1);
+	TEST_UNCHECKED_DIVIDES("NumA > 2 && NumC > 0 && NumB / (NumA - 1) > NumB / NumC", 2);
+	TEST_UNCHECKED_DIVIDES("NumA > -1 && NumB / NumA > 2", 0);
+	TEST_UNCHECKED_DIVIDES("NumA != 0 || NumB / NumA > 2", 0);
+	TEST_UNCHECKED_DIVIDES("(NumA != 0 || NumB > 0) && NumB / NumA > 2", 0);
+	TEST_UNCHECKED_DIVIDES("(NumA != 0 && NumB / NumA > 2) || NumC / NumA > 2", 1);
+	TEST_UNCHECKED_DIVIDES("NumB != 0 ? NumA / NumB : 0", 1);
+	TEST_UNCHECKED_DIVIDES("NumB == 0 ? 0 : NumA / NumB", 1);
+	TEST_UNCHECKED_DIVIDES("NumB != 0 ? 0 : NumA / NumB", 0);
+	TEST_UNCHECKED_DIVIDES("NumA in (1, 2) && NumB / NumA > 2", 1);
+	TEST_UNCHECKED_DIVIDES("NumA in (0, 2) && NumB / NumA > 2", 0);
+	TEST_UNCHECKED_DIVIDES("NumA in (0, 2) || NumB / NumA > 2", 1);
+	TEST_UNCHECKED_DIVIDES("NumA > 0 && NumA < 5 && NumB / NumA > 2", 1);
+	TEST_UNCHECKED_DIVIDES("NumA >= 0 && NumA < 5 && NumB / NumA > 2", 0);
+	TEST_UNCHECKED_DIVIDES("NumA >= -5 && NumA < 0 && NumB / NumA > 2", 1);
+
+	// constants folded to NaN have no range, and comparing with one tells nothing
+	TEST_COMPILE("(0 % 0) + NumA");
+	TEST_COMPILE("(3 % 0) == NumPos");
+	TEST_COMPILE("(100000000000000000000 * 100000000000000000000 - 100000000000000000000 * 100000000000000000000) * NumA");
+	TEST_UNCHECKED_DIVIDES("NumA == 0 % 0 && NumB / NumA > 2", 0);
+	TEST_UNCHECKED_DIVIDES("NumA > 0 % 0 || NumB / NumA > 2", 0);
+
+	// the range packs check writes against in debug builds
+	const ValueRange& posRange = layout.getRange(layout.getIndex(Name("NumPos")));
+	ENSURE(posRange.contains(1.f) && posRange.contains(100.f) && !posRange.contains(0.f) && !posRange.contains(posRange.maxValue * 2.f));
+	ENSURE(layout.getRange(layout.getIndex(Name("NumA"))).contains(0.f));
+
+	// and that packs start ranged slots in
+	VariablePack pack(&layout, Name(), 0.f);
+	ENSURE(pack.getVariableNumber(Name("NumPos")) == 1.f && pack.getVariableNumber(Name("NumA")) == 0.f);
+	ENSURE(posRange.clamp(500.f) == posRange.maxValue && posRange.clamp(50.f) == 50.f);
 }
 
 
@@ -114,6 +372,24 @@ void CompileTests::test()
  * Execution Tests
  */
 
+// every execution test is run through each dispatch loop of the evaluator
+static const eDispatchMode dispatchModes[] = { eDispatchMode::Switch, eDispatchMode::Threaded, eDispatchMode::Native, eDispatchMode::NativeVerify, eDispatchMode::Closure };
+
+static const char* getDispatchModeAsString(eDispatchMode mode)
+{
+	switch (mode)
+	{
+	case eDispatchMode::Switch:		return "switch";
+	case eDispatchMode::Threaded:	return "threaded";
+	case eDispatchMode::Native:		return "native";
+	case eDispatchMode::NativeVerify:	return "native-verify";
+	case eDispatchMode::Closure:	return "closure";
+
+	default:
+		return "!ERROR!";
+	}
+}
+
 class ExecutionTests : public ExpressionTestBase
 {
 	VariablePack *vars;
@@ -122,6 +398,10 @@ protected:
 	void executeNumber(const char* expressionText, size_t line, const char* functionName, const char* fileName, float expectedValue);
 	void executeBool(const char* expressionText, size_t line, const char* functionName, const char* fileName, bool expectedValue);
 	void executeExpectError(const char* expressionText, size_t line, const char* functionName, const char* fileName, eErrorCode expectedErrorCode);
+	void executeIeee(const char* expressionText, size_t line, const char* functionName, const char* fileName, float expectedValue, uint32_t expectedStatus);
+	void executeCompact(const char* expressionText, size_t line, const char* functionName, const char* fileName, bool expectCompact);
+	void executeSame(const char* expressionText, size_t line, const char* functionName, const char* fileName, const ExpressionCompileOptions& referenceOptions,
+		const VariablePack* pack = nullptr);
 
 	virtual void setupFixture();
 	virtual void test();
@@ -137,6 +417,7 @@ void ExecutionTests::setupFixture()
 	vars->setVariable(Name("NumA"), 5.f);
 	vars->setVariable(Name("NumB"), -3.f);
 	vars->setVariable(Name("NumC"), 2.f);
+	vars->setVariable(Name("NumPos"), 4.f);
 
 	vars->setVariable(Name("NameC"), Name("C"));
 	vars->setVariable(Name("NameC2"), Name("C"));
@@ -153,29 +434,32 @@ void ExecutionTests::executeNumber(const char* expressionText, size_t line, cons
 	std::unique_ptr<ExpressionData> expData(compile(expressionText, line, functionName, fileName));
 	if (didFail()) return;
 
-	ExpressionEvaluator eval(vars);
-	eval.evaluate(expData.get());
-
-	if (eval.errors().errorCount() > 0)
+	for (eDispatchMode mode : dispatchModes)
 	{
-		std::ostringstream msg;
-		msg << "Expression error - " << eval.errors().error(0).message;
-		genericFail(msg.str().c_str(), line, functionName, fileName);
-		return;
-	}
+		ExpressionEvaluator eval(vars, mode);
+		eval.evaluate(expData.get());
 
-	if (eval.getResultType() != eExpType::NUMBER)
-	{
-		genericFail("Expression result type not numeric", line, functionName, fileName);
-		return;
-	}
+		if (eval.errors().errorCount() > 0)
+		{
+			std::ostringstream msg;
+			msg << "Expression error - " << eval.errors().error(0).message;
+			genericFail(msg.str().c_str(), line, functionName, fileName);
+			return;
+		}
 
-	if (eval.getNumericResult() != expectedValue)
-	{
-		std::ostringstream msg;
-		msg << "Expected result: " << expectedValue << ", actual: " << eval.getNumericResult();
-		genericFail(msg.str().c_str(), line, functionName, fileName);
-		return;
+		if (eval.getResultType() != eExpType::NUMBER)
+		{
+			genericFail("Expression result type not numeric", line, functionName, fileName);
+			return;
+		}
+
+		if (eval.getNumericResult() != expectedValue)
+		{
+			std::ostringstream msg;
+			msg << "Expected result: " << expectedValue << ", actual: " << eval.getNumericResult() << " (" << getDispatchModeAsString(mode) << " dispatch)";
+			genericFail(msg.str().c_str(), line, functionName, fileName);
+			return;
+		}
 	}
 }
 
@@ -184,29 +468,32 @@ void ExecutionTests::executeBool(const char* expressionText, size_t line, const
 	std::unique_ptr<ExpressionData> expData(compile(expressionText, line, functionName, fileName));
 	if (didFail()) return;
 
-	ExpressionEvaluator eval(vars);
-	eval.evaluate(expData.get());
-
-	if (eval.errors().errorCount() > 0)
+	for (eDispatchMode mode : dispatchModes)
 	{
-		std::ostringstream msg;
-		msg << "Expression error - " << eval.errors().error(0).message;
-		genericFail(msg.str().c_str(), line, functionName, fileName);
-		return;
-	}
+		ExpressionEvaluator eval(vars, mode);
+		eval.evaluate(expData.get());
 
-	if (eval.getResultType() != eExpType::BOOL)
-	{
-		genericFail("Expression result type not numeric", line, functionName, fileName);
-		return;
-	}
+		if (eval.errors().errorCount() > 0)
+		{
+			std::ostringstream msg;
+			msg << "Expression error - " << eval.errors().error(0).message;
+			genericFail(msg.str().c_str(), line, functionName, fileName);
+			return;
+		}
 
-	if (eval.getBoolResult() != expectedValue)
-	{
-		std::ostringstream msg;
-		msg << "Expected result: " << expectedValue << ", actual: " << eval.getBoolResult();
-		genericFail(msg.str().c_str(), line, functionName, fileName);
-		return;
+		if (eval.getResultType() != eExpType::BOOL)
+		{
+			genericFail("Expression result type not numeric", line, functionName, fileName);
+			return;
+		}
+
+		if (eval.getBoolResult() != expectedValue)
+		{
+			std::ostringstream msg;
+			msg << "Expected result: " << expectedValue << ", actual: " << eval.getBoolResult() << " (" << getDispatchModeAsString(mode) << " dispatch)";
+			genericFail(msg.str().c_str(), line, functionName, fileName);
+			return;
+		}
 	}
 }
 
@@ -228,19 +515,161 @@ void ExecutionTests::executeExpectError(const char* expressionText, size_t line,
 		}
 	}
 
-	ExpressionEvaluator eval(vars);
-	eval.evaluate(expData.get());
+	ExpressionJIT::compile(expData.get());
 
-	if (eval.errors().errorCount() > 0)
+	for (eDispatchMode mode : dispatchModes)
 	{
-		if (eval.errors().error(0).code != expectedErrorCode)
+		ExpressionEvaluator eval(vars, mode);
+		eval.evaluate(expData.get());
+
+		if (eval.errors().errorCount() > 0)
 		{
-			genericFail("Compile expected one error but got another", line, functionName, fileName);
+			if (eval.errors().error(0).code != expectedErrorCode)
+			{
+				genericFail("Compile expected one error but got another", line, functionName, fileName);
+				return;
+			}
+		}
+		else
+		{
+			genericFail("Compile expected one error but got none", line, functionName, fileName);	
+			return;
 		}
 	}
-	else
+}
+
+// compiles with ieeeDivide, so the expression mustn't fail - booleans are expected as 1.f/0.f and a NaN matches a NaN
+void ExecutionTests::executeIeee(const char* expressionText, size_t line, const char* functionName, const char* fileName, float expectedValue, uint32_t expectedStatus)
+{
+	ExpressionCompileOptions options;
+	options.ieeeDivide = true;
+
+	std::unique_ptr<ExpressionData> expData(compile(expressionText, line, functionName, fileName, options));
+	if (didFail()) return;
+
+	for (eDispatchMode mode : dispatchModes)
+	{
+		ExpressionEvaluator eval(vars, mode);
+		eval.evaluate(expData.get());
+
+		if (eval.errors().errorCount() > 0)
+		{
+			std::ostringstream msg;
+			msg << "Expression error - " << eval.errors().error(0).message << " (" << getDispatchModeAsString(mode) << " dispatch)";
+			genericFail(msg.str().c_str(), line, functionName, fileName);
+			return;
+		}
+
+		const float value = eval.getResultType() == eExpType::BOOL ? (eval.getBoolResult() ? 1.f : 0.f) : eval.getNumericResult();
+		if (!(value == expectedValue || (value != value && expectedValue != expectedValue)) || eval.getStatus() != expectedStatus)
+		{
+			std::ostringstream msg;
+			msg << "Expected result: " << expectedValue << " status " << expectedStatus << ", actual: " << value << " status " << eval.getStatus() <<
+				" (" << getDispatchModeAsString(mode) << " dispatch)";
+			genericFail(msg.str().c_str(), line, functionName, fileName);
+			return;
+		}
+	}
+}
+
+
+void ExecutionTests::executeCompact(const char* expressionText, size_t line, const char* functionName, const char* fileName, bool expectCompact)
+{
+	ExpressionCompileOptions wideOptions;
+	wideOptions.compactCode = false;
+
+	std::unique_ptr<ExpressionData> compactData(compile(expressionText, line, functionName, fileName));
+	if (didFail()) return;
+	std::unique_ptr<ExpressionData> wideData(compile(expressionText, line, functionName, fileName, wideOptions));
+	if (didFail()) return;
+
+	ExpressionCompileOptions unfusedOptions;
+	unfusedOptions.superinstructions = false;
+
+	std::unique_ptr<ExpressionData> unfusedData(compile(expressionText, line, functionName, fileName, unfusedOptions));
+	if (didFail()) return;
+
+	if (!wideData->compactCode.empty())
+	{
+		genericFail("Compact code generated when disabled", line, functionName, fileName);
+		return;
+	}
+
+	const size_t expectedWords = expectCompact ? compactData->byteCode.size() / 2 : 0;
+	if (compactData->compactCode.size() != expectedWords)
+	{
+		std::ostringstream msg;
+		msg << "Expected " << expectedWords << " compact words, actual: " << compactData->compactCode.size();
+		genericFail(msg.str().c_str(), line, functionName, fileName);
+		return;
+	}
+
+	// superinstructions only ever cut the dispatches
+	if (getCompactDispatchCount(*unfusedData) != unfusedData->compactCode.size() ||
+		getCompactDispatchCount(*compactData) > compactData->compactCode.size())
+	{
+		genericFail("Unexpected compact dispatch count", line, functionName, fileName);
+		return;
+	}
+
+	ExpressionEvaluator wideEval(vars, eDispatchMode::Switch);
+	wideEval.evaluate(wideData.get());
+	const float wideValue = wideEval.getResultType() == eExpType::BOOL ? (wideEval.getBoolResult() ? 1.f : 0.f) : wideEval.getNumericResult();
+
+	for (const ExpressionData* expData : { compactData.get(), unfusedData.get() })
+	{
+		ExpressionEvaluator eval(vars, eDispatchMode::Switch);
+		eval.evaluate(expData);
+
+		const float value = eval.getResultType() == eExpType::BOOL ? (eval.getBoolResult() ? 1.f : 0.f) : eval.getNumericResult();
+		if (value != wideValue || eval.errors().errorCount() != wideEval.errors().errorCount())
+		{
+			std::ostringstream msg;
+			msg << "Compact result: " << value << ", wide result: " << wideValue << (expData == compactData.get() ? " (superinstructions)" : "");
+			genericFail(msg.str().c_str(), line, functionName, fileName);
+			return;
+		}
+	}
+}
+
+
+void ExecutionTests::executeSame(const char* expressionText, size_t line, const char* functionName, const char* fileName, const ExpressionCompileOptions& referenceOptions,
+	const VariablePack* pack)
+{
+	if (!pack)
+	{
+		pack = vars;
+	}
+
+	// the reference leaves a pass out, and the default compile has to give the same value or error
+	std::unique_ptr<ExpressionData> referenceData(compile(expressionText, line, functionName, fileName, referenceOptions));
+	if (didFail()) return;
+	std::unique_ptr<ExpressionData> expData(compile(expressionText, line, functionName, fileName));
+	if (didFail()) return;
+
+	ExpressionEvaluator referenceEval(pack, eDispatchMode::Switch);
+	referenceEval.evaluate(referenceData.get());
+	const bool referenceFailed = referenceEval.errors().errorCount() > 0;
+	const float referenceValue = referenceFailed ? 0.f :
+		(referenceEval.getResultType() == eExpType::BOOL ? (referenceEval.getBoolResult() ? 1.f : 0.f) : referenceEval.getNumericResult());
+
+	for (eDispatchMode mode : dispatchModes)
 	{
-		genericFail("Compile expected one error but got none", line, functionName, fileName);	
+		ExpressionEvaluator eval(pack, mode);
+		eval.evaluate(expData.get());
+
+		const bool failed = eval.errors().errorCount() > 0;
+		const float value = failed ? 0.f : (eval.getResultType() == eExpType::BOOL ? (eval.getBoolResult() ? 1.f : 0.f) : eval.getNumericResult());
+
+		if (failed != referenceFailed || (failed && eval.errors().error(0).code != referenceEval.errors().error(0).code) ||
+			!(value == referenceValue || (value != value && referenceValue != referenceValue)))
+		{
+			std::ostringstream msg;
+			msg << "Expected result: " << referenceValue << (referenceFailed ? " (error)" : "") << ", actual: " << value <<
+				(failed ? " (error)" : "") << " (" << getDispatchModeAsString(mode) << " dispatch)";
+			genericFail(msg.str().c_str(), line, functionName, fileName);
+			return;
+		}
 	}
 }
 
@@ -248,6 +677,10 @@ void ExecutionTests::executeExpectError(const char* expressionText, size_t line,
 #define TEST_EXPRESSION_NUM(EXP,VALUE) { executeNumber(EXP, __LINE__, __FUNCTION__, __FILE__, VALUE); if (didFail()) return; }
 #define TEST_EXPRESSION_BOOL(EXP,VALUE) { executeBool(EXP, __LINE__, __FUNCTION__, __FILE__, VALUE); if (didFail()) return; }
 #define TEST_EXPRESSION_FAILS(EXP,ERRORCODE) { executeExpectError(EXP, __LINE__, __FUNCTION__, __FILE__, ERRORCODE); if (didFail()) return; }
+#define TEST_EXPRESSION_IEEE(EXP,VALUE,STATUS) { executeIeee(EXP, __LINE__, __FUNCTION__, __FILE__, VALUE, STATUS); if (didFail()) return; }
+#define TEST_EXPRESSION_COMPACT(EXP,COMPACT) { executeCompact(EXP, __LINE__, __FUNCTION__, __FILE__, COMPACT); if (didFail()) return; }
+#define TEST_EXPRESSION_SAME(EXP,OPTIONS) { executeSame(EXP, __LINE__, __FUNCTION__, __FILE__, OPTIONS); if (didFail()) return; }
+#define TEST_EXPRESSION_SAME_ON(EXP,OPTIONS,PACK) { executeSame(EXP, __LINE__, __FUNCTION__, __FILE__, OPTIONS, PACK); if (didFail()) return; }
 
 void ExecutionTests::test()
 {
@@ -292,6 +725,10 @@ void ExecutionTests::test()
 	TEST_EXPRESSION_NUM("12 % -5", 2);
 	TEST_EXPRESSION_NUM("-12%-5", -2);
 
+	TEST_EXPRESSION_NUM("NumA - (NumB - (NumC - (NumA / NumC)))", 7.5);
+	TEST_EXPRESSION_NUM("NumA * 2 + (NumB - (NumC + NumA) * (NumB + NumC))", 14);
+	TEST_EXPRESSION_NUM("10 / (NumA - (NumB * NumC)) - (NumC - NumA) / (NumB - NumC)", 10.f / 11.f - 0.6f);
+
 
 	// Numeric comparison
 
@@ -423,6 +860,17 @@ void ExecutionTests::test()
 	TEST_EXPRESSION_BOOL("(NumA == 5) != (NumB < 0)", false);
 	TEST_EXPRESSION_BOOL("(NumA == 5) == (NumB > 0)", false);
 	TEST_EXPRESSION_BOOL("(NumA == 5) != (NumB > 0)", true);
+
+	// with a constant side, folded to the other side or its negation
+	TEST_EXPRESSION_BOOL("(1 == 1) != (NumA > NumC)", false);
+	TEST_EXPRESSION_BOOL("(NumA > NumC) == (2 > 1)", true);
+	TEST_EXPRESSION_BOOL("(1 > 2) == (NumB > 0)", true);
+	TEST_EXPRESSION_BOOL("(NumB > 0) != (1 > 2)", false);
+
+	// booleans and numbers kept in separate register banks under the same register numbers
+	TEST_EXPRESSION_BOOL("(NumA + NumB > NumC) == !(NumA * NumB < NumC - 1)", true);
+	TEST_EXPRESSION_BOOL("!(NumA > NumC) != !(NameC == 'C')", false);
+	TEST_EXPRESSION_BOOL("!(NumA > NumC || NumB > NumC) || NumA * NumB < 0", true);
 	
 	
 	// Logical operators
@@ -461,6 +909,132 @@ void ExecutionTests::test()
 	TEST_EXPRESSION_BOOL("NumA!=5 || NumB<0", true);
 	TEST_EXPRESSION_BOOL("NumA!=5 || NumB>0", false);
 
+	// Short-circuit evaluation and mixed nesting
+
+	TEST_EXPRESSION_BOOL("NumA!=5 && 10/(NumA-5) > 1", false);
+	TEST_EXPRESSION_BOOL("NumA==5 || 10/(NumA-5) > 1", true);
+	TEST_EXPRESSION_BOOL("NumA==5 && (NumB<0 || NumA/(NumB+3) > 0)", true);
+	TEST_EXPRESSION_BOOL("(NumA==5 && NumB>0) || (NumC==2 && NumB<0)", true);
+	TEST_EXPRESSION_BOOL("(NumA!=5 || NumB>0) && NumC==2", false);
+	TEST_EXPRESSION_BOOL("(NumA==5 || NumB>0) && (NumC!=2 || NumB<0)", true);
+	TEST_EXPRESSION_BOOL("((NumA==5 && NumB<0) && NumC==2) && NumB!=0", true);
+	TEST_EXPRESSION_BOOL("NumA==5 && (NumB>0 || (NumC==2 && NumA>NumC))", true);
+	TEST_EXPRESSION_BOOL("!(NumA==5 && NumB<0) || (NumC==2) != (NumA>NumC && NumB>0)", true);
+	TEST_EXPRESSION_BOOL("NumA!=5 || NumB>0 || NumC!=2 || NumA<NumC", false);
+
+	// Algebraic simplification
+
+	TEST_EXPRESSION_NUM("NumA*1", 5);
+	TEST_EXPRESSION_NUM("NumA*1+0", 5);
+	TEST_EXPRESSION_NUM("0+NumB*1", -3);
+	TEST_EXPRESSION_NUM("-(-NumA)", 5);
+	TEST_EXPRESSION_NUM("(1 + NumA) + 2", 8);
+	TEST_EXPRESSION_NUM("5 - (NumA - 1)", 1);
+	TEST_EXPRESSION_NUM("(10 - NumA) - 2", 3);
+	TEST_EXPRESSION_NUM("2 - (3 - (4 - (NumB + 1)))", 5);
+	TEST_EXPRESSION_NUM("(2 * NumA) * 3", 30);
+	TEST_EXPRESSION_NUM("NumA / 4", 1.25);
+	TEST_EXPRESSION_NUM("NumA / 0.5 / 2", 5);
+	TEST_EXPRESSION_NUM("NumA / 3", 5.f / 3.f);
+	TEST_EXPRESSION_NUM("0 * (NumB + NumC) + NumA", 5);
+	TEST_EXPRESSION_BOOL("!!(NumA > 2)", true);
+	TEST_EXPRESSION_BOOL("!!!(NumA > 2)", false);
+	TEST_EXPRESSION_BOOL("NumA * 1 == NumA + 0", true);
+
+	// Common subexpressions
+
+	TEST_EXPRESSION_BOOL("(NumA - NumB) > 5 && (NumA - NumB) < 50", true);
+	TEST_EXPRESSION_BOOL("(NumA - NumB) > 10 && (NumA - NumB) < 50", false);
+	TEST_EXPRESSION_NUM("(NumA + NumB) * (NumB + NumA)", 4);
+	TEST_EXPRESSION_NUM("(NumA + NumB) * (NumA + NumB) + (NumB * NumC) * (NumB * NumC)", 40);
+	TEST_EXPRESSION_NUM("NumB - NumA + (NumA - NumB)", 0);
+	TEST_EXPRESSION_NUM("(NumA * NumC - NumB) / (NumC + (NumA * NumC - NumB) * NumC)", 13.f / 28.f);
+	TEST_EXPRESSION_BOOL("NumA - NumB > 0 == NumA - NumB > 0", true);
+	TEST_EXPRESSION_BOOL("(NumA < 1 && NumB - NumC < 0) || NumB - NumC < 0", true);
+	TEST_EXPRESSION_BOOL("(NumA > 1 && NumB - NumC < 0) || NumB - NumC > 0", true);
+	TEST_EXPRESSION_BOOL("NumB - NumC < 0 && (NumB - NumC) * 2 < -5", true);
+	TEST_EXPRESSION_BOOL("NumA > NumC && (NumA > NumC || NumB > 0)", true);
+	TEST_EXPRESSION_BOOL("(NumA > NumC || NumB > 0) && !(NumA > NumC)", false);
+
+	ExpressionCompileOptions unshared;
+	unshared.shareSubexpressions = false;
+
+	// the || takes its shared result register before the && inside it reads NameC == NameC2 for the last time
+	TEST_EXPRESSION_SAME("(NameC == NameC2) && (((NumPos < 0) || ((NumPos == 4) && (NameC == NameC2))) == ((NumPos < 0) || ((NumPos == 4) && (NameC == NameC2))))", unshared);
+	TEST_EXPRESSION_SAME("(NumA - NumB > 0) || ((NumA - NumB > 0) && NumC > 0) || ((NumA - NumB > 0) && NumC > 0)", unshared);
+
+	// Divides without a divide by zero check
+
+	TEST_EXPRESSION_NUM("NumA / NumPos", 1.25);
+	TEST_EXPRESSION_NUM("NumA % (NumPos - 1)", 2);
+	TEST_EXPRESSION_NUM("NumB / -NumPos", 0.75);
+	TEST_EXPRESSION_BOOL("NumA != 0 && NumC / NumA > 2", false);
+	TEST_EXPRESSION_BOOL("NumB >= 0 || NumA / NumB < -1", true);
+	TEST_EXPRESSION_BOOL("NumA > 2 && NumC > 0 && NumB / (NumA - 1) > NumB / NumC", true);
+
+	// Selection
+
+	TEST_EXPRESSION_NUM("NumA > 0 ? NumB : NumC", -3);
+	TEST_EXPRESSION_NUM("NumA < 0 ? NumB : NumC", 2);
+	TEST_EXPRESSION_NUM("NumA < 0 ? 1 : 2", 2);
+	TEST_EXPRESSION_NUM("NumA > 0 ? 1 : NumC", 1);
+	TEST_EXPRESSION_NUM("NumA < 0 ? NumB : 7", 7);
+	TEST_EXPRESSION_NUM("NumA > 0 ? NumA * 2 : NumB - 1", 10);
+	TEST_EXPRESSION_NUM("NumA < 0 ? NumA * 2 : NumB - 1", -4);
+	TEST_EXPRESSION_NUM("NumA > NumB ? NumA : NumB", 5);
+	TEST_EXPRESSION_NUM("1 < 2 ? NumA + NumB : NumC", 2);
+	TEST_EXPRESSION_NUM("NumA > 0 ? 1 : NumB > 0 ? 2 : 3", 1);
+	TEST_EXPRESSION_NUM("NumA < 0 ? 1 : NumB > 0 ? 2 : 3", 3);
+	TEST_EXPRESSION_NUM("(NumA < 0 ? NumB : NumC) * (NumB < 0 ? NumA : NumC) + 1", 11);
+	TEST_EXPRESSION_NUM("(NumA - NumB) > 0 ? (NumA - NumB) : 0", 8);
+	TEST_EXPRESSION_NUM("NumB + 3 != 0 ? NumA / (NumB + 3) : 0", 0);
+	TEST_EXPRESSION_NUM("NumC != 0 ? NumA / NumC : 0", 2.5);
+	TEST_EXPRESSION_NUM("NumA > 0 ? NumB > 0 ? NumA : NumB : NumC", -3);
+	TEST_EXPRESSION_BOOL("NumA > 0 ? NumB > 0 : NumC > 0", false);
+	TEST_EXPRESSION_BOOL("NumA < 0 ? NumB > 0 : NumC > 0", true);
+	TEST_EXPRESSION_BOOL("NumA > 0 ? 1 < 2 : NumB > 0", true);
+	TEST_EXPRESSION_BOOL("NumA < 0 ? 2 < 1 : NameC == 'C'", true);
+	TEST_EXPRESSION_BOOL("NumB > 0 || (NumA > 0 ? NumC > 1 : NumC < 1)", true);
+	TEST_EXPRESSION_BOOL("(NumA > 0 ? NumB : NumC) < 0 && NumC > 0", true);
+
+	// Set membership
+
+	TEST_EXPRESSION_BOOL("NumA in (1, 5, 9)", true);
+	TEST_EXPRESSION_BOOL("NumA in (1, 4, 9)", false);
+	TEST_EXPRESSION_BOOL("NumA in (5)", true);
+	TEST_EXPRESSION_BOOL("NumB in (3, -3)", true);
+	TEST_EXPRESSION_BOOL("NumA + NumB in (2, 4)", true);
+	TEST_EXPRESSION_BOOL("NumA in (10/2, 7)", true);
+	TEST_EXPRESSION_BOOL("NumA in (9, 1, 5, 1)", true);
+	TEST_EXPRESSION_BOOL("NumA in (12, 11, 10, 9, 8, 7, 6, 5, 4, 3)", true);
+	TEST_EXPRESSION_BOOL("NumA in (12, 11, 10, 9, 8, 7, 6, 4, 3, 2)", false);
+	TEST_EXPRESSION_BOOL("3 in (1, 2, 3)", true);
+	TEST_EXPRESSION_BOOL("NameC in ('A', 'B', 'C')", true);
+	TEST_EXPRESSION_BOOL("NameC in ('A', 'B')", false);
+	TEST_EXPRESSION_BOOL("NameD in ('A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J')", true);
+	TEST_EXPRESSION_BOOL("NameC in ('A', 'B', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K')", false);
+	TEST_EXPRESSION_BOOL("NameC == 'A' || NameC == 'B' || NameC == 'C'", true);
+	TEST_EXPRESSION_BOOL("NumA == 1 || NumA == 2 || NumA == 3", false);
+	TEST_EXPRESSION_BOOL("NumB > 0 || NumA == 4 || NumA == 5", true);
+	TEST_EXPRESSION_BOOL("!(NumA in (1, 2)) && NameD in ('D')", true);
+	TEST_EXPRESSION_BOOL("NumA in (1, 2) || NumC in (2, 3)", true);
+
+	// Intervals
+
+	TEST_EXPRESSION_BOOL("NumA >= 5 && NumA <= 10", true);
+	TEST_EXPRESSION_BOOL("NumA > 5 && NumA <= 10", false);
+	TEST_EXPRESSION_BOOL("NumA >= 0 && NumA < 5", false);
+	TEST_EXPRESSION_BOOL("NumA > 0 && NumA < 6", true);
+	TEST_EXPRESSION_BOOL("5 <= NumA && 5 >= NumA", true);
+	TEST_EXPRESSION_BOOL("NumA < 10 && NumA > 4.5", true);
+	TEST_EXPRESSION_BOOL("NumB < NumA && NumA < NumC", false);
+	TEST_EXPRESSION_BOOL("NumC < NumA && NumA <= 5", true);
+	TEST_EXPRESSION_BOOL("NumA > 10 && NumA < 0", false);
+	TEST_EXPRESSION_BOOL("NumB > -4 && NumB < -2 && NumA >= 5 && NumA < 6", true);
+	TEST_EXPRESSION_BOOL("NumC > 0 && NumA >= 0 && NumA < 5", false);
+	TEST_EXPRESSION_BOOL("!(NumA >= 0 && NumA < 5) || NameC == 'D'", true);
+	TEST_EXPRESSION_BOOL("NumA > 0 && NumA < 10 ? NumB < 0 : NumB > 0", true);
+
 
 	// Tests error reporting
 
@@ -469,9 +1043,1399 @@ void ExecutionTests::test()
 
 	TEST_EXPRESSION_FAILS("5/0", eErrorCode::DivideByZero);
 	TEST_EXPRESSION_FAILS("NumA/(NumA-5)", eErrorCode::DivideByZero);
+	TEST_EXPRESSION_FAILS("NumA==5 && 10/(NumA-5) > 1", eErrorCode::DivideByZero);
+	TEST_EXPRESSION_FAILS("NumA==5 && (NumB>0 || (NumC==2 && NumA/(NumB+3) > 0))", eErrorCode::DivideByZero);
+
+	// multiplying by zero mustn't hide a divide by zero
+	TEST_EXPRESSION_FAILS("0 * (NumA / (NumA - 5))", eErrorCode::DivideByZero);
+	TEST_EXPRESSION_FAILS("(NumA % (NumB + 3)) * 0 + NumA", eErrorCode::DivideByZero);
+	TEST_EXPRESSION_FAILS("NumA / (NumB + 3) > 0 || NumA / (NumB + 3) < 0", eErrorCode::DivideByZero);
+	TEST_EXPRESSION_FAILS("NumA / (NumPos - 4)", eErrorCode::DivideByZero);
+	TEST_EXPRESSION_FAILS("NumB != 0 && NumA / (NumB + 3) > 0", eErrorCode::DivideByZero);
+	TEST_EXPRESSION_FAILS("NumB < 0 ? NumA / (NumB + 3) : 0", eErrorCode::DivideByZero);
+
+	// nor can it turn a divisor into a constant 0
+	ExpressionCompileOptions unsimplified;
+	unsimplified.simplify = false;
+
+	TEST_EXPRESSION_SAME("1 % (NumB * 0)", unsimplified);
+	TEST_EXPRESSION_SAME("(0.5 % (0 * NumB)) <= 4", unsimplified);
+	TEST_EXPRESSION_SAME("1 / (NumB * 0)", unsimplified);
+	TEST_EXPRESSION_SAME("NumA / ((NumB * 0) * 5 + 0)", unsimplified);
+	TEST_EXPRESSION_SAME("NumA % (0 * NumB - 0 * NumC)", unsimplified);
+	TEST_EXPRESSION_SAME("NumA / (NumB * 0 + 1)", unsimplified);
+	TEST_EXPRESSION_SAME("(NumPos * 0) % 0", unsimplified);
+	TEST_EXPRESSION_SAME("(0 * NumPos + 0) / 0", unsimplified);
+
+	// and x * 0 is NaN for an x that can be inf or NaN
+	VariablePack infinite(*vars);
+	infinite.setVariable(Name("NumA"), std::numeric_limits<float>::infinity());
+
+	TEST_EXPRESSION_SAME_ON("0 * NumA", unsimplified, &infinite);
+	TEST_EXPRESSION_SAME_ON("NumA * 0 + NumB", unsimplified, &infinite);
+	TEST_EXPRESSION_SAME_ON("(NumA * 0) % 0", unsimplified, &infinite);
+	TEST_EXPRESSION_SAME_ON("(NumA * 0) / 0", unsimplified, &infinite);
+	TEST_EXPRESSION_SAME_ON("0 * (NumA - NumA) + NumC", unsimplified, &infinite);
+	TEST_EXPRESSION_SAME_ON("0 * (NumPos - 1) + NumA", unsimplified, &infinite);
+	TEST_EXPRESSION_FAILS("NumA ? 1 : 2", eErrorCode::LogicTypeError);
+	TEST_EXPRESSION_FAILS("NumA > 0 ? 1 : NumB > 0", eErrorCode::SelectTypeError);
+	TEST_EXPRESSION_FAILS("NumA > 0 ? NameC : NameD", eErrorCode::SelectTypeError);
+	TEST_EXPRESSION_FAILS("NumA in (NumB)", eErrorCode::SetMemberNotConstant);
+	TEST_EXPRESSION_FAILS("NumA in (1, 'C')", eErrorCode::ComparisonTypeError);
+	TEST_EXPRESSION_FAILS("NameC in (1, 2)", eErrorCode::ComparisonTypeError);
+	TEST_EXPRESSION_FAILS("NumA > 0 in (1 < 2)", eErrorCode::ComparisonTypeError);
+	TEST_EXPRESSION_FAILS("NumA in (1, 1/0)", eErrorCode::DivideByZero);
+
+
+	// IEEE division - a zero divisor gives inf or NaN and a status bit instead of an error
+
+	const float infinity = std::numeric_limits<float>::infinity();
+	const float nan = std::numeric_limits<float>::quiet_NaN();
+
+	TEST_EXPRESSION_IEEE("NumA / NumC", 2.5, 0);
+	TEST_EXPRESSION_IEEE("NumA / (NumB + 3)", infinity, EXP_STATUS_DIVIDE_BY_ZERO | EXP_STATUS_NOT_FINITE);
+	TEST_EXPRESSION_IEEE("NumB / (NumB + 3)", -infinity, EXP_STATUS_DIVIDE_BY_ZERO | EXP_STATUS_NOT_FINITE);
+	TEST_EXPRESSION_IEEE("(NumB + 3) / (NumB + 3)", nan, EXP_STATUS_DIVIDE_BY_ZERO | EXP_STATUS_NOT_FINITE);
+	TEST_EXPRESSION_IEEE("NumA % (NumB + 3)", nan, EXP_STATUS_DIVIDE_BY_ZERO | EXP_STATUS_NOT_FINITE);
+	TEST_EXPRESSION_IEEE("NumA / (NumB + 3) > 1", 1, EXP_STATUS_DIVIDE_BY_ZERO);
+	TEST_EXPRESSION_IEEE("NumA / (NumB + 3) * 0 + NumA", nan, EXP_STATUS_DIVIDE_BY_ZERO | EXP_STATUS_NOT_FINITE);
+	TEST_EXPRESSION_IEEE("NumB + 3 == 0 || NumA / (NumB + 3) > 1", 1, 0);
+	TEST_EXPRESSION_IEEE("NumB + 3 != 0 ? NumA / (NumB + 3) : 0", 0, 0);
+	TEST_EXPRESSION_IEEE("NumB < 0 ? NumA / (NumB + 3) : 0", infinity, EXP_STATUS_DIVIDE_BY_ZERO | EXP_STATUS_NOT_FINITE);
+	TEST_EXPRESSION_IEEE("NumA / NumPos", 1.25, 0);
+	TEST_EXPRESSION_IEEE("NumA * 100000000000000000000000000000000000000", infinity, EXP_STATUS_NOT_FINITE);
+
+	// Compact encoding
+	TEST_EXPRESSION_COMPACT("NumA + NumB * NumC", true);
+	TEST_EXPRESSION_COMPACT("NumA > 3 && (NameC == 'C' || NumB / NumC < 0)", true);
+	TEST_EXPRESSION_COMPACT("NumA / (NumB + 3)", true);
+	TEST_EXPRESSION_COMPACT("NumA > NumB ? NumA * 2 : NumB > 0 ? 1 : NumC", true);
+	TEST_EXPRESSION_COMPACT("NumA + 1 in (2, 6) && NameC in ('C', 'D')", true);
+	TEST_EXPRESSION_COMPACT("NumA >= 0 && NumA < NumC * 4 && NumB > -5 && NumB <= NumC", true);
+	{
+		// Too many constants and too long a jump for 8-bit fields
+		std::string longExpression = "NumA > 100 || ";
+		for (int term = 1; term < 300; ++term)
+		{
+			std::ostringstream termText;
+			termText << (term > 1 ? " + " : "") << "NumB * " << term << ".5";
+			longExpression += termText.str();
+		}
+		longExpression += " > 0";
+		TEST_EXPRESSION_COMPACT(longExpression.c_str(), false);
+	}
+	TEST_EXPRESSION_COMPACT("NumA == 5 && NumB < 0", true);
+	TEST_EXPRESSION_COMPACT("NumA != 5 || 10 / NumC >= 5", true);
+	TEST_EXPRESSION_COMPACT("NumA - 1 > 3 && NumA / NumC < 3", true);
+
+	// Opcode profile - pairs that run back to back, but none starting with a jump
+	{
+		std::unique_ptr<ExpressionData> expData(compile("NumA == 5 && NumB < 0", __LINE__, __FUNCTION__, __FILE__));
+		if (didFail()) return;
+
+		ExpressionOpcodeProfile profile;
+		ExpressionEvaluator eval(vars);
+		eval.setProfile(&profile);
+		eval.evaluate(expData.get());
+		eval.evaluate(expData.get());
+		ENSURE(eval.getBoolResult());
+
+		const std::vector<ExpressionOpcodeProfile::Sequence> sequences = profile.getTopSequences(8);
+		ENSURE(profile.getDispatchCount() == expData->byteCode.size());
+		ENSURE(sequences.size() == 2);
+		ENSURE(sequences[0].length == 2 && sequences[0].count == 2);
+		ENSURE(sequences[0].opcodes[0] == eEncOpcode::NUM_EQ_LV_RC && sequences[0].opcodes[1] == eEncOpcode::JUMP_IF_FALSE);
+		ENSURE(sequences[1].opcodes[0] == eEncOpcode::NUM_LT_LV_RC && sequences[1].opcodes[1] == eEncOpcode::AND);
+	}
+}
+
+
+
+/*
+ * Native Code Tests
+ */
+
+class NativeCodeTests : public ExpressionTestBase
+{
+	VariablePack *vars;
+
+protected:
+	void expectNative(const char* expressionText, size_t line, const char* functionName, const char* fileName, bool expectedNative);
+
+	virtual void setupFixture();
+	virtual void test();
+	virtual void tearDownFixture();
+};
+
+void NativeCodeTests::setupFixture()
+{
+	ExpressionTestBase::setupFixture();
+
+	vars = new VariablePack(&layout, Name(), 0);
+
+	vars->setVariable(Name("NumA"), 5.f);
+	vars->setVariable(Name("NumB"), -3.f);
+	vars->setVariable(Name("NumC"), 2.f);
+}
+
+void NativeCodeTests::tearDownFixture()
+{
+	delete vars;
+}
+
+void NativeCodeTests::expectNative(const char* expressionText, size_t line, const char* functionName, const char* fileName, bool expectedNative)
+{
+	std::unique_ptr<ExpressionData> expData(compile(expressionText, line, functionName, fileName));
+	if (didFail()) return;
+
+	const bool hasNative = expData->nativeCode != nullptr;
+	if (hasNative != (expectedNative && ExpressionJIT::isSupported()))
+	{
+		genericFail(hasNative ? "Unexpected native code generated" : "Native code not generated", line, functionName, fileName);
+		return;
+	}
+
+	// Native mode must give the interpreter's answer whether or not the JIT took the expression
+	ExpressionEvaluator interpreted(vars, eDispatchMode::Switch);
+	ExpressionEvaluator native(vars, eDispatchMode::Native);
+	interpreted.evaluate(expData.get());
+	native.evaluate(expData.get());
+
+	bool resultsMatch = native.errors().errorCount() == interpreted.errors().errorCount();
+	if (resultsMatch && interpreted.errors().errorCount() == 0)
+	{
+		resultsMatch = expData->resultType == eExpType::BOOL ?
+			native.getBoolResult() == interpreted.getBoolResult() :
+			native.getNumericResult() == interpreted.getNumericResult();
+	}
+
+	if (!resultsMatch)
+	{
+		genericFail("Native dispatch disagrees with the interpreter", line, functionName, fileName);
+	}
+}
+
+#define TEST_NATIVE(EXP) { expectNative(EXP, __LINE__, __FUNCTION__, __FILE__, true); if (didFail()) return; }
+#define TEST_NOT_NATIVE(EXP) { expectNative(EXP, __LINE__, __FUNCTION__, __FILE__, false); if (didFail()) return; }
+
+void NativeCodeTests::test()
+{
+	TEST_NATIVE("NumA*(NumB/2.5) - NumC");
+	TEST_NATIVE("NumA/NumB >= NumC || NameC != 'C'");
+	TEST_NATIVE("(NumA > 3) == !(NumB > 3)");
+	TEST_NATIVE("NumA/(NumA-5)");
+	TEST_NATIVE("NumA > NumB ? NumA * 2 : NumC - 1");
+	TEST_NATIVE("NumA < 0 ? NumB > 0 : NumC > 1");
+	TEST_NATIVE("NumA in (1, 5, 9) && NumB + 1 in (-2, 0)");
+	TEST_NATIVE("NameC in ('A', 'B', 'C') || NameD in ('A')");
+	TEST_NATIVE("NameC in ('A', 'B')");
+	TEST_NATIVE("NumA >= 0 && NumA < 10");
+	TEST_NATIVE("NumB < NumA && NumA <= NumC || NumA > 5 && NumA < 6");
+
+	// MOD needs fmodf, which the JIT doesn't call out to
+	TEST_NOT_NATIVE("NumA % 3");
+	TEST_NOT_NATIVE("NumA % 3 == 2 && NumB < 0");
 }
 
 
+/*
+ * Variable Table Tests
+ */
+
+class VariableTableTests : public ExpressionTestBase
+{
+protected:
+	virtual void test();
+};
+
+void VariableTableTests::test()
+{
+	VariableTable table(&layout, Name(), 0.f);
+
+	VariableRowHandle handles[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		handles[i] = table.addRow();
+
+		VariableTableRow row = table.getRow(handles[i]);
+		row.setVariable(Name("NumA"), static_cast<float>(i));
+		row.setVariable(Name("NameC"), i & 1 ? Name("odd") : Name("even"));
+	}
+
+	ENSURE(table.getRowCount() == 4);
+	ENSURE(table.getNumberColumn(layout.getIndex(Name("NumA")))[2] == 2.f);
+	ENSURE(table.getNumberColumn(layout.getIndex(Name("NumB")))[3] == 0.f);
+	ENSURE(table.getNumberColumn(layout.getIndex(Name("NumPos")))[3] == 1.f);	// ranged slots start in their range
+
+	// removing a row moves the last row into its place, the moved row's handle follows it
+	table.removeRow(handles[1]);
+
+	ENSURE(table.getRowCount() == 3);
+	ENSURE(!table.isValid(handles[1]));
+	ENSURE(table.getRowIndex(handles[3]) == 1);
+	ENSURE(table.getRowHandle(1) == handles[3]);
+	ENSURE(table.getNumberColumn(layout.getIndex(Name("NumA")))[1] == 3.f);
+	ENSURE(table.getRow(handles[3]).getVariableName(Name("NameC")) == Name("odd"));
+
+	// recycled handle indices don't revive stale handles
+	VariableRowHandle newHandle = table.addRow();
+	ENSURE(newHandle.index == handles[1].index);
+	ENSURE(!table.isValid(handles[1]));
+	ENSURE(table.getRow(newHandle).getVariableNumber(Name("NumA")) == 0.f);
+
+	// rows can stand in for a VariablePack
+	table.getRow(handles[2]).setVariable(Name("NumB"), 4.f);
+
+	VariablePack vars(&layout, Name(), 0.f);
+	table.getRow(handles[2]).copyTo(vars);
+
+	std::unique_ptr<ExpressionData> expData(compile("NumA * NumB", __LINE__, __FUNCTION__, __FILE__));
+	if (didFail()) return;
+
+	ExpressionEvaluator eval(&vars);
+	eval.evaluate(expData.get());
+	ENSURE(eval.getNumericResult() == 8.f);
+
+	vars.setVariable(Name("NumA"), 10.f);
+	table.getRow(newHandle).copyFrom(vars);
+	ENSURE(table.getRow(newHandle).getVariableNumber(Name("NumA")) == 10.f);
+	ENSURE(table.getRow(newHandle).getVariableNumber(Name("NumB")) == 4.f);
+}
+
+
+/*
+ * SIMD Tests - every lane width is checked against the interpreter, row by row
+ */
+
+class SIMDTests : public ExpressionTestBase
+{
+	VariableTable *table;
+
+protected:
+	void compareWithInterpreter(const char* expressionText, size_t line, const char* functionName, const char* fileName,
+		const ExpressionCompileOptions& options = ExpressionCompileOptions());
+
+	virtual void setupFixture();
+	virtual void test();
+	virtual void tearDownFixture();
+};
+
+void SIMDTests::setupFixture()
+{
+	ExpressionTestBase::setupFixture();
+
+	// an odd row count so every level also runs its scalar tail
+	table = new VariableTable(&layout, Name("C"), 0.f);
+	for (int i = 0; i < 37; ++i)
+	{
+		VariableTableRow row = table->getRow(table->addRow());
+		row.setVariable(Name("NumA"), static_cast<float>(i % 7) - 3.f);
+		row.setVariable(Name("NumB"), static_cast<float>(i % 5) * 0.5f);
+		row.setVariable(Name("NumC"), static_cast<float>(i));
+		row.setVariable(Name("NumPos"), static_cast<float>(i % 4) + 1.f);
+		row.setVariable(Name("NameD"), i % 3 ? Name("C") : Name("D"));
+	}
+}
+
+void SIMDTests::tearDownFixture()
+{
+	delete table;
+}
+
+void SIMDTests::compareWithInterpreter(const char* expressionText, size_t line, const char* functionName, const char* fileName,
+	const ExpressionCompileOptions& options)
+{
+	std::unique_ptr<ExpressionData> expData(compile(expressionText, line, functionName, fileName, options));
+	if (didFail()) return;
+
+	const uint32_t rowCount = table->getRowCount();
+	std::vector<float> results(rowCount);
+	std::vector<uint8_t> errors(rowCount);
+	VariablePack vars(&layout, Name(), 0.f);
+
+	const eSimdLevel levels[] = { eSimdLevel::Scalar, eSimdLevel::SSE2, eSimdLevel::AVX2, eSimdLevel::AVX512 };
+	for (eSimdLevel level : levels)
+	{
+		if (level > ExpressionSIMD::getSupportedLevel())
+		{
+			break;
+		}
+
+		if (!ExpressionSIMD::evaluate(expData.get(), table, 0, rowCount, results.data(), errors.data(), level))
+		{
+			genericFail("SIMD evaluation rejected the expression", line, functionName, fileName);
+			return;
+		}
+
+		for (uint32_t row = 0; row < rowCount; ++row)
+		{
+			table->getRow(table->getRowHandle(row)).copyTo(vars);
+
+			ExpressionEvaluator eval(&vars);
+			eval.evaluate(expData.get());
+
+			const bool expectError = eval.errors().errorCount() > 0;
+			const float expected = expectError ? 0.f : 
+				(expData->resultType == eExpType::BOOL ? (eval.getBoolResult() ? 1.f : 0.f) : eval.getNumericResult());
+
+			if ((errors[row] != 0) != expectError || !(results[row] == expected || (results[row] != results[row] && expected != expected)))
+			{
+				std::ostringstream msg;
+				msg << "Row " << row << " expected " << expected << (expectError ? " (error)" : "") << ", actual: " << results[row] << 
+					(errors[row] ? " (error)" : "") << " (" << ExpressionSIMD::getLevelAsString(level) << ")";
+				genericFail(msg.str().c_str(), line, functionName, fileName);
+				return;
+			}
+		}
+	}
+}
+
+#define TEST_SIMD(EXP) { compareWithInterpreter(EXP, __LINE__, __FUNCTION__, __FILE__); if (didFail()) return; }
+#define TEST_SIMD_OPTIONS(EXP,OPTIONS) { compareWithInterpreter(EXP, __LINE__, __FUNCTION__, __FILE__, OPTIONS); if (didFail()) return; }
+
+void SIMDTests::test()
+{
+	ExpressionCompileOptions ieee;
+	ieee.ieeeDivide = true;
+
+	TEST_SIMD("NumA + NumB * NumC - 2");
+	TEST_SIMD("NumC / NumA");
+	TEST_SIMD("NumC % NumB");
+	TEST_SIMD("10 / (NumA + 1) > NumB");
+	TEST_SIMD("NumA < 0 && NumB >= 1 || !(NumC != 4)");
+	TEST_SIMD("(NumA <= NumB) == (NumC > 20)");
+	TEST_SIMD("(NumA == 0) != (NameD == 'C')");
+	TEST_SIMD("NameD != NameC");
+	TEST_SIMD("NumA != 0 && NumC / NumA > 1");
+	TEST_SIMD("NumA == 0 || (NumB != 0 && NumC % NumB < 1 || NumC / NumA > 2)");
+	TEST_SIMD("3 * 4");
+	TEST_SIMD("NumA - NumB > 0 && (NumA - NumB) * NumC < 10 || NumA - NumB < -1");
+	TEST_SIMD("NumA > NumB && (NumA > NumB || NumC / NumA > 3)");
+	TEST_SIMD("NumC / NumPos + NumC % (NumPos + 1)");
+	TEST_SIMD("NumA != 0 && NumC / NumA > 1 || NumB > 0 && NumC % NumB < 1");
+	TEST_SIMD("!(NumA > NumC) == (NameD != 'C') || !(NumA < NumB)");
+	TEST_SIMD("NumA > NumB ? NumA * 2 : NumC - 1");
+	TEST_SIMD("NumA != 0 ? NumC / NumA : NumB > 0 ? 1 : NumC");
+	TEST_SIMD("NumA > 0 ? NumB >= 1 : NameD == 'C'");
+
+	// every lane skips the side behind the jump, which the select still blends in
+	TEST_SIMD("((NameD != NameD) != (NameC in ('C', 'C'))) ? (NameD in ('E', 'F')) : ((NumPos % 1) in (-1, 1, 1.5, 3))");
+	TEST_SIMD("NumC >= 0 ? NumA < 1 : NumC / NumA > 2");
+	TEST_SIMD("NumC < 0 ? NumC % NumB : NumA + 1");
+	TEST_SIMD("NumA in (-3, 0, 2) || NumB + 1 in (1.5, 3)");
+	TEST_SIMD("NumC in (1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21)");
+	TEST_SIMD("NameD in ('A', 'D') && NumA != 0");
+	TEST_SIMD("NumA >= -1 && NumA < 1.5 || NumB < NumA && NumA <= NumC");
+	TEST_SIMD_OPTIONS("NumC / NumA + NumC % NumB", ieee);
+	TEST_SIMD_OPTIONS("NumA == 0 || NumC / NumA > 1", ieee);
+	TEST_SIMD_OPTIONS("NumA != 0 ? NumC / NumA : NumC % NumB", ieee);
+
+	// selects nest their jumps as deep as && and || do
+	TEST_SIMD("NumA > 0 ? NumC / NumA : NumB > 1 ? NumC / NumB : NumC > 2 ? NumC % NumA : NumB > 0 ? NumA % NumB : NumC > 9 ? NumA / NumC : NumB / NumC");
+
+	// more jumps than the kernel can have pending are turned away rather than overrunning it
+	std::string longChain("NumC * 2 != NumA");
+	for (uint32_t i = 3; i <= EXPRESSION_SIMD_MAX_REGISTERS + 3; ++i)
+	{
+		longChain += " && NumC * " + std::to_string(i) + " != NumA";
+	}
+
+	std::unique_ptr<ExpressionData> longData(compile(longChain.c_str(), __LINE__, __FUNCTION__, __FILE__));
+	if (didFail()) return;
+	std::vector<float> results(table->getRowCount());
+	std::vector<uint8_t> errors(table->getRowCount());
+	ENSURE(!ExpressionSIMD::evaluate(longData.get(), table, 0, table->getRowCount(), results.data(), errors.data(), eSimdLevel::Scalar));
+}
+
+
+/*
+ * Batch Tests
+ */
+
+class BatchTests : public ExpressionTestBase
+{
+	std::vector<VariablePack> packs;
+	std::vector<const VariablePack*> packPointers;
+	ExpressionBatchEvaluator batchEval;
+
+protected:
+	void compareWithInterpreter(const char* expressionText, size_t line, const char* functionName, const char* fileName,
+		const ExpressionCompileOptions& options = ExpressionCompileOptions());
+
+	virtual void setupFixture();
+	virtual void test();
+};
+
+void BatchTests::setupFixture()
+{
+	ExpressionTestBase::setupFixture();
+
+	// enough packs for a couple of full chunks and a partial one
+	const uint32_t packCount = ExpressionBatchEvaluator::chunkSize * 2 + 11;
+	packs.reserve(packCount);
+
+	for (uint32_t i = 0; i < packCount; ++i)
+	{
+		packs.emplace_back(&layout, Name("C"), 0.f);
+		packs.back().setVariable(Name("NumA"), static_cast<float>(i % 7) - 3.f);
+		packs.back().setVariable(Name("NumB"), static_cast<float>(i % 5) * 0.5f);
+		packs.back().setVariable(Name("NumC"), static_cast<float>(i));
+		packs.back().setVariable(Name("NumPos"), static_cast<float>(i % 4) + 1.f);
+		packs.back().setVariable(Name("NameD"), i % 3 ? Name("C") : Name("D"));
+	}
+
+	// the pointer overload gets the packs in reverse order
+	for (auto it = packs.rbegin(); it != packs.rend(); ++it)
+	{
+		packPointers.push_back(&*it);
+	}
+}
+
+void BatchTests::compareWithInterpreter(const char* expressionText, size_t line, const char* functionName, const char* fileName,
+	const ExpressionCompileOptions& options)
+{
+	std::unique_ptr<ExpressionData> expData(compile(expressionText, line, functionName, fileName, options));
+	if (didFail()) return;
+
+	const uint32_t packCount = static_cast<uint32_t>(packs.size());
+	std::vector<float> results(packCount), pointerResults(packCount);
+	std::vector<uint8_t> errors(packCount), pointerErrors(packCount);
+
+	batchEval.evaluate(expData.get(), packs.data(), packCount, results.data(), errors.data());
+	batchEval.evaluate(expData.get(), packPointers.data(), packCount, pointerResults.data(), pointerErrors.data());
+
+	for (uint32_t i = 0; i < packCount; ++i)
+	{
+		ExpressionEvaluator eval(&packs[i]);
+		eval.evaluate(expData.get());
+
+		const bool expectError = eval.errors().errorCount() > 0;
+		const float expected = expectError ? 0.f :
+			(expData->resultType == eExpType::BOOL ? (eval.getBoolResult() ? 1.f : 0.f) : eval.getNumericResult());
+		const uint32_t reversed = packCount - 1 - i;
+
+		auto matches = [expected](float result) { return result == expected || (result != result && expected != expected); };
+
+		if ((errors[i] != 0) != expectError || !matches(results[i]) ||
+			(pointerErrors[reversed] != 0) != expectError || !matches(pointerResults[reversed]))
+		{
+			std::ostringstream msg;
+			msg << "Pack " << i << " expected " << expected << (expectError ? " (error)" : "") << ", actual: " << results[i] <<
+				(errors[i] ? " (error)" : "") << " / " << pointerResults[reversed] << (pointerErrors[reversed] ? " (error)" : "");
+			genericFail(msg.str().c_str(), line, functionName, fileName);
+			return;
+		}
+	}
+}
+
+#define TEST_BATCH(EXP) { compareWithInterpreter(EXP, __LINE__, __FUNCTION__, __FILE__); if (didFail()) return; }
+#define TEST_BATCH_OPTIONS(EXP,OPTIONS) { compareWithInterpreter(EXP, __LINE__, __FUNCTION__, __FILE__, OPTIONS); if (didFail()) return; }
+
+void BatchTests::test()
+{
+	ExpressionCompileOptions ieee;
+	ieee.ieeeDivide = true;
+
+	TEST_BATCH("NumA + NumB * NumC - 2");
+	TEST_BATCH("NumC / NumA");
+	TEST_BATCH("NumC % NumB");
+	TEST_BATCH("10 / (NumA + 1) > NumB");
+	TEST_BATCH("NumA < 0 && NumB >= 1 || !(NumC != 4)");
+	TEST_BATCH("(NumA <= NumB) == (NumC > 20)");
+	TEST_BATCH("(NumA == 0) != (NameD == 'C')");
+	TEST_BATCH("NameD != NameC");
+	TEST_BATCH("NumA != 0 && NumC / NumA > 1");
+	TEST_BATCH("NumA == 0 || (NumB != 0 && NumC % NumB < 1 || NumC / NumA > 2)");
+	TEST_BATCH("3 * 4");
+	TEST_BATCH("NumA");	// a lone variable loads with no constants to index
+	TEST_BATCH("NumA - NumB > 0 && (NumA - NumB) * NumC < 10 || NumA - NumB < -1");
+	TEST_BATCH("NumA > NumB && (NumA > NumB || NumC / NumA > 3)");
+	TEST_BATCH("NumC / NumPos + NumC % (NumPos + 1)");
+	TEST_BATCH("NumA != 0 && NumC / NumA > 1 || NumB > 0 && NumC % NumB < 1");
+	TEST_BATCH("!(NumA > NumC) == (NameD != 'C') || !(NumA < NumB)");
+	TEST_BATCH("NumA > NumB ? NumA * 2 : NumC - 1");
+	TEST_BATCH("NumA != 0 ? NumC / NumA : NumB > 0 ? 1 : NumC");
+	TEST_BATCH("NumA > 0 ? NumB >= 1 : NameD == 'C'");
+	TEST_BATCH("NumA in (-3, 0, 2) || NumB + 1 in (1.5, 3)");
+	TEST_BATCH("NumC in (1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21)");
+	TEST_BATCH("NameD in ('A', 'D') && NumA != 0");
+	TEST_BATCH("NumA >= -1 && NumA < 1.5 || NumB < NumA && NumA <= NumC");
+	TEST_BATCH_OPTIONS("NumC / NumA + NumC % NumB", ieee);
+	TEST_BATCH_OPTIONS("NumA == 0 || NumC / NumA > 1", ieee);
+	TEST_BATCH_OPTIONS("NumA != 0 ? NumC / NumA : NumC % NumB", ieee);
+
+	// the pending jumps are sized by the program's jumps, which selects add to as well as && and ||
+	TEST_BATCH("NumA > 0 ? NumC / NumA : NumB > 1 ? NumC / NumB : NumC > 2 ? NumC % NumA : NumB > 0 ? NumA % NumB : NumC > 9 ? NumA / NumC : NumB / NumC");
+	TEST_BATCH("NumC % 2 < 1 && (NumC % 3 < 2 && (NumC % 5 < 4 && (NumC % 7 < 6 && (NumA != 0 && NumB != 1))))");
+}
+
+
+/*
+ * Stateless Evaluation Tests
+ */
+
+class StatelessTests : public ExpressionTestBase
+{
+	std::unique_ptr<VariablePack> vars;
+
+protected:
+	void compareWithEvaluator(const char* expressionText, size_t line, const char* functionName, const char* fileName);
+
+	virtual void setupFixture();
+	virtual void tearDownFixture();
+	virtual void test();
+};
+
+void StatelessTests::setupFixture()
+{
+	ExpressionTestBase::setupFixture();
+
+	vars.reset(new VariablePack(&layout, Name("C"), 0.f));
+	vars->setVariable(Name("NumA"), 3.f);
+	vars->setVariable(Name("NumB"), 0.f);
+	vars->setVariable(Name("NumC"), 7.5f);
+	vars->setVariable(Name("NameD"), Name("D"));
+}
+
+void StatelessTests::tearDownFixture()
+{
+	vars.reset();
+}
+
+void StatelessTests::compareWithEvaluator(const char* expressionText, size_t line, const char* functionName, const char* fileName)
+{
+	std::unique_ptr<ExpressionData> expData(compile(expressionText, line, functionName, fileName));
+	if (didFail()) return;
+
+	ExpressionEvaluator eval(vars.get());
+	eval.evaluate(expData.get());
+
+	const bool expectError = eval.errors().errorCount() > 0;
+	const float expected = expectError ? 0.f :
+		(expData->resultType == eExpType::BOOL ? (eval.getBoolResult() ? 1.f : 0.f) : eval.getNumericResult());
+
+	const eDispatchMode modes[] = { eDispatchMode::Switch, eDispatchMode::Threaded, eDispatchMode::Native, eDispatchMode::Closure };
+	float registers[16];
+	uint8_t boolRegisters[16];
+
+	if (expData->regCount > 16)
+	{
+		genericFail("Expression needs more registers than the test provides", line, functionName, fileName);
+		return;
+	}
+
+	for (eDispatchMode mode : modes)
+	{
+		const uint32_t allocationsBefore = allocationCount;
+		ExpressionResult result;
+
+		for (uint32_t i = 0; i < 100; ++i)
+		{
+			result = evaluateExpression(*expData, *vars, registers, boolRegisters, 16, mode);
+		}
+
+		const uint32_t allocations = allocationCount - allocationsBefore;
+		const float actual = result.failed() ? 0.f : result.value;
+
+		if (allocations != 0 || result.failed() != expectError || actual != expected ||
+			(expectError && result.error != eErrorCode::DivideByZero))
+		{
+			std::ostringstream msg;
+			msg << "Mode " << static_cast<int>(mode) << " expected " << expected << (expectError ? " (error)" : "") <<
+				", actual: " << actual << (result.failed() ? " (error)" : "") << ", allocations: " << allocations;
+			genericFail(msg.str().c_str(), line, functionName, fileName);
+			return;
+		}
+	}
+}
+
+#define TEST_STATELESS(EXP) { compareWithEvaluator(EXP, __LINE__, __FUNCTION__, __FILE__); if (didFail()) return; }
+
+void StatelessTests::test()
+{
+	TEST_STATELESS("NumA + NumB * NumC - 2");
+	TEST_STATELESS("NumC / NumA");
+	TEST_STATELESS("NumC % NumB");
+	TEST_STATELESS("NumA < 0 && NumB >= 1 || !(NumC != 4)");
+	TEST_STATELESS("(NumA == 0) != (NameD == 'C')");
+	TEST_STATELESS("NameD != NameC");
+	TEST_STATELESS("NumB != 0 && NumC / NumB > 1");
+	TEST_STATELESS("NumA > NumB ? NumC / NumA : NumB - 1");
+	TEST_STATELESS("NumA in (1, 5) || NameD in ('C')");
+	TEST_STATELESS("NumA > 0 && NumA <= NumC");
+
+	// a register file smaller than the expression needs is reported rather than overrun
+	std::unique_ptr<ExpressionData> expData(compile("(NumA + NumB) * (NumC + NumA)", __LINE__, __FUNCTION__, __FILE__));
+	if (didFail()) return;
+
+	float registers[1];
+	uint8_t boolRegisters[1];
+	const ExpressionResult result = evaluateExpression(*expData, *vars, registers, boolRegisters, 1);
+	ENSURE(result.failed() && result.error == eErrorCode::InternalError);
+}
+
+
+/*
+ * Network Tests
+ */
+
+class NetworkTests : public ExpressionTestBase
+{
+	std::vector<VariablePack> packs;
+
+protected:
+	void compareWithEvaluator(const char* const* expressionTexts, uint32_t expressionCount, size_t line, const char* functionName, const char* fileName);
+
+	virtual void setupFixture();
+	virtual void test();
+};
+
+void NetworkTests::setupFixture()
+{
+	ExpressionTestBase::setupFixture();
+
+	for (uint32_t i = 0; i < 20; ++i)
+	{
+		packs.emplace_back(&layout, Name("C"), 0.f);
+		packs.back().setVariable(Name("NumA"), static_cast<float>(i % 7) - 3.f);
+		packs.back().setVariable(Name("NumB"), static_cast<float>(i % 5) * 0.5f);
+		packs.back().setVariable(Name("NumC"), static_cast<float>(i));
+		packs.back().setVariable(Name("NameD"), i % 3 ? Name("C") : Name("D"));
+	}
+}
+
+void NetworkTests::compareWithEvaluator(const char* const* expressionTexts, uint32_t expressionCount, size_t line, const char* functionName, const char* fileName)
+{
+	ExpressionCompiler comp(&layout);
+	std::unique_ptr<ExpressionNetwork> network(comp.compileNetwork(expressionTexts, expressionCount));
+
+	if (!network)
+	{
+		std::ostringstream msg;
+		msg << "Compile error - " << comp.errors().error(0).message;
+		genericFail(msg.str().c_str(), line, functionName, fileName);
+		return;
+	}
+
+	// the shared program should never be longer than the expressions compiled separately
+	size_t separateInstructions(0);
+	for (uint32_t index = 0; index < expressionCount; ++index)
+	{
+		separateInstructions += network->getExpression(index).byteCode.size() / 2;
+	}
+
+	if (network->getProgram().byteCode.size() / 2 > separateInstructions)
+	{
+		genericFail("Network program is longer than its expressions", line, functionName, fileName);
+		return;
+	}
+
+	const eDispatchMode modes[] = { eDispatchMode::Switch, eDispatchMode::Threaded };
+
+	for (eDispatchMode mode : modes)
+	{
+		ExpressionNetworkEvaluator networkEval(network.get(), mode);
+
+		for (uint32_t packIndex = 0; packIndex < packs.size(); ++packIndex)
+		{
+			const uint32_t allocationsBefore = allocationCount;
+			networkEval.evaluate(packs[packIndex]);
+			const uint32_t allocations = allocationCount - allocationsBefore;
+
+			for (uint32_t index = 0; index < expressionCount; ++index)
+			{
+				ExpressionEvaluator eval(&packs[packIndex]);
+				eval.evaluate(&network->getExpression(index));
+
+				const bool expectError = eval.errors().errorCount() > 0;
+				const float expected = expectError ? 0.f :
+					(eval.getResultType() == eExpType::BOOL ? (eval.getBoolResult() ? 1.f : 0.f) : eval.getNumericResult());
+
+				const ExpressionResult& result = networkEval.getResult(index);
+				const float actual = result.failed() ? 0.f : result.value;
+
+				if (allocations != 0 || result.failed() != expectError || actual != expected || result.type != eval.getResultType())
+				{
+					std::ostringstream msg;
+					msg << "Expression '" << expressionTexts[index] << "', pack " << packIndex << " expected " << expected <<
+						(expectError ? " (error)" : "") << ", actual: " << actual << (result.failed() ? " (error)" : "") <<
+						", allocations: " << allocations << " (mode " << static_cast<int>(mode) << ")";
+					genericFail(msg.str().c_str(), line, functionName, fileName);
+					return;
+				}
+			}
+		}
+	}
+}
+
+#define TEST_NETWORK(EXPS) { compareWithEvaluator(EXPS, sizeof(EXPS) / sizeof(EXPS[0]), __LINE__, __FUNCTION__, __FILE__); if (didFail()) return; }
+
+void NetworkTests::test()
+{
+	const char* const conditions[] =
+	{
+		"NumA > 0 && NameD == 'C'",
+		"NumA > 0 || NumB > 1",
+		"NameD == 'C' && NumB > 1",
+		"NumA > 0",
+		"NumA - NumB > NumC || NumB > 1",
+		"(NumA - NumB) * 2",
+		"NumC - (NumA - NumB) * 2",
+		"NumB > 1 && NumA - NumB > NumC",
+		"NumA - NumB > 0 ? NumA - NumB : NumC",
+		"NumA > 0 ? NumB > 1 : NameD == 'C'",
+		"NumA in (-3, 0, 2) && NameD in ('C', 'E')",
+		"NumA >= 0 && NumA < NumC",
+	};
+	TEST_NETWORK(conditions);
+
+	// expressions that divide by zero for some packs, without stopping the others
+	const char* const failing[] =
+	{
+		"NumC / NumA > 2",
+		"NumA > 0",
+		"NumA != 0 && NumC / NumA > 2",
+		"NumC / NumA > 2 || NumB > 1",
+		"NumC % NumA",
+		"NumA != 0 ? NumC / NumA : NumB",
+		"NumA + NumB",
+	};
+	TEST_NETWORK(failing);
+
+	// constant and variable expressions and repeats of whole expressions
+	const char* const leaves[] =
+	{
+		"4",
+		"NumC",
+		"NumA * 1",
+		"NumC < NumA",
+		"2 > 1",
+		"NumC < NumA",
+		"NumC + 0",
+	};
+	TEST_NETWORK(leaves);
+
+	// shared values read for the last time inside the right side of a later && or ||
+	const char* const mixed[] =
+	{
+		"(NameC2 == NameC) && (NumB > 0)",
+		"(NumA < 0) || ((NumA == 1) ? (NameC == NameC2) : (NumC == 7))",
+		"NumA - NumB > 0 || (NameD == 'C' && NumA - NumB > 0)",
+		"(NumA - NumB > 0) == (NumC > 3 && (NumB > 0 || NameD == 'C'))",
+		"NumC > 3 && (NumB > 0 || NameD == 'C') ? NumA - NumB : NumC",
+		"NumB > 0 || NameD == 'C'",
+	};
+	TEST_NETWORK(mixed);
+
+	// a condition computed in full by an earlier one is a single shared register
+	const char* const repeated[] = { "NumA > 0 && NumB > 1", "NumB > 1", "NumA > 0 && NumB > 1" };
+	ExpressionCompiler comp(&layout);
+	std::unique_ptr<ExpressionNetwork> network(comp.compileNetwork(repeated, 3));
+	ENSURE(network && network->getProgram().byteCode.size() / 2 == 6);
+	ENSURE(network->getResultRegister(0) == network->getResultRegister(2));
+
+	// with ieeeDivide nothing fails, and a zero divisor anywhere in the program flags every result
+	ExpressionCompileOptions ieee;
+	ieee.ieeeDivide = true;
+	const char* const ieeeTexts[] = { "NumC / NumA", "NumB + 1" };
+	ExpressionCompiler ieeeComp(&layout, ieee);
+	std::unique_ptr<ExpressionNetwork> ieeeNetwork(ieeeComp.compileNetwork(ieeeTexts, 2));
+	ENSURE(ieeeNetwork != nullptr);
+
+	ExpressionNetworkEvaluator ieeeEval(ieeeNetwork.get());
+	ieeeEval.evaluate(packs[3]);	// NumA is 0
+	ENSURE(!ieeeEval.getResult(0).failed() && ieeeEval.getResult(0).status == (EXP_STATUS_DIVIDE_BY_ZERO | EXP_STATUS_NOT_FINITE));
+	ENSURE(!ieeeEval.getResult(1).failed() && ieeeEval.getResult(1).value == 2.5f && ieeeEval.getResult(1).status == EXP_STATUS_DIVIDE_BY_ZERO);
+
+	// any expression failing to compile fails the whole network
+	const char* const broken[] = { "NumA > 0", "NumA > 'X'" };
+	std::unique_ptr<ExpressionNetwork> brokenNetwork(comp.compileNetwork(broken, 2));
+	ENSURE(!brokenNetwork);
+}
+
+
+/*
+ * Memo Tests
+ */
+
+class MemoTests : public ExpressionTestBase
+{
+protected:
+	virtual void test();
+};
+
+void MemoTests::test()
+{
+	// the inputs are the variables left after optimisation
+	std::unique_ptr<ExpressionData> expData(compile("NumC + 0 * NumPos > 1 && (NameD == 'C' || NumC < NumA)", __LINE__, __FUNCTION__, __FILE__));
+	if (didFail()) return;
+
+	const ExpressionSlotIndex numA = layout.getIndex(Name("NumA"));
+	const ExpressionSlotIndex numB = layout.getIndex(Name("NumB"));
+	const ExpressionSlotIndex numC = layout.getIndex(Name("NumC"));
+	ENSURE(expData->numberInputs.size() == 2 && expData->numberInputs[0] == std::min(numA, numC) && expData->numberInputs[1] == std::max(numA, numC));
+	ENSURE(expData->nameInputs.size() == 1 && expData->nameInputs[0] == layout.getIndex(Name("NameD")));
+
+	// only a write that changes a variable moves the pack on
+	VariablePack vars(&layout, Name("C"), 0.f);
+	ENSURE(vars.getVersion() == 0);
+	vars.setVariable(Name("NumA"), 0.f);
+	vars.setVariable(Name("NameD"), Name("C"));
+	ENSURE(vars.getVersion() == 0);
+	vars.setVariable(Name("NumA"), -0.f);
+	ENSURE(vars.getVersion() == 1 && vars.getNumberStamp(numA) == 1 && vars.getNumberStamp(numC) == 0);
+
+	vars.setVariable(Name("NumA"), 4.f);
+	vars.setVariable(Name("NumC"), 2.f);
+	vars.setVariable(Name("NameD"), Name("D"));
+
+	ExpressionMemoEvaluator memo(&vars);
+	const uint32_t condition = memo.addExpression(expData.get());
+	ENSURE(memo.evaluate(condition).getBoolResult());
+	ENSURE(memo.evaluate(condition).getBoolResult());
+	ENSURE(memo.getEvaluationCount() == 1);
+
+	// a variable the expression doesn't read, and one rewritten with its value, leave the result alone
+	const uint32_t allocationsBefore = allocationCount;
+	vars.setVariable(numB, 7.f);
+	vars.setVariable(numA, 4.f);
+	ENSURE(memo.evaluate(condition).getBoolResult());
+	ENSURE(memo.getEvaluationCount() == 1);
+	ENSURE(allocationCount == allocationsBefore);
+
+	vars.setVariable(Name("NumA"), 1.f);
+	ENSURE(!memo.evaluate(condition).getBoolResult());
+	ENSURE(memo.getEvaluationCount() == 2);
+
+	vars.setVariable(Name("NameD"), Name("C"));
+	vars.setVariable(Name("NameD"), Name("D"));
+	ENSURE(!memo.evaluate(condition).getBoolResult());
+	ENSURE(memo.getEvaluationCount() == 3);
+
+	// failures are remembered like any other result
+	std::unique_ptr<ExpressionData> divideData(compile("NumC / NumB", __LINE__, __FUNCTION__, __FILE__));
+	if (didFail()) return;
+	const uint32_t divide = memo.addExpression(divideData.get());
+
+	vars.setVariable(Name("NumB"), 0.f);
+	ENSURE(memo.evaluate(divide).error == eErrorCode::DivideByZero);
+	ENSURE(memo.evaluate(divide).error == eErrorCode::DivideByZero);
+	ENSURE(memo.getEvaluationCount() == 4);
+
+	vars.setVariable(Name("NumB"), 4.f);
+	ENSURE(!memo.evaluate(divide).failed() && memo.evaluate(divide).getNumericResult() == 0.5f);
+	ENSURE(memo.getEvaluationCount() == 5);
+
+	// an expression with no variables is only evaluated once
+	std::unique_ptr<ExpressionData> constantData(compile("2 * 3", __LINE__, __FUNCTION__, __FILE__));
+	if (didFail()) return;
+	const uint32_t constant = memo.addExpression(constantData.get());
+
+	ENSURE(constantData->numberInputs.empty() && constantData->nameInputs.empty());
+	memo.evaluate(constant);
+	vars.setVariable(Name("NumA"), 9.f);
+	ENSURE(memo.evaluate(constant).getNumericResult() == 6.f);
+	ENSURE(memo.evaluate(condition).getBoolResult());
+	ENSURE(memo.getEvaluationCount() == 7);
+
+	// assigning a pack, even one on an older version, moves on whichever variables it changes
+	VariablePack other(&layout, Name("C"), 0.f);
+	other.setVariable(Name("NumB"), 4.f);
+	other.setVariable(Name("NumC"), 44.f);
+	other.setVariable(Name("NumA"), 9.f);
+	other.setVariable(Name("NameD"), Name("D"));
+	ENSURE(other.getVersion() < vars.getVersion());
+
+	vars = other;
+	ENSURE(memo.evaluate(divide).getNumericResult() == 11.f);
+	ENSURE(!memo.evaluate(condition).getBoolResult());
+	ENSURE(memo.getEvaluationCount() == 9);
+
+	vars = other;
+	ENSURE(memo.evaluate(divide).getNumericResult() == 11.f);
+	ENSURE(memo.getEvaluationCount() == 9);
+}
+
+
+/*
+ * Derived Variable Tests
+ */
+
+class DerivedVariableTests : public ExpressionTestBase
+{
+protected:
+	virtual void setupFixture();
+	virtual void test();
+};
+
+void DerivedVariableTests::setupFixture()
+{
+	ExpressionTestBase::setupFixture();
+
+	layout.addDerivedVariable(Name("Ratio"), "NumA / NumB");
+	layout.addDerivedVariable(Name("Total"), "Ratio + NumC");
+	layout.addDerivedVariable(Name("IsA"), "NameC == 'A' ? 1 : 0");
+}
+
+void DerivedVariableTests::test()
+{
+	const ExpressionSlotIndex numA = layout.getIndex(Name("NumA"));
+	const ExpressionSlotIndex numC = layout.getIndex(Name("NumC"));
+	const ExpressionSlotIndex ratio = layout.getIndex(Name("Ratio"));
+	const ExpressionSlotIndex total = layout.getIndex(Name("Total"));
+
+	ENSURE(layout.getDerivedCount() == 3 && layout.isDerived(ratio) && !layout.isDerived(numA));
+	ENSURE(layout.getNumberDependents(numA).size() == 2 && layout.getNumberDependents(numA)[0] == 0 && layout.getNumberDependents(numA)[1] == 1);
+	ENSURE(layout.getNumberDependents(numC).size() == 1 && layout.getNumberDependents(numC)[0] == 1);
+	ENSURE(layout.getNameDependents(layout.getIndex(Name("NameC"))).size() == 1);
+
+	// worked out when the pack is made, a zero divisor giving NaN rather than failing
+	VariablePack vars(&layout, Name("A"), 0.f);
+	ENSURE(vars.getVariableNumber(ratio) != vars.getVariableNumber(ratio));
+	ENSURE(vars.getVariableNumber(Name("IsA")) == 1.f);
+	ENSURE(vars.getVersion() == 0);
+
+	// and again, in order, when an input changes
+	vars.setVariable(Name("NumA"), 6.f);
+	vars.setVariable(Name("NumB"), 3.f);
+	vars.setVariable(Name("NumC"), 0.5f);
+	vars.setVariable(Name("NameC"), Name("B"));
+	ENSURE(vars.getVariableNumber(ratio) == 2.f);
+	ENSURE(vars.getVariableNumber(total) == 2.5f);
+	ENSURE(vars.getVariableNumber(Name("IsA")) == 0.f);
+
+	std::unique_ptr<ExpressionData> expData(compile("Total > 2 && Ratio < NumB", __LINE__, __FUNCTION__, __FILE__));
+	if (didFail()) return;
+
+	ExpressionEvaluator eval(&vars);
+	eval.evaluate(expData.get());
+	ENSURE(eval.getBoolResult());
+
+	// only the derived variables that actually changed are stamped, so memoized results follow them
+	const uint64_t ratioStamp = vars.getNumberStamp(ratio);
+	vars.setVariable(numC, 2.f);
+	ENSURE(vars.getNumberStamp(ratio) == ratioStamp && vars.getNumberStamp(total) == vars.getVersion());
+
+	ExpressionMemoEvaluator memo(&vars);
+	const uint32_t condition = memo.addExpression(expData.get());
+	ENSURE(memo.evaluate(condition).getBoolResult());
+
+	vars.setVariable(numA, 12.f);
+	ENSURE(!memo.evaluate(condition).getBoolResult());
+	ENSURE(memo.getEvaluationCount() == 2);
+
+	// table rows work theirs out too, so the vector kernels read them like any other column
+	VariableTable table(&layout, Name("A"), 0.f);
+	VariableTableRow first = table.getRow(table.addRow());
+	ENSURE(first.getVariableNumber(ratio) != first.getVariableNumber(ratio));
+	ENSURE(first.getVariableNumber(Name("IsA")) == 1.f);
+
+	first.setVariable(Name("NumA"), 6.f);
+	first.setVariable(Name("NumB"), 3.f);
+	first.setVariable(Name("NumC"), 0.5f);
+	first.setVariable(Name("NameC"), Name("B"));
+	ENSURE(first.getVariableNumber(ratio) == 2.f && first.getVariableNumber(total) == 2.5f);
+	ENSURE(first.getVariableNumber(Name("IsA")) == 0.f);
+
+	VariableTableRow second = table.getRow(table.addRow());
+	second.copyFrom(vars);
+	ENSURE(second.getVariableNumber(total) == vars.getVariableNumber(total));
+
+	float results[2];
+	uint8_t resultErrors[2];
+	ENSURE(ExpressionSIMD::evaluate(expData.get(), &table, 0, 2, results, resultErrors, ExpressionSIMD::getSupportedLevel()));
+	ENSURE(results[0] == 1.f && results[1] == 0.f);
+
+	// a formula that doesn't compile, isn't a number, or reads a variable added after it is rejected
+	ExpressionErrorReporter errors;
+	ENSURE(layout.addDerivedVariable(Name("Bool"), "NumA > 1", &errors) == EXP_SLOT_INDEX_MAX);
+	ENSURE(errors.errorCount() == 1 && errors.error(0).code == eErrorCode::DerivedVariableType);
+
+	errors.reset();
+	ENSURE(layout.addDerivedVariable(Name("Self"), "Self + 1", &errors) == EXP_SLOT_INDEX_MAX);
+	ENSURE(errors.errorCount() == 1 && errors.error(0).code == eErrorCode::IdentifierNotFound);
+	ENSURE(!layout.variableExists(Name("Self")));
+}
+
+
+/*
+ * Archetype Tests
+ */
+
+class ArchetypeTests : public ExpressionTestBase
+{
+protected:
+	virtual void test();
+};
+
+void ArchetypeTests::test()
+{
+	const ExpressionSlotIndex numA = layout.getIndex(Name("NumA"));
+	const ExpressionSlotIndex numB = layout.getIndex(Name("NumB"));
+
+	VariablePack vars(&layout, Name("B"), 0.f);
+	vars.setVariable(numA, 6.f);
+	vars.setVariable(numB, 4.f);
+	vars.setVariable(Name("NumC"), 1.f);
+	vars.setVariable(Name("NameD"), Name("D"));
+
+	ExpressionBindings bindings;
+	bindings.bindVariable(Name("NameC"), vars);
+	bindings.bindVariable(Name("NumB"), vars);
+	ENSURE(*bindings.findNumber(numB) == 4.f && *bindings.findName(layout.getIndex(Name("NameC"))) == Name("B"));
+	ENSURE(!bindings.findNumber(numA));
+
+	// a bound test that fails folds the whole expression away
+	ExpressionCompiler comp(&layout);
+	std::unique_ptr<ExpressionData> folded(comp.specialise("NameC == 'A' && NumA > 1", bindings));
+	ENSURE(folded.get() && folded->numberInputs.empty() && folded->nameInputs.empty());
+
+	ExpressionEvaluator eval(&vars);
+	eval.evaluate(folded.get());
+	ENSURE(!eval.getBoolResult());
+
+	// a bound variable is as good as a constant set member
+	std::unique_ptr<ExpressionData> inSet(comp.specialise("NumA in (2, NumB + 2)", bindings));
+	ENSURE(inSet.get() != nullptr);
+	eval.evaluate(inSet.get());
+	ENSURE(eval.getBoolResult());
+
+	// and can fold a division by zero the generic expression only fails on when it runs
+	ExpressionBindings zeroB;
+	zeroB.bindNumber(numB, 0.f);
+	std::unique_ptr<ExpressionData> divide(comp.specialise("NumA > 1 / NumB", zeroB));
+	ENSURE(!divide.get() && comp.errors().error(comp.errors().errorCount() - 1).code == eErrorCode::DivideByZero);
+
+	// a folded % rounds the quotient toward zero like it does when it runs
+	for (float value : { 5.f, -5.f, 7.5f, -7.f })
+	{
+		VariablePack modVars(&layout, Name("B"), 0.f);
+		modVars.setVariable(numA, value);
+		ExpressionBindings modBindings;
+		modBindings.bindNumber(numA, value);
+
+		for (const char* modText : { "NumA % 3", "NumA % 3 > 1" })
+		{
+			std::unique_ptr<ExpressionData> generic(comp.compile(modText));
+			std::unique_ptr<ExpressionData> specialised(comp.specialise(modText, modBindings));
+			ENSURE(generic.get() && specialised.get() && specialised->numberInputs.empty());
+
+			ExpressionEvaluator genericEval(&modVars);
+			ExpressionEvaluator specialisedEval(&modVars);
+			genericEval.evaluate(generic.get());
+			specialisedEval.evaluate(specialised.get());
+			ENSURE(generic->resultType == eExpType::BOOL ? genericEval.getBoolResult() == specialisedEval.getBoolResult() :
+				genericEval.getNumericResult() == specialisedEval.getNumericResult());
+		}
+	}
+
+	ExpressionArchetypeCache cache(&layout);
+	const uint32_t ratio = cache.addExpression("NumA > 8 / NumB && NameC != 'A'");
+	const uint32_t unbound = cache.addExpression("NumA + NumC");
+	const uint32_t select = cache.addExpression("NameD == 'D' ? NumA / NumB : NumC");
+	ExpressionErrorReporter errors;
+	ENSURE(cache.addExpression("NumA > Missing", &errors) == UINT32_MAX && errors.error(0).code == eErrorCode::IdentifierNotFound);
+	ENSURE(cache.getExpressionCount() == 3);
+
+	const uint32_t goblin = cache.addArchetype(Name("Goblin"), bindings);
+	ExpressionBindings orcBindings(bindings);
+	orcBindings.bindName(layout.getIndex(Name("NameD")), Name("D"));
+	const uint32_t orc = cache.addArchetype(Name("Orc"), orcBindings);
+	const uint32_t broken = cache.addArchetype(Name("Broken"), zeroB);
+	ENSURE(cache.getArchetypeIndex(Name("Orc")) == orc && cache.getArchetypeIndex(Name("Elf")) == UINT32_MAX);
+
+	// each variant gives what the generic expression does against a pack holding the bound values
+	for (uint32_t expression : { ratio, unbound, select })
+	{
+		ExpressionEvaluator genericEval(&vars);
+		genericEval.evaluate(cache.getGenericExpression(expression));
+
+		for (uint32_t archetype : { goblin, orc })
+		{
+			const ExpressionData* variant = cache.getExpression(archetype, expression);
+			eval.evaluate(variant);
+			ENSURE(eval.getResultType() == eExpType::BOOL ? eval.getBoolResult() == genericEval.getBoolResult() : eval.getNumericResult() == genericEval.getNumericResult());
+			ENSURE(cache.getExpression(archetype, expression) == variant);
+		}
+	}
+
+	// loads of the bound variables are gone, an expression reading none of them is shared as it is, and
+	// archetypes binding the same values to an expression's inputs share its variant
+	ENSURE(cache.getExpression(goblin, ratio)->numberInputs.size() == 1 && cache.getExpression(goblin, ratio)->nameInputs.empty());
+	ENSURE(cache.getExpression(goblin, unbound) == cache.getGenericExpression(unbound));
+	ENSURE(cache.getExpression(orc, ratio) == cache.getExpression(goblin, ratio));
+	ENSURE(cache.getExpression(orc, select) != cache.getExpression(goblin, select));
+	ENSURE(cache.getExpression(orc, select)->numberInputs.size() == 1);
+	ENSURE(cache.getSpecialisedCount() == 3);
+
+	// a variant that can't compile falls back on the generic expression
+	ENSURE(cache.getExpression(broken, ratio) == cache.getGenericExpression(ratio));
+
+	// new bindings for an archetype take effect on its next lookup
+	ExpressionBindings elfBindings;
+	elfBindings.bindName(layout.getIndex(Name("NameC")), Name("A"));
+	ENSURE(cache.addArchetype(Name("Goblin"), elfBindings) == goblin && cache.getArchetypeCount() == 3);
+	eval.evaluate(cache.getExpression(goblin, ratio));
+	ENSURE(!eval.getBoolResult());
+}
+
+
+/*
+ * Tiering Tests
+ */
+
+class TieringTests : public ExpressionTestBase
+{
+protected:
+	virtual void test();
+};
+
+void TieringTests::test()
+{
+	VariablePack vars(&layout, Name("C"), 0.f);
+	vars.setVariable(Name("NumA"), 5.f);
+	vars.setVariable(Name("NumB"), -3.f);
+	vars.setVariable(Name("NumC"), 2.f);
+
+	const char* expressionTexts[] = { "NumA * NumB + NumC", "NumA > NumC && NameC == 'C'", "NumA / (NumC - 2) > 1", "NumB in (1, -3, 7) ? NumA % 3 : NumC" };
+	const uint32_t expressionCount = sizeof(expressionTexts) / sizeof(expressionTexts[0]);
+
+	ExpressionCompileOptions noClosure;
+	noClosure.closureCode = false;
+
+	std::vector<std::unique_ptr<ExpressionData>> expressions;
+	for (const char* expressionText : expressionTexts)
+	{
+		ExpressionCompiler comp(&layout, noClosure);
+		expressions.emplace_back(comp.compile(expressionText));
+		ENSURE(expressions.back().get() && !expressions.back()->closureCode);
+	}
+
+	std::vector<ExpressionResult> expected;
+	std::vector<float> registers(8);
+	std::vector<uint8_t> boolRegisters(8);
+
+	for (const auto& exprData : expressions)
+	{
+		expected.push_back(evaluateExpression(*exprData, vars, registers.data(), boolRegisters.data(), 8, eDispatchMode::Switch));
+	}
+
+	auto sameResult = [](const ExpressionResult& lhs, const ExpressionResult& rhs)
+	{
+		return lhs.error == rhs.error && (lhs.failed() || lhs.value == rhs.value);
+	};
+
+	// promoted by the evaluation reaching the threshold, to the threaded interpreter without closure code
+	ExpressionTierPolicy policy;
+	policy.promoteThreshold = 3;
+	policy.promotedMode = eDispatchMode::Closure;
+	policy.promotion = eTierPromotion::Synchronous;
+
+	{
+		ExpressionTiering tiering(policy);
+		ExpressionData& exprData = *expressions[0];
+
+		for (uint32_t i = 0; i < 2; ++i)
+		{
+			ENSURE(sameResult(tiering.evaluate(exprData, vars, registers.data(), boolRegisters.data(), 8), expected[0]));
+		}
+		ENSURE(exprData.dispatchMode == eDispatchMode::Switch && tiering.getPromotedCount() == 0);
+
+		ENSURE(sameResult(tiering.evaluate(exprData, vars, registers.data(), boolRegisters.data(), 8), expected[0]));
+		ENSURE(exprData.dispatchMode == eDispatchMode::Threaded && tiering.getPromotedCount() == 1);
+
+		for (uint32_t i = 0; i < 5; ++i)
+		{
+			ENSURE(sameResult(tiering.evaluate(exprData, vars, registers.data(), boolRegisters.data(), 8), expected[0]));
+		}
+		ENSURE(exprData.executionCount == 3 && tiering.getPromotedCount() == 1);
+	}
+
+	// to native code on a worker thread while other threads keep evaluating. A divide by zero still fails.
+	policy.promoteThreshold = 50;
+	policy.promotedMode = eDispatchMode::Native;
+	policy.promotion = eTierPromotion::Background;
+
+	ExpressionTiering tiering(policy);
+	const uint32_t threadCount = 4;
+	std::vector<uint32_t> mismatches(threadCount, 0);
+	std::vector<std::thread> threads;
+
+	for (uint32_t t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			float threadRegisters[8];
+			uint8_t threadBoolRegisters[8];
+
+			for (uint32_t i = 0; i < 2000; ++i)
+			{
+				const uint32_t index = (i + t) % expressionCount;
+				const ExpressionResult result = tiering.evaluate(*expressions[index], vars, threadRegisters, threadBoolRegisters, 8);
+				mismatches[t] += result.error != expected[index].error || (!result.failed() && result.value != expected[index].value);
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	tiering.waitForPromotions();
+	ENSURE(expected[2].failed());
+
+	for (uint32_t t = 0; t < threadCount; ++t)
+	{
+		ENSURE(mismatches[t] == 0);
+	}
+
+	ENSURE(tiering.getPromotedCount() == expressionCount - 1);
+	for (uint32_t index = 1; index < expressionCount; ++index)
+	{
+		const ExpressionData& exprData = *expressions[index];
+		ENSURE(exprData.dispatchMode == (exprData.nativeCode ? eDispatchMode::Native : eDispatchMode::Threaded));
+		ENSURE(sameResult(tiering.evaluate(*expressions[index], vars, registers.data(), boolRegisters.data(), 8), expected[index]));
+	}
+}
+
+
+/*
+ * Precompiled Tests
+ */
+
+#include "GeneratedFiles/PrecompiledTestFormulas.inl"
+
+class PrecompiledTests : public ExpressionTestBase
+{
+protected:
+	void checkPrecompiled(const ExpressionPrecompiled& precompiled, size_t line, const char* functionName, const char* fileName);
+
+	virtual void test();
+};
+
+#define TEST_PRECOMPILED(TABLE) { checkPrecompiled(TABLE, __LINE__, __FUNCTION__, __FILE__); if (didFail()) return; }
+
+// the table loads into what compiling its text gives now, so a stale .inl fails here
+void PrecompiledTests::checkPrecompiled(const ExpressionPrecompiled& precompiled, size_t line, const char* functionName, const char* fileName)
+{
+	std::unique_ptr<ExpressionData> loaded(loadPrecompiledExpression(precompiled, layout));
+	std::unique_ptr<ExpressionData> compiled(compile(precompiled.text, line, functionName, fileName));
+	if (didFail()) return;
+
+	if (!loaded)
+	{
+		genericFail("Precompiled expression didn't load - regenerate GeneratedFiles/PrecompiledTestFormulas.inl", line, functionName, fileName);
+		return;
+	}
+
+	const bool same = loaded->resultType == compiled->resultType && loaded->regCount == compiled->regCount && loaded->ieeeDivide == compiled->ieeeDivide &&
+		loaded->byteCode == compiled->byteCode && loaded->compactCode == compiled->compactCode &&
+		loaded->const_floats == compiled->const_floats && loaded->const_names == compiled->const_names && loaded->set_floats == compiled->set_floats &&
+		loaded->set_names == compiled->set_names && loaded->numberInputs == compiled->numberInputs && loaded->nameInputs == compiled->nameInputs &&
+		loaded->const_sets.size() == compiled->const_sets.size() && loaded->const_ranges.size() == compiled->const_ranges.size() &&
+		loaded->threadedCode.size() == compiled->threadedCode.size();
+
+	if (!same)
+	{
+		genericFail("Precompiled expression differs from compiling it - regenerate GeneratedFiles/PrecompiledTestFormulas.inl", line, functionName, fileName);
+		return;
+	}
+
+	if (loaded->regCount > 16)
+	{
+		genericFail("Expression needs more registers than the test provides", line, functionName, fileName);
+		return;
+	}
+
+	float registers[16];
+	uint8_t boolRegisters[16];
+
+	// NumC == 0 takes the divide by zero path
+	const float numberValues[][4] = { { 5.f, -3.f, 2.f, 4.f }, { -2.f, 7.f, 0.f, 1.f }, { 0.5f, 1.f, -8.f, 100.f } };
+	const char* nameValues[][3] = { { "C", "C", "A" }, { "C", "B", "E" }, { "D", "D", "F" } };
+
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		VariablePack vars(&layout, Name(), 0.f);
+		vars.setVariable(Name("NumA"), numberValues[i][0]);
+		vars.setVariable(Name("NumB"), numberValues[i][1]);
+		vars.setVariable(Name("NumC"), numberValues[i][2]);
+		vars.setVariable(Name("NumPos"), numberValues[i][3]);
+		vars.setVariable(Name("NameC"), Name(nameValues[i][0]));
+		vars.setVariable(Name("NameC2"), Name(nameValues[i][1]));
+		vars.setVariable(Name("NameD"), Name(nameValues[i][2]));
+
+		for (eDispatchMode mode : dispatchModes)
+		{
+			const ExpressionResult expected = evaluateExpression(*compiled, vars, registers, boolRegisters, 16, mode);
+			const ExpressionResult actual = evaluateExpression(*loaded, vars, registers, boolRegisters, 16, mode);
+
+			if (actual.error != expected.error || (!expected.failed() && actual.value != expected.value))
+			{
+				std::ostringstream msg;
+				msg << "Precompiled expression evaluates differently in mode " << getDispatchModeAsString(mode);
+				genericFail(msg.str().c_str(), line, functionName, fileName);
+				return;
+			}
+		}
+	}
+}
+
+void PrecompiledTests::test()
+{
+	TEST_PRECOMPILED(precompiledArithmetic);
+	TEST_PRECOMPILED(precompiledCondition);
+	TEST_PRECOMPILED(precompiledNameSet);
+	TEST_PRECOMPILED(precompiledNumberSet);
+	TEST_PRECOMPILED(precompiledRange);
+	TEST_PRECOMPILED(precompiledDivide);
+	TEST_PRECOMPILED(precompiledInexact);
+
+	// a table from a different VM, or for a layout with its variables elsewhere, is refused
+	ExpressionPrecompiled stale(precompiledArithmetic);
+	stale.opcodeMax += 1;
+	ENSURE(!loadPrecompiledExpression(stale, layout));
+
+	VariableLayout otherLayout;
+	otherLayout.addVariable(Name("NumB"), eExpType::NUMBER);
+	otherLayout.addVariable(Name("NumA"), eExpType::NUMBER);
+	otherLayout.addVariable(Name("NumC"), eExpType::NUMBER);
+	ENSURE(!loadPrecompiledExpression(precompiledArithmetic, otherLayout));
+
+	// 10 / NumPos was left unchecked for NumPos's declared range, so a layout allowing zero can't take it
+	VariableLayout widerLayout;
+	widerLayout.addVariable(Name("NumA"), eExpType::NUMBER);
+	widerLayout.addVariable(Name("NumB"), eExpType::NUMBER);
+	widerLayout.addVariable(Name("NumC"), eExpType::NUMBER);
+	widerLayout.addVariable(Name("NumPos"), ValueRange(0.f, 100.f));
+	ENSURE(!loadPrecompiledExpression(precompiledDivide, widerLayout));
+
+	VariableLayout narrowerLayout;
+	narrowerLayout.addVariable(Name("NumA"), eExpType::NUMBER);
+	narrowerLayout.addVariable(Name("NumB"), eExpType::NUMBER);
+	narrowerLayout.addVariable(Name("NumC"), eExpType::NUMBER);
+	narrowerLayout.addVariable(Name("NumPos"), ValueRange(2.f, 50.f));
+	std::unique_ptr<ExpressionData> narrower(loadPrecompiledExpression(precompiledDivide, narrowerLayout));
+	ENSURE(narrower.get() != nullptr);
+
+	// a spec is checked as it is read, each error giving its line
+	std::istringstream spec("# layout\nnumber NumA\nname NameC\n\nformula good NumA > 1 && NameC == 'C'\nformula bad NumA > && 1\n");
+	std::ostringstream tables;
+	ExpressionErrorReporter errors;
+	ENSURE(!writePrecompiledExpressions(spec, tables, errors));
+	ENSURE(errors.errorCount() == 1 && errors.error(0).code == eErrorCode::SyntaxError && errors.error(0).message.find("line 6:") == 0);
+
+	std::istringstream unknownSpec("number NumA\nformula missing NumB + 1\n");
+	errors.reset();
+	ENSURE(!writePrecompiledExpressions(unknownSpec, tables, errors));
+	ENSURE(errors.errorCount() == 1 && errors.error(0).code == eErrorCode::IdentifierNotFound && errors.error(0).message.find("line 2:") == 0);
+
+	std::istringstream goodSpec("number NumA\nderived Twice NumA * 2\nformula twice Twice > NumA\n");
+	errors.reset();
+	ENSURE(writePrecompiledExpressions(goodSpec, tables, errors));
+	ENSURE(tables.str().find("static const ExpressionPrecompiled twice =") != std::string::npos);
+}
 
 
 /*
@@ -481,6 +2445,17 @@ void ExecutionTests::test()
 TESTRUNNER(ExpressionTests)
 	RUN_TEST(CompileTests)
 	RUN_TEST(ExecutionTests)
+	RUN_TEST(NativeCodeTests)
+	RUN_TEST(VariableTableTests)
+	RUN_TEST(SIMDTests)
+	RUN_TEST(BatchTests)
+	RUN_TEST(StatelessTests)
+	RUN_TEST(NetworkTests)
+	RUN_TEST(MemoTests)
+	RUN_TEST(DerivedVariableTests)
+	RUN_TEST(ArchetypeTests)
+	RUN_TEST(TieringTests)
+	RUN_TEST(PrecompiledTests)
 END_TESTRUNNER
 
 
@@ -0,0 +1,120 @@
+/*
+ * ExpressionTiering.cpp
+ *
+ */
+
+#include "stdafx.h"
+
+#include "ExpressionTiering.h"
+#include "ExpressionJIT.h"
+
+
+/*
+ * ExpressionTiering
+ */
+
+ExpressionTiering::ExpressionTiering(const ExpressionTierPolicy& _policy)
+	: policy(_policy)
+	, promotedCount(0)
+	, promoting(false)
+	, stopping(false)
+{
+	assert(policy.promoteThreshold > 0);
+	assert(policy.promotedMode == eDispatchMode::Native || policy.promotedMode == eDispatchMode::Closure || policy.promotedMode == eDispatchMode::Threaded);
+
+	if (policy.promotion == eTierPromotion::Background)
+	{
+		worker = std::thread(&ExpressionTiering::runWorker, this);
+	}
+}
+
+ExpressionTiering::~ExpressionTiering()
+{
+	if (worker.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			stopping = true;
+		}
+
+		queueChanged.notify_all();
+		worker.join();
+	}
+}
+
+void ExpressionTiering::requestPromotion(ExpressionData& exprData)
+{
+	// a lost count can bring an expression back to the threshold, but it is only ever promoted once
+	if (exprData.promotionRequested.exchange(true))
+	{
+		return;
+	}
+
+	if (policy.promotion == eTierPromotion::Synchronous)
+	{
+		promote(exprData);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		queue.push_back(&exprData);
+	}
+
+	queueChanged.notify_all();
+}
+
+void ExpressionTiering::promote(ExpressionData& exprData)
+{
+	eDispatchMode mode = policy.promotedMode;
+
+	if (mode == eDispatchMode::Native && !exprData.nativeCode && !ExpressionJIT::compile(&exprData))
+	{
+		mode = eDispatchMode::Closure;
+	}
+
+	if (mode == eDispatchMode::Closure && !exprData.closureCode)
+	{
+		mode = eDispatchMode::Threaded;
+	}
+
+	// the code is in place before any evaluation can see the mode that runs it
+	exprData.dispatchMode.store(mode, std::memory_order_release);
+	promotedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ExpressionTiering::runWorker()
+{
+	std::unique_lock<std::mutex> lock(queueMutex);
+
+	for (;;)
+	{
+		queueChanged.wait(lock, [this] { return stopping || !queue.empty(); });
+		if (stopping)
+		{
+			return;
+		}
+
+		ExpressionData* exprData = queue.front();
+		queue.pop_front();
+		promoting = true;
+
+		lock.unlock();
+		promote(*exprData);
+		lock.lock();
+
+		promoting = false;
+		queueChanged.notify_all();
+	}
+}
+
+void ExpressionTiering::waitForPromotions()
+{
+	if (!worker.joinable())
+	{
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(queueMutex);
+	queueChanged.wait(lock, [this] { return queue.empty() && !promoting; });
+}
@@ -0,0 +1,110 @@
+/*
+ * ExpressionTiering.h
+ * Promotion of frequently evaluated expressions to a faster backend.
+ *
+ * Generating native code for every one of a large set of expressions costs load time and memory that
+ * most of them never pay back. Evaluated through an ExpressionTiering, expressions start in whichever
+ * interpreter their dispatchMode names (Switch unless set) and each evaluation is counted in
+ * ExpressionData::executionCount. The one that reaches the policy's threshold promotes the expression:
+ * native code is generated for it and its dispatchMode moved to Native, or to Closure or Threaded when
+ * that can't be done. The promotion is made there and then, or queued for a worker thread so the
+ * evaluation that crossed the threshold isn't held up.
+ *
+ * Promotion only adds to an ExpressionData, and stores its new code before the dispatch mode that runs
+ * it, so other threads can go on evaluating the expression in PerExpression mode while it is promoted.
+ * Evaluating it explicitly in Native mode meanwhile is not safe.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "Expression.h"
+
+
+enum class eTierPromotion
+{
+	Synchronous,	// in the evaluation that reaches the threshold
+	Background,		// on the tiering's worker thread
+};
+
+struct ExpressionTierPolicy
+{
+	uint32_t promoteThreshold;		// evaluations before an expression is promoted, at least 1
+	eDispatchMode promotedMode;		// Native, Closure or Threaded - each falls back on the next when it isn't available
+	eTierPromotion promotion;
+
+	ExpressionTierPolicy() : promoteThreshold(1000), promotedMode(eDispatchMode::Native), promotion(eTierPromotion::Background) {}
+};
+
+
+class ExpressionTiering
+{
+	ExpressionTierPolicy policy;
+	std::atomic<uint32_t> promotedCount;
+
+	// the worker, only started for Background promotion
+	std::thread worker;
+	std::mutex queueMutex;
+	std::condition_variable queueChanged;
+	std::deque<ExpressionData*> queue;
+	bool promoting;		// the worker has taken an expression off the queue and not finished with it
+	bool stopping;
+
+	void requestPromotion(ExpressionData& exprData);
+	void promote(ExpressionData& exprData);
+	void runWorker();
+
+	ExpressionTiering(const ExpressionTiering&);
+	ExpressionTiering& operator=(const ExpressionTiering&);
+
+public:
+	explicit ExpressionTiering(const ExpressionTierPolicy& _policy = ExpressionTierPolicy());
+
+	// Finishes the promotion under way, if any. Expressions still queued are left where they are.
+	~ExpressionTiering();
+
+	// Counts an evaluation of exprData, promoting it if this one reaches the threshold. Can be called
+	// from any number of threads at once. The expression must outlive the tiering once it is queued.
+	void countExecution(ExpressionData& exprData);
+
+	// evaluateExpression in PerExpression mode, counting the evaluation first. Thread safe as
+	// evaluateExpression is, and doesn't allocate unless it promotes synchronously.
+	ExpressionResult evaluate(ExpressionData& exprData, const VariablePack& variables, float* registers, uint8_t* boolRegisters, uint32_t registerCount);
+
+	// blocks until every queued promotion has been made
+	void waitForPromotions();
+
+	uint32_t getPromotedCount() const { return promotedCount.load(std::memory_order_relaxed); }
+	const ExpressionTierPolicy& getPolicy() const { return policy; }
+};
+
+
+// Counted with a separate load and store rather than an atomic increment, so evaluations racing on
+// other threads can lose counts - only the order of magnitude matters. Once an expression has
+// reached the threshold this is a single load.
+inline void ExpressionTiering::countExecution(ExpressionData& exprData)
+{
+	const uint32_t count = exprData.executionCount.load(std::memory_order_relaxed);
+	if (count >= policy.promoteThreshold)
+	{
+		return;
+	}
+
+	exprData.executionCount.store(count + 1, std::memory_order_relaxed);
+	if (count + 1 == policy.promoteThreshold)
+	{
+		requestPromotion(exprData);
+	}
+}
+
+inline ExpressionResult ExpressionTiering::evaluate(ExpressionData& exprData, const VariablePack& variables, float* registers, uint8_t* boolRegisters, uint32_t registerCount)
+{
+	countExecution(exprData);
+	return evaluateExpression(exprData, variables, registers, boolRegisters, registerCount, eDispatchMode::PerExpression);
+}
@@ -40,9 +40,10 @@ typedef void* yyscan_t;
     ASTNode *expression;
 }
 
+%right TOKEN_QUESTION TOKEN_COLON
 %left TOKEN_OR
 %left TOKEN_AND
-%left TOKEN_EQ TOKEN_NEQ
+%left TOKEN_EQ TOKEN_NEQ TOKEN_IN
 %left TOKEN_LT TOKEN_LTEQ TOKEN_GT TOKEN_GTEQ
 %left TOKEN_PLUS TOKEN_MINUS
 %left TOKEN_MUL TOKEN_DIV TOKEN_PERCENT
@@ -52,13 +53,14 @@ typedef void* yyscan_t;
 
 %token TOKEN_LPAREN
 %token TOKEN_RPAREN
+%token TOKEN_COMMA
 %token TOKEN_TRUE
 %token TOKEN_FALSE
 %token <n_value> TOKEN_NAME
 %token <f_value> TOKEN_NUMBER
 %token <n_value> TOKEN_ID
 
-%type <expression> expr
+%type <expression> expr set_members
  
 %%
  
@@ -74,6 +76,7 @@ expr
 	| expr TOKEN_PERCENT expr	{ $$ = createNode( eASTNodeType::ARITH_MOD, $1, $3 ); }
 	| expr TOKEN_AND expr		{ $$ = createNode( eASTNodeType::LOGICAL_AND, $1, $3 ); }
 	| expr TOKEN_OR expr		{ $$ = createNode( eASTNodeType::LOGICAL_OR, $1, $3 ); }
+	| expr TOKEN_QUESTION expr TOKEN_COLON expr { $$ = createSelectNode( $1, $3, $5 ); }
 	| TOKEN_NOT expr			{ $$ = createNode( eASTNodeType::LOGICAL_NOT, $2, nullptr ); }
 	| TOKEN_MINUS expr %prec TOKEN_UNARY_NEG { $$ = createNode( eASTNodeType::ARITH_SUB, createConstNode(0.f), $2 ); }
 	| expr TOKEN_EQ expr		{ $$ = createNode( eASTNodeType::COMP_EQ, $1, $3 ); }
@@ -82,6 +85,7 @@ expr
 	| expr TOKEN_LTEQ expr		{ $$ = createNode( eASTNodeType::COMP_LTEQ, $1, $3 ); }
 	| expr TOKEN_GT expr		{ $$ = createNode( eASTNodeType::COMP_GT, $1, $3 ); }
 	| expr TOKEN_GTEQ expr		{ $$ = createNode( eASTNodeType::COMP_GTEQ, $1, $3 ); }
+	| expr TOKEN_IN TOKEN_LPAREN set_members TOKEN_RPAREN { $$ = createInNode( $1, $4 ); }
     | TOKEN_LPAREN expr TOKEN_RPAREN { $$ = $2; }
     | TOKEN_NUMBER				{ $$ = createConstNode($1); }
 	| TOKEN_NAME				{ $$ = createConstNode($1); free((void*)$1); }
@@ -90,4 +94,9 @@ expr
 	| TOKEN_FALSE				{ $$ = createConstNode(false); }
 	;
  
+set_members
+	: expr						{ $$ = createSetNode( $1 ); }
+	| set_members TOKEN_COMMA expr { $$ = addSetMember( $1, $3 ); }
+	;
+ 
 %%
@@ -358,8 +358,8 @@ static void yy_fatal_error (yyconst char msg[] ,yyscan_t yyscanner );
 	*yy_cp = '\0'; \
 	yyg->yy_c_buf_p = yy_cp;
 
-#define YY_NUM_RULES 24
-#define YY_END_OF_BUFFER 25
+#define YY_NUM_RULES 28
+#define YY_END_OF_BUFFER 29
 /* This struct is not used in this scanner,
    but its presence is necessary. */
 struct yy_trans_info
@@ -367,12 +367,13 @@ struct yy_trans_info
 	flex_int32_t yy_verify;
 	flex_int32_t yy_nxt;
 	};
-static yyconst flex_int16_t yy_accept[40] =
+static yyconst flex_int16_t yy_accept[44] =
     {   0,
-        1,    1,   25,   23,    1,    1,   16,   13,   23,   23,
-        7,    8,   11,    9,   10,   23,   12,    2,   19,   23,
-       21,    6,   23,    1,   18,   14,    0,    5,    4,    3,
-        2,   20,   17,   22,    6,    6,   15,    3,    0
+        1,    1,   29,   27,    1,    1,   18,   15,   27,   27,
+        8,    9,   13,   11,   10,   12,   27,   14,    2,   26,
+       21,   27,   23,   25,    7,    7,   27,   20,   16,    0,
+        5,    4,    3,    2,   22,   19,   24,    7,    7,    6,
+       17,    3,    0
     } ;
 
 static yyconst flex_int32_t yy_ec[256] =
@@ -381,16 +382,16 @@ static yyconst flex_int32_t yy_ec[256] =
         1,    1,    2,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    2,    4,    1,    1,    1,    5,    6,    7,    8,
-        9,   10,   11,    1,   12,   13,   14,   15,   15,   15,
-       15,   15,   15,   15,   15,   15,   15,    1,    1,   16,
-       17,   18,    1,    1,   19,   19,   19,   19,   19,   19,
-       19,   19,   19,   19,   19,   19,   19,   19,   19,   19,
-       19,   19,   19,   19,   19,   19,   19,   19,   19,   19,
-        1,    1,    1,    1,   20,    1,   19,   19,   19,   19,
-
-       19,   19,   19,   19,   19,   19,   19,   19,   19,   19,
-       19,   19,   19,   19,   19,   19,   19,   19,   19,   19,
-       19,   19,    1,   21,    1,    1,    1,    1,    1,    1,
+        9,   10,   11,   12,   13,   14,   15,   16,   16,   16,
+       16,   16,   16,   16,   16,   16,   16,   17,    1,   18,
+       19,   20,   21,    1,   22,   22,   22,   22,   22,   22,
+       22,   22,   22,   22,   22,   22,   22,   22,   22,   22,
+       22,   22,   22,   22,   22,   22,   22,   22,   22,   22,
+        1,    1,    1,    1,   23,    1,   22,   22,   22,   22,
+
+       22,   22,   22,   22,   24,   22,   22,   22,   22,   25,
+       22,   22,   22,   22,   22,   22,   22,   22,   22,   22,
+       22,   22,    1,   26,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
@@ -407,51 +408,61 @@ static yyconst flex_int32_t yy_ec[256] =
         1,    1,    1,    1,    1
     } ;
 
-static yyconst flex_int32_t yy_meta[22] =
+static yyconst flex_int32_t yy_meta[27] =
     {   0,
-        1,    1,    2,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1
+        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
+        1,    1,    1,    1,    1,    1
     } ;
 
-static yyconst flex_int16_t yy_base[41] =
+static yyconst flex_int16_t yy_base[44] =
     {   0,
-        0,    0,   55,   56,   20,   22,   37,   56,   47,   45,
-       56,   56,   56,   56,   56,   36,   56,   13,   33,   32,
-       31,   12,   26,   27,   56,   56,   39,   38,   29,   28,
-       20,   56,   56,   56,   19,   21,   56,   27,   56,   36
+        0,    0,   27,    0,   26,    0,   11,    0,   25,   31,
+        0,    0,    0,    0,    0,    0,   18,    0,   44,    0,
+       40,   42,   43,    0,   47,   39,   39,    0,    0,    0,
+        0,    0,   50,    0,    0,    0,    0,   51,    0,    0,
+        0,    0,   77
     } ;
 
-static yyconst flex_int16_t yy_def[41] =
+static yyconst flex_int16_t yy_def[44] =
     {   0,
-       39,    1,   39,   39,   39,   39,   39,   39,   39,   40,
-       39,   39,   39,   39,   39,   39,   39,   39,   39,   39,
-       39,   39,   39,   39,   39,   39,   40,   40,   39,   39,
-       39,   39,   39,   39,   39,   39,   39,   39,    0,   39
+       43,    1,   43,   43,   43,    5,   43,   43,   43,   43,
+       43,   43,   43,   43,   43,   43,   43,   43,   43,   43,
+       43,   43,   43,   43,   43,   25,   43,   43,   43,   10,
+       43,   17,   43,   19,   43,   43,   43,   25,   25,   25,
+       43,   33,    0
     } ;
 
-static yyconst flex_int16_t yy_nxt[78] =
+static yyconst flex_int16_t yy_nxt[104] =
     {   0,
         4,    5,    6,    7,    8,    9,   10,   11,   12,   13,
-       14,   15,   16,   17,   18,   19,   20,   21,   22,    4,
-       23,   24,   24,   24,   24,   30,   35,   31,   24,   24,
-       36,   35,   30,   35,   31,   35,   27,   35,   35,   36,
-       35,   38,   38,   29,   28,   28,   37,   34,   33,   32,
-       29,   28,   26,   25,   39,    3,   39,   39,   39,   39,
-       39,   39,   39,   39,   39,   39,   39,   39,   39,   39,
-       39,   39,   39,   39,   39,   39,   39
+       14,   15,   16,   17,   18,   19,   20,   21,   22,   23,
+       24,   25,    4,   26,   25,   27,   43,    6,    6,   28,
+       29,   30,   30,   32,   30,   30,   30,   31,   30,   30,
+       30,   30,   30,   30,   30,   30,   30,   30,   30,   30,
+       30,   30,   30,   30,   30,   30,   30,   33,   35,   34,
+       36,   37,   38,   40,   41,   42,    0,    0,   39,   38,
+       39,   39,   38,    0,   38,   38,    3,   43,   43,   43,
+       43,   43,   43,   43,   43,   43,   43,   43,   43,   43,
+       43,   43,   43,   43,   43,   43,   43,   43,   43,   43,
+
+       43,   43,   43
     } ;
 
-static yyconst flex_int16_t yy_chk[78] =
+static yyconst flex_int16_t yy_chk[104] =
     {   0,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
         1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    5,    5,    6,    6,   18,   22,   18,   24,   24,
-       22,   22,   31,   35,   31,   36,   40,   35,   35,   36,
-       36,   38,   30,   29,   28,   27,   23,   21,   20,   19,
-       16,   10,    9,    7,    3,   39,   39,   39,   39,   39,
-       39,   39,   39,   39,   39,   39,   39,   39,   39,   39,
-       39,   39,   39,   39,   39,   39,   39
+        1,    1,    1,    1,    1,    1,    3,    5,    5,    7,
+        9,   10,   10,   17,   10,   10,   10,   10,   10,   10,
+       10,   10,   10,   10,   10,   10,   10,   10,   10,   10,
+       10,   10,   10,   10,   10,   10,   10,   19,   21,   19,
+       22,   23,   25,   26,   27,   33,    0,    0,   25,   25,
+       25,   25,   38,    0,   38,   38,   43,   43,   43,   43,
+       43,   43,   43,   43,   43,   43,   43,   43,   43,   43,
+       43,   43,   43,   43,   43,   43,   43,   43,   43,   43,
+
+       43,   43,   43
     } ;
 
 /* The intent behind this definition is that it'll catch
@@ -477,7 +488,7 @@ static yyconst flex_int16_t yy_chk[78] =
 char *copyString(const char *start, size_t len); 
 
 #define YY_NO_UNISTD_H 1
-#line 481 "GeneratedFiles/FormulaLexer.c"
+#line 492 "GeneratedFiles/FormulaLexer.c"
 
 #define INITIAL 0
 
@@ -718,7 +729,7 @@ YY_DECL
 #line 25 "FormulaLexer.l"
 
  
-#line 722 "GeneratedFiles/FormulaLexer.c"
+#line 733 "GeneratedFiles/FormulaLexer.c"
 
     yylval = yylval_param;
 
@@ -773,13 +784,13 @@ yy_match:
 			while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 				{
 				yy_current_state = (int) yy_def[yy_current_state];
-				if ( yy_current_state >= 40 )
+				if ( yy_current_state >= 44 )
 					yy_c = yy_meta[(unsigned int) yy_c];
 				}
 			yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
 			++yy_cp;
 			}
-		while ( yy_current_state != 39 );
+		while ( yy_current_state != 43 );
 		yy_cp = yyg->yy_last_accepting_cpos;
 		yy_current_state = yyg->yy_last_accepting_state;
 
@@ -822,99 +833,119 @@ YY_RULE_SETUP
 case 6:
 YY_RULE_SETUP
 #line 35 "FormulaLexer.l"
-{ yylval->n_value = copyString(yytext, yyleng); return TOKEN_ID; }
+{ return TOKEN_IN; }
 	YY_BREAK
 case 7:
 YY_RULE_SETUP
-#line 37 "FormulaLexer.l"
-{ return TOKEN_LPAREN; }
+#line 36 "FormulaLexer.l"
+{ yylval->n_value = copyString(yytext, yyleng); return TOKEN_ID; }
 	YY_BREAK
 case 8:
 YY_RULE_SETUP
 #line 38 "FormulaLexer.l"
-{ return TOKEN_RPAREN; }
+{ return TOKEN_LPAREN; }
 	YY_BREAK
 case 9:
 YY_RULE_SETUP
 #line 39 "FormulaLexer.l"
-{ return TOKEN_PLUS; }
+{ return TOKEN_RPAREN; }
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
 #line 40 "FormulaLexer.l"
-{ return TOKEN_MINUS; }
+{ return TOKEN_COMMA; }
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
 #line 41 "FormulaLexer.l"
-{ return TOKEN_MUL; }
+{ return TOKEN_PLUS; }
 	YY_BREAK
 case 12:
 YY_RULE_SETUP
 #line 42 "FormulaLexer.l"
-{ return TOKEN_DIV; }
+{ return TOKEN_MINUS; }
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
 #line 43 "FormulaLexer.l"
-{ return TOKEN_PERCENT; }
+{ return TOKEN_MUL; }
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
 #line 44 "FormulaLexer.l"
-{ return TOKEN_AND; }
+{ return TOKEN_DIV; }
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
 #line 45 "FormulaLexer.l"
-{ return TOKEN_OR; }
+{ return TOKEN_PERCENT; }
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
 #line 46 "FormulaLexer.l"
-{ return TOKEN_NOT; }
+{ return TOKEN_AND; }
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
 #line 47 "FormulaLexer.l"
-{ return TOKEN_EQ; }
+{ return TOKEN_OR; }
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
 #line 48 "FormulaLexer.l"
-{ return TOKEN_NEQ; }
+{ return TOKEN_NOT; }
 	YY_BREAK
 case 19:
 YY_RULE_SETUP
 #line 49 "FormulaLexer.l"
-{ return TOKEN_LT; }
+{ return TOKEN_EQ; }
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
 #line 50 "FormulaLexer.l"
-{ return TOKEN_LTEQ; }
+{ return TOKEN_NEQ; }
 	YY_BREAK
 case 21:
 YY_RULE_SETUP
 #line 51 "FormulaLexer.l"
-{ return TOKEN_GT; }
+{ return TOKEN_LT; }
 	YY_BREAK
 case 22:
 YY_RULE_SETUP
 #line 52 "FormulaLexer.l"
-{ return TOKEN_GTEQ; }
+{ return TOKEN_LTEQ; }
 	YY_BREAK
 case 23:
 YY_RULE_SETUP
-#line 54 "FormulaLexer.l"
-{ return TOKEN_ERR; }
+#line 53 "FormulaLexer.l"
+{ return TOKEN_GT; }
 	YY_BREAK
 case 24:
 YY_RULE_SETUP
+#line 54 "FormulaLexer.l"
+{ return TOKEN_GTEQ; }
+	YY_BREAK
+case 25:
+YY_RULE_SETUP
+#line 55 "FormulaLexer.l"
+{ return TOKEN_QUESTION; }
+	YY_BREAK
+case 26:
+YY_RULE_SETUP
 #line 56 "FormulaLexer.l"
+{ return TOKEN_COLON; }
+	YY_BREAK
+case 27:
+YY_RULE_SETUP
+#line 58 "FormulaLexer.l"
+{ return TOKEN_ERR; }
+	YY_BREAK
+case 28:
+YY_RULE_SETUP
+#line 60 "FormulaLexer.l"
 YY_FATAL_ERROR( "flex scanner jammed" );
 	YY_BREAK
-#line 918 "GeneratedFiles/FormulaLexer.c"
+#line 949 "GeneratedFiles/FormulaLexer.c"
 case YY_STATE_EOF(INITIAL):
 	yyterminate();
 
@@ -1209,7 +1240,7 @@ static int yy_get_next_buffer (yyscan_t yyscanner)
 		while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 			{
 			yy_current_state = (int) yy_def[yy_current_state];
-			if ( yy_current_state >= 40 )
+			if ( yy_current_state >= 44 )
 				yy_c = yy_meta[(unsigned int) yy_c];
 			}
 		yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
@@ -1238,11 +1269,11 @@ static int yy_get_next_buffer (yyscan_t yyscanner)
 	while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
 		{
 		yy_current_state = (int) yy_def[yy_current_state];
-		if ( yy_current_state >= 40 )
+		if ( yy_current_state >= 44 )
 			yy_c = yy_meta[(unsigned int) yy_c];
 		}
 	yy_current_state = yy_nxt[yy_base[yy_current_state] + (unsigned int) yy_c];
-	yy_is_jam = (yy_current_state == 39);
+	yy_is_jam = (yy_current_state == 43);
 
 	return yy_is_jam ? 0 : yy_current_state;
 }
@@ -2078,7 +2109,7 @@ void yyfree (void * ptr , yyscan_t yyscanner)
 
 #define YYTABLES_NAME "yytables"
 
-#line 56 "FormulaLexer.l"
+#line 60 "FormulaLexer.l"
 
 
  
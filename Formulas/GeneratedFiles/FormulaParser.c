@@ -401,20 +401,20 @@ union yyalloc
 /* YYFINAL -- State number of the termination state.  */
 #define YYFINAL  14
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   93
+#define YYLAST   131
 
 /* YYNTOKENS -- Number of terminals.  */
-#define YYNTOKENS  26
+#define YYNTOKENS  30
 /* YYNNTS -- Number of nonterminals.  */
-#define YYNNTS  3
+#define YYNNTS  4
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  23
+#define YYNRULES  27
 /* YYNRULES -- Number of states.  */
-#define YYNSTATES  42
+#define YYNSTATES  53
 
 /* YYTRANSLATE(YYLEX) -- Bison symbol number corresponding to YYLEX.  */
 #define YYUNDEFTOK  2
-#define YYMAXUTOK   280
+#define YYMAXUTOK   284
 
 #define YYTRANSLATE(YYX)						\
   ((unsigned int) (YYX) <= YYMAXUTOK ? yytranslate[YYX] : YYUNDEFTOK)
@@ -450,7 +450,7 @@ static const yytype_uint8 yytranslate[] =
        2,     2,     2,     2,     2,     2,     1,     2,     3,     4,
        5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
       15,    16,    17,    18,    19,    20,    21,    22,    23,    24,
-      25
+      25,    26,    27,    28,    29
 };
 
 #if YYDEBUG
@@ -459,29 +459,31 @@ static const yytype_uint8 yytranslate[] =
 static const yytype_uint8 yyprhs[] =
 {
        0,     0,     3,     5,     9,    13,    17,    21,    25,    29,
-      33,    36,    39,    43,    47,    51,    55,    59,    63,    67,
-      69,    71,    73,    75
+      33,    39,    42,    45,    49,    53,    57,    61,    65,    69,
+      75,    79,    81,    83,    85,    87,    89,    91
 };
 
 /* YYRHS -- A `-1'-separated list of the rules' RHS.  */
 static const yytype_int8 yyrhs[] =
 {
-      27,     0,    -1,    28,    -1,    28,    12,    28,    -1,    28,
-      11,    28,    -1,    28,    15,    28,    -1,    28,    14,    28,
-      -1,    28,    13,    28,    -1,    28,     4,    28,    -1,    28,
-       3,    28,    -1,    17,    28,    -1,    11,    28,    -1,    28,
-       6,    28,    -1,    28,     5,    28,    -1,    28,    10,    28,
-      -1,    28,     9,    28,    -1,    28,     8,    28,    -1,    28,
-       7,    28,    -1,    19,    28,    20,    -1,    24,    -1,    23,
-      -1,    25,    -1,    21,    -1,    22,    -1
+      31,     0,    -1,    32,    -1,    32,    15,    32,    -1,    32,
+      14,    32,    -1,    32,    18,    32,    -1,    32,    17,    32,
+      -1,    32,    16,    32,    -1,    32,     6,    32,    -1,    32,
+       5,    32,    -1,    32,     4,    32,     3,    32,    -1,    20,
+      32,    -1,    14,    32,    -1,    32,     9,    32,    -1,    32,
+       8,    32,    -1,    32,    13,    32,    -1,    32,    12,    32,
+      -1,    32,    11,    32,    -1,    32,    10,    32,    -1,    32,
+       7,    22,    33,    23,    -1,    22,    32,    23,    -1,    28,
+      -1,    27,    -1,    29,    -1,    25,    -1,    26,    -1,    32,
+      -1,    33,    24,    32,    -1
 };
 
 /* YYRLINE[YYN] -- source line where rule number YYN was defined.  */
 static const yytype_uint8 yyrline[] =
 {
-       0,    66,    66,    70,    71,    72,    73,    74,    75,    76,
-      77,    78,    79,    80,    81,    82,    83,    84,    85,    86,
-      87,    88,    89,    90
+       0,    68,    68,    72,    73,    74,    75,    76,    77,    78,
+      79,    80,    81,    82,    83,    84,    85,    86,    87,    88,
+      89,    90,    91,    92,    93,    94,    98,    99
 };
 #endif
 
@@ -490,12 +492,13 @@ static const yytype_uint8 yyrline[] =
    First, the terminals, then, starting at YYNTOKENS, nonterminals.  */
 static const char *const yytname[] =
 {
-  "$end", "error", "$undefined", "TOKEN_OR", "TOKEN_AND", "TOKEN_NEQ",
-  "TOKEN_EQ", "TOKEN_GTEQ", "TOKEN_GT", "TOKEN_LTEQ", "TOKEN_LT",
-  "TOKEN_MINUS", "TOKEN_PLUS", "TOKEN_PERCENT", "TOKEN_DIV", "TOKEN_MUL",
+  "$end", "error", "$undefined", "TOKEN_COLON", "TOKEN_QUESTION",
+  "TOKEN_OR", "TOKEN_AND", "TOKEN_IN", "TOKEN_NEQ", "TOKEN_EQ",
+  "TOKEN_GTEQ", "TOKEN_GT", "TOKEN_LTEQ", "TOKEN_LT", "TOKEN_MINUS",
+  "TOKEN_PLUS", "TOKEN_PERCENT", "TOKEN_DIV", "TOKEN_MUL",
   "TOKEN_UNARY_NEG", "TOKEN_NOT", "TOKEN_ERR", "TOKEN_LPAREN",
-  "TOKEN_RPAREN", "TOKEN_TRUE", "TOKEN_FALSE", "TOKEN_NAME",
-  "TOKEN_NUMBER", "TOKEN_ID", "$accept", "input", "expr", 0
+  "TOKEN_RPAREN", "TOKEN_COMMA", "TOKEN_TRUE", "TOKEN_FALSE", "TOKEN_NAME",
+  "TOKEN_NUMBER", "TOKEN_ID", "$accept", "input", "expr", "set_members", 0
 };
 #endif
 
@@ -506,24 +509,24 @@ static const yytype_uint16 yytoknum[] =
 {
        0,   256,   257,   258,   259,   260,   261,   262,   263,   264,
      265,   266,   267,   268,   269,   270,   271,   272,   273,   274,
-     275,   276,   277,   278,   279,   280
+     275,   276,   277,   278,   279,   280,   281,   282,   283,   284
 };
 # endif
 
 /* YYR1[YYN] -- Symbol number of symbol that rule YYN derives.  */
 static const yytype_uint8 yyr1[] =
 {
-       0,    26,    27,    28,    28,    28,    28,    28,    28,    28,
-      28,    28,    28,    28,    28,    28,    28,    28,    28,    28,
-      28,    28,    28,    28
+       0,    30,    31,    32,    32,    32,    32,    32,    32,    32,
+      32,    32,    32,    32,    32,    32,    32,    32,    32,    32,
+      32,    32,    32,    32,    32,    32,    33,    33
 };
 
 /* YYR2[YYN] -- Number of symbols composing right hand side of rule YYN.  */
 static const yytype_uint8 yyr2[] =
 {
        0,     2,     1,     3,     3,     3,     3,     3,     3,     3,
-       2,     2,     3,     3,     3,     3,     3,     3,     3,     1,
-       1,     1,     1,     1
+       5,     2,     2,     3,     3,     3,     3,     3,     3,     5,
+       3,     1,     1,     1,     1,     1,     1,     3
 };
 
 /* YYDEFACT[STATE-NAME] -- Default rule to reduce with in state
@@ -531,35 +534,37 @@ static const yytype_uint8 yyr2[] =
    means the default is an error.  */
 static const yytype_uint8 yydefact[] =
 {
-       0,     0,     0,     0,    22,    23,    20,    19,    21,     0,
-       2,    11,    10,     0,     1,     0,     0,     0,     0,     0,
-       0,     0,     0,     0,     0,     0,     0,     0,    18,     9,
-       8,    13,    12,    17,    16,    15,    14,     4,     3,     7,
-       6,     5
+       0,     0,     0,     0,    24,    25,    22,    21,    23,     0,
+       2,    12,    11,     0,     1,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+      20,     0,     9,     8,     0,    14,    13,    18,    17,    16,
+      15,     4,     3,     7,     6,     5,     0,    26,     0,    10,
+      19,     0,    27
 };
 
 /* YYDEFGOTO[NTERM-NUM].  */
 static const yytype_int8 yydefgoto[] =
 {
-      -1,     9,    10
+      -1,     9,    10,    48
 };
 
 /* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
    STATE-NUM.  */
-#define YYPACT_NINF -3
+#define YYPACT_NINF -12
 static const yytype_int8 yypact[] =
 {
-      29,    29,    29,    29,    -3,    -3,    -3,    -3,    -3,    45,
-      52,    -3,    -3,    24,    -3,    29,    29,    29,    29,    29,
-      29,    29,    29,    29,    29,    29,    29,    29,    -3,    64,
-      -2,    73,    73,    78,    78,    78,    78,    28,    28,    -3,
-      -3,    -3
+      15,    15,    15,    15,   -12,   -12,   -12,   -12,   -12,    17,
+      83,   -12,   -12,    47,   -12,    15,    15,    15,    12,    15,
+      15,    15,    15,    15,    15,    15,    15,    15,    15,    15,
+     -12,    68,    96,   108,    15,    -7,    -7,   113,   113,   113,
+     113,    14,    14,   -12,   -12,   -12,    15,    83,   -11,    83,
+     -12,    15,    83
 };
 
 /* YYPGOTO[NTERM-NUM].  */
 static const yytype_int8 yypgoto[] =
 {
-      -3,    -3,    -1
+     -12,   -12,    -1,   -12
 };
 
 /* YYTABLE[YYPACT[STATE-NUM]].  What to do in state STATE-NUM.  If
@@ -569,41 +574,50 @@ static const yytype_int8 yypgoto[] =
 #define YYTABLE_NINF -1
 static const yytype_uint8 yytable[] =
 {
-      11,    12,    13,    17,    18,    19,    20,    21,    22,    23,
-      24,    25,    26,    27,    29,    30,    31,    32,    33,    34,
-      35,    36,    37,    38,    39,    40,    41,    15,    16,    17,
+      11,    12,    13,    21,    22,    23,    24,    25,    26,    27,
+      28,    29,    50,    51,    31,    32,    33,    14,    35,    36,
+      37,    38,    39,    40,    41,    42,    43,    44,    45,     1,
+      27,    28,    29,    47,    34,     2,     0,     3,     0,     0,
+       4,     5,     6,     7,     8,    49,     0,     0,     0,     0,
+      52,    15,    16,    17,    18,    19,    20,    21,    22,    23,
+      24,    25,    26,    27,    28,    29,     0,     0,     0,     0,
+      30,    46,    15,    16,    17,    18,    19,    20,    21,    22,
+      23,    24,    25,    26,    27,    28,    29,    15,    16,    17,
       18,    19,    20,    21,    22,    23,    24,    25,    26,    27,
-       1,    25,    26,    27,    28,    14,     2,     0,     3,     0,
-       4,     5,     6,     7,     8,    15,    16,    17,    18,    19,
-      20,    21,    22,    23,    24,    25,    26,    27,    16,    17,
-      18,    19,    20,    21,    22,    23,    24,    25,    26,    27,
-      19,    20,    21,    22,    23,    24,    25,    26,    27,    23,
-      24,    25,    26,    27
+      28,    29,    17,    18,    19,    20,    21,    22,    23,    24,
+      25,    26,    27,    28,    29,    18,    19,    20,    21,    22,
+      23,    24,    25,    26,    27,    28,    29,    25,    26,    27,
+      28,    29
 };
 
 static const yytype_int8 yycheck[] =
 {
-       1,     2,     3,     5,     6,     7,     8,     9,    10,    11,
-      12,    13,    14,    15,    15,    16,    17,    18,    19,    20,
-      21,    22,    23,    24,    25,    26,    27,     3,     4,     5,
-       6,     7,     8,     9,    10,    11,    12,    13,    14,    15,
-      11,    13,    14,    15,    20,     0,    17,    -1,    19,    -1,
-      21,    22,    23,    24,    25,     3,     4,     5,     6,     7,
-       8,     9,    10,    11,    12,    13,    14,    15,     4,     5,
-       6,     7,     8,     9,    10,    11,    12,    13,    14,    15,
-       7,     8,     9,    10,    11,    12,    13,    14,    15,    11,
-      12,    13,    14,    15
+       1,     2,     3,    10,    11,    12,    13,    14,    15,    16,
+      17,    18,    23,    24,    15,    16,    17,     0,    19,    20,
+      21,    22,    23,    24,    25,    26,    27,    28,    29,    14,
+      16,    17,    18,    34,    22,    20,    -1,    22,    -1,    -1,
+      25,    26,    27,    28,    29,    46,    -1,    -1,    -1,    -1,
+      51,     4,     5,     6,     7,     8,     9,    10,    11,    12,
+      13,    14,    15,    16,    17,    18,    -1,    -1,    -1,    -1,
+      23,     3,     4,     5,     6,     7,     8,     9,    10,    11,
+      12,    13,    14,    15,    16,    17,    18,     4,     5,     6,
+       7,     8,     9,    10,    11,    12,    13,    14,    15,    16,
+      17,    18,     6,     7,     8,     9,    10,    11,    12,    13,
+      14,    15,    16,    17,    18,     7,     8,     9,    10,    11,
+      12,    13,    14,    15,    16,    17,    18,    14,    15,    16,
+      17,    18
 };
 
 /* YYSTOS[STATE-NUM] -- The (internal number of the) accessing
    symbol of state STATE-NUM.  */
 static const yytype_uint8 yystos[] =
 {
-       0,    11,    17,    19,    21,    22,    23,    24,    25,    27,
-      28,    28,    28,    28,     0,     3,     4,     5,     6,     7,
-       8,     9,    10,    11,    12,    13,    14,    15,    20,    28,
-      28,    28,    28,    28,    28,    28,    28,    28,    28,    28,
-      28,    28
+       0,    14,    20,    22,    25,    26,    27,    28,    29,    31,
+      32,    32,    32,    32,     0,     4,     5,     6,     7,     8,
+       9,    10,    11,    12,    13,    14,    15,    16,    17,    18,
+      23,    32,    32,    32,    22,    32,    32,    32,    32,    32,
+      32,    32,    32,    32,    32,    32,     3,    32,    33,    32,
+      23,    24,    32
 };
 
 #define yyerrok		(yyerrstatus = 0)
@@ -1429,161 +1443,189 @@ yyreduce:
         case 2:
 
 /* Line 1455 of yacc.c  */
-#line 66 "FormulaParser.y"
+#line 68 "FormulaParser.y"
     { *expression = (yyvsp[(1) - (1)].expression); ;}
     break;
 
   case 3:
 
 /* Line 1455 of yacc.c  */
-#line 70 "FormulaParser.y"
+#line 72 "FormulaParser.y"
     { (yyval.expression) = createNode( eASTNodeType::ARITH_ADD, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
     break;
 
   case 4:
 
 /* Line 1455 of yacc.c  */
-#line 71 "FormulaParser.y"
+#line 73 "FormulaParser.y"
     { (yyval.expression) = createNode( eASTNodeType::ARITH_SUB, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
     break;
 
   case 5:
 
 /* Line 1455 of yacc.c  */
-#line 72 "FormulaParser.y"
+#line 74 "FormulaParser.y"
     { (yyval.expression) = createNode( eASTNodeType::ARITH_MUL, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
     break;
 
   case 6:
 
 /* Line 1455 of yacc.c  */
-#line 73 "FormulaParser.y"
+#line 75 "FormulaParser.y"
     { (yyval.expression) = createNode( eASTNodeType::ARITH_DIV, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
     break;
 
   case 7:
 
 /* Line 1455 of yacc.c  */
-#line 74 "FormulaParser.y"
+#line 76 "FormulaParser.y"
     { (yyval.expression) = createNode( eASTNodeType::ARITH_MOD, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
     break;
 
   case 8:
 
 /* Line 1455 of yacc.c  */
-#line 75 "FormulaParser.y"
+#line 77 "FormulaParser.y"
     { (yyval.expression) = createNode( eASTNodeType::LOGICAL_AND, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
     break;
 
   case 9:
 
 /* Line 1455 of yacc.c  */
-#line 76 "FormulaParser.y"
+#line 78 "FormulaParser.y"
     { (yyval.expression) = createNode( eASTNodeType::LOGICAL_OR, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
     break;
 
   case 10:
 
 /* Line 1455 of yacc.c  */
-#line 77 "FormulaParser.y"
-    { (yyval.expression) = createNode( eASTNodeType::LOGICAL_NOT, (yyvsp[(2) - (2)].expression), nullptr ); ;}
+#line 79 "FormulaParser.y"
+    { (yyval.expression) = createSelectNode( (yyvsp[(1) - (5)].expression), (yyvsp[(3) - (5)].expression), (yyvsp[(5) - (5)].expression) ); ;}
     break;
 
   case 11:
 
 /* Line 1455 of yacc.c  */
-#line 78 "FormulaParser.y"
-    { (yyval.expression) = createNode( eASTNodeType::ARITH_SUB, createConstNode(0.f), (yyvsp[(2) - (2)].expression) ); ;}
+#line 80 "FormulaParser.y"
+    { (yyval.expression) = createNode( eASTNodeType::LOGICAL_NOT, (yyvsp[(2) - (2)].expression), nullptr ); ;}
     break;
 
   case 12:
 
 /* Line 1455 of yacc.c  */
-#line 79 "FormulaParser.y"
-    { (yyval.expression) = createNode( eASTNodeType::COMP_EQ, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
+#line 81 "FormulaParser.y"
+    { (yyval.expression) = createNode( eASTNodeType::ARITH_SUB, createConstNode(0.f), (yyvsp[(2) - (2)].expression) ); ;}
     break;
 
   case 13:
 
 /* Line 1455 of yacc.c  */
-#line 80 "FormulaParser.y"
-    { (yyval.expression) = createNode( eASTNodeType::COMP_NEQ, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
+#line 82 "FormulaParser.y"
+    { (yyval.expression) = createNode( eASTNodeType::COMP_EQ, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
     break;
 
   case 14:
 
 /* Line 1455 of yacc.c  */
-#line 81 "FormulaParser.y"
-    { (yyval.expression) = createNode( eASTNodeType::COMP_LT, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
+#line 83 "FormulaParser.y"
+    { (yyval.expression) = createNode( eASTNodeType::COMP_NEQ, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
     break;
 
   case 15:
 
 /* Line 1455 of yacc.c  */
-#line 82 "FormulaParser.y"
-    { (yyval.expression) = createNode( eASTNodeType::COMP_LTEQ, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
+#line 84 "FormulaParser.y"
+    { (yyval.expression) = createNode( eASTNodeType::COMP_LT, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
     break;
 
   case 16:
 
 /* Line 1455 of yacc.c  */
-#line 83 "FormulaParser.y"
-    { (yyval.expression) = createNode( eASTNodeType::COMP_GT, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
+#line 85 "FormulaParser.y"
+    { (yyval.expression) = createNode( eASTNodeType::COMP_LTEQ, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
     break;
 
   case 17:
 
 /* Line 1455 of yacc.c  */
-#line 84 "FormulaParser.y"
-    { (yyval.expression) = createNode( eASTNodeType::COMP_GTEQ, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
+#line 86 "FormulaParser.y"
+    { (yyval.expression) = createNode( eASTNodeType::COMP_GT, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
     break;
 
   case 18:
 
 /* Line 1455 of yacc.c  */
-#line 85 "FormulaParser.y"
-    { (yyval.expression) = (yyvsp[(2) - (3)].expression); ;}
+#line 87 "FormulaParser.y"
+    { (yyval.expression) = createNode( eASTNodeType::COMP_GTEQ, (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
     break;
 
   case 19:
 
 /* Line 1455 of yacc.c  */
-#line 86 "FormulaParser.y"
-    { (yyval.expression) = createConstNode((yyvsp[(1) - (1)].f_value)); ;}
+#line 88 "FormulaParser.y"
+    { (yyval.expression) = createInNode( (yyvsp[(1) - (5)].expression), (yyvsp[(4) - (5)].expression) ); ;}
     break;
 
   case 20:
 
 /* Line 1455 of yacc.c  */
-#line 87 "FormulaParser.y"
-    { (yyval.expression) = createConstNode((yyvsp[(1) - (1)].n_value)); free((void*)(yyvsp[(1) - (1)].n_value)); ;}
+#line 89 "FormulaParser.y"
+    { (yyval.expression) = (yyvsp[(2) - (3)].expression); ;}
     break;
 
   case 21:
 
 /* Line 1455 of yacc.c  */
-#line 88 "FormulaParser.y"
-    { (yyval.expression) = createIDNode((yyvsp[(1) - (1)].n_value)); free((void*)(yyvsp[(1) - (1)].n_value)); ;}
+#line 90 "FormulaParser.y"
+    { (yyval.expression) = createConstNode((yyvsp[(1) - (1)].f_value)); ;}
     break;
 
   case 22:
 
 /* Line 1455 of yacc.c  */
-#line 89 "FormulaParser.y"
-    { (yyval.expression) = createConstNode(true); ;}
+#line 91 "FormulaParser.y"
+    { (yyval.expression) = createConstNode((yyvsp[(1) - (1)].n_value)); free((void*)(yyvsp[(1) - (1)].n_value)); ;}
     break;
 
   case 23:
 
 /* Line 1455 of yacc.c  */
-#line 90 "FormulaParser.y"
+#line 92 "FormulaParser.y"
+    { (yyval.expression) = createIDNode((yyvsp[(1) - (1)].n_value)); free((void*)(yyvsp[(1) - (1)].n_value)); ;}
+    break;
+
+  case 24:
+
+/* Line 1455 of yacc.c  */
+#line 93 "FormulaParser.y"
+    { (yyval.expression) = createConstNode(true); ;}
+    break;
+
+  case 25:
+
+/* Line 1455 of yacc.c  */
+#line 94 "FormulaParser.y"
     { (yyval.expression) = createConstNode(false); ;}
     break;
 
+  case 26:
+
+/* Line 1455 of yacc.c  */
+#line 98 "FormulaParser.y"
+    { (yyval.expression) = createSetNode( (yyvsp[(1) - (1)].expression) ); ;}
+    break;
+
+  case 27:
+
+/* Line 1455 of yacc.c  */
+#line 99 "FormulaParser.y"
+    { (yyval.expression) = addSetMember( (yyvsp[(1) - (3)].expression), (yyvsp[(3) - (3)].expression) ); ;}
+    break;
+
 
 
 /* Line 1455 of yacc.c  */
-#line 1587 "GeneratedFiles/FormulaParser.c"
+#line 1629 "GeneratedFiles/FormulaParser.c"
       default: break;
     }
   YY_SYMBOL_PRINT ("-> $$ =", yyr1[yyn], &yyval, &yyloc);
@@ -1795,6 +1837,6 @@ yyreturn:
 
 
 /* Line 1675 of yacc.c  */
-#line 93 "FormulaParser.y"
+#line 102 "FormulaParser.y"
 
 
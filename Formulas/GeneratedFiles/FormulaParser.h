@@ -55,29 +55,33 @@ typedef void* yyscan_t;
    /* Put the tokens into the symbol table, so that GDB and other debuggers
       know about them.  */
    enum yytokentype {
-     TOKEN_OR = 258,
-     TOKEN_AND = 259,
-     TOKEN_NEQ = 260,
-     TOKEN_EQ = 261,
-     TOKEN_GTEQ = 262,
-     TOKEN_GT = 263,
-     TOKEN_LTEQ = 264,
-     TOKEN_LT = 265,
-     TOKEN_MINUS = 266,
-     TOKEN_PLUS = 267,
-     TOKEN_PERCENT = 268,
-     TOKEN_DIV = 269,
-     TOKEN_MUL = 270,
-     TOKEN_UNARY_NEG = 271,
-     TOKEN_NOT = 272,
-     TOKEN_ERR = 273,
-     TOKEN_LPAREN = 274,
-     TOKEN_RPAREN = 275,
-     TOKEN_TRUE = 276,
-     TOKEN_FALSE = 277,
-     TOKEN_NAME = 278,
-     TOKEN_NUMBER = 279,
-     TOKEN_ID = 280
+     TOKEN_COLON = 258,
+     TOKEN_QUESTION = 259,
+     TOKEN_OR = 260,
+     TOKEN_AND = 261,
+     TOKEN_IN = 262,
+     TOKEN_NEQ = 263,
+     TOKEN_EQ = 264,
+     TOKEN_GTEQ = 265,
+     TOKEN_GT = 266,
+     TOKEN_LTEQ = 267,
+     TOKEN_LT = 268,
+     TOKEN_MINUS = 269,
+     TOKEN_PLUS = 270,
+     TOKEN_PERCENT = 271,
+     TOKEN_DIV = 272,
+     TOKEN_MUL = 273,
+     TOKEN_UNARY_NEG = 274,
+     TOKEN_NOT = 275,
+     TOKEN_ERR = 276,
+     TOKEN_LPAREN = 277,
+     TOKEN_RPAREN = 278,
+     TOKEN_COMMA = 279,
+     TOKEN_TRUE = 280,
+     TOKEN_FALSE = 281,
+     TOKEN_NAME = 282,
+     TOKEN_NUMBER = 283,
+     TOKEN_ID = 284
    };
 #endif
 
@@ -97,7 +101,7 @@ typedef union YYSTYPE
 
 
 /* Line 1676 of yacc.c  */
-#line 101 "GeneratedFiles/FormulaParser.h"
+#line 105 "GeneratedFiles/FormulaParser.h"
 } YYSTYPE;
 # define YYSTYPE_IS_TRIVIAL 1
 # define yystype YYSTYPE /* obsolescent; will be withdrawn */
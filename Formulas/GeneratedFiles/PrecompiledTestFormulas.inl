@@ -0,0 +1,210 @@
+/*
+ * Precompiled expressions, see ExpressionPrecompiled.h. Generated by the precompiler from its spec
+ * at build time - edit the spec rather than this.
+ */
+
+// NumA * NumB + NumC / 4
+static const uint32_t precompiledArithmetic_byteCode[] =
+{
+	0x003a0000u, 0x00000001u, 0x00360001u, 0x00000002u, 0x00100000u, 0x00000001u,
+};
+static const uint32_t precompiledArithmetic_constFloats[] =
+{
+	0x3e800000u,
+};
+static const ExpressionPrecompiledVariable precompiledArithmetic_inputs[] =
+{
+	{ "NumA", eExpType::NUMBER, 0, 0xff800000u, 0x7f800000u, false }, { "NumB", eExpType::NUMBER, 1, 0xff800000u, 0x7f800000u, false }, { "NumC", eExpType::NUMBER, 2, 0xff800000u, 0x7f800000u, false },
+};
+static const ExpressionPrecompiled precompiledArithmetic =
+{
+	"NumA * NumB + NumC / 4",
+	545, eExpType::NUMBER, 2, false,
+	precompiledArithmetic_byteCode, 6,
+	precompiledArithmetic_constFloats, 1,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	precompiledArithmetic_inputs, 3,
+};
+
+// NumA > NumC && NameC == 'C' || NameD != 'D'
+static const uint32_t precompiledCondition_byteCode[] =
+{
+	0x014a0000u, 0x00000002u, 0x02100000u, 0x00000002u, 0x00e60001u, 0x00000000u, 0x00a00000u, 0x00000001u,
+	0x02200000u, 0x00000002u, 0x00f60001u, 0x00010002u, 0x00b00000u, 0x00000001u,
+};
+static const char* const precompiledCondition_constNames[] =
+{
+	"C", "D",
+};
+static const ExpressionPrecompiledVariable precompiledCondition_inputs[] =
+{
+	{ "NumA", eExpType::NUMBER, 0, 0xff800000u, 0x7f800000u, false }, { "NumC", eExpType::NUMBER, 2, 0xff800000u, 0x7f800000u, false }, { "NameC", eExpType::NAME, 0, 0xff800000u, 0x7f800000u, false }, { "NameD", eExpType::NAME, 2, 0xff800000u, 0x7f800000u, false },
+};
+static const ExpressionPrecompiled precompiledCondition =
+{
+	"NumA > NumC && NameC == 'C' || NameD != 'D'",
+	545, eExpType::BOOL, 2, false,
+	precompiledCondition_byteCode, 14,
+	nullptr, 0,
+	precompiledCondition_constNames, 2,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	precompiledCondition_inputs, 4,
+};
+
+// NameD in ('A', 'B', 'C', 'D', 'E') && NameC2 != NameC
+static const uint32_t precompiledNameSet_byteCode[] =
+{
+	0x01890000u, 0x00020000u, 0x02100000u, 0x00000002u, 0x00fa0001u, 0x00010000u, 0x00a00000u, 0x00000001u,
+};
+static const ExpressionSet precompiledNameSet_constSets[] =
+{
+	{ 0, 5 },
+};
+static const char* const precompiledNameSet_setNames[] =
+{
+	"B", "A", "C", "E", "D",
+};
+static const ExpressionPrecompiledVariable precompiledNameSet_inputs[] =
+{
+	{ "NameC", eExpType::NAME, 0, 0xff800000u, 0x7f800000u, false }, { "NameC2", eExpType::NAME, 1, 0xff800000u, 0x7f800000u, false }, { "NameD", eExpType::NAME, 2, 0xff800000u, 0x7f800000u, false },
+};
+static const ExpressionPrecompiled precompiledNameSet =
+{
+	"NameD in ('A', 'B', 'C', 'D', 'E') && NameC2 != NameC",
+	545, eExpType::BOOL, 2, false,
+	precompiledNameSet_byteCode, 8,
+	nullptr, 0,
+	nullptr, 0,
+	precompiledNameSet_constSets, 1,
+	nullptr, 0,
+	precompiledNameSet_setNames, 5,
+	nullptr, 0,
+	precompiledNameSet_inputs, 3,
+};
+
+// NumB in (-3, 1, 7) ? NumA % 3 : NumC
+static const uint32_t precompiledNumberSet_byteCode[] =
+{
+	0x01790000u, 0x00010000u, 0x00790001u, 0x00000000u, 0x01f20000u, 0x00010002u,
+};
+static const uint32_t precompiledNumberSet_constFloats[] =
+{
+	0x40400000u,
+};
+static const ExpressionSet precompiledNumberSet_constSets[] =
+{
+	{ 0, 3 },
+};
+static const uint32_t precompiledNumberSet_setFloats[] =
+{
+	0xc0400000u, 0x3f800000u, 0x40e00000u,
+};
+static const ExpressionPrecompiledVariable precompiledNumberSet_inputs[] =
+{
+	{ "NumA", eExpType::NUMBER, 0, 0xff800000u, 0x7f800000u, false }, { "NumB", eExpType::NUMBER, 1, 0xff800000u, 0x7f800000u, false }, { "NumC", eExpType::NUMBER, 2, 0xff800000u, 0x7f800000u, false },
+};
+static const ExpressionPrecompiled precompiledNumberSet =
+{
+	"NumB in (-3, 1, 7) ? NumA % 3 : NumC",
+	545, eExpType::NUMBER, 2, false,
+	precompiledNumberSet_byteCode, 6,
+	precompiledNumberSet_constFloats, 1,
+	nullptr, 0,
+	precompiledNumberSet_constSets, 1,
+	precompiledNumberSet_setFloats, 3,
+	nullptr, 0,
+	nullptr, 0,
+	precompiledNumberSet_inputs, 3,
+};
+
+// NumA >= 1 && NumA < NumPos
+static const uint32_t precompiledRange_byteCode[] =
+{
+	0x01a90000u, 0x00000000u,
+};
+static const uint32_t precompiledRange_constFloats[] =
+{
+	0x3f800000u,
+};
+static const ExpressionRange precompiledRange_constRanges[] =
+{
+	{ 0, 3, false, true },
+};
+static const ExpressionPrecompiledVariable precompiledRange_inputs[] =
+{
+	{ "NumA", eExpType::NUMBER, 0, 0xff800000u, 0x7f800000u, false }, { "NumPos", eExpType::NUMBER, 3, 0x3f800000u, 0x42c80000u, false },
+};
+static const ExpressionPrecompiled precompiledRange =
+{
+	"NumA >= 1 && NumA < NumPos",
+	545, eExpType::BOOL, 1, false,
+	precompiledRange_byteCode, 2,
+	precompiledRange_constFloats, 1,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	precompiledRange_constRanges, 1,
+	precompiledRange_inputs, 2,
+};
+
+// 10 / NumPos + NumA / NumC
+static const uint32_t precompiledDivide_byteCode[] =
+{
+	0x00660000u, 0x00000003u, 0x004a0001u, 0x00000002u, 0x00100000u, 0x00000001u,
+};
+static const uint32_t precompiledDivide_constFloats[] =
+{
+	0x41200000u,
+};
+static const ExpressionPrecompiledVariable precompiledDivide_inputs[] =
+{
+	{ "NumA", eExpType::NUMBER, 0, 0xff800000u, 0x7f800000u, false }, { "NumC", eExpType::NUMBER, 2, 0xff800000u, 0x7f800000u, false }, { "NumPos", eExpType::NUMBER, 3, 0x3f800000u, 0x42c80000u, false },
+};
+static const ExpressionPrecompiled precompiledDivide =
+{
+	"10 / NumPos + NumA / NumC",
+	545, eExpType::NUMBER, 2, false,
+	precompiledDivide_byteCode, 6,
+	precompiledDivide_constFloats, 1,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	precompiledDivide_inputs, 3,
+};
+
+// NumPos * 0.1 + 0.3 > NumA - 0.7
+static const uint32_t precompiledInexact_byteCode[] =
+{
+	0x00360000u, 0x00000003u, 0x00140000u, 0x00010000u, 0x00290001u, 0x00000002u, 0x01400000u, 0x00000001u,
+};
+static const uint32_t precompiledInexact_constFloats[] =
+{
+	0x3dcccccdu, 0x3e99999au, 0x3f333333u,
+};
+static const ExpressionPrecompiledVariable precompiledInexact_inputs[] =
+{
+	{ "NumA", eExpType::NUMBER, 0, 0xff800000u, 0x7f800000u, false }, { "NumPos", eExpType::NUMBER, 3, 0x3f800000u, 0x42c80000u, false },
+};
+static const ExpressionPrecompiled precompiledInexact =
+{
+	"NumPos * 0.1 + 0.3 > NumA - 0.7",
+	545, eExpType::BOOL, 2, false,
+	precompiledInexact_byteCode, 8,
+	precompiledInexact_constFloats, 3,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	nullptr, 0,
+	precompiledInexact_inputs, 2,
+};
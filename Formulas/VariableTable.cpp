@@ -0,0 +1,206 @@
+/*
+ * VariableTable.cpp
+ *
+ */
+
+#include "stdafx.h"
+
+#include "VariableTable.h"
+#include "ExpressionClosure.h"
+
+
+/*
+ * VariableTable
+ */
+
+VariableTable::VariableTable(const VariableLayout* _layout, Name _initName, float _initNumber)
+	: layout(_layout)
+	, initName(_initName)
+{
+	assert(layout != nullptr);
+
+	numberColumns.resize(layout->getNumberCount());
+
+	initNumbers.resize(layout->getNumberCount());
+	for (ExpressionSlotIndex slotIndex = 0; slotIndex < initNumbers.size(); ++slotIndex)
+	{
+		initNumbers[slotIndex] = layout->getRange(slotIndex).clamp(_initNumber);
+	}
+	nameColumns.resize(layout->getNameCount());
+
+	allDerived.resize(layout->getDerivedCount());
+	for (uint32_t i = 0; i < allDerived.size(); ++i)
+	{
+		allDerived[i] = i;
+	}
+}
+
+void VariableTable::reserve(uint32_t rowCount)
+{
+	for (std::vector<float>& column : numberColumns)
+	{
+		column.reserve(rowCount);
+	}
+
+	for (std::vector<Name>& column : nameColumns)
+	{
+		column.reserve(rowCount);
+	}
+
+	rowHandles.reserve(rowCount);
+	handles.reserve(rowCount);
+}
+
+VariableRowHandle VariableTable::addRow()
+{
+	// the layout must not grow once rows exist
+	assert(numberColumns.size() == layout->getNumberCount());
+	assert(nameColumns.size() == layout->getNameCount());
+
+	uint32_t handleIndex;
+	if (freeHandles.empty())
+	{
+		handleIndex = static_cast<uint32_t>(handles.size());
+		HandleInfo info = { 0, 0 };
+		handles.push_back(info);
+	}
+	else
+	{
+		handleIndex = freeHandles.back();
+		freeHandles.pop_back();
+	}
+
+	const uint32_t row = getRowCount();
+	handles[handleIndex].row = row;
+	rowHandles.push_back(handleIndex);
+
+	for (size_t slotIndex = 0; slotIndex < numberColumns.size(); ++slotIndex)
+	{
+		numberColumns[slotIndex].push_back(initNumbers[slotIndex]);
+	}
+
+	for (std::vector<Name>& column : nameColumns)
+	{
+		column.push_back(initName);
+	}
+
+	if (!allDerived.empty())
+	{
+		computeDerived(row, allDerived);
+	}
+
+	VariableRowHandle handle = { handleIndex, handles[handleIndex].generation };
+	return handle;
+}
+
+void VariableTable::computeDerived(uint32_t row, const std::vector<uint32_t>& derivedIndices)
+{
+	// the closure code reads a VariablePack's layout, so the row is gathered into one first
+	rowNumbers.resize(numberColumns.size());
+	rowNames.resize(nameColumns.size());
+
+	for (size_t slotIndex = 0; slotIndex < numberColumns.size(); ++slotIndex)
+	{
+		rowNumbers[slotIndex] = numberColumns[slotIndex][row];
+	}
+
+	for (size_t slotIndex = 0; slotIndex < nameColumns.size(); ++slotIndex)
+	{
+		rowNames[slotIndex] = nameColumns[slotIndex][row];
+	}
+
+	for (uint32_t derivedIndex : derivedIndices)
+	{
+		const VariableLayout::DerivedVariable& derived = layout->getDerived(derivedIndex);
+
+		// compiled with ieeeDivide, so a zero divisor still gives a value
+		bool divideByZero(false);
+		const float value = derived.expression->closureCode->run(rowNumbers.data(), rowNames.data(), divideByZero);
+
+		rowNumbers[derived.slotIndex] = value;
+		numberColumns[derived.slotIndex][row] = value;
+	}
+}
+
+void VariableTable::removeRow(VariableRowHandle handle)
+{
+	assert(isValid(handle));
+
+	const uint32_t row = handles[handle.index].row;
+	const uint32_t lastRow = getRowCount() - 1;
+
+	if (row != lastRow)
+	{
+		for (std::vector<float>& column : numberColumns)
+		{
+			column[row] = column[lastRow];
+		}
+
+		for (std::vector<Name>& column : nameColumns)
+		{
+			column[row] = column[lastRow];
+		}
+
+		const uint32_t movedHandleIndex = rowHandles[lastRow];
+		rowHandles[row] = movedHandleIndex;
+		handles[movedHandleIndex].row = row;
+	}
+
+	for (std::vector<float>& column : numberColumns)
+	{
+		column.pop_back();
+	}
+
+	for (std::vector<Name>& column : nameColumns)
+	{
+		column.pop_back();
+	}
+
+	rowHandles.pop_back();
+
+	handles[handle.index].row = UINT32_MAX;
+	handles[handle.index].generation += 1;
+	freeHandles.push_back(handle.index);
+}
+
+
+/*
+ * VariableTableRow
+ */
+
+void VariableTableRow::copyTo(VariablePack& pack) const
+{
+	assert(pack.getLayout() == getLayout());
+
+	// the pack works its derived variables out for itself
+	for (ExpressionSlotIndex i = 0; i < getLayout()->getNumberCount(); ++i)
+	{
+		if (!getLayout()->isDerived(i))
+		{
+			pack.setVariable(i, getVariableNumber(i));
+		}
+	}
+
+	for (ExpressionSlotIndex i = 0; i < getLayout()->getNameCount(); ++i)
+	{
+		pack.setVariable(i, getVariableName(i));
+	}
+}
+
+void VariableTableRow::copyFrom(const VariablePack& pack)
+{
+	assert(pack.getLayout() == getLayout());
+
+	// the pack's derived variables are already worked out from the values being copied
+	const uint32_t row = table->getRowIndex(handle);
+
+	for (ExpressionSlotIndex i = 0; i < getLayout()->getNumberCount(); ++i)
+	{
+		table->getNumberColumn(i)[row] = pack.getVariableNumber(i);
+	}
+
+	for (ExpressionSlotIndex i = 0; i < getLayout()->getNameCount(); ++i)
+	{
+		table->getNameColumn(i)[row] = pack.getVariableName(i);
+	}
+}
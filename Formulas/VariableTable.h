@@ -0,0 +1,252 @@
+/*
+ * VariableTable.h
+ * Structure-of-arrays storage for the variables of many entities sharing one VariableLayout.
+ *
+ * Each variable slot is stored as one contiguous column with an entry per row, so a table of 100k
+ * entities costs one allocation per slot rather than two per entity, and code sweeping one variable
+ * across all entities reads dense memory. Rows are kept packed: removing a row moves the last row
+ * into its place. Row handles stay valid across that move, dense row indices do not.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Expression.h"
+
+
+/*
+ * VariableRowHandle
+ */
+
+struct VariableRowHandle
+{
+	uint32_t index;
+	uint32_t generation;	// bumped each time the handle index is recycled, so stale handles are detected
+
+	bool operator==(const VariableRowHandle& rhs) const { return index == rhs.index && generation == rhs.generation; }
+	bool operator!=(const VariableRowHandle& rhs) const { return !(*this == rhs); }
+};
+
+static const VariableRowHandle invalidVariableRowHandle = { UINT32_MAX, 0 };
+
+
+class VariableTableRow;
+
+/*
+ * VariableTable
+ */
+
+class VariableTable
+{
+	struct HandleInfo
+	{
+		uint32_t row;
+		uint32_t generation;
+	};
+
+	const VariableLayout* layout;
+	Name initName;
+	std::vector<float> initNumbers;		// per number slot, the initial number moved into the slot's range
+
+	std::vector<std::vector<float>> numberColumns;
+	std::vector<std::vector<Name>> nameColumns;
+
+	std::vector<HandleInfo> handles;		// indexed by handle index, row is UINT32_MAX for free handles
+	std::vector<uint32_t> rowHandles;		// indexed by row, the handle index owning the row
+	std::vector<uint32_t> freeHandles;
+
+	std::vector<uint32_t> allDerived;		// every derived variable of the layout, in the order to compute them
+	std::vector<float> rowNumbers;			// one row gathered like a VariablePack, for computing its derived variables
+	std::vector<Name> rowNames;
+
+	friend class VariableTableRow;
+	void computeDerived(uint32_t row, const std::vector<uint32_t>& derivedIndices);
+
+public:
+	VariableTable(const VariableLayout* _layout, Name _initName, float _initNumber);
+
+	const VariableLayout* getLayout() const { return layout; }
+
+	void reserve(uint32_t rowCount);
+
+	// new rows are filled with the initial values the table was created with, and their derived variables worked out from those
+	VariableRowHandle addRow();
+	// moves the last row into the removed row's place
+	void removeRow(VariableRowHandle handle);
+
+	bool isValid(VariableRowHandle handle) const;
+	uint32_t getRowCount() const { return static_cast<uint32_t>(rowHandles.size()); }
+	uint32_t getRowIndex(VariableRowHandle handle) const;
+	VariableRowHandle getRowHandle(uint32_t rowIndex) const;
+
+	VariableTableRow getRow(VariableRowHandle handle);
+
+	// columns hold getRowCount() entries and move when rows are added. Writing through them leaves derived
+	// variables as they were, unlike writing through a VariableTableRow
+	float* getNumberColumn(ExpressionSlotIndex slotIndex);
+	const float* getNumberColumn(ExpressionSlotIndex slotIndex) const;
+	Name* getNameColumn(ExpressionSlotIndex slotIndex);
+	const Name* getNameColumn(ExpressionSlotIndex slotIndex) const;
+};
+
+
+/*
+ * VariableTableRow - a view of one row with the same accessors as VariablePack
+ *
+ * Like a VariablePack, writing a variable works out again the derived variables that depend on it, so
+ * the table's derived columns can be read like any other.
+ */
+
+class VariableTableRow
+{
+	VariableTable* table;
+	VariableRowHandle handle;
+
+public:
+	VariableTableRow(VariableTable* _table, VariableRowHandle _handle);
+
+	const VariableLayout* getLayout() const { return table->getLayout(); }
+	VariableRowHandle getHandle() const { return handle; }
+
+	void setVariable(Name variableName, Name value);
+	void setVariable(Name variableName, float value);
+	void setVariable(ExpressionSlotIndex slotIndex, Name value);
+	void setVariable(ExpressionSlotIndex slotIndex, float value);
+
+	Name getVariableName(Name variableName) const;
+	float getVariableNumber(Name variableName) const;
+	Name getVariableName(ExpressionSlotIndex slotIndex) const;
+	float getVariableNumber(ExpressionSlotIndex slotIndex) const;
+
+	// for code that still takes a VariablePack
+	void copyTo(VariablePack& pack) const;
+	void copyFrom(const VariablePack& pack);
+};
+
+
+/*
+ * VariableTable
+ */
+
+inline bool VariableTable::isValid(VariableRowHandle handle) const
+{
+	return handle.index < handles.size() &&
+		handles[handle.index].generation == handle.generation &&
+		handles[handle.index].row != UINT32_MAX;
+}
+
+inline uint32_t VariableTable::getRowIndex(VariableRowHandle handle) const
+{
+	assert(isValid(handle));
+	return handles[handle.index].row;
+}
+
+inline VariableRowHandle VariableTable::getRowHandle(uint32_t rowIndex) const
+{
+	assert(rowIndex < rowHandles.size());
+	const uint32_t handleIndex = rowHandles[rowIndex];
+
+	VariableRowHandle handle = { handleIndex, handles[handleIndex].generation };
+	return handle;
+}
+
+inline VariableTableRow VariableTable::getRow(VariableRowHandle handle)
+{
+	assert(isValid(handle));
+	return VariableTableRow(this, handle);
+}
+
+inline float* VariableTable::getNumberColumn(ExpressionSlotIndex slotIndex)
+{
+	assert(slotIndex < numberColumns.size());
+	return numberColumns[slotIndex].data();
+}
+
+inline const float* VariableTable::getNumberColumn(ExpressionSlotIndex slotIndex) const
+{
+	assert(slotIndex < numberColumns.size());
+	return numberColumns[slotIndex].data();
+}
+
+inline Name* VariableTable::getNameColumn(ExpressionSlotIndex slotIndex)
+{
+	assert(slotIndex < nameColumns.size());
+	return nameColumns[slotIndex].data();
+}
+
+inline const Name* VariableTable::getNameColumn(ExpressionSlotIndex slotIndex) const
+{
+	assert(slotIndex < nameColumns.size());
+	return nameColumns[slotIndex].data();
+}
+
+
+/*
+ * VariableTableRow
+ */
+
+inline VariableTableRow::VariableTableRow(VariableTable* _table, VariableRowHandle _handle)
+	: table(_table)
+	, handle(_handle)
+{
+	assert(table != nullptr);
+}
+
+inline void VariableTableRow::setVariable(Name variableName, Name value)
+{
+	setVariable(getLayout()->getIndex(variableName), value);
+}
+
+inline void VariableTableRow::setVariable(Name variableName, float value)
+{
+	setVariable(getLayout()->getIndex(variableName), value);
+}
+
+inline void VariableTableRow::setVariable(ExpressionSlotIndex slotIndex, Name value)
+{
+	const uint32_t row = table->getRowIndex(handle);
+	table->getNameColumn(slotIndex)[row] = value;
+
+	const std::vector<uint32_t>& dependents = getLayout()->getNameDependents(slotIndex);
+	if (!dependents.empty())
+	{
+		table->computeDerived(row, dependents);
+	}
+}
+
+inline void VariableTableRow::setVariable(ExpressionSlotIndex slotIndex, float value)
+{
+	assert(!getLayout()->isDerived(slotIndex));
+	assert(getLayout()->getRange(slotIndex).contains(value));
+
+	const uint32_t row = table->getRowIndex(handle);
+	table->getNumberColumn(slotIndex)[row] = value;
+
+	const std::vector<uint32_t>& dependents = getLayout()->getNumberDependents(slotIndex);
+	if (!dependents.empty())
+	{
+		table->computeDerived(row, dependents);
+	}
+}
+
+inline Name VariableTableRow::getVariableName(Name variableName) const
+{
+	return getVariableName(getLayout()->getIndex(variableName));
+}
+
+inline float VariableTableRow::getVariableNumber(Name variableName) const
+{
+	return getVariableNumber(getLayout()->getIndex(variableName));
+}
+
+inline Name VariableTableRow::getVariableName(ExpressionSlotIndex slotIndex) const
+{
+	return table->getNameColumn(slotIndex)[table->getRowIndex(handle)];
+}
+
+inline float VariableTableRow::getVariableNumber(ExpressionSlotIndex slotIndex) const
+{
+	return table->getNumberColumn(slotIndex)[table->getRowIndex(handle)];
+}
@@ -4,9 +4,11 @@
 #include "stdafx.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "ExpressionTests.h"
+#include "ExpressionBenchmarks.h"
 
  
 int main(int argc, char* argv[])
@@ -16,5 +18,15 @@ int main(int argc, char* argv[])
 		return runExpressionTests();
 	}
 
+	if (argc >= 2 && _stricmp(argv[1], "bench") == 0)
+	{
+		return runExpressionBenchmarks();
+	}
+
+	if (argc >= 2 && _stricmp(argv[1], "superinstructions") == 0)
+	{
+		return generateSuperinstructions(argc >= 3 ? static_cast<uint32_t>(atoi(argv[2])) : 32);
+	}
+
     return 10;
 }
\ No newline at end of file
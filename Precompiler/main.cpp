@@ -0,0 +1,51 @@
+// main.cpp : the precompiler, which turns a spec of formulas into tables to build in - see ExpressionPrecompiled.h.
+//
+// It is built from the same engine sources as the projects that load its tables, so the tables always match
+// the VM. Formulas and BehaviourTree run it over their specs ahead of compiling.
+
+#include "stdafx.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "ExpressionPrecompiled.h"
+
+
+int main(int argc, char* argv[])
+{
+	if (argc != 3)
+	{
+		std::cerr << "usage: " << argv[0] << " <spec> <output .inl>" << std::endl;
+		return -1;
+	}
+
+	std::ifstream spec(argv[1]);
+	if (!spec)
+	{
+		std::cerr << argv[1] << " : error : can't open" << std::endl;
+		return -1;
+	}
+
+	// the output is only written once every formula has compiled, so a failed run leaves no half-written tables
+	ExpressionErrorReporter errors;
+	std::ostringstream tables;
+	if (!writePrecompiledExpressions(spec, tables, errors))
+	{
+		for (uint32_t errorIndex = 0; errorIndex < errors.errorCount(); ++errorIndex)
+		{
+			std::cerr << argv[1] << " : error : " << errors.error(errorIndex).message << std::endl;
+		}
+		return -1;
+	}
+
+	std::ofstream out(argv[2], std::ios::binary);
+	out << tables.str();
+	if (!out.flush())
+	{
+		std::cerr << argv[2] << " : error : can't write" << std::endl;
+		return -1;
+	}
+
+	return 0;
+}